@@ -0,0 +1,631 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/inotify.h>
+#include <xcb/xcb.h>
+#include <xcb/xproto.h>
+#include <xcb/xfixes.h>
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+
+/**************************************************************************************************
+ * BENCHMARK CONFIGURATION SECTION ****************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Property used by the synthetic requestor to receive pasted data.
+ */
+#define BENCH_PROP_NAME         "NGXX_FUS_CLIPBOARD_BENCH_PROP"
+
+/**
+ * @brief Largest property write of the synthetic owner (bytes); bigger payloads are sent with INCR.
+ * @note Mirrors what common toolkits do, so captures exercise both single-shot and INCR.
+ */
+#define BENCH_OWNER_CHUNK       (256U * 1024U)
+
+/**
+ * @brief Pause (ms) between the last capture of a row and the first injection (history push settles).
+ */
+#define BENCH_SETTLE_MS         100
+
+/**
+ * @brief Payload sizes exercised, in bytes (filtered by the max-size argument).
+ */
+static const size_t BenchSizes[] = {
+    100U,
+    4U * 1024U,
+    64U * 1024U,
+    1U * 1024U * 1024U,
+    16U * 1024U * 1024U,
+    100U * 1024U * 1024U,
+    1024U * 1024U * 1024U
+};
+
+#define BENCH_SIZE_COUNT        (sizeof(BenchSizes) / sizeof(BenchSizes[0]))
+
+/**************************************************************************************************
+ * BENCHMARK STATE SECTION ************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Synthetic clipboard owner: serves one payload to the daemon (capture path).
+ */
+typedef struct {
+    const uint8_t      *Data;           /// Payload offered, NULL when not owning
+    size_t              Len;            /// Payload size in bytes
+    xcb_atom_t          Type;           /// Target announced in TARGETS
+    xcb_window_t        Requestor;      /// Window the transfer goes to
+    xcb_atom_t          Property;       /// Requestor property the transfer goes through
+    size_t              Offset;         /// Bytes already staged
+    int                 Busy;           /// 1 while a transfer is in flight
+    int                 SentEof;        /// 1 once the last write (full payload or 0-byte chunk) is staged
+    int                 Done;           /// 1 once the daemon consumed the last write
+} sBenchOwner;
+
+/**
+ * @brief Synthetic requestor: pastes the daemon's current item (provide path).
+ */
+typedef struct {
+    const uint8_t      *Expect;         /// Bytes the daemon should hand back
+    size_t              Len;            /// Expected size in bytes
+    size_t              Received;       /// Bytes received so far
+    int                 Incr;           /// 1 if the daemon answered with INCR
+    int                 Mismatch;       /// 1 if the data differs from Expect
+    int                 Failed;         /// 1 if the daemon refused the request
+    int                 Done;           /// 1 once the transfer ended
+} sBenchReader;
+
+/**
+ * @brief Latency samples and resource usage of one benchmark row.
+ */
+typedef struct {
+    double             *Ms;             /// Latency samples in milliseconds
+    int                 Count;          /// Number of successful samples
+    int                 Failed;         /// Number of failed repetitions
+    double              CpuSec;         /// Daemon CPU time consumed during the row
+    double              PeakRssMb;      /// Daemon peak RSS after the row
+    const char         *Mode;           /// "single", "incr" or "mixed"
+} sBenchRow;
+
+static xcb_connection_t *Conn;
+static xcb_window_t      Win;
+static xcb_atom_t        AtomClipboard, AtomTargets, AtomIncr, AtomUtf8, AtomPng, AtomBenchProp;
+static uint8_t           XFixesEventBase;
+static int               InotifyFd = -1;
+static pid_t             DaemonPid;
+
+static sBenchOwner       Owner;
+static sBenchReader      Reader;
+static int               OwnerChanged;  /// Set when someone else claims CLIPBOARD
+static int               StoredItems;   /// Items the daemon finished writing to disk
+static int               StoreTarget;   /// StoredItems value the current capture waits for
+static int               StoreReached;  /// Set once StoredItems reaches StoreTarget
+
+/**************************************************************************************************
+ * HELPER FUNCTIONS SECTION ***********************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Returns a monotonic timestamp in milliseconds.
+ */
+static double NowMs(void) {
+    struct timespec Ts;
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (double)Ts.tv_sec * 1000.0 + (double)Ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Interns an atom (blocking round trip).
+ */
+static xcb_atom_t InternAtom(const char *Name) {
+    xcb_intern_atom_reply_t *R = xcb_intern_atom_reply(Conn, xcb_intern_atom(Conn, 0, strlen(Name), Name), NULL);
+    xcb_atom_t Atom = R ? R->atom : XCB_ATOM_NONE;
+    free(R);
+    return Atom;
+}
+
+/**
+ * @brief Reads the daemon's CPU time (user + system) in seconds from /proc.
+ */
+static double ReadDaemonCpuSec(void) {
+    char Path[64], Buf[1024];
+    snprintf(Path, sizeof(Path), "/proc/%d/stat", (int)DaemonPid);
+    FILE *F = fopen(Path, "r");
+    if (!F) return 0.0;
+    size_t N = fread(Buf, 1, sizeof(Buf) - 1, F);
+    fclose(F);
+    Buf[N] = '\0';
+
+    /// Fields after the command name (which may contain spaces): state is field 3, utime 14, stime 15
+    char *P = strrchr(Buf, ')');
+    unsigned long long UTime = 0, STime = 0;
+    if (!P || sscanf(P + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &UTime, &STime) != 2) return 0.0;
+    return (double)(UTime + STime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+/**
+ * @brief Reads the daemon's peak resident set size (VmHWM) in megabytes from /proc.
+ */
+static double ReadDaemonPeakRssMb(void) {
+    char Path[64], Line[256];
+    snprintf(Path, sizeof(Path), "/proc/%d/status", (int)DaemonPid);
+    FILE *F = fopen(Path, "r");
+    if (!F) return 0.0;
+    unsigned long long Kb = 0;
+    while (fgets(Line, sizeof(Line), F)) {
+        if (sscanf(Line, "VmHWM: %llu kB", &Kb) == 1) break;
+    }
+    fclose(F);
+    return (double)Kb / 1024.0;
+}
+
+/**
+ * @brief Fills a payload of the given type with realistic content (compressible text / noisy image).
+ */
+static void FillPayload(uint8_t *Data, size_t Len, int IsImage) {
+    static const uint8_t PngMagic[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    static const char Words[] = "clipboard capture provider benchmark payload lorem ipsum dolor sit amet\n";
+    uint64_t X = 0x9E3779B97F4A7C15ULL;
+
+    for (size_t i = 0; i < Len; i++) {
+        if (IsImage) {
+            X ^= X << 13; X ^= X >> 7; X ^= X << 17;
+            Data[i] = (uint8_t)X;
+        } else {
+            Data[i] = (uint8_t)Words[i % (sizeof(Words) - 1)];
+        }
+    }
+    if (IsImage) memcpy(Data, PngMagic, (Len < sizeof(PngMagic)) ? Len : sizeof(PngMagic));
+}
+
+/**
+ * @brief Writes a unique tag near the start of the payload so the daemon never deduplicates it.
+ */
+static void StampPayload(uint8_t *Data, size_t Len, int IsImage, unsigned Serial) {
+    char Tag[24];
+    int TagLen = snprintf(Tag, sizeof(Tag), "#%08x#", Serial);
+    size_t At = IsImage ? 8 : 0;
+    if (At + (size_t)TagLen <= Len) memcpy(Data + At, Tag, TagLen);
+}
+
+/**
+ * @brief Formats a byte count as a short human readable string.
+ */
+static const char *FormatSize(size_t Bytes, char *Out, size_t OutLen) {
+    if (Bytes >= 1024U * 1024U * 1024U) snprintf(Out, OutLen, "%zuG", Bytes / (1024U * 1024U * 1024U));
+    else if (Bytes >= 1024U * 1024U) snprintf(Out, OutLen, "%zuM", Bytes / (1024U * 1024U));
+    else if (Bytes >= 1024U) snprintf(Out, OutLen, "%zuK", Bytes / 1024U);
+    else snprintf(Out, OutLen, "%zuB", Bytes);
+    return Out;
+}
+
+/**
+ * @brief Qsort comparator for latency samples.
+ */
+static int CompareDouble(const void *a, const void *b) {
+    double A = *(const double *)a, B = *(const double *)b;
+    return (A > B) - (A < B);
+}
+
+/**
+ * @brief Nearest-rank percentile of a sorted sample array.
+ */
+static double Percentile(const double *Sorted, int Count, double P) {
+    if (Count <= 0) return 0.0;
+    int Rank = (int)((P / 100.0) * Count + 0.999999);
+    if (Rank < 1) Rank = 1;
+    if (Rank > Count) Rank = Count;
+    return Sorted[Rank - 1];
+}
+
+/**
+ * @brief Number of repetitions for a payload size (large payloads are expensive to repeat).
+ */
+static int RepsForSize(size_t Len) {
+    if (Len <= 64U * 1024U) return 50;
+    if (Len <= 16U * 1024U * 1024U) return 10;
+    return 2;
+}
+
+/**
+ * @brief Per-operation timeout: 10s plus enough time for 20MB/s.
+ */
+static double TimeoutForSize(size_t Len) {
+    return 10000.0 + (double)Len / (20.0 * 1024.0);
+}
+
+/**************************************************************************************************
+ * EVENT HANDLING SECTION *************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Answers a SelectionNotify to a requestor.
+ */
+static void SendSelectionNotify(xcb_selection_request_event_t *Req, xcb_atom_t Property) {
+    xcb_selection_notify_event_t Ev;
+    memset(&Ev, 0, sizeof(Ev));
+    Ev.response_type = XCB_SELECTION_NOTIFY;
+    Ev.time = Req->time;
+    Ev.requestor = Req->requestor;
+    Ev.selection = Req->selection;
+    Ev.target = Req->target;
+    Ev.property = Property;
+    xcb_send_event(Conn, 0, Req->requestor, XCB_EVENT_MASK_NO_EVENT, (const char *)&Ev);
+}
+
+/**
+ * @brief Serves the daemon's requests for the payload we own (TARGETS, then the data).
+ */
+static void HandleSelectionRequest(xcb_selection_request_event_t *Req) {
+    xcb_atom_t Property = (Req->property != XCB_ATOM_NONE) ? Req->property : Req->target;
+
+    if (!Owner.Data || Req->selection != AtomClipboard) {
+        SendSelectionNotify(Req, XCB_ATOM_NONE);
+    }
+    else if (Req->target == AtomTargets) {
+        xcb_atom_t Targets[2] = { AtomTargets, Owner.Type };
+        xcb_change_property(Conn, XCB_PROP_MODE_REPLACE, Req->requestor, Property, XCB_ATOM_ATOM, 32, 2, Targets);
+        SendSelectionNotify(Req, Property);
+    }
+    else if (Req->target == Owner.Type) {
+        uint32_t Mask[] = { XCB_EVENT_MASK_PROPERTY_CHANGE };
+        xcb_change_window_attributes(Conn, Req->requestor, XCB_CW_EVENT_MASK, Mask);
+
+        Owner.Requestor = Req->requestor;
+        Owner.Property = Property;
+        Owner.Busy = 1;
+        if (Owner.Len <= BENCH_OWNER_CHUNK) {
+            xcb_change_property(Conn, XCB_PROP_MODE_REPLACE, Req->requestor, Property, Owner.Type, 8, Owner.Len, Owner.Data);
+            Owner.Offset = Owner.Len;
+            Owner.SentEof = 1;
+        } else {
+            uint32_t Total = (uint32_t)Owner.Len;
+            xcb_change_property(Conn, XCB_PROP_MODE_REPLACE, Req->requestor, Property, AtomIncr, 32, 1, &Total);
+            Owner.Offset = 0;
+            Owner.SentEof = 0;
+        }
+        SendSelectionNotify(Req, Property);
+    }
+    else {
+        SendSelectionNotify(Req, XCB_ATOM_NONE);
+    }
+}
+
+/**
+ * @brief Checks received bytes against the expected payload.
+ */
+static void ReaderConsume(const uint8_t *Data, size_t Len) {
+    if (Reader.Received + Len > Reader.Len || memcmp(Reader.Expect + Reader.Received, Data, Len) != 0) {
+        Reader.Mismatch = 1;
+    }
+    Reader.Received += Len;
+}
+
+/**
+ * @brief Reads (and deletes) the bench property; returns the reply or NULL.
+ */
+static xcb_get_property_reply_t *ReadBenchProperty(void) {
+    xcb_get_property_cookie_t Ck = xcb_get_property(Conn, 1, Win, AtomBenchProp, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT32_MAX / 4);
+    return xcb_get_property_reply(Conn, Ck, NULL);
+}
+
+/**
+ * @brief Handles the daemon's answer to our paste request.
+ */
+static void HandleSelectionNotify(xcb_selection_notify_event_t *Ev) {
+    if (Ev->property == XCB_ATOM_NONE) {
+        Reader.Failed = 1;
+        Reader.Done = 1;
+        return;
+    }
+    xcb_get_property_reply_t *R = ReadBenchProperty();
+    if (!R) {
+        Reader.Failed = 1;
+        Reader.Done = 1;
+        return;
+    }
+    if (R->type == AtomIncr) {
+        /// Deleting the INCR property (done by the read) asks the owner for the first chunk
+        Reader.Incr = 1;
+    } else {
+        ReaderConsume(xcb_get_property_value(R), xcb_get_property_value_length(R));
+        Reader.Done = 1;
+    }
+    free(R);
+}
+
+/**
+ * @brief Drives both INCR directions: owner chunks consumed, requestor chunks arriving.
+ */
+static void HandlePropertyNotify(xcb_property_notify_event_t *Ev) {
+    if (Owner.Busy && Ev->window == Owner.Requestor && Ev->atom == Owner.Property && Ev->state == XCB_PROPERTY_DELETE) {
+        if (Owner.SentEof) {
+            Owner.Busy = 0;
+            Owner.Done = 1;
+            return;
+        }
+        size_t Left = Owner.Len - Owner.Offset;
+        size_t Chunk = (Left > BENCH_OWNER_CHUNK) ? BENCH_OWNER_CHUNK : Left;
+        xcb_change_property(Conn, XCB_PROP_MODE_REPLACE, Owner.Requestor, Owner.Property, Owner.Type, 8, Chunk, Owner.Data + Owner.Offset);
+        Owner.Offset += Chunk;
+        if (Chunk == 0) Owner.SentEof = 1;
+    }
+    else if (Reader.Incr && !Reader.Done && Ev->window == Win && Ev->atom == AtomBenchProp && Ev->state == XCB_PROPERTY_NEW_VALUE) {
+        xcb_get_property_reply_t *R = ReadBenchProperty();
+        if (!R) {
+            Reader.Failed = 1;
+            Reader.Done = 1;
+            return;
+        }
+        int Len = xcb_get_property_value_length(R);
+        if (Len > 0) ReaderConsume(xcb_get_property_value(R), Len);
+        else Reader.Done = 1;
+        free(R);
+    }
+}
+
+/**
+ * @brief Dispatches one X event.
+ */
+static void DispatchEvent(xcb_generic_event_t *Ev) {
+    uint8_t Type = Ev->response_type & ~0x80;
+
+    if (Type == XCB_SELECTION_REQUEST) HandleSelectionRequest((xcb_selection_request_event_t *)Ev);
+    else if (Type == XCB_SELECTION_NOTIFY) HandleSelectionNotify((xcb_selection_notify_event_t *)Ev);
+    else if (Type == XCB_PROPERTY_NOTIFY) HandlePropertyNotify((xcb_property_notify_event_t *)Ev);
+    else if (Type == XFixesEventBase + XCB_XFIXES_SELECTION_NOTIFY) {
+        xcb_xfixes_selection_notify_event_t *Fx = (xcb_xfixes_selection_notify_event_t *)Ev;
+        if (Fx->owner != Win && Fx->owner != XCB_NONE) OwnerChanged = 1;
+    }
+}
+
+/**
+ * @brief Counts items the daemon closed after writing (sidecars and hidden temp files excluded).
+ */
+static void DrainInotify(void) {
+    char Buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t N;
+    while ((N = read(InotifyFd, Buf, sizeof(Buf))) > 0) {
+        for (char *P = Buf; P < Buf + N; ) {
+            struct inotify_event *Ie = (struct inotify_event *)P;
+            size_t NameLen = Ie->len ? strlen(Ie->name) : 0;
+            int IsSidecar = (NameLen > 3 && strcmp(Ie->name + NameLen - 3, ".mt") == 0);
+            if ((Ie->mask & IN_CLOSE_WRITE) && NameLen > 0 && Ie->name[0] != '.' && !IsSidecar) StoredItems++;
+            P += sizeof(struct inotify_event) + Ie->len;
+        }
+    }
+    if (StoredItems >= StoreTarget) StoreReached = 1;
+}
+
+/**
+ * @brief Pumps X and inotify events until *Flag becomes non-zero or the deadline passes.
+ * @return OKE if the flag was raised, ERR_TIMEOUT on timeout, ERR if the X connection broke.
+ */
+static RetType WaitFor(volatile int *Flag, double DeadlineMs) {
+    while (!*Flag) {
+        xcb_generic_event_t *Ev;
+        while (!*Flag && (Ev = xcb_poll_for_event(Conn)) != NULL) {
+            DispatchEvent(Ev);
+            free(Ev);
+        }
+        if (xcb_connection_has_error(Conn)) return ERR;
+        DrainInotify();
+        if (*Flag) break;
+
+        double Left = DeadlineMs - NowMs();
+        if (Left <= 0) return ERR_TIMEOUT;
+        xcb_flush(Conn);
+
+        struct pollfd Fds[2] = {
+            { .fd = xcb_get_file_descriptor(Conn), .events = POLLIN },
+            { .fd = InotifyFd, .events = POLLIN },
+        };
+        poll(Fds, 2, (int)Left + 1);
+    }
+    return OKE;
+}
+
+/**************************************************************************************************
+ * BENCHMARK SECTION ******************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Copies a payload R times: the daemon captures it, latency runs until the item is on disk.
+ */
+static void BenchCapture(uint8_t *Data, size_t Len, xcb_atom_t Type, int IsImage, int Reps, unsigned *Serial, sBenchRow *Row) {
+    double Cpu0 = ReadDaemonCpuSec();
+    for (int i = 0; i < Reps; i++) {
+        StampPayload(Data, Len, IsImage, (*Serial)++);
+        memset(&Owner, 0, sizeof(Owner));
+        Owner.Data = Data;
+        Owner.Len = Len;
+        Owner.Type = Type;
+        StoreTarget = StoredItems + 1;
+        StoreReached = 0;
+
+        double T0 = NowMs();
+        double Deadline = T0 + TimeoutForSize(Len);
+        xcb_set_selection_owner(Conn, Win, AtomClipboard, XCB_CURRENT_TIME);
+        xcb_flush(Conn);
+
+        /// Done once the daemon consumed the last write and its writer closed the stored file
+        if (WaitFor(&Owner.Done, Deadline) == OKE && WaitFor(&StoreReached, Deadline) == OKE) {
+            Row->Ms[Row->Count++] = NowMs() - T0;
+        } else {
+            Row->Failed++;
+        }
+    }
+    Row->CpuSec = ReadDaemonCpuSec() - Cpu0;
+    Row->PeakRssMb = ReadDaemonPeakRssMb();
+    Row->Mode = (Len <= BENCH_OWNER_CHUNK) ? "single" : "incr";
+    Owner.Data = NULL;
+}
+
+/**
+ * @brief Injects the newest item R times (SIGUSR2) and pastes it back after each injection.
+ */
+static void BenchProvide(const uint8_t *Data, size_t Len, xcb_atom_t Type, int Reps, sBenchRow *Inject, sBenchRow *Paste) {
+    int SawSingle = 0, SawIncr = 0;
+    double Cpu0 = ReadDaemonCpuSec();
+
+    usleep(BENCH_SETTLE_MS * 1000U);
+    for (int i = 0; i < Reps; i++) {
+        OwnerChanged = 0;
+        double T0 = NowMs();
+        double Deadline = T0 + TimeoutForSize(Len);
+        kill(DaemonPid, SIGUSR2);
+        if (WaitFor(&OwnerChanged, Deadline) != OKE) {
+            Inject->Failed++;
+            Paste->Failed++;
+            continue;
+        }
+        Inject->Ms[Inject->Count++] = NowMs() - T0;
+
+        memset(&Reader, 0, sizeof(Reader));
+        Reader.Expect = Data;
+        Reader.Len = Len;
+        T0 = NowMs();
+        Deadline = T0 + TimeoutForSize(Len);
+        xcb_convert_selection(Conn, Win, AtomClipboard, Type, AtomBenchProp, XCB_CURRENT_TIME);
+        xcb_flush(Conn);
+
+        if (WaitFor(&Reader.Done, Deadline) == OKE && !Reader.Failed && !Reader.Mismatch && Reader.Received == Len) {
+            Paste->Ms[Paste->Count++] = NowMs() - T0;
+            if (Reader.Incr) SawIncr = 1;
+            else SawSingle = 1;
+        } else {
+            Paste->Failed++;
+        }
+    }
+    Paste->CpuSec = ReadDaemonCpuSec() - Cpu0;
+    Paste->PeakRssMb = Inject->PeakRssMb = ReadDaemonPeakRssMb();
+    Inject->CpuSec = -1.0;
+    Inject->Mode = "-";
+    Paste->Mode = (SawSingle && SawIncr) ? "mixed" : SawIncr ? "incr" : "single";
+}
+
+/**
+ * @brief Prints one report line.
+ */
+static void PrintRow(const char *Op, const char *TypeName, size_t Len, sBenchRow *Row) {
+    char SizeStr[16], CpuStr[16];
+    double Total = 0.0;
+    qsort(Row->Ms, Row->Count, sizeof(double), CompareDouble);
+    for (int i = 0; i < Row->Count; i++) Total += Row->Ms[i];
+
+    double MBps = (Total > 0.0) ? ((double)Len * Row->Count / (1024.0 * 1024.0)) / (Total / 1000.0) : 0.0;
+    if (Row->CpuSec < 0) snprintf(CpuStr, sizeof(CpuStr), "-");
+    else snprintf(CpuStr, sizeof(CpuStr), "%.2f", Row->CpuSec);
+
+    printf("%-8s %-5s %6s %-7s %4d %4d %9.2f %9.2f %9.2f %9.2f %9.1f %8s %9.1f\n",
+           Op, TypeName, FormatSize(Len, SizeStr, sizeof(SizeStr)), Row->Mode, Row->Count, Row->Failed,
+           Percentile(Row->Ms, Row->Count, 50), Percentile(Row->Ms, Row->Count, 90),
+           Percentile(Row->Ms, Row->Count, 99), Percentile(Row->Ms, Row->Count, 100),
+           MBps, CpuStr, Row->PeakRssMb);
+    fflush(stdout);
+}
+
+/**************************************************************************************************
+ * MAIN SECTION ***********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Synthetic owner/requestor driving a running daemon through copy and paste cycles.
+ * @note Usage: CBC_Bench <daemon-pid> <db-dir> [max-size-bytes]
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <daemon-pid> <db-dir> [max-size-bytes]\n", argv[0]);
+        return 2;
+    }
+    DaemonPid = (pid_t)atoi(argv[1]);
+    size_t MaxSize = (argc > 3) ? (size_t)strtoull(argv[3], NULL, 0) : BenchSizes[BENCH_SIZE_COUNT - 1];
+
+    Conn = xcb_connect(NULL, NULL);
+    if (xcb_connection_has_error(Conn)) {
+        fprintf(stderr, "Cannot connect to the X server.\n");
+        return 2;
+    }
+    xcb_screen_t *Screen = xcb_setup_roots_iterator(xcb_get_setup(Conn)).data;
+    Win = xcb_generate_id(Conn);
+    uint32_t Mask[] = { XCB_EVENT_MASK_PROPERTY_CHANGE };
+    xcb_create_window(Conn, XCB_COPY_FROM_PARENT, Win, Screen->root, 0, 0, 1, 1, 0,
+                      XCB_WINDOW_CLASS_INPUT_ONLY, Screen->root_visual, XCB_CW_EVENT_MASK, Mask);
+
+    AtomClipboard = InternAtom("CLIPBOARD");
+    AtomTargets   = InternAtom("TARGETS");
+    AtomIncr      = InternAtom("INCR");
+    AtomUtf8      = InternAtom("UTF8_STRING");
+    AtomPng       = InternAtom("image/png");
+    AtomBenchProp = InternAtom(BENCH_PROP_NAME);
+
+    const xcb_query_extension_reply_t *Ext = xcb_get_extension_data(Conn, &xcb_xfixes_id);
+    if (!Ext || !Ext->present) {
+        fprintf(stderr, "XFixes is not available.\n");
+        return 2;
+    }
+    XFixesEventBase = Ext->first_event;
+    free(xcb_xfixes_query_version_reply(Conn, xcb_xfixes_query_version(Conn, 5, 0), NULL));
+    xcb_xfixes_select_selection_input(Conn, Win, AtomClipboard, XCB_XFIXES_SELECTION_EVENT_MASK_SET_SELECTION_OWNER);
+    xcb_flush(Conn);
+
+    InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (InotifyFd < 0 || inotify_add_watch(InotifyFd, argv[2], IN_CLOSE_WRITE) < 0) {
+        fprintf(stderr, "Cannot watch %s.\n", argv[2]);
+        return 2;
+    }
+
+    printf("%-8s %-5s %6s %-7s %4s %4s %9s %9s %9s %9s %9s %8s %9s\n",
+           "op", "type", "size", "mode", "ok", "fail", "p50(ms)", "p90(ms)", "p99(ms)", "max(ms)", "MB/s", "cpu(s)", "rss(MB)");
+
+    int Failures = 0;
+    unsigned Serial = (unsigned)time(NULL);
+    for (int IsImage = 0; IsImage <= 1; IsImage++) {
+        xcb_atom_t Type = IsImage ? AtomPng : AtomUtf8;
+        const char *TypeName = IsImage ? "png" : "text";
+
+        for (size_t s = 0; s < BENCH_SIZE_COUNT && BenchSizes[s] <= MaxSize; s++) {
+            size_t Len = BenchSizes[s];
+            int Reps = RepsForSize(Len);
+            uint8_t *Data = malloc(Len);
+            double *Samples = calloc(3 * (size_t)Reps, sizeof(double));
+            if (!Data || !Samples) {
+                fprintf(stderr, "Out of memory for %zu bytes.\n", Len);
+                free(Data);
+                free(Samples);
+                Failures++;
+                continue;
+            }
+            FillPayload(Data, Len, IsImage);
+
+            sBenchRow Capture = { .Ms = Samples };
+            sBenchRow Inject  = { .Ms = Samples + Reps };
+            sBenchRow Paste   = { .Ms = Samples + 2 * Reps };
+            BenchCapture(Data, Len, Type, IsImage, Reps, &Serial, &Capture);
+            PrintRow("capture", TypeName, Len, &Capture);
+
+            /// The newest history item now holds the last stamped payload
+            BenchProvide(Data, Len, Type, Reps, &Inject, &Paste);
+            PrintRow("inject", TypeName, Len, &Inject);
+            PrintRow("paste", TypeName, Len, &Paste);
+
+            Failures += Capture.Failed + Inject.Failed + Paste.Failed;
+            free(Samples);
+            free(Data);
+        }
+    }
+
+    close(InotifyFd);
+    xcb_disconnect(Conn);
+    return (Failures == 0) ? 0 : 1;
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
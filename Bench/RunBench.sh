@@ -0,0 +1,79 @@
+#!/bin/sh
+# ==============================================================================
+# Capture/provide throughput benchmark
+# Starts a private Xvfb, runs the daemon against a temporary PATH_DIR_ROOT and
+# drives it with the synthetic owner/requestor client (CBC_Bench).
+#
+# Usage: RunBench.sh <daemon-bin> <bench-bin> <root-dir> [max-size-bytes]
+# ==============================================================================
+
+DAEMON_BIN=$1
+BENCH_BIN=$2
+ROOT_DIR=$3
+MAX_SIZE=${4:-1073741824}
+
+if [ -z "$DAEMON_BIN" ] || [ -z "$BENCH_BIN" ] || [ -z "$ROOT_DIR" ]; then
+    echo "Usage: $0 <daemon-bin> <bench-bin> <root-dir> [max-size-bytes]"
+    exit 2
+fi
+
+if ! command -v Xvfb >/dev/null 2>&1; then
+    echo ">>> Xvfb not found (install xvfb / xorg-server-xvfb)."
+    exit 2
+fi
+
+XVFB_PID=""
+DAEMON_PID=""
+
+cleanup() {
+    [ -n "$DAEMON_PID" ] && kill -INT "$DAEMON_PID" 2>/dev/null && wait "$DAEMON_PID" 2>/dev/null
+    [ -n "$XVFB_PID" ] && kill "$XVFB_PID" 2>/dev/null && wait "$XVFB_PID" 2>/dev/null
+    rm -rf "$ROOT_DIR"
+}
+trap cleanup EXIT INT TERM
+
+# --- Private X server on the first free display ---
+DISPLAY_NUM=99
+while [ -e "/tmp/.X11-unix/X$DISPLAY_NUM" ] || [ -e "/tmp/.X$DISPLAY_NUM-lock" ]; do
+    DISPLAY_NUM=$((DISPLAY_NUM + 1))
+done
+
+Xvfb ":$DISPLAY_NUM" -nolisten tcp -screen 0 640x480x24 >/dev/null 2>&1 &
+XVFB_PID=$!
+
+TRIES=0
+while [ ! -e "/tmp/.X11-unix/X$DISPLAY_NUM" ]; do
+    TRIES=$((TRIES + 1))
+    if [ $TRIES -gt 50 ]; then
+        echo ">>> Xvfb did not start."
+        exit 1
+    fi
+    sleep 0.1
+done
+export DISPLAY=":$DISPLAY_NUM"
+
+# --- Daemon on a clean temporary root ---
+rm -rf "$ROOT_DIR"
+"$DAEMON_BIN" >/dev/null 2>&1 &
+DAEMON_PID=$!
+
+TRIES=0
+while [ ! -d "$ROOT_DIR/DBs" ]; do
+    TRIES=$((TRIES + 1))
+    if [ $TRIES -gt 50 ] || ! kill -0 "$DAEMON_PID" 2>/dev/null; then
+        echo ">>> Daemon did not start."
+        exit 1
+    fi
+    sleep 0.1
+done
+# Let the receiver finish its X11 setup before the first copy
+sleep 0.2
+
+echo ">>> Benchmark on $DISPLAY, root $ROOT_DIR, sizes up to $MAX_SIZE bytes"
+"$BENCH_BIN" "$DAEMON_PID" "$ROOT_DIR/DBs" "$MAX_SIZE"
+STATUS=$?
+
+if [ $STATUS -ne 0 ]; then
+    echo ">>> Benchmark finished with failures (status $STATUS)."
+fi
+exit $STATUS
@@ -0,0 +1,654 @@
+#define _GNU_SOURCE
+#include "CBC_CaptureSink.h"
+#include "CBC_MemBudget.h"
+#include "CBC_Codec.h"
+#include "CBC_Flavour.h"
+#include "CBC_Segment.h"
+#include "CBC_Preview.h"
+#include "CBC_Thumb.h"
+#include "CBC_Search.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+
+/**************************************************************************************************
+ * INTERNAL TYPES SECTION *************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Operations handed from the X thread to the writer thread.
+ */
+enum eSinkOpType {
+    eSINK_OP_OPEN = 0,
+    eSINK_OP_HINT,
+    eSINK_OP_DATA,
+    eSINK_OP_FLAVOURS,
+    eSINK_OP_COMMIT,
+    eSINK_OP_ABORT
+};
+
+/**
+ * @brief A single queued writer operation.
+ */
+typedef struct {
+    enum eSinkOpType    Type;
+    int                 BufIdx;                 /// Staging buffer index (eSINK_OP_DATA only)
+    size_t              SizeHint;               /// Preallocation hint (eSINK_OP_OPEN / eSINK_OP_HINT)
+    sFlavourSet        *Flavours;               /// Extra targets handed over (eSINK_OP_FLAVOURS only)
+    char                Filename[NAME_MAX + 1]; /// Target filename (eSINK_OP_OPEN only)
+} sSinkOp;
+
+/**
+ * @brief A rotating staging buffer.
+ */
+typedef struct {
+    uint8_t            *Data;
+    size_t              Len;
+} sSinkBuffer;
+
+/**
+ * @brief Writer-side state of the capture currently being persisted.
+ */
+typedef struct {
+    int                 Fd;                     /// Output descriptor, -1 when no capture is open
+    int                 Buffered;               /// 1 while a small text payload is held in Small (no file yet)
+    uint8_t            *Small;                  /// SEGMENT_ITEM_MAX bytes for the segment store, allocated once
+    int                 Started;                /// 1 once the codec owns Fd (first slice seen)
+    int                 Failed;                 /// Sticky I/O error flag
+    size_t              Written;                /// Decoded payload bytes persisted so far
+    size_t              SizeHint;               /// Expected payload size (0 = unknown)
+    uLong               Crc, Adler;             /// Incremental content hash of the payload
+    int                 IsText;                 /// 1 if the payload gets a menu preview
+    sPreviewBuilder     Preview;                /// Menu preview and line count, built as slices arrive
+    sSearchBuilder      Search;                 /// Trigrams of the text payload, built as slices arrive
+    sCodecWriter        Codec;                  /// Raw or deflate stream writer
+    sFlavourSet        *Flavours;               /// Extra targets saved beside the item on commit
+    char                Filename[NAME_MAX + 1]; /// Target filename inside PATH_DIR_DB
+} sSinkOutput;
+
+/**************************************************************************************************
+ * INTERNAL DATA SECTION **************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Pool of staging buffers. Memory is taken from the MemBudget lazily and returned when idle.
+ */
+static sSinkBuffer      SinkBuffers[SINK_BUFFER_COUNT];
+
+/**
+ * @brief Stack of buffer indices currently available to the producer.
+ */
+static int              SinkFreeStack[SINK_BUFFER_COUNT];
+
+/**
+ * @brief Number of valid entries inside SinkFreeStack.
+ */
+static int              SinkFreeCount = 0;
+
+/**
+ * @brief Ring queue of pending writer operations.
+ */
+static sSinkOp          SinkQueue[SINK_QUEUE_LEN];
+
+/**
+ * @brief Read position, write position and fill level of SinkQueue.
+ */
+static int              SinkQueueHead = 0, SinkQueueTail = 0, SinkQueueCount = 0;
+
+/**
+ * @brief Mutex protecting the buffer pool and the operation queue.
+ */
+static pthread_mutex_t  SinkMutex       = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Signalled when a new operation is queued (wakes the writer).
+ */
+static pthread_cond_t   SinkCondWork    = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief Signalled when a buffer or queue slot is released (wakes the producer).
+ */
+static pthread_cond_t   SinkCondSpace   = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief Set to 1 to ask the writer thread to exit once the queue is drained.
+ */
+static int              SinkStopReq     = 0;
+
+/**
+ * @brief Set to 1 while the writer thread is alive.
+ */
+static int              SinkRunning     = 0;
+
+/**
+ * @brief Thread handle of the writer.
+ */
+static pthread_t        SinkWriterThread;
+
+/**
+ * @brief Producer-side state: 1 if a capture is open (owned by the X thread).
+ */
+static int              ProdIsOpen      = 0;
+
+/**
+ * @brief Producer-side state: index of the buffer currently being filled, or -1.
+ */
+static int              ProdBufIdx      = -1;
+
+/**************************************************************************************************
+ * INTERNAL HELPERS *******************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Pushes an operation into the queue, waiting for a free slot if needed.
+ * @param Op The operation to enqueue (copied).
+ */
+static void Internal_Enqueue(const sSinkOp *Op) {
+    pthread_mutex_lock(&SinkMutex);
+    while (SinkQueueCount >= SINK_QUEUE_LEN) {
+        pthread_cond_wait(&SinkCondSpace, &SinkMutex);
+    }
+    SinkQueue[SinkQueueTail] = *Op;
+    SinkQueueTail = (SinkQueueTail + 1) % SINK_QUEUE_LEN;
+    SinkQueueCount++;
+    pthread_cond_signal(&SinkCondWork);
+    pthread_mutex_unlock(&SinkMutex);
+}
+
+/**
+ * @brief Returns a staging buffer to the free stack.
+ * @param BufIdx The index of the buffer to release.
+ */
+static void Internal_ReleaseBuffer(int BufIdx) {
+    pthread_mutex_lock(&SinkMutex);
+    SinkBuffers[BufIdx].Len = 0;
+    SinkFreeStack[SinkFreeCount++] = BufIdx;
+    pthread_cond_signal(&SinkCondSpace);
+    pthread_mutex_unlock(&SinkMutex);
+}
+
+/**
+ * @brief Takes a staging buffer from the free stack, waiting for the writer if all are in flight.
+ * @return The buffer index, or -1 if the buffer memory cannot be allocated.
+ */
+static int Internal_AcquireBuffer(void) {
+    pthread_mutex_lock(&SinkMutex);
+    while (SinkFreeCount == 0) {
+        pthread_cond_wait(&SinkCondSpace, &SinkMutex);
+    }
+    int BufIdx = SinkFreeStack[--SinkFreeCount];
+    pthread_mutex_unlock(&SinkMutex);
+
+    if (SinkBuffers[BufIdx].Data == NULL) {
+        SinkBuffers[BufIdx].Data = MemBudget_Alloc(SINK_BUFFER_SIZE);
+        if (SinkBuffers[BufIdx].Data == NULL) {
+            xError("[CaptureSink] Memory budget exhausted for staging buffer!");
+            Internal_ReleaseBuffer(BufIdx);
+            return -1;
+        }
+    }
+    SinkBuffers[BufIdx].Len = 0;
+    return BufIdx;
+}
+
+/**
+ * @brief Gives the memory of every idle staging buffer back to the OS.
+ * @note Buffers sitting in the free stack are owned by nobody, so they can be unmapped safely.
+ */
+static void Internal_ReleaseIdleBuffers(void) {
+    pthread_mutex_lock(&SinkMutex);
+    for (int i = 0; i < SinkFreeCount; i++) {
+        int BufIdx = SinkFreeStack[i];
+        MemBudget_Free(SinkBuffers[BufIdx].Data);
+        SinkBuffers[BufIdx].Data = NULL;
+    }
+    pthread_mutex_unlock(&SinkMutex);
+    MemBudget_Trim();
+}
+
+/**
+ * @brief Hands the buffer currently being filled to the writer (or drops it if empty).
+ */
+static void Internal_SubmitCurrentBuffer(void) {
+    if (ProdBufIdx < 0) return;
+
+    if (SinkBuffers[ProdBufIdx].Len == 0) {
+        Internal_ReleaseBuffer(ProdBufIdx);
+    } else {
+        sSinkOp Op = { .Type = eSINK_OP_DATA, .BufIdx = ProdBufIdx };
+        Internal_Enqueue(&Op);
+    }
+    ProdBufIdx = -1;
+}
+
+/**
+ * @brief Reserves disk blocks for the expected payload without changing the visible file size.
+ * @param Fd The open file descriptor.
+ * @param SizeHint Expected payload size in bytes.
+ * @note Failure is harmless (e.g., filesystems without fallocate support) and silently ignored.
+ */
+static void Internal_Preallocate(int Fd, size_t SizeHint) {
+    if (Fd < 0 || SizeHint == 0) return;
+    if (fallocate(Fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)SizeHint) != 0) {
+        xLog1("[CaptureSink] fallocate(%zu) skipped: %s", SizeHint, strerror(errno));
+    }
+}
+
+/**
+ * @brief Closes the output of the current capture, flushing the codec if it was started.
+ * @param Out The writer-side capture state.
+ * @return OKE if every byte reached the file, ERR otherwise.
+ */
+static RetType Internal_CloseOutput(sSinkOutput *Out) {
+    RetType Ret = OKE;
+    if (Out->Started) {
+        Ret = Codec_WriterEnd(&Out->Codec);
+    } else if (Out->Fd >= 0) {
+        Ret = (close(Out->Fd) == 0) ? OKE : ERR;
+    }
+    Out->Fd = -1;
+    Out->Started = 0;
+    return Ret;
+}
+
+/**
+ * @brief Removes the file of the current capture from PATH_DIR_DB.
+ * @param Out The writer-side capture state.
+ */
+static void Internal_UnlinkOutput(const sSinkOutput *Out) {
+    char FullPath[PATH_MAX];
+    snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, Out->Filename);
+    unlink(FullPath);
+}
+
+/**
+ * @brief Opens the file of the current capture in PATH_DIR_DB.
+ * @param Out The writer-side capture state.
+ */
+static void Internal_OpenOutput(sSinkOutput *Out) {
+    char FullPath[PATH_MAX];
+    snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, Out->Filename);
+    Out->Fd = open(FullPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    Out->Failed = (Out->Fd < 0);
+    if (Out->Failed) {
+        xError("[CaptureSink] Failed to open %s: %s", FullPath, strerror(errno));
+    }
+}
+
+/**
+ * @brief Encodes payload bytes into the open file, choosing the storage policy on the first slice.
+ * @param Out The writer-side capture state.
+ * @return OKE on success, ERR on failure (Out->Failed is set).
+ */
+static RetType Internal_EncodeSlice(sSinkOutput *Out, const uint8_t *Data, size_t Len) {
+    if (!Out->Started) {
+        /// First slice: now we know both the size hint and the leading bytes
+        size_t Hint = (Out->SizeHint > 0) ? Out->SizeHint : Len;
+        int Compress = Codec_ShouldCompress(GetFileTypeFromName(Out->Filename), Hint, Data, Len);
+
+        /// Reserving the raw size only makes sense for payloads stored as-is
+        if (!Compress) Internal_Preallocate(Out->Fd, Out->SizeHint);
+
+        Codec_WriterBegin(&Out->Codec, Out->Fd, Compress);
+        Out->Started = 1;
+    }
+
+    if (Codec_WriterWrite(&Out->Codec, Data, Len) != OKE) {
+        xError("[CaptureSink] Write failed on %s: %s. Discarding it.", Out->Filename, strerror(errno));
+        /// The payload is incomplete from here on: drop the file now rather than commit a truncated item
+        Internal_CloseOutput(Out);
+        Internal_UnlinkOutput(Out);
+        Out->Failed = 1;
+        return ERR;
+    }
+    return OKE;
+}
+
+/**
+ * @brief Moves a capture held in memory to its own file (it outgrew the segment store).
+ * @param Out The writer-side capture state.
+ */
+static void Internal_SpillToFile(sSinkOutput *Out) {
+    Out->Buffered = 0;
+    Internal_OpenOutput(Out);
+    if (!Out->Failed && Out->Written > 0) Internal_EncodeSlice(Out, Out->Small, Out->Written);
+}
+
+/**
+ * @brief Persists one staging buffer: kept in memory for the segment store, or written through the codec.
+ * @param Out The writer-side capture state.
+ * @param Buf The staging buffer to persist.
+ */
+static void Internal_WriteBuffer(sSinkOutput *Out, const sSinkBuffer *Buf) {
+    if (Out->Failed) return;
+
+    if (Out->Buffered && Out->Written + Buf->Len > SEGMENT_ITEM_MAX) Internal_SpillToFile(Out);
+
+    if (Out->Buffered) {
+        memcpy(Out->Small + Out->Written, Buf->Data, Buf->Len);
+    } else if (Out->Fd < 0 || Internal_EncodeSlice(Out, Buf->Data, Buf->Len) != OKE) {
+        return;
+    }
+
+    /// The content hash covers the decoded payload so deduplication ignores storage format
+    Out->Written += Buf->Len;
+    Out->Crc   = crc32(Out->Crc, Buf->Data, (uInt)Buf->Len);
+    Out->Adler = adler32(Out->Adler, Buf->Data, (uInt)Buf->Len);
+    if (Out->IsText) {
+        Preview_Feed(&Out->Preview, Buf->Data, Buf->Len);
+        Search_Feed(&Out->Search, Buf->Data, Buf->Len);
+    }
+}
+
+/**
+ * @brief Returns the CRC32:Adler32 content hash of the current capture.
+ */
+static uint64_t Internal_ContentHash(const sSinkOutput *Out) {
+    return ((uint64_t)(Out->Crc & 0xFFFFFFFFUL) << 32) | (Out->Adler & 0xFFFFFFFFUL);
+}
+
+/**
+ * @brief Finishes the menu preview of the current capture.
+ * @param Preview Receives the preview ("" for non-text payloads).
+ * @param Lines Receives the line count.
+ */
+static void Internal_FinishPreview(const sSinkOutput *Out, char Preview[PREVIEW_TXT_LEN + 1], uint32_t *Lines) {
+    Preview[0] = '\0';
+    *Lines = 0;
+    if (Out->IsText) Preview_End(&Out->Preview, Preview, Lines);
+}
+
+/**
+ * @brief Commits a capture held in memory as one segment record.
+ * @param Out The writer-side capture state.
+ * @return OKE if the record was appended (pushed or deduplicated), ERR if the store refused it.
+ */
+static RetType Internal_CommitToSegment(sSinkOutput *Out) {
+    uint32_t Segment;
+    uint64_t Offset;
+    if (Segment_Append(Out->Filename, GetFileTypeFromName(Out->Filename), Out->Small, Out->Written,
+                       time(NULL), &Segment, &Offset) != OKE) {
+        return ERR;
+    }
+    Out->Buffered = 0;
+
+    char Preview[PREVIEW_TXT_LEN + 1];
+    uint32_t Lines;
+    Internal_FinishPreview(Out, Preview, &Lines);
+    if (XCBList_PushSegmentItem(Out->Filename, Internal_ContentHash(Out), Out->Written, Segment, Offset, Preview, Lines) == OKE) {
+        xLog1("[CaptureSink] Committed %s (%zu bytes, segment %u).", Out->Filename, Out->Written, Segment);
+        if (Out->Flavours) FlavourSet_Save(Out->Flavours, Out->Filename);
+        if (Out->IsText) Search_Add(Out->Filename, &Out->Search);
+    } else {
+        /// Identical content already in history (promoted instead): the record is dead
+        Segment_Release(Segment, Offset);
+    }
+    return OKE;
+}
+
+/**
+ * @brief Releases the flavour set attached to the current capture, if any.
+ * @param Out The writer-side capture state.
+ */
+static void Internal_DropFlavours(sSinkOutput *Out) {
+    if (!Out->Flavours) return;
+    FlavourSet_Clear(Out->Flavours);
+    free(Out->Flavours);
+    Out->Flavours = NULL;
+}
+
+/**************************************************************************************************
+ * WRITER THREAD SECTION **************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Writer Thread: Drains queued operations to disk so the X event loop never blocks on I/O.
+ */
+static void *CaptureSink_WriterRuntime(void *Param) {
+    (void)Param;
+    xEntry1("CaptureSink_WriterRuntime");
+
+    sSinkOutput Out;
+    memset(&Out, 0, sizeof(Out));
+    Out.Fd = -1;
+
+    while (1) {
+        pthread_mutex_lock(&SinkMutex);
+        while (SinkQueueCount == 0 && !SinkStopReq) {
+            pthread_cond_wait(&SinkCondWork, &SinkMutex);
+        }
+        if (SinkQueueCount == 0 && SinkStopReq) {
+            pthread_mutex_unlock(&SinkMutex);
+            break;
+        }
+        sSinkOp Op = SinkQueue[SinkQueueHead];
+        SinkQueueHead = (SinkQueueHead + 1) % SINK_QUEUE_LEN;
+        SinkQueueCount--;
+        pthread_cond_signal(&SinkCondSpace);
+        pthread_mutex_unlock(&SinkMutex);
+
+        switch (Op.Type) {
+            case eSINK_OP_OPEN:
+                Internal_CloseOutput(&Out);
+                Internal_DropFlavours(&Out);
+                snprintf(Out.Filename, sizeof(Out.Filename), "%s", Op.Filename);
+                Out.Written = 0;
+                Out.SizeHint = Op.SizeHint;
+                Out.Crc = crc32(0L, Z_NULL, 0);
+                Out.Adler = adler32(0L, Z_NULL, 0);
+                Out.Failed = 0;
+                Out.IsText = (GetFileTypeFromName(Out.Filename) == eFMT_TXT);
+                Preview_Begin(&Out.Preview);
+                if (Out.IsText) Search_Begin(&Out.Search);
+
+                /// Small text stays in memory until commit: one append, no file of its own
+                Out.Buffered = Segment_Accepts(GetFileTypeFromName(Out.Filename), Op.SizeHint);
+                if (Out.Buffered && !Out.Small) Out.Small = MemBudget_Alloc(SEGMENT_ITEM_MAX);
+                if (!Out.Small) Out.Buffered = 0;
+                if (!Out.Buffered) Internal_OpenOutput(&Out);
+                break;
+
+            case eSINK_OP_HINT:
+                Out.SizeHint = Op.SizeHint;
+                if (Out.Buffered && Op.SizeHint > SEGMENT_ITEM_MAX) Internal_SpillToFile(&Out);
+                break;
+
+            case eSINK_OP_FLAVOURS:
+                Internal_DropFlavours(&Out);
+                Out.Flavours = Op.Flavours;
+                break;
+
+            case eSINK_OP_DATA:
+                Internal_WriteBuffer(&Out, &SinkBuffers[Op.BufIdx]);
+                Internal_ReleaseBuffer(Op.BufIdx);
+                break;
+
+            case eSINK_OP_COMMIT:
+                /// If the segment store refuses the record, the payload still gets its own file
+                if (Out.Buffered && Internal_CommitToSegment(&Out) != OKE) Internal_SpillToFile(&Out);
+
+                /// A failed write already discarded the output (Fd is -1): nothing gets pushed
+
+                if (Out.Fd >= 0) {
+                    char Preview[PREVIEW_TXT_LEN + 1];
+                    uint32_t Lines;
+                    Internal_FinishPreview(&Out, Preview, &Lines);
+                    if (Internal_CloseOutput(&Out) != OKE) Out.Failed = 1;
+                    if (!Out.Failed && XCBList_PushItemWithHash(Out.Filename, Internal_ContentHash(&Out), Out.Written, Preview, Lines) == OKE) {
+                        xLog1("[CaptureSink] Committed %s (%zu bytes).", Out.Filename, Out.Written);
+                        if (Out.Flavours) FlavourSet_Save(Out.Flavours, Out.Filename);
+                        /// Downscaled off this thread, so a large screenshot never delays the next capture
+                        Thumb_Request(Out.Filename, GetFileTypeFromName(Out.Filename));
+                        if (Out.IsText) Search_Add(Out.Filename, &Out.Search);
+                    } else {
+                        /// Write failure, or identical content already in history (promoted instead)
+                        Internal_UnlinkOutput(&Out);
+                    }
+                }
+                Internal_DropFlavours(&Out);
+                Internal_ReleaseIdleBuffers();
+                break;
+
+            case eSINK_OP_ABORT:
+                Out.Buffered = 0;
+                if (Out.Fd >= 0) {
+                    Internal_CloseOutput(&Out);
+                    Internal_UnlinkOutput(&Out);
+                    xLog1("[CaptureSink] Aborted %s.", Out.Filename);
+                }
+                Internal_DropFlavours(&Out);
+                Internal_ReleaseIdleBuffers();
+                break;
+        }
+    }
+
+    Internal_CloseOutput(&Out);
+    Internal_DropFlavours(&Out);
+    MemBudget_Free(Out.Small);
+    Search_FreeBuilder(&Out.Search);
+
+    xExit1("CaptureSink_WriterRuntime");
+    return NULL;
+}
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+RetType CaptureSink_Start(void) {
+    xEntry1("CaptureSink_Start");
+
+    pthread_mutex_lock(&SinkMutex);
+    SinkFreeCount = 0;
+    for (int i = 0; i < SINK_BUFFER_COUNT; i++) {
+        SinkBuffers[i].Len = 0;
+        SinkFreeStack[SinkFreeCount++] = i;
+    }
+    SinkQueueHead = SinkQueueTail = SinkQueueCount = 0;
+    SinkStopReq = 0;
+    pthread_mutex_unlock(&SinkMutex);
+
+    if (pthread_create(&SinkWriterThread, NULL, CaptureSink_WriterRuntime, NULL) != 0) {
+        xError("[CaptureSink] Failed to spawn writer thread!");
+        return ERR;
+    }
+    SinkRunning = 1;
+
+    xExit1("CaptureSink_Start");
+    return OKE;
+}
+
+void CaptureSink_Stop(void) {
+    if (!SinkRunning) return;
+
+    if (ProdIsOpen) CaptureSink_Abort();
+
+    pthread_mutex_lock(&SinkMutex);
+    SinkStopReq = 1;
+    pthread_cond_signal(&SinkCondWork);
+    pthread_mutex_unlock(&SinkMutex);
+
+    pthread_join(SinkWriterThread, NULL);
+    SinkRunning = 0;
+
+    for (int i = 0; i < SINK_BUFFER_COUNT; i++) {
+        MemBudget_Free(SinkBuffers[i].Data);
+        SinkBuffers[i].Data = NULL;
+    }
+}
+
+RetType CaptureSink_Open(const char *Filename, size_t SizeHint) {
+    if (!Filename || !SinkRunning) return ERR;
+    if (ProdIsOpen) {
+        xWarn("[CaptureSink] Previous capture still open. Aborting it.");
+        CaptureSink_Abort();
+    }
+
+    sSinkOp Op = { .Type = eSINK_OP_OPEN, .BufIdx = -1, .SizeHint = SizeHint };
+    snprintf(Op.Filename, sizeof(Op.Filename), "%s", Filename);
+    Internal_Enqueue(&Op);
+
+    ProdIsOpen = 1;
+    ProdBufIdx = -1;
+    return OKE;
+}
+
+void CaptureSink_SetSizeHint(size_t SizeHint) {
+    if (!ProdIsOpen || SizeHint == 0) return;
+    sSinkOp Op = { .Type = eSINK_OP_HINT, .BufIdx = -1, .SizeHint = SizeHint };
+    Internal_Enqueue(&Op);
+}
+
+RetType CaptureSink_Write(const uint8_t *Data, size_t Len) {
+    if (!ProdIsOpen) return ERR;
+
+    while (Len > 0) {
+        if (ProdBufIdx < 0) {
+            ProdBufIdx = Internal_AcquireBuffer();
+            if (ProdBufIdx < 0) return ERR;
+        }
+
+        sSinkBuffer *Buf = &SinkBuffers[ProdBufIdx];
+        size_t SpaceLeft = SINK_BUFFER_SIZE - Buf->Len;
+        size_t ToCopy = (Len < SpaceLeft) ? Len : SpaceLeft;
+
+        memcpy(Buf->Data + Buf->Len, Data, ToCopy);
+        Buf->Len += ToCopy;
+        Data     += ToCopy;
+        Len      -= ToCopy;
+
+        /// Buffer is full -> hand it over to the writer and rotate to the next one
+        if (Buf->Len == SINK_BUFFER_SIZE) {
+            Internal_SubmitCurrentBuffer();
+        }
+    }
+    return OKE;
+}
+
+RetType CaptureSink_AttachFlavours(sFlavourSet *Set) {
+    if (!Set) return ERR_NULL;
+    if (!ProdIsOpen) {
+        FlavourSet_Clear(Set);
+        free(Set);
+        return ERR;
+    }
+
+    sSinkOp Op = { .Type = eSINK_OP_FLAVOURS, .BufIdx = -1, .Flavours = Set };
+    Internal_Enqueue(&Op);
+    return OKE;
+}
+
+RetType CaptureSink_Commit(void) {
+    if (!ProdIsOpen) return ERR;
+
+    Internal_SubmitCurrentBuffer();
+
+    sSinkOp Op = { .Type = eSINK_OP_COMMIT, .BufIdx = -1 };
+    Internal_Enqueue(&Op);
+
+    ProdIsOpen = 0;
+    return OKE;
+}
+
+void CaptureSink_Abort(void) {
+    if (!ProdIsOpen) return;
+
+    if (ProdBufIdx >= 0) {
+        Internal_ReleaseBuffer(ProdBufIdx);
+        ProdBufIdx = -1;
+    }
+
+    sSinkOp Op = { .Type = eSINK_OP_ABORT, .BufIdx = -1 };
+    Internal_Enqueue(&Op);
+
+    ProdIsOpen = 0;
+}
+
+int CaptureSink_IsOpen(void) {
+    return ProdIsOpen;
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
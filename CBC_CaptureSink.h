@@ -0,0 +1,107 @@
+#ifndef __CBC_CAPTURE_SINK_H__
+#define __CBC_CAPTURE_SINK_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include "CBC_Flavour.h"
+
+/**************************************************************************************************
+ * CAPTURE SINK CONFIGURATION SECTION *************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Size of a single rotating staging buffer (1MB).
+ * @note Matches the largest slice we request from the X Server per xcb_get_property call.
+ */
+#define SINK_BUFFER_SIZE        (1U * 1024U * 1024U)
+
+/**
+ * @brief Number of rotating staging buffers shared between the X thread and the writer thread.
+ * @note Peak RAM used by an in-flight capture is SINK_BUFFER_COUNT * SINK_BUFFER_SIZE.
+ *       Buffers are drawn from the MemBudget on demand and released after every transaction.
+ */
+#define SINK_BUFFER_COUNT       4
+
+/**
+ * @brief Capacity of the pending operation queue consumed by the writer thread.
+ */
+#define SINK_QUEUE_LEN          64
+
+/**************************************************************************************************
+ * CAPTURE SINK PROTOTYPES ************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Spawns the background writer thread that drains staged buffers to disk.
+ * @return OKE on success, ERR if the thread cannot be created.
+ */
+RetType CaptureSink_Start(void);
+
+/**
+ * @brief Drains all queued operations and joins the writer thread.
+ * @note Any file still open on the producer side is aborted (deleted) before stopping.
+ */
+void CaptureSink_Stop(void);
+
+/**
+ * @brief Starts a new capture file inside PATH_DIR_DB.
+ * @param Filename Bare filename (no directory) of the item to be created.
+ * @param SizeHint Expected payload size in bytes used to preallocate disk space (0 = unknown).
+ * @return OKE on success, ERR if a capture is already open or the queue is stopped.
+ * @note The file is created by the writer thread; this call never touches the disk.
+ */
+RetType CaptureSink_Open(const char *Filename, size_t SizeHint);
+
+/**
+ * @brief Updates the preallocation hint of the currently open capture (e.g., from INCR SizeEst).
+ * @param SizeHint Expected payload size in bytes.
+ */
+void CaptureSink_SetSizeHint(size_t SizeHint);
+
+/**
+ * @brief Copies a payload slice into the current staging buffer, handing full buffers to the writer.
+ * @param Data Pointer to the incoming bytes.
+ * @param Len Number of bytes.
+ * @return OKE on success, ERR if no capture is open or no staging buffer can be allocated.
+ *         On ERR part of the slice may be lost: the caller must abort the capture.
+ * @note Only blocks when every staging buffer is still waiting for the disk (back-pressure).
+ */
+RetType CaptureSink_Write(const uint8_t *Data, size_t Len);
+
+/**
+ * @brief Hands a set of extra targets to the open capture, to be saved beside it on commit.
+ * @param Set Heap-allocated flavour set. Ownership always moves to the sink (freed on failure).
+ * @return OKE on success, ERR if no capture is open.
+ * @note If the capture turns out to be a duplicate or is aborted, the set is simply dropped.
+ */
+RetType CaptureSink_AttachFlavours(sFlavourSet *Set);
+
+/**
+ * @brief Flushes the partial buffer and asks the writer to close the file and push it to XCBList.
+ * @note The writer hashes every slice on the way to disk; if XCBList already holds identical
+ *       content, that item is promoted to the head and the new file is deleted. If any write
+ *       failed on the way, the file was already deleted and nothing is pushed.
+ * @return OKE on success, ERR if no capture is open.
+ */
+RetType CaptureSink_Commit(void);
+
+/**
+ * @brief Discards the current capture. The writer closes and unlinks the partial file.
+ */
+void CaptureSink_Abort(void);
+
+/**
+ * @brief Reports whether a capture file is currently open on the producer side.
+ * @return 1 if open, 0 otherwise.
+ */
+int CaptureSink_IsOpen(void);
+
+#endif /*__CBC_CAPTURE_SINK_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,96 @@
+#include "CBC_CmdQueue.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+#include <stdatomic.h>
+
+_Static_assert((CMD_QUEUE_DEPTH & (CMD_QUEUE_DEPTH - 1)) == 0, "CMD_QUEUE_DEPTH must be a power of two");
+
+/**************************************************************************************************
+ * INTERNAL TYPES SECTION *************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Ring slot. Seq tells whose turn it is: == position (free for that producer),
+ *        == position + 1 (filled, ready for the consumer).
+ */
+typedef struct {
+    atomic_size_t   Seq;
+    sCmd            Cmd;
+} sCmdSlot;
+
+/**************************************************************************************************
+ * INTERNAL DATA SECTION **************************************************************************
+ **************************************************************************************************/
+
+static sCmdSlot         CmdSlots[CMD_QUEUE_DEPTH];
+
+/**
+ * @brief Next position to claim by producers (CAS).
+ */
+static atomic_size_t    CmdEnqueuePos = 0;
+
+/**
+ * @brief Next position to read. Only the consumer touches it.
+ */
+static size_t           CmdDequeuePos = 0;
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+void CmdQueue_Init(void) {
+    for (size_t i = 0; i < CMD_QUEUE_DEPTH; i++) {
+        atomic_store_explicit(&CmdSlots[i].Seq, i, memory_order_relaxed);
+    }
+    atomic_store_explicit(&CmdEnqueuePos, 0, memory_order_relaxed);
+    CmdDequeuePos = 0;
+    atomic_thread_fence(memory_order_release);
+}
+
+RetType CmdQueue_Push(const sCmd *Cmd) {
+    if (!Cmd) return ERR_NULL;
+
+    size_t Pos = atomic_load_explicit(&CmdEnqueuePos, memory_order_relaxed);
+    sCmdSlot *Slot;
+
+    for (;;) {
+        Slot = &CmdSlots[Pos & (CMD_QUEUE_DEPTH - 1)];
+        size_t Seq = atomic_load_explicit(&Slot->Seq, memory_order_acquire);
+        intptr_t Diff = (intptr_t)Seq - (intptr_t)Pos;
+
+        if (Diff == 0) {
+            /// Slot free for this lap: claim the position, retry with the fresh one on contention
+            if (atomic_compare_exchange_weak_explicit(&CmdEnqueuePos, &Pos, Pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) break;
+        } else if (Diff < 0) {
+            /// The consumer has not freed this slot yet: the ring is full
+            return ERR_BUSY;
+        } else {
+            Pos = atomic_load_explicit(&CmdEnqueuePos, memory_order_relaxed);
+        }
+    }
+
+    Slot->Cmd = *Cmd;
+    /// Publish: the consumer sees the command only after it is fully written
+    atomic_store_explicit(&Slot->Seq, Pos + 1, memory_order_release);
+    return OKE;
+}
+
+RetType CmdQueue_Pop(sCmd *Out) {
+    sCmdSlot *Slot = &CmdSlots[CmdDequeuePos & (CMD_QUEUE_DEPTH - 1)];
+    size_t Seq = atomic_load_explicit(&Slot->Seq, memory_order_acquire);
+
+    if (Seq != CmdDequeuePos + 1) return ERR;
+
+    *Out = Slot->Cmd;
+    /// Hand the slot back to producers for the next lap
+    atomic_store_explicit(&Slot->Seq, CmdDequeuePos + CMD_QUEUE_DEPTH, memory_order_release);
+    CmdDequeuePos++;
+    return OKE;
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,65 @@
+#ifndef __CBC_CMD_QUEUE_H__
+#define __CBC_CMD_QUEUE_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * COMMAND DEFINITION SECTION *********************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Commands executed by the event loop thread (the only thread touching the X connection).
+ */
+enum eCmdType {
+    eCMD_INJECT_INDEX = 0,      /// Offer item Index (logical, 0 = newest; -1 = selected, else newest)
+    eCMD_INJECT_NAME,           /// Offer the item stored under Name
+    eCMD_INJECT_ID,             /// Offer the item with runtime id Id (picked from a snapshot)
+    eCMD_CLEAR,                 /// Delete every item from RAM and disk
+    eCMD_DELETE,                /// Delete item Index (logical) from RAM and disk
+    eCMD_RELOAD                 /// Rebuild the history list from PATH_DIR_DB
+};
+
+/**
+ * @brief One queued command. Copied by value: the producer keeps nothing alive.
+ */
+typedef struct {
+    enum eCmdType   Type;
+    int             Index;                  /// eCMD_INJECT_INDEX, eCMD_DELETE
+    char            Name[NAME_MAX + 4];     /// eCMD_INJECT_NAME
+    uint64_t        Id;                     /// eCMD_INJECT_ID
+} sCmd;
+
+/**************************************************************************************************
+ * COMMAND QUEUE PROTOTYPES ***********************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Resets the queue. Must run before any producer or consumer uses it.
+ */
+void CmdQueue_Init(void);
+
+/**
+ * @brief Appends a command (lock-free, any number of producers, async-signal-safe).
+ * @param Cmd The command to copy into the queue.
+ * @return OKE on success, ERR_NULL if Cmd is NULL, ERR_BUSY if all CMD_QUEUE_DEPTH slots are taken.
+ * @note Commands are never merged: N pushes are N executions, in push order per producer.
+ */
+RetType CmdQueue_Push(const sCmd *Cmd);
+
+/**
+ * @brief Takes the oldest command. Single consumer only (the event loop thread).
+ * @param Out Receives the command.
+ * @return OKE if a command was taken, ERR if the queue is empty (or the head is still being written).
+ */
+RetType CmdQueue_Pop(sCmd *Out);
+
+#endif /*__CBC_CMD_QUEUE_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
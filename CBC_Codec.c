@@ -0,0 +1,307 @@
+#include "CBC_Codec.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include "CBC_Segment.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+#include <sys/mman.h>
+
+/**************************************************************************************************
+ * INTERNAL HELPERS *******************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Largest single gzread/gzwrite call (zlib takes an unsigned int length).
+ */
+#define CODEC_IO_MAX    (1U << 30)
+
+/**
+ * @brief Checks whether a buffer starts with the gzip magic bytes (1F 8B).
+ */
+static inline int HasGzipMagic(const uint8_t *Head, size_t HeadLen) {
+    return (HeadLen >= 2 && Head[0] == 0x1F && Head[1] == 0x8B);
+}
+
+/**************************************************************************************************
+ * POLICY IMPLEMENTATION **************************************************************************
+ **************************************************************************************************/
+
+int Codec_ShouldCompress(enum XCBFileType Type, size_t SizeHint, const uint8_t *Head, size_t HeadLen) {
+#if (STORE_COMPRESS == 1)
+    /// PNG/JPEG are already entropy-coded: deflate would only burn CPU
+    if (Type != eFMT_TXT && Type != eFMT_IMG_BMP) return 0;
+
+    /// A raw payload starting with the gzip magic would be misread as compressed
+    if (HasGzipMagic(Head, HeadLen)) return 1;
+
+    return (SizeHint >= STORE_COMPRESS_MIN_SIZE);
+#else
+    (void)Type; (void)SizeHint; (void)Head; (void)HeadLen;
+    return 0;
+#endif /*(STORE_COMPRESS == 1)*/
+}
+
+/**************************************************************************************************
+ * WRITER IMPLEMENTATION **************************************************************************
+ **************************************************************************************************/
+
+RetType Codec_WriterBegin(sCodecWriter *Writer, int Fd, int Compress) {
+    if (!Writer || Fd < 0) return ERR;
+
+    Writer->Fd = Fd;
+    Writer->Gz = NULL;
+
+    if (Compress) {
+        char Mode[8];
+        snprintf(Mode, sizeof(Mode), "wb%d", STORE_COMPRESS_LEVEL);
+        Writer->Gz = gzdopen(Fd, Mode);
+        if (Writer->Gz) {
+            gzbuffer(Writer->Gz, CODEC_STREAM_BUF);
+        } else {
+            /// gzdopen leaves the descriptor open on failure: fall back to raw storage
+            xWarn("[Codec] gzdopen failed. Storing payload uncompressed.");
+        }
+    }
+    return OKE;
+}
+
+RetType Codec_WriterWrite(sCodecWriter *Writer, const uint8_t *Data, size_t Len) {
+    if (!Writer || Writer->Fd < 0) return ERR;
+
+    while (Len > 0) {
+        if (Writer->Gz) {
+            unsigned Chunk = (Len > CODEC_IO_MAX) ? CODEC_IO_MAX : (unsigned)Len;
+            int Ret = gzwrite(Writer->Gz, Data, Chunk);
+            if (Ret <= 0) return ERR;
+            Data += Ret;
+            Len  -= (size_t)Ret;
+        } else {
+            ssize_t Ret = write(Writer->Fd, Data, Len);
+            if (Ret < 0) {
+                if (errno == EINTR) continue;
+                return ERR;
+            }
+            Data += Ret;
+            Len  -= (size_t)Ret;
+        }
+    }
+    return OKE;
+}
+
+RetType Codec_WriterEnd(sCodecWriter *Writer) {
+    if (!Writer || Writer->Fd < 0) return ERR;
+
+    int Ok;
+    if (Writer->Gz) {
+        /// gzclose flushes the deflate stream, writes the trailer and closes the descriptor
+        Ok = (gzclose(Writer->Gz) == Z_OK);
+    } else {
+        Ok = (close(Writer->Fd) == 0);
+    }
+    Writer->Gz = NULL;
+    Writer->Fd = -1;
+    return Ok ? OKE : ERR;
+}
+
+/**************************************************************************************************
+ * READER IMPLEMENTATION **************************************************************************
+ **************************************************************************************************/
+
+int64_t Codec_GetPayloadSize(const char *FullPath) {
+    int Fd = open(FullPath, O_RDONLY | O_CLOEXEC);
+    if (Fd < 0) return -1;
+
+    struct stat FileStat;
+    uint8_t Head[2] = {0};
+    int64_t Size = -1;
+
+    if (fstat(Fd, &FileStat) == 0) {
+        Size = FileStat.st_size;
+        if (pread(Fd, Head, sizeof(Head), 0) == (ssize_t)sizeof(Head) && HasGzipMagic(Head, sizeof(Head))) {
+            /// gzip trailer: last 4 bytes hold the decoded size (little-endian, modulo 2^32)
+            uint8_t Trailer[4];
+            if (FileStat.st_size >= 18 && pread(Fd, Trailer, sizeof(Trailer), FileStat.st_size - 4) == (ssize_t)sizeof(Trailer)) {
+                Size = (int64_t)Trailer[0] | ((int64_t)Trailer[1] << 8) | ((int64_t)Trailer[2] << 16) | ((int64_t)Trailer[3] << 24);
+            } else {
+                Size = -1;
+            }
+        }
+    }
+    close(Fd);
+    return Size;
+}
+
+int64_t Codec_ReadHead(const char *FullPath, void *Output, size_t MaxLen) {
+    /// gzopen reads non-gzip files transparently, so raw and compressed payloads share one path
+    gzFile Gz = gzopen(FullPath, "rb");
+    if (!Gz) return -1;
+    gzbuffer(Gz, CODEC_STREAM_BUF);
+
+    size_t Total = 0;
+    while (Total < MaxLen) {
+        size_t Want = MaxLen - Total;
+        unsigned Chunk = (Want > CODEC_IO_MAX) ? CODEC_IO_MAX : (unsigned)Want;
+        int Ret = gzread(Gz, (uint8_t *)Output + Total, Chunk);
+        if (Ret < 0) {
+            gzclose(Gz);
+            return -1;
+        }
+        if (Ret == 0) break;
+        Total += (size_t)Ret;
+    }
+    gzclose(Gz);
+    return (int64_t)Total;
+}
+
+int64_t Codec_ReadFile(const char *FullPath, void *Output, size_t MaxLen) {
+    gzFile Gz = gzopen(FullPath, "rb");
+    if (!Gz) return ERR;
+    gzbuffer(Gz, CODEC_STREAM_BUF);
+
+    size_t Total = 0;
+    int64_t Result = ERR;
+    while (1) {
+        if (Total == MaxLen) {
+            /// Buffer is full: the payload fits only if the stream is exhausted
+            uint8_t Probe;
+            int Ret = gzread(Gz, &Probe, 1);
+            Result = (Ret == 0) ? (int64_t)Total : (Ret > 0) ? ERR_OVERFLOW : ERR;
+            break;
+        }
+        size_t Want = MaxLen - Total;
+        unsigned Chunk = (Want > CODEC_IO_MAX) ? CODEC_IO_MAX : (unsigned)Want;
+        int Ret = gzread(Gz, (uint8_t *)Output + Total, Chunk);
+        if (Ret < 0) break;
+        if (Ret == 0) {
+            Result = (int64_t)Total;
+            break;
+        }
+        Total += (size_t)Ret;
+    }
+    gzclose(Gz);
+    return Result;
+}
+
+/**************************************************************************************************
+ * MAPPING IMPLEMENTATION *************************************************************************
+ **************************************************************************************************/
+
+RetType Codec_MapFile(const char *FullPath, sCodecMapping *Map) {
+    Map->Base = NULL;
+    Map->Len = 0;
+
+    int Fd = open(FullPath, O_RDONLY | O_CLOEXEC);
+    if (Fd < 0) return ERR;
+
+    struct stat FileStat;
+    uint8_t Head[2] = {0};
+    RetType Ret = ERR;
+
+    if (fstat(Fd, &FileStat) == 0) {
+        if (FileStat.st_size <= 0) {
+            Ret = ERR_UNSUPPORTED;
+        } else if (pread(Fd, Head, sizeof(Head), 0) == (ssize_t)sizeof(Head) && HasGzipMagic(Head, sizeof(Head))) {
+            /// Deflated on disk: the bytes on disk are not the payload
+            Ret = ERR_UNSUPPORTED;
+        } else {
+            void *Base = mmap(NULL, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+            if (Base != MAP_FAILED) {
+                /// Requestors consume the payload front to back in INCR chunks
+                madvise(Base, (size_t)FileStat.st_size, MADV_SEQUENTIAL);
+                Map->Base = (const uint8_t *)Base;
+                Map->Len = (size_t)FileStat.st_size;
+                Ret = OKE;
+            }
+        }
+    }
+    /// The mapping holds its own reference to the file
+    close(Fd);
+    return Ret;
+}
+
+void Codec_UnmapFile(sCodecMapping *Map) {
+    if (Map->Base) munmap((void *)Map->Base, Map->Len);
+    Map->Base = NULL;
+    Map->Len = 0;
+}
+
+/**************************************************************************************************
+ * HISTORY ITEM ACCESS IMPLEMENTATION *************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Builds the path of an item stored as its own file.
+ */
+static void Internal_ItemPath(const sClipboardItem *Item, char *FullPath, size_t Len) {
+    snprintf(FullPath, Len, "%s/%s", PATH_DIR_DB, Item->Filename);
+}
+
+/**
+ * @brief Re-reads the location of a segment item after a failed read.
+ * @return 1 if the compactor moved the record meanwhile (Fresh holds the new location), 0 otherwise.
+ */
+static int Internal_RefreshSegmentItem(const sClipboardItem *Item, sClipboardItem *Fresh) {
+    int Index = XCBList_FindByName(Item->Filename);
+    if (Index < 0 || XCBList_GetItem(Index, Fresh) != OKE) return 0;
+    return Fresh->Segment != Item->Segment || Fresh->SegOffset != Item->SegOffset;
+}
+
+/**
+ * @brief Reads a segment item, retrying once if its record was compacted away mid-read.
+ */
+static int64_t Internal_SegmentItemRead(const sClipboardItem *Item, void *Output, size_t MaxLen, int AllowPartial) {
+    int64_t Ret = Segment_Read(Item->Segment, Item->SegOffset, Output, MaxLen, AllowPartial);
+    sClipboardItem Fresh;
+    if (Ret == ERR && Internal_RefreshSegmentItem(Item, &Fresh) && Fresh.Segment != 0) {
+        Ret = Segment_Read(Fresh.Segment, Fresh.SegOffset, Output, MaxLen, AllowPartial);
+    }
+    return Ret;
+}
+
+int64_t Codec_ItemGetPayloadSize(const sClipboardItem *Item) {
+    if (Item->Segment != 0) {
+        int64_t Size = Segment_GetPayloadSize(Item->Segment, Item->SegOffset);
+        sClipboardItem Fresh;
+        if (Size < 0 && Internal_RefreshSegmentItem(Item, &Fresh) && Fresh.Segment != 0) {
+            Size = Segment_GetPayloadSize(Fresh.Segment, Fresh.SegOffset);
+        }
+        return Size;
+    }
+    char FullPath[PATH_MAX];
+    Internal_ItemPath(Item, FullPath, sizeof(FullPath));
+    return Codec_GetPayloadSize(FullPath);
+}
+
+int64_t Codec_ItemReadHead(const sClipboardItem *Item, void *Output, size_t MaxLen) {
+    if (Item->Segment != 0) {
+        int64_t Ret = Internal_SegmentItemRead(Item, Output, MaxLen, 1);
+        return (Ret >= 0) ? Ret : -1;
+    }
+    char FullPath[PATH_MAX];
+    Internal_ItemPath(Item, FullPath, sizeof(FullPath));
+    return Codec_ReadHead(FullPath, Output, MaxLen);
+}
+
+int64_t Codec_ItemRead(const sClipboardItem *Item, void *Output, size_t MaxLen) {
+    if (Item->Segment != 0) return Internal_SegmentItemRead(Item, Output, MaxLen, 0);
+
+    char FullPath[PATH_MAX];
+    Internal_ItemPath(Item, FullPath, sizeof(FullPath));
+    return Codec_ReadFile(FullPath, Output, MaxLen);
+}
+
+RetType Codec_ItemMap(const sClipboardItem *Item, sCodecMapping *Map) {
+    if (Item->Segment != 0) {
+        /// Records are small and shared with their neighbours: copying beats a page-aligned view
+        Map->Base = NULL;
+        Map->Len = 0;
+        return ERR_UNSUPPORTED;
+    }
+    char FullPath[PATH_MAX];
+    Internal_ItemPath(Item, FullPath, sizeof(FullPath));
+    return Codec_MapFile(FullPath, Map);
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,149 @@
+#ifndef __CBC_CODEC_H__
+#define __CBC_CODEC_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * STORAGE CODEC CONFIGURATION SECTION ************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Internal zlib buffer size (64KB) used by the streaming compressor and decompressor.
+ */
+#define CODEC_STREAM_BUF        (64U * 1024U)
+
+/**************************************************************************************************
+ * STORAGE CODEC TYPES ****************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Streaming writer for one stored payload. Raw or gzip-deflated depending on the policy.
+ */
+typedef struct {
+    int         Fd;         /// Destination file descriptor (owned by the writer once begun)
+    gzFile      Gz;         /// Non-NULL when the payload is being deflated
+} sCodecWriter;
+
+/**
+ * @brief Read-only view of a stored raw payload, mapped straight from its file.
+ * @note The mapping keeps the file's pages alive even if the item is evicted (unlinked) while
+ *       the view is in use; they are released on Codec_UnmapFile().
+ */
+typedef struct {
+    const uint8_t  *Base;       /// First payload byte
+    size_t          Len;        /// Payload size in bytes
+} sCodecMapping;
+
+/**************************************************************************************************
+ * STORAGE CODEC PROTOTYPES ***********************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Decides whether a payload should be stored compressed.
+ * @param Type The clipboard file type of the payload.
+ * @param SizeHint Total payload size if known, otherwise the size of the first slice.
+ * @param Head First bytes of the payload.
+ * @param HeadLen Number of bytes available in Head.
+ * @return 1 to compress, 0 to store as-is.
+ * @note Raw payloads that happen to start with the gzip magic are always compressed so the
+ *       reader never mistakes them for a compressed stream.
+ */
+int Codec_ShouldCompress(enum XCBFileType Type, size_t SizeHint, const uint8_t *Head, size_t HeadLen);
+
+/**
+ * @brief Starts writing a payload to an already open file descriptor.
+ * @param Writer The writer state to initialize.
+ * @param Fd Open, writable file descriptor. The writer takes ownership of it.
+ * @param Compress 1 to deflate the stream (gzip format), 0 to store it raw.
+ * @return OKE on success, ERR if the compressor cannot be initialized (Fd stays owned by the writer).
+ */
+RetType Codec_WriterBegin(sCodecWriter *Writer, int Fd, int Compress);
+
+/**
+ * @brief Appends payload bytes to the stream.
+ * @return OKE on success, ERR on I/O or compressor failure.
+ */
+RetType Codec_WriterWrite(sCodecWriter *Writer, const uint8_t *Data, size_t Len);
+
+/**
+ * @brief Flushes the stream and closes the file descriptor.
+ * @return OKE on success, ERR if the final flush or close failed.
+ */
+RetType Codec_WriterEnd(sCodecWriter *Writer);
+
+/**
+ * @brief Returns the decoded payload size of a stored file.
+ * @param FullPath Absolute path to the stored file.
+ * @return Size in bytes, or -1 if the file cannot be read.
+ * @note For compressed files this is the gzip ISIZE trailer (exact below 4GB).
+ */
+int64_t Codec_GetPayloadSize(const char *FullPath);
+
+/**
+ * @brief Reads up to MaxLen decoded payload bytes from the start of a stored file.
+ * @param FullPath Absolute path to the stored file (compressed or raw).
+ * @param Output Destination buffer.
+ * @param MaxLen Capacity of Output.
+ * @return Number of bytes read, or -1 on error.
+ */
+int64_t Codec_ReadHead(const char *FullPath, void *Output, size_t MaxLen);
+
+/**
+ * @brief Reads the whole decoded payload of a stored file.
+ * @param FullPath Absolute path to the stored file (compressed or raw).
+ * @param Output Destination buffer.
+ * @param MaxLen Capacity of Output.
+ * @return Number of bytes read, ERR_OVERFLOW if the payload exceeds MaxLen, ERR on I/O errors.
+ */
+int64_t Codec_ReadFile(const char *FullPath, void *Output, size_t MaxLen);
+
+/**
+ * @brief Maps a stored payload read-only so it can be served without copying it.
+ * @param FullPath Absolute path to the stored file.
+ * @param Map Receives the view on success.
+ * @return OKE on success, ERR_UNSUPPORTED if the payload is compressed (or empty) and must be
+ *         read with Codec_ReadFile() instead, ERR on I/O errors.
+ */
+RetType Codec_MapFile(const char *FullPath, sCodecMapping *Map);
+
+/**
+ * @brief Releases a view obtained from Codec_MapFile().
+ */
+void Codec_UnmapFile(sCodecMapping *Map);
+
+/**
+ * @brief Returns the decoded payload size of a history item, wherever it is stored.
+ * @param Item The item (own file in PATH_DIR_DB or segment record).
+ * @return Size in bytes, or -1 if the payload cannot be read.
+ */
+int64_t Codec_ItemGetPayloadSize(const sClipboardItem *Item);
+
+/**
+ * @brief Reads up to MaxLen decoded payload bytes from the start of a history item.
+ * @return Number of bytes read, or -1 on error.
+ */
+int64_t Codec_ItemReadHead(const sClipboardItem *Item, void *Output, size_t MaxLen);
+
+/**
+ * @brief Reads the whole decoded payload of a history item.
+ * @return Number of bytes read, ERR_OVERFLOW if the payload exceeds MaxLen, ERR on I/O errors.
+ */
+int64_t Codec_ItemRead(const sClipboardItem *Item, void *Output, size_t MaxLen);
+
+/**
+ * @brief Maps the payload of a history item read-only (see Codec_MapFile()).
+ * @return OKE on success, ERR_UNSUPPORTED if it must be read with Codec_ItemRead() instead
+ *         (compressed, empty or stored in a segment), ERR on I/O errors.
+ */
+RetType Codec_ItemMap(const sClipboardItem *Item, sCodecMapping *Map);
+
+#endif /*__CBC_CODEC_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,174 @@
+#include "CBC_Flavour.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include "CBC_MemBudget.h"
+#include "CBC_Codec.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+
+/**************************************************************************************************
+ * INTERNAL HELPERS *******************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Fixed container header.
+ */
+typedef struct {
+    uint32_t    Magic;      /// FLAVOUR_MAGIC
+    uint32_t    Version;    /// FLAVOUR_VERSION
+    uint32_t    Count;      /// Number of flavour records that follow
+} sFlavourHeader;
+
+/**
+ * @brief Builds the absolute path of an item's sidecar container.
+ */
+static void GetSidecarPath(const char *Filename, char *Output, size_t OutputSize) {
+    snprintf(Output, OutputSize, "%s/%s%s", PATH_DIR_DB, Filename, FLAVOUR_SIDECAR_EXT);
+}
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+RetType FlavourSet_Add(sFlavourSet *Set, const char *Name, const uint8_t *Data, size_t Len) {
+    if (!Set || !Name || (!Data && Len > 0)) return ERR_NULL;
+    if (Set->Count >= FLAVOUR_MAX) return ERR_OVERFLOW;
+
+    sFlavour *F = &Set->Items[Set->Count];
+    memset(F, 0, sizeof(*F));
+    snprintf(F->Name, sizeof(F->Name), "%s", Name);
+
+    if (Len > 0) {
+        F->Data = MemBudget_Alloc(Len);
+        if (!F->Data) return ERR_MALLOC_FAILED;
+        memcpy(F->Data, Data, Len);
+    }
+    F->Len = Len;
+    Set->Count++;
+    return OKE;
+}
+
+void FlavourSet_Clear(sFlavourSet *Set) {
+    if (!Set) return;
+    for (int i = 0; i < Set->Count; i++) {
+        MemBudget_Free(Set->Items[i].Data);
+    }
+    memset(Set, 0, sizeof(*Set));
+}
+
+void FlavourSet_GetSidecarName(const char *Filename, char *Output, size_t OutputSize) {
+    snprintf(Output, OutputSize, "%s%s", Filename, FLAVOUR_SIDECAR_EXT);
+}
+
+int FlavourSet_IsSidecarName(const char *Filename) {
+    size_t Len = strlen(Filename);
+    size_t ExtLen = strlen(FLAVOUR_SIDECAR_EXT);
+    return (Len > ExtLen && strcmp(Filename + Len - ExtLen, FLAVOUR_SIDECAR_EXT) == 0);
+}
+
+RetType FlavourSet_Save(const sFlavourSet *Set, const char *Filename) {
+    if (!Set || !Filename) return ERR_NULL;
+    if (Set->Count == 0) return OKE;
+
+    char FullPath[PATH_MAX], TmpPath[PATH_MAX];
+    GetSidecarPath(Filename, FullPath, sizeof(FullPath));
+    /// Hidden temporary name: XCBList_Scan() skips dot-files if we crash mid-write
+    snprintf(TmpPath, sizeof(TmpPath), "%s/.%s%s.tmp", PATH_DIR_DB, Filename, FLAVOUR_SIDECAR_EXT);
+
+    int Fd = open(TmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (Fd < 0) {
+        xError("[Flavour] Failed to open %s: %s", TmpPath, strerror(errno));
+        return ERR;
+    }
+
+    /// The container is mostly markup/text: let the codec policy decide on compression
+    size_t Total = sizeof(sFlavourHeader);
+    for (int i = 0; i < Set->Count; i++) Total += sizeof(uint32_t) + strlen(Set->Items[i].Name) + sizeof(uint64_t) + Set->Items[i].Len;
+
+    sFlavourHeader Hdr = { FLAVOUR_MAGIC, FLAVOUR_VERSION, (uint32_t)Set->Count };
+    sCodecWriter Writer;
+    Codec_WriterBegin(&Writer, Fd, Codec_ShouldCompress(eFMT_TXT, Total, (const uint8_t *)&Hdr, sizeof(Hdr)));
+
+    RetType Ret = Codec_WriterWrite(&Writer, (const uint8_t *)&Hdr, sizeof(Hdr));
+    for (int i = 0; i < Set->Count && Ret == OKE; i++) {
+        const sFlavour *F = &Set->Items[i];
+        uint32_t NameLen = (uint32_t)strlen(F->Name);
+        uint64_t DataLen = F->Len;
+        Ret = Codec_WriterWrite(&Writer, (const uint8_t *)&NameLen, sizeof(NameLen));
+        if (Ret == OKE) Ret = Codec_WriterWrite(&Writer, (const uint8_t *)F->Name, NameLen);
+        if (Ret == OKE) Ret = Codec_WriterWrite(&Writer, (const uint8_t *)&DataLen, sizeof(DataLen));
+        if (Ret == OKE && DataLen > 0) Ret = Codec_WriterWrite(&Writer, F->Data, F->Len);
+    }
+    if (Codec_WriterEnd(&Writer) != OKE) Ret = ERR;
+
+    /// Publish atomically so a reader never sees a half-written container
+    if (Ret != OKE || rename(TmpPath, FullPath) != 0) {
+        xError("[Flavour] Failed to save %s.", FullPath);
+        unlink(TmpPath);
+        return ERR;
+    }
+    return OKE;
+}
+
+RetType FlavourSet_Load(sFlavourSet *Set, const char *Filename) {
+    if (!Set || !Filename) return ERR_NULL;
+    FlavourSet_Clear(Set);
+
+    char FullPath[PATH_MAX];
+    GetSidecarPath(Filename, FullPath, sizeof(FullPath));
+
+    int64_t Size = Codec_GetPayloadSize(FullPath);
+    if (Size < 0) return OKE;   /// No sidecar: the item only has its primary target
+    if (Size < (int64_t)sizeof(sFlavourHeader)) return ERR;
+
+    uint8_t *Raw = MemBudget_Alloc((size_t)Size);
+    if (!Raw) return ERR_MALLOC_FAILED;
+
+    RetType Ret = ERR;
+    if (Codec_ReadFile(FullPath, Raw, (size_t)Size) == Size) {
+        sFlavourHeader Hdr;
+        memcpy(&Hdr, Raw, sizeof(Hdr));
+        size_t Pos = sizeof(Hdr);
+
+        if (Hdr.Magic == FLAVOUR_MAGIC && Hdr.Version == FLAVOUR_VERSION) {
+            Ret = OKE;
+            for (uint32_t i = 0; i < Hdr.Count && Ret == OKE; i++) {
+                uint32_t NameLen;
+                uint64_t DataLen;
+                char Name[FLAVOUR_NAME_MAX];
+
+                /// Bounds-check every field: a truncated container must not read past Raw
+                if (Pos + sizeof(NameLen) > (size_t)Size) { Ret = ERR; break; }
+                memcpy(&NameLen, Raw + Pos, sizeof(NameLen));
+                Pos += sizeof(NameLen);
+                if (NameLen >= FLAVOUR_NAME_MAX || Pos + NameLen + sizeof(DataLen) > (size_t)Size) { Ret = ERR; break; }
+                memcpy(Name, Raw + Pos, NameLen);
+                Name[NameLen] = '\0';
+                Pos += NameLen;
+                memcpy(&DataLen, Raw + Pos, sizeof(DataLen));
+                Pos += sizeof(DataLen);
+                if (DataLen > (uint64_t)Size - Pos) { Ret = ERR; break; }
+
+                Ret = FlavourSet_Add(Set, Name, Raw + Pos, (size_t)DataLen);
+                Pos += (size_t)DataLen;
+            }
+        }
+    }
+
+    MemBudget_Free(Raw);
+    if (Ret != OKE) {
+        xWarn("[Flavour] Ignoring unreadable container %s.", FullPath);
+        FlavourSet_Clear(Set);
+    }
+    return Ret;
+}
+
+void FlavourSet_Remove(const char *Filename) {
+    char FullPath[PATH_MAX];
+    GetSidecarPath(Filename, FullPath, sizeof(FullPath));
+    unlink(FullPath);
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
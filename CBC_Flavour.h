@@ -0,0 +1,124 @@
+#ifndef __CBC_FLAVOUR_H__
+#define __CBC_FLAVOUR_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * FLAVOUR CONTAINER CONFIGURATION SECTION ********************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Maximum number of extra targets (flavours) stored next to a clipboard item.
+ */
+#define FLAVOUR_MAX             8
+
+/**
+ * @brief Maximum length of a target name (e.g., "text/html"), including the terminator.
+ */
+#define FLAVOUR_NAME_MAX        64
+
+/**
+ * @brief Filename suffix of the flavour container stored beside an item in PATH_DIR_DB.
+ */
+#define FLAVOUR_SIDECAR_EXT     ".mt"
+
+/**
+ * @brief Magic bytes at the start of a flavour container ("XCBM").
+ */
+#define FLAVOUR_MAGIC           0x4D424358U
+
+/**
+ * @brief Current flavour container format version.
+ */
+#define FLAVOUR_VERSION         1U
+
+/**************************************************************************************************
+ * FLAVOUR CONTAINER TYPES ************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief One extra representation of a clipboard item (e.g., the text/html of a copied paragraph).
+ */
+typedef struct {
+    char                Name[FLAVOUR_NAME_MAX]; /// Target name as interned on the X Server
+    uint32_t            Atom;                   /// Resolved atom (0 until interned by the provider)
+    uint8_t            *Data;                   /// Payload (MemBudget buffer)
+    size_t              Len;                    /// Payload size in bytes
+} sFlavour;
+
+/**
+ * @brief Set of flavours belonging to a single clipboard item.
+ */
+typedef struct {
+    int                 Count;
+    sFlavour            Items[FLAVOUR_MAX];
+} sFlavourSet;
+
+/**************************************************************************************************
+ * FLAVOUR CONTAINER PROTOTYPES *******************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Copies a payload into the set under the given target name.
+ * @param Set The flavour set.
+ * @param Name Target name (e.g., "text/html").
+ * @param Data Payload bytes.
+ * @param Len Payload size in bytes.
+ * @return OKE on success, ERR_OVERFLOW if the set is full, ERR_MALLOC_FAILED if the budget refuses.
+ */
+RetType FlavourSet_Add(sFlavourSet *Set, const char *Name, const uint8_t *Data, size_t Len);
+
+/**
+ * @brief Releases every payload and empties the set.
+ * @param Set The flavour set.
+ */
+void FlavourSet_Clear(sFlavourSet *Set);
+
+/**
+ * @brief Builds the sidecar filename of an item (e.g., "X.txt" -> "X.txt.mt").
+ * @param Filename The item filename.
+ * @param Output Buffer receiving the sidecar filename.
+ * @param OutputSize Capacity of Output.
+ */
+void FlavourSet_GetSidecarName(const char *Filename, char *Output, size_t OutputSize);
+
+/**
+ * @brief Checks whether a filename is a flavour sidecar (and therefore not an item).
+ * @param Filename The filename to check.
+ * @return 1 if it ends with FLAVOUR_SIDECAR_EXT, 0 otherwise.
+ */
+int FlavourSet_IsSidecarName(const char *Filename);
+
+/**
+ * @brief Writes the set as the sidecar container of an item inside PATH_DIR_DB.
+ * @param Set The flavour set (nothing is written when empty).
+ * @param Filename The item filename the flavours belong to.
+ * @return OKE on success, ERR on I/O failure.
+ * @note The container goes through the storage codec, so large text flavours are compressed.
+ */
+RetType FlavourSet_Save(const sFlavourSet *Set, const char *Filename);
+
+/**
+ * @brief Loads the sidecar container of an item.
+ * @param Set The set to fill (cleared first).
+ * @param Filename The item filename.
+ * @return OKE on success (an absent sidecar yields an empty set), ERR on corrupt data.
+ */
+RetType FlavourSet_Load(sFlavourSet *Set, const char *Filename);
+
+/**
+ * @brief Deletes the sidecar container of an item, if any.
+ * @param Filename The item filename.
+ */
+void FlavourSet_Remove(const char *Filename);
+
+#endif /*__CBC_FLAVOUR_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
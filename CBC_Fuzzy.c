@@ -0,0 +1,348 @@
+#include "CBC_Fuzzy.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+
+#if (FUZZY_SIMD == 1) && (defined(__x86_64__) || defined(__i386__))
+    #include <immintrin.h>
+    #define FUZZY_X86                   1
+#else
+    #define FUZZY_X86                   0
+#endif
+
+/**************************************************************************************************
+ * INTERNAL TYPES *********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Scoring of a match window (same scheme as fzf): every matched byte scores, gaps cost,
+ *        and matches at word starts or right after the previous one earn a bonus.
+ */
+#define FUZZY_SCORE_MATCH               16
+#define FUZZY_GAP_START                 (-3)
+#define FUZZY_GAP_EXTENSION             (-1)
+#define FUZZY_BONUS_BOUNDARY            (FUZZY_SCORE_MATCH / 2)
+#define FUZZY_BONUS_WHITE               (FUZZY_BONUS_BOUNDARY + 2)  /// Word start after a blank
+#define FUZZY_BONUS_DELIMITER           (FUZZY_BONUS_BOUNDARY + 1)  /// Word start after / , : ; |
+#define FUZZY_BONUS_NON_WORD            FUZZY_BONUS_BOUNDARY
+#define FUZZY_BONUS_CAMEL_123           (FUZZY_BONUS_BOUNDARY - 1)  /// aB or a1
+#define FUZZY_BONUS_CONSECUTIVE         (-(FUZZY_GAP_START + FUZZY_GAP_EXTENSION))
+#define FUZZY_BONUS_FIRST_MULTIPLIER    2
+
+enum eFuzzyClass {
+    eFZ_WHITE = 0,
+    eFZ_NON_WORD,
+    eFZ_DELIMITER,
+    eFZ_LOWER,
+    eFZ_UPPER,
+    eFZ_LETTER,     /// Non-ASCII byte
+    eFZ_NUMBER
+};
+
+/**
+ * @brief Finds the first byte equal to Lower or Upper in [From, End).
+ * @note May read up to FUZZY_PAD bytes past End (never past the table padding).
+ */
+typedef const uint8_t *(*FuzzyFindFn)(const uint8_t *From, const uint8_t *End, uint8_t Lower, uint8_t Upper);
+
+/**************************************************************************************************
+ * INTERNAL HELPERS *******************************************************************************
+ **************************************************************************************************/
+
+static inline uint8_t Internal_Fold(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + 32) : c;
+}
+
+static inline uint8_t Internal_Upper(uint8_t c) {
+    return (c >= 'a' && c <= 'z') ? (uint8_t)(c - 32) : c;
+}
+
+/**
+ * @brief Prefilter bit of a folded byte: letters and digits get one each, other bytes share the rest.
+ */
+static inline uint64_t Internal_Bit(uint8_t c) {
+    if (c >= 'a' && c <= 'z') return 1ULL << (c - 'a');
+    if (c >= '0' && c <= '9') return 1ULL << (26 + c - '0');
+    return 1ULL << (36 + c % 28);
+}
+
+static inline enum eFuzzyClass Internal_Class(uint8_t c) {
+    if (c >= 'a' && c <= 'z') return eFZ_LOWER;
+    if (c >= 'A' && c <= 'Z') return eFZ_UPPER;
+    if (c >= '0' && c <= '9') return eFZ_NUMBER;
+    if (c >= 0x80) return eFZ_LETTER;
+    if (c == ' ' || c == '\t') return eFZ_WHITE;
+    if (c == '/' || c == ',' || c == ':' || c == ';' || c == '|') return eFZ_DELIMITER;
+    return eFZ_NON_WORD;
+}
+
+static inline int32_t Internal_Bonus(enum eFuzzyClass Prev, enum eFuzzyClass Class) {
+    if (Class > eFZ_DELIMITER) {
+        if (Prev == eFZ_WHITE) return FUZZY_BONUS_WHITE;
+        if (Prev == eFZ_DELIMITER) return FUZZY_BONUS_DELIMITER;
+        if (Prev == eFZ_NON_WORD) return FUZZY_BONUS_BOUNDARY;
+    }
+    if ((Prev == eFZ_LOWER && Class == eFZ_UPPER) || (Prev != eFZ_NUMBER && Class == eFZ_NUMBER)) {
+        return FUZZY_BONUS_CAMEL_123;
+    }
+    if (Class == eFZ_WHITE) return FUZZY_BONUS_WHITE;
+    if (Class == eFZ_NON_WORD || Class == eFZ_DELIMITER) return FUZZY_BONUS_NON_WORD;
+    return 0;
+}
+
+#if (FUZZY_X86 == 0)
+static const uint8_t *Internal_FindScalar(const uint8_t *From, const uint8_t *End, uint8_t Lower, uint8_t Upper) {
+    for (; From < End; From++) {
+        if (*From == Lower || *From == Upper) return From;
+    }
+    return NULL;
+}
+#else
+static const uint8_t *Internal_FindSse2(const uint8_t *From, const uint8_t *End, uint8_t Lower, uint8_t Upper) {
+    const __m128i L = _mm_set1_epi8((char)Lower);
+    const __m128i U = _mm_set1_epi8((char)Upper);
+
+    for (; From < End; From += 16) {
+        __m128i Block = _mm_loadu_si128((const __m128i *)From);
+        uint32_t Bits = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(Block, L), _mm_cmpeq_epi8(Block, U)));
+        if (Bits) {
+            const uint8_t *Hit = From + __builtin_ctz(Bits);
+            return (Hit < End) ? Hit : NULL;
+        }
+    }
+    return NULL;
+}
+
+__attribute__((target("avx2")))
+static const uint8_t *Internal_FindAvx2(const uint8_t *From, const uint8_t *End, uint8_t Lower, uint8_t Upper) {
+    const __m256i L = _mm256_set1_epi8((char)Lower);
+    const __m256i U = _mm256_set1_epi8((char)Upper);
+
+    for (; From < End; From += 32) {
+        __m256i Block = _mm256_loadu_si256((const __m256i *)From);
+        uint32_t Bits = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(Block, L), _mm256_cmpeq_epi8(Block, U)));
+        if (Bits) {
+            const uint8_t *Hit = From + __builtin_ctz(Bits);
+            return (Hit < End) ? Hit : NULL;
+        }
+    }
+    return NULL;
+}
+#endif /*FUZZY_X86*/
+
+/**
+ * @brief The byte search of the running CPU (the Makefile targets the baseline ISA only).
+ */
+static FuzzyFindFn Internal_PickFind(void) {
+#if (FUZZY_X86 == 1)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Internal_FindAvx2;
+    return Internal_FindSse2;
+#else
+    return Internal_FindScalar;
+#endif
+}
+
+/**
+ * @brief Scores the window [Start, End) of a haystack, whose bytes hold the whole query in order.
+ */
+static int32_t Internal_Score(const uint8_t *Text, const uint8_t *Start, const uint8_t *End,
+                              const uint8_t *Query, size_t Len) {
+    enum eFuzzyClass Prev = (Start > Text) ? Internal_Class(Start[-1]) : eFZ_WHITE;
+    int32_t Score = 0, FirstBonus = 0;
+    int InGap = 0, Consecutive = 0;
+    size_t q = 0;
+
+    for (const uint8_t *p = Start; p < End; p++) {
+        enum eFuzzyClass Class = Internal_Class(*p);
+        if (q < Len && Internal_Fold(*p) == Query[q]) {
+            int32_t Bonus = Internal_Bonus(Prev, Class);
+            if (Consecutive == 0) {
+                FirstBonus = Bonus;
+            } else {
+                /// A run keeps the bonus of its first byte, unless it crosses a better boundary
+                if (Bonus >= FUZZY_BONUS_BOUNDARY && Bonus > FirstBonus) FirstBonus = Bonus;
+                if (Bonus < FirstBonus) Bonus = FirstBonus;
+                if (Bonus < FUZZY_BONUS_CONSECUTIVE) Bonus = FUZZY_BONUS_CONSECUTIVE;
+            }
+            Score += FUZZY_SCORE_MATCH + ((q == 0) ? Bonus * FUZZY_BONUS_FIRST_MULTIPLIER : Bonus);
+            InGap = 0;
+            Consecutive++;
+            q++;
+        } else {
+            Score += InGap ? FUZZY_GAP_EXTENSION : FUZZY_GAP_START;
+            InGap = 1;
+            Consecutive = 0;
+            FirstBonus = 0;
+        }
+        Prev = Class;
+    }
+    return Score;
+}
+
+/**
+ * @brief Matches a folded query as a subsequence of one haystack and scores the tightest window.
+ * @return 1 and the score in *Score on a match, 0 otherwise.
+ */
+static int Internal_Match(FuzzyFindFn Find, const uint8_t *Text, const uint8_t *End,
+                          const uint8_t *Query, size_t Len, int32_t *Score) {
+    /// 1. Forward: the first occurrence of each query byte after the previous one (vector search)
+    const uint8_t *p = Text;
+    for (size_t q = 0; q < Len; q++) {
+        p = Find(p, End, Query[q], Internal_Upper(Query[q]));
+        if (!p) return 0;
+        p++;
+    }
+    const uint8_t *Last = p;
+
+    /// 2. Backward from the last match: the latest start still holding the whole query
+    const uint8_t *Start = Last;
+    for (size_t q = Len; q > 0; ) {
+        Start--;
+        if (Internal_Fold(*Start) == Query[q - 1]) q--;
+    }
+
+    *Score = Internal_Score(Text, Start, Last, Query, Len);
+    return 1;
+}
+
+/**
+ * @brief Orders two matches: 1 if A ranks below B (lower score, or same score and older row).
+ */
+static inline int Internal_Worse(const sFuzzyMatch *A, const sFuzzyMatch *B) {
+    return (A->Score < B->Score) || (A->Score == B->Score && A->Row > B->Row);
+}
+
+/**
+ * @brief Restores the min-heap (worst match on top) below Index.
+ */
+static void Internal_SiftDown(sFuzzyMatch *Heap, int Count, int Index) {
+    for (;;) {
+        int Child = 2 * Index + 1;
+        if (Child >= Count) return;
+        if (Child + 1 < Count && Internal_Worse(&Heap[Child + 1], &Heap[Child])) Child++;
+        if (!Internal_Worse(&Heap[Child], &Heap[Index])) return;
+        sFuzzyMatch Tmp = Heap[Index];
+        Heap[Index] = Heap[Child];
+        Heap[Child] = Tmp;
+        Index = Child;
+    }
+}
+
+static void Internal_Push(sFuzzyMatch *Heap, int *Count, int K, int Row, int32_t Score) {
+    sFuzzyMatch Match = { .Row = Row, .Score = Score };
+
+    if (*Count < K) {
+        int Index = (*Count)++;
+        while (Index > 0) {
+            int Parent = (Index - 1) / 2;
+            if (!Internal_Worse(&Match, &Heap[Parent])) break;
+            Heap[Index] = Heap[Parent];
+            Index = Parent;
+        }
+        Heap[Index] = Match;
+    } else if (K > 0 && Internal_Worse(&Heap[0], &Match)) {
+        Heap[0] = Match;
+        Internal_SiftDown(Heap, K, 0);
+    }
+}
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+RetType Fuzzy_Build(sFuzzyTable *Table, const sXCBListSnapshot *Snapshot) {
+    memset(Table, 0, sizeof(*Table));
+
+    size_t Total = 0;
+    for (int i = 0; i < Snapshot->Count; i++) {
+        const sXCBListRow *Row = XCBList_SnapshotRow(Snapshot, i);
+        Total += strlen(Row->Preview) + 1 + strlen(Row->Name);
+    }
+    if (Total > UINT32_MAX) return ERR;
+
+    Table->Text = malloc(Total + FUZZY_PAD);
+    Table->Offset = malloc(((size_t)Snapshot->Count + 1) * sizeof(uint32_t));
+    Table->Mask = malloc(((size_t)Snapshot->Count + 1) * sizeof(uint64_t));
+    if (!Table->Text || !Table->Offset || !Table->Mask) {
+        Fuzzy_Free(Table);
+        return ERR;
+    }
+
+    /// Preview, then name: the name (time stamp) also matches images, which have no preview
+    uint8_t *Out = Table->Text;
+    for (int i = 0; i < Snapshot->Count; i++) {
+        const sXCBListRow *Row = XCBList_SnapshotRow(Snapshot, i);
+        uint8_t *Begin = Out;
+        size_t Len = strlen(Row->Preview);
+        if (Len > 0) {
+            memcpy(Out, Row->Preview, Len);
+            Out += Len;
+            *Out++ = ' ';
+        }
+        Len = strlen(Row->Name);
+        memcpy(Out, Row->Name, Len);
+        Out += Len;
+
+        uint64_t Mask = 0;
+        for (const uint8_t *p = Begin; p < Out; p++) Mask |= Internal_Bit(Internal_Fold(*p));
+        Table->Offset[i] = (uint32_t)(Begin - Table->Text);
+        Table->Mask[i] = Mask;
+    }
+    Table->Offset[Snapshot->Count] = (uint32_t)(Out - Table->Text);
+    memset(Out, 0, FUZZY_PAD);
+    Table->Count = Snapshot->Count;
+    return OKE;
+}
+
+void Fuzzy_Free(sFuzzyTable *Table) {
+    free(Table->Text);
+    free(Table->Offset);
+    free(Table->Mask);
+    memset(Table, 0, sizeof(*Table));
+}
+
+int Fuzzy_Rank(const sFuzzyTable *Table, const char *Query, size_t Len, const uint8_t *Keep,
+               int *Rows, int Count, sFuzzyMatch *Top, int K, int *TopCount) {
+    static FuzzyFindFn Find = NULL;
+    if (!Find) Find = Internal_PickFind();
+
+    uint8_t Folded[FUZZY_QUERY_MAX];
+    uint64_t QueryMask = 0;
+    if (Len > sizeof(Folded)) Len = sizeof(Folded);
+    for (size_t i = 0; i < Len; i++) {
+        Folded[i] = Internal_Fold((uint8_t)Query[i]);
+        QueryMask |= Internal_Bit(Folded[i]);
+    }
+
+    int Kept = 0, Heap = 0;
+    for (int i = 0; i < Count; i++) {
+        int Row = Rows[i];
+        int32_t Score = 0;
+        /// The mask test rejects most rows before their haystack is touched
+        int Match = ((Table->Mask[Row] & QueryMask) == QueryMask) &&
+                    Internal_Match(Find, Table->Text + Table->Offset[Row], Table->Text + Table->Offset[Row + 1],
+                                   Folded, Len, &Score);
+        if (!Match) {
+            if (!Keep || !Keep[Row]) continue;
+            Score = FUZZY_SCORE_KEPT;
+        }
+        Rows[Kept++] = Row;
+        Internal_Push(Top, &Heap, K, Row, Score);
+    }
+
+    /// Heap sort: the worst match goes last each round, leaving the best first
+    *TopCount = Heap;
+    while (Heap > 1) {
+        sFuzzyMatch Tmp = Top[0];
+        Top[0] = Top[--Heap];
+        Top[Heap] = Tmp;
+        Internal_SiftDown(Top, Heap, 0);
+    }
+    return Kept;
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,89 @@
+#ifndef __CBC_FUZZY_H__
+#define __CBC_FUZZY_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * FUZZY CONFIGURATION SECTION ********************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Zero bytes after the last haystack, so vector loads never leave the table.
+ */
+#define FUZZY_PAD                       32
+
+/**
+ * @brief Longest query (bytes) scored; the rest is ignored.
+ */
+#define FUZZY_QUERY_MAX                 256
+
+/**
+ * @brief Score given to rows kept without a fuzzy match (see Fuzzy_Rank()): ranked after every match.
+ */
+#define FUZZY_SCORE_KEPT                (INT32_MIN / 2)
+
+/**************************************************************************************************
+ * FUZZY TYPES ************************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Haystacks of a snapshot ("preview name", ASCII case-folded), packed for the matcher.
+ */
+typedef struct {
+    uint8_t    *Text;           /// Haystacks back to back, FUZZY_PAD zero bytes after the last
+    uint32_t   *Offset;         /// Row -> start of its haystack in Text (Count + 1 entries)
+    uint64_t   *Mask;           /// Row -> one bit per byte class present (see the prefilter)
+    int         Count;
+} sFuzzyTable;
+
+/**
+ * @brief One ranked row.
+ */
+typedef struct {
+    int         Row;
+    int32_t     Score;
+} sFuzzyMatch;
+
+/**************************************************************************************************
+ * FUZZY PROTOTYPES *******************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Builds the haystacks of every row of a snapshot.
+ * @return OKE on success, ERR on allocation failure.
+ * @note One pass over the previews already in the snapshot: no payload is read.
+ */
+RetType Fuzzy_Build(sFuzzyTable *Table, const sXCBListSnapshot *Snapshot);
+
+/**
+ * @brief Releases a table built by Fuzzy_Build().
+ */
+void Fuzzy_Free(sFuzzyTable *Table);
+
+/**
+ * @brief Scores candidate rows against a query and keeps the best ones.
+ * @param Query The query, matched as an ordered subsequence (ASCII case-insensitive).
+ * @param Len Length of Query in bytes.
+ * @param Keep Optional per-row flags: a flagged row survives without a match, scored FUZZY_SCORE_KEPT.
+ * @param Rows Candidate rows in ascending order. On return, the rows that survived (same order).
+ * @param Count Number of candidates.
+ * @param Top Receives the K best rows, best first (ties: lower row, i.e. newer item, first).
+ * @param K Capacity of Top.
+ * @param TopCount Receives the number of rows written to Top.
+ * @return The number of surviving rows.
+ * @note A query that only grew can be matched against the previous survivors alone: a row that
+ *       does not hold a query as a subsequence cannot hold any longer one.
+ */
+int Fuzzy_Rank(const sFuzzyTable *Table, const char *Query, size_t Len, const uint8_t *Keep,
+               int *Rows, int Count, sFuzzyMatch *Top, int K, int *TopCount);
+
+#endif /*__CBC_FUZZY_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
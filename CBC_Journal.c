@@ -0,0 +1,282 @@
+#include "CBC_Journal.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+
+/**************************************************************************************************
+ * INTERNAL TYPES SECTION *************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Fixed journal header.
+ */
+typedef struct {
+    uint32_t    Magic;      /// JOURNAL_MAGIC
+    uint32_t    Version;    /// JOURNAL_VERSION
+} sJournalHeader;
+
+/**
+ * @brief Fixed part of a record. The filename (NameLen bytes, no terminator) follows it, then
+ *        the menu preview (PreviewLen bytes, PUSH records only).
+ */
+typedef struct {
+    uint32_t    Crc;            /// CRC32 of the rest of the record (fields below + filename + preview)
+    uint8_t     Op;             /// eJournalOp
+    uint8_t     FileType;       /// XCBFileType
+    uint16_t    NameLen;
+    int64_t     Timestamp;
+    uint64_t    ContentHash;
+    uint64_t    ContentSize;
+    uint32_t    Segment;        /// Segment holding the payload (0 = own file)
+    uint32_t    Lines;          /// Line count of a text payload (0 = empty or unknown)
+    uint64_t    SegOffset;
+    uint16_t    PreviewLen;
+    uint16_t    Reserved[3];
+} sJournalRecord;
+
+_Static_assert(sizeof(sJournalRecord) == 56, "sJournalRecord must stay 56 bytes (on-disk format)");
+
+/**
+ * @brief Largest encoded record (fixed part, filename and preview).
+ */
+#define JOURNAL_RECORD_MAX      (sizeof(sJournalRecord) + NAME_MAX + PREVIEW_TXT_LEN)
+
+/**************************************************************************************************
+ * INTERNAL DATA SECTION **************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Append descriptor of PATH_ITEM (-1 until replayed or rewritten).
+ */
+static int              JournalFd = -1;
+
+/**
+ * @brief Records currently in the journal.
+ */
+static int              JournalRecords = 0;
+
+/**************************************************************************************************
+ * INTERNAL HELPERS *******************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief CRC32 of a record, skipping its own Crc field.
+ * @param Tail The filename immediately followed by the preview.
+ */
+static uint32_t Internal_RecordCrc(const sJournalRecord *Rec, const char *Tail) {
+    uLong Crc = crc32(0L, Z_NULL, 0);
+    Crc = crc32(Crc, (const Bytef *)Rec + sizeof(Rec->Crc), sizeof(*Rec) - sizeof(Rec->Crc));
+    return (uint32_t)crc32(Crc, (const Bytef *)Tail, (uInt)Rec->NameLen + Rec->PreviewLen);
+}
+
+/**
+ * @brief Serializes one record into Output.
+ * @param Output At least JOURNAL_RECORD_MAX bytes.
+ * @return Number of bytes written (record + filename + preview).
+ */
+static size_t Internal_EncodeRecord(enum eJournalOp Op, const sClipboardItem *Item, uint8_t *Output) {
+    sJournalRecord Rec;
+    memset(&Rec, 0, sizeof(Rec));
+    const char *Name = "";
+    uint8_t *Tail = Output + sizeof(Rec);
+
+    Rec.Op = (uint8_t)Op;
+    if (Item && Op != eJOURNAL_CLEAR) {
+        Name = Item->Filename;
+        Rec.NameLen = (uint16_t)strnlen(Item->Filename, NAME_MAX);
+        Rec.FileType = (uint8_t)Item->FileType;
+        Rec.Timestamp = (int64_t)Item->Timestamp;
+        Rec.ContentHash = Item->ContentHash;
+        Rec.ContentSize = Item->ContentSize;
+        Rec.Segment = Item->Segment;
+        Rec.SegOffset = Item->SegOffset;
+        Rec.Lines = Item->Lines;
+
+        /// Only PUSH creates an item: the other records never need its preview
+        if (Op == eJOURNAL_PUSH) Rec.PreviewLen = (uint16_t)strnlen(Item->Preview, PREVIEW_TXT_LEN);
+    }
+
+    memcpy(Tail, Name, Rec.NameLen);
+    if (Rec.PreviewLen > 0) memcpy(Tail + Rec.NameLen, Item->Preview, Rec.PreviewLen);
+    Rec.Crc = Internal_RecordCrc(&Rec, (const char *)Tail);
+    memcpy(Output, &Rec, sizeof(Rec));
+    return sizeof(Rec) + Rec.NameLen + Rec.PreviewLen;
+}
+
+/**
+ * @brief Writes a whole buffer, retrying short writes.
+ */
+static RetType Internal_WriteAll(int Fd, const uint8_t *Data, size_t Len) {
+    while (Len > 0) {
+        ssize_t Written = write(Fd, Data, Len);
+        if (Written < 0) {
+            if (errno == EINTR) continue;
+            return ERR;
+        }
+        Data += Written;
+        Len -= (size_t)Written;
+    }
+    return OKE;
+}
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+RetType Journal_Replay(JournalApplyFn Apply) {
+    xEntry1("Journal_Replay");
+
+    int Fd = open(PATH_ITEM, O_RDWR | O_CLOEXEC);
+    if (Fd < 0) return ERR;
+
+    struct stat St;
+    if (fstat(Fd, &St) != 0 || St.st_size < (off_t)sizeof(sJournalHeader)) {
+        close(Fd);
+        return ERR;
+    }
+
+    /// The journal is bounded by compaction (JOURNAL_COMPACT_FACTOR): read it in one go
+    size_t Size = (size_t)St.st_size;
+    uint8_t *Raw = malloc(Size);
+    if (!Raw || pread(Fd, Raw, Size, 0) != (ssize_t)Size) {
+        free(Raw);
+        close(Fd);
+        return ERR;
+    }
+
+    sJournalHeader Hdr;
+    memcpy(&Hdr, Raw, sizeof(Hdr));
+    if (Hdr.Magic != JOURNAL_MAGIC || Hdr.Version != JOURNAL_VERSION) {
+        xWarn("[Journal] %s has an unknown header. Ignoring it.", PATH_ITEM);
+        free(Raw);
+        close(Fd);
+        return ERR;
+    }
+
+    size_t Pos = sizeof(Hdr);
+    int Records = 0;
+    while (Pos + sizeof(sJournalRecord) <= Size) {
+        sJournalRecord Rec;
+        memcpy(&Rec, Raw + Pos, sizeof(Rec));
+        const char *Name = (const char *)Raw + Pos + sizeof(Rec);
+
+        /// Stop at the first record that is cut short or fails its checksum
+        if (Rec.NameLen > NAME_MAX || Rec.PreviewLen > PREVIEW_TXT_LEN) break;
+        if (Pos + sizeof(Rec) + Rec.NameLen + Rec.PreviewLen > Size) break;
+        if (Rec.Op < eJOURNAL_PUSH || Rec.Op > eJOURNAL_MOVE) break;
+        if (Internal_RecordCrc(&Rec, Name) != Rec.Crc) break;
+
+        sClipboardItem Item;
+        memset(&Item, 0, sizeof(Item));
+        memcpy(Item.Filename, Name, Rec.NameLen);
+        Item.Timestamp = (time_t)Rec.Timestamp;
+        Item.FileType = (enum XCBFileType)Rec.FileType;
+        Item.ContentHash = Rec.ContentHash;
+        Item.ContentSize = Rec.ContentSize;
+        Item.Segment = Rec.Segment;
+        Item.SegOffset = Rec.SegOffset;
+        Item.Lines = Rec.Lines;
+        memcpy(Item.Preview, Name + Rec.NameLen, Rec.PreviewLen);
+        Apply((enum eJournalOp)Rec.Op, &Item);
+
+        Pos += sizeof(Rec) + Rec.NameLen + Rec.PreviewLen;
+        Records++;
+    }
+    free(Raw);
+
+    if (Pos < Size) {
+        xWarn("[Journal] Dropping %zu trailing bytes (torn or corrupted record).", Size - Pos);
+        if (ftruncate(Fd, (off_t)Pos) != 0) {
+            close(Fd);
+            return ERR;
+        }
+    }
+    close(Fd);
+
+    Journal_Close();
+    JournalFd = open(PATH_ITEM, O_WRONLY | O_APPEND | O_CLOEXEC);
+    JournalRecords = Records;
+
+    xLog1("[Journal] Replayed %d records.", Records);
+    xExit1("Journal_Replay");
+    return (JournalFd >= 0) ? OKE : ERR;
+}
+
+RetType Journal_Append(enum eJournalOp Op, const sClipboardItem *Item) {
+    if (JournalFd < 0) return ERR;
+
+    /// One write() per record: a crash leaves at most one torn record at the tail
+    uint8_t Buffer[JOURNAL_RECORD_MAX];
+    size_t Len = Internal_EncodeRecord(Op, Item, Buffer);
+    if (Internal_WriteAll(JournalFd, Buffer, Len) != OKE) {
+        xWarn("[Journal] Append failed: %s", strerror(errno));
+        return ERR;
+    }
+    JournalRecords++;
+    return OKE;
+}
+
+RetType Journal_Rewrite(JournalItemFn GetItem, int Count) {
+    xEntry1("Journal_Rewrite(%d)", Count);
+
+    char TmpPath[PATH_MAX];
+    snprintf(TmpPath, sizeof(TmpPath), "%s.tmp", PATH_ITEM);
+
+    int Fd = open(TmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (Fd < 0) {
+        xError("[Journal] Failed to open %s: %s", TmpPath, strerror(errno));
+        return ERR;
+    }
+
+    sJournalHeader Hdr = { JOURNAL_MAGIC, JOURNAL_VERSION };
+    RetType Ret = Internal_WriteAll(Fd, (const uint8_t *)&Hdr, sizeof(Hdr));
+
+    /// Batch records so a full history costs a handful of syscalls
+    uint8_t Buffer[64 * 1024];
+    size_t Used = 0;
+    sClipboardItem Item;
+    for (int i = 0; i < Count && Ret == OKE; i++) {
+        if (Used + JOURNAL_RECORD_MAX > sizeof(Buffer)) {
+            Ret = Internal_WriteAll(Fd, Buffer, Used);
+            Used = 0;
+        }
+        GetItem(i, &Item);
+        Used += Internal_EncodeRecord(eJOURNAL_PUSH, &Item, Buffer + Used);
+    }
+    if (Ret == OKE && Used > 0) Ret = Internal_WriteAll(Fd, Buffer, Used);
+    if (Ret == OKE && fdatasync(Fd) != 0) Ret = ERR;
+    if (close(Fd) != 0) Ret = ERR;
+
+    /// Publish atomically: a crash leaves either the old or the new journal, never a mix
+    if (Ret != OKE || rename(TmpPath, PATH_ITEM) != 0) {
+        xError("[Journal] Failed to rewrite %s.", PATH_ITEM);
+        unlink(TmpPath);
+        return ERR;
+    }
+
+    Journal_Close();
+    JournalFd = open(PATH_ITEM, O_WRONLY | O_APPEND | O_CLOEXEC);
+    JournalRecords = Count;
+
+    xExit1("Journal_Rewrite");
+    return (JournalFd >= 0) ? OKE : ERR;
+}
+
+RetType Journal_Sync(void) {
+    if (JournalFd < 0) return ERR;
+    return (fdatasync(JournalFd) == 0) ? OKE : ERR;
+}
+
+int Journal_GetRecordCount(void) {
+    return JournalRecords;
+}
+
+void Journal_Close(void) {
+    if (JournalFd >= 0) close(JournalFd);
+    JournalFd = -1;
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,106 @@
+#ifndef __CBC_JOURNAL_H__
+#define __CBC_JOURNAL_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * JOURNAL CONFIGURATION SECTION ******************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Magic bytes at the start of the history journal ("XCBJ").
+ */
+#define JOURNAL_MAGIC           0x4A424358U
+
+/**
+ * @brief Current journal format version.
+ */
+#define JOURNAL_VERSION         3U
+
+/**************************************************************************************************
+ * JOURNAL TYPES **********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Journal record types, replayed in file order.
+ */
+enum eJournalOp {
+    eJOURNAL_PUSH = 1,          /// Item added as the newest entry
+    eJOURNAL_REMOVE,            /// Item (by filename) removed from the history
+    eJOURNAL_PROMOTE,           /// Item (by filename) moved to the newest position
+    eJOURNAL_CLEAR,             /// History emptied
+    eJOURNAL_MOVE               /// Item (by filename) relocated to another segment record
+};
+
+/**
+ * @brief Called once per valid record during Journal_Replay().
+ * @param Op The record type.
+ * @param Item Filename, Timestamp, FileType, ContentHash, ContentSize, Segment, SegOffset, Lines and
+ *             (PUSH records only) Preview of the record.
+ */
+typedef void (*JournalApplyFn)(enum eJournalOp Op, const sClipboardItem *Item);
+
+/**
+ * @brief Called once per live item by Journal_Rewrite().
+ * @param Index Position of the item, 0 being the oldest.
+ * @param Item Receives the item to write as a PUSH record.
+ */
+typedef void (*JournalItemFn)(int Index, sClipboardItem *Item);
+
+/**************************************************************************************************
+ * JOURNAL PROTOTYPES *****************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Replays PATH_ITEM record by record and opens it for appending.
+ * @param Apply Callback receiving every valid record, oldest first.
+ * @return OKE if the journal was replayed, ERR if it is missing or its header is invalid.
+ * @note A torn or corrupted tail (crash mid-append) is truncated at the last valid record.
+ */
+RetType Journal_Replay(JournalApplyFn Apply);
+
+/**
+ * @brief Appends one checksummed record. No-op (ERR) until the journal is replayed or rewritten.
+ * @param Op The record type.
+ * @param Item The item the record describes (only the filename is used for REMOVE/PROMOTE, the filename
+ *             and location for MOVE, nothing for CLEAR).
+ * @return OKE on success, ERR if the journal is not open or the write fails.
+ */
+RetType Journal_Append(enum eJournalOp Op, const sClipboardItem *Item);
+
+/**
+ * @brief Compacts the journal into one PUSH record per live item (atomic rename) and reopens it.
+ * @param GetItem Callback producing the live items, oldest first.
+ * @param Count Number of items.
+ * @return OKE on success, ERR on I/O failure (the previous journal is kept).
+ */
+RetType Journal_Rewrite(JournalItemFn GetItem, int Count);
+
+/**
+ * @brief Flushes appended records to disk (fdatasync).
+ * @return OKE on success, ERR if the journal is not open or the sync fails.
+ * @note Required before deleting data that the previous records still point to.
+ */
+RetType Journal_Sync(void);
+
+/**
+ * @brief Returns the number of records currently in the journal.
+ * @return The record count (compare against JOURNAL_COMPACT_FACTOR times the capacity).
+ */
+int Journal_GetRecordCount(void);
+
+/**
+ * @brief Closes the append descriptor.
+ */
+void Journal_Close(void);
+
+#endif /*__CBC_JOURNAL_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
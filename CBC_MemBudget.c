@@ -0,0 +1,125 @@
+#include "CBC_MemBudget.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+#include <stdatomic.h>
+#include <malloc.h>
+#include <sys/mman.h>
+
+/**************************************************************************************************
+ * INTERNAL TYPES SECTION *************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Magic number stamped in every block header to catch foreign pointers.
+ */
+#define MEM_BUDGET_MAGIC        0x43424D42U /* "CBMB" */
+
+/**
+ * @brief Hidden header placed right before every block handed to the caller.
+ * @note Kept at 16 bytes so the payload stays 16-byte aligned.
+ */
+typedef struct {
+    size_t      Len;        /// Payload bytes accounted against the ceiling
+    uint32_t    IsMapped;   /// 1 = private anonymous mapping, 0 = malloc arena
+    uint32_t    Magic;      /// MEM_BUDGET_MAGIC
+} sMemBlockHeader;
+
+/**************************************************************************************************
+ * INTERNAL DATA SECTION **************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Bytes currently handed out to callers.
+ */
+static atomic_size_t    MemBudgetUsed       = 0;
+
+/**
+ * @brief Active ceiling in bytes.
+ */
+static atomic_size_t    MemBudgetCeiling    = MEM_BUDGET_CEILING;
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+void *MemBudget_Alloc(size_t Len) {
+    if (Len == 0) return NULL;
+
+    /// Reserve the bytes first so concurrent callers can never overshoot the ceiling together
+    size_t Ceiling = atomic_load_explicit(&MemBudgetCeiling, memory_order_relaxed);
+    size_t Used = atomic_load_explicit(&MemBudgetUsed, memory_order_relaxed);
+    do {
+        if (Len > Ceiling || Used > Ceiling - Len) {
+            xWarn("[MemBudget] Refusing %zu bytes (used %zu / ceiling %zu).", Len, Used, Ceiling);
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&MemBudgetUsed, &Used, Used + Len,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    sMemBlockHeader *Hdr = NULL;
+    size_t Total = Len + sizeof(sMemBlockHeader);
+
+    if (Len <= MEM_BUDGET_SMALL_MAX) {
+        Hdr = malloc(Total);
+        if (Hdr) Hdr->IsMapped = 0;
+    } else {
+        void *Map = mmap(NULL, Total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (Map != MAP_FAILED) {
+            Hdr = (sMemBlockHeader *)Map;
+            Hdr->IsMapped = 1;
+        }
+    }
+
+    if (!Hdr) {
+        atomic_fetch_sub_explicit(&MemBudgetUsed, Len, memory_order_relaxed);
+        xError("[MemBudget] OS refused %zu bytes!", Len);
+        return NULL;
+    }
+
+    Hdr->Len = Len;
+    Hdr->Magic = MEM_BUDGET_MAGIC;
+    return (void *)(Hdr + 1);
+}
+
+void MemBudget_Free(void *Ptr) {
+    if (!Ptr) return;
+
+    sMemBlockHeader *Hdr = (sMemBlockHeader *)Ptr - 1;
+    if (Hdr->Magic != MEM_BUDGET_MAGIC) {
+        xError("[MemBudget] Free of foreign pointer %p ignored!", Ptr);
+        return;
+    }
+
+    size_t Len = Hdr->Len;
+    Hdr->Magic = 0;
+
+    if (Hdr->IsMapped) {
+        munmap(Hdr, Len + sizeof(sMemBlockHeader));
+    } else {
+        free(Hdr);
+    }
+    atomic_fetch_sub_explicit(&MemBudgetUsed, Len, memory_order_relaxed);
+}
+
+void MemBudget_Trim(void) {
+    malloc_trim(0);
+}
+
+size_t MemBudget_GetUsed(void) {
+    return atomic_load_explicit(&MemBudgetUsed, memory_order_relaxed);
+}
+
+size_t MemBudget_GetCeiling(void) {
+    return atomic_load_explicit(&MemBudgetCeiling, memory_order_relaxed);
+}
+
+void MemBudget_SetCeiling(size_t Ceiling) {
+    atomic_store_explicit(&MemBudgetCeiling, (Ceiling == 0) ? MEM_BUDGET_CEILING : Ceiling, memory_order_relaxed);
+    xLog1("[MemBudget] Ceiling set to %zu bytes.", MemBudget_GetCeiling());
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
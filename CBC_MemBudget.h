@@ -0,0 +1,65 @@
+#ifndef __CBC_MEM_BUDGET_H__
+#define __CBC_MEM_BUDGET_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * MEMORY BUDGET CONFIGURATION SECTION ************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Requests up to this size (64KB) are served from the small malloc arena.
+ * @note Larger requests get a private anonymous mapping that is unmapped on free.
+ */
+#define MEM_BUDGET_SMALL_MAX    (64U * 1024U)
+
+/**************************************************************************************************
+ * MEMORY BUDGET PROTOTYPES ***********************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Allocates a transfer buffer accounted against the global ceiling.
+ * @param Len Number of bytes requested.
+ * @return Pointer to the buffer, or NULL if Len is 0, the ceiling would be exceeded, or the OS refuses.
+ */
+void *MemBudget_Alloc(size_t Len);
+
+/**
+ * @brief Releases a buffer obtained from MemBudget_Alloc(). Large buffers are unmapped immediately.
+ * @param Ptr The buffer to release (NULL is ignored).
+ */
+void MemBudget_Free(void *Ptr);
+
+/**
+ * @brief Returns free heap pages to the OS. Call once a transaction is finished.
+ */
+void MemBudget_Trim(void);
+
+/**
+ * @brief Returns the number of bytes currently accounted against the ceiling.
+ * @return Bytes in use.
+ */
+size_t MemBudget_GetUsed(void);
+
+/**
+ * @brief Returns the current ceiling in bytes.
+ * @return The ceiling.
+ */
+size_t MemBudget_GetCeiling(void);
+
+/**
+ * @brief Changes the ceiling at runtime. Existing allocations are not affected.
+ * @param Ceiling New ceiling in bytes (0 restores MEM_BUDGET_CEILING).
+ */
+void MemBudget_SetCeiling(size_t Ceiling);
+
+#endif /*__CBC_MEM_BUDGET_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
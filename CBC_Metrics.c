@@ -0,0 +1,251 @@
+#include "CBC_Metrics.h"
+#include "CBC_MemBudget.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+#include <stdatomic.h>
+
+#if (METRICS_EN == 1)
+
+/**************************************************************************************************
+ * INTERNAL TYPES SECTION *************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Exported name and help text of a metric.
+ */
+typedef struct {
+    const char     *Name;
+    const char     *Help;
+} sMetricInfo;
+
+/**
+ * @brief Lock-free histogram: per-bucket counts (non-cumulative), sample count and sum.
+ */
+typedef struct {
+    atomic_ullong   Buckets[METRICS_BUCKET_COUNT + 1];  /// Last slot is the +Inf bucket
+    atomic_ullong   Count;
+    atomic_ullong   Sum;
+} sMetricHistogram;
+
+/**************************************************************************************************
+ * INTERNAL DATA SECTION **************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Counter names, indexed by eMetricCounter.
+ */
+static const sMetricInfo CounterInfo[eMET_COUNTER_COUNT] = {
+    [eMET_CAPTURE_STARTED]      = { "xcbc_captures_started_total",      "Captures started." },
+    [eMET_CAPTURE_COMPLETED]    = { "xcbc_captures_completed_total",    "Captures committed to disk." },
+    [eMET_CAPTURE_QUEUED]       = { "xcbc_captures_queued_total",       "Owner changes queued behind a running capture." },
+    [eMET_CAPTURE_COALESCED]    = { "xcbc_captures_coalesced_total",    "Queued owner changes replaced by a newer one." },
+    [eMET_CAPTURE_DROPPED]      = { "xcbc_captures_dropped_total",      "Queued owner changes discarded because the queue was full." },
+    [eMET_CAPTURE_TIMEOUT]      = { "xcbc_capture_timeouts_total",      "Captures aborted after their owner stalled." },
+    [eMET_CAPTURE_DEDUP]        = { "xcbc_captures_deduplicated_total", "Captures identical to an existing item." },
+    [eMET_BYTES_RECEIVED]       = { "xcbc_received_bytes_total",        "Payload bytes received from owners." },
+    [eMET_INCR_CHUNKS_RECEIVED] = { "xcbc_incr_chunks_received_total",  "INCR chunks received from owners." },
+    [eMET_PROVIDE_REQUESTS]     = { "xcbc_provide_requests_total",      "Selection requests served." },
+    [eMET_PROVIDE_REJECTED]     = { "xcbc_provide_rejected_total",      "Data requests refused because every session was busy." },
+    [eMET_BYTES_PROVIDED]       = { "xcbc_provided_bytes_total",        "Payload bytes written to requestors." },
+    [eMET_INCR_CHUNKS_SENT]     = { "xcbc_incr_chunks_sent_total",      "INCR chunks sent to requestors." },
+    [eMET_PROVIDE_EVICTED]      = { "xcbc_provide_sessions_evicted_total", "Outgoing transfers evicted after their requestor stalled." },
+    [eMET_HISTORY_EVICTED]      = { "xcbc_history_evictions_total",     "History items removed from the list and disk." },
+};
+
+/**
+ * @brief Histogram names, indexed by eMetricHistogram.
+ */
+static const sMetricInfo HistogramInfo[eMET_HISTOGRAM_COUNT] = {
+    [eMET_H_CAPTURE_BYTES]      = { "xcbc_capture_size_bytes",          "Size of committed captures." },
+    [eMET_H_CAPTURE_MS]         = { "xcbc_capture_duration_ms",         "Time from owner change to commit." },
+    [eMET_H_PROVIDE_BYTES]      = { "xcbc_provide_size_bytes",          "Size of payloads served to requestors." },
+};
+
+/**
+ * @brief Upper bounds of the finite buckets, indexed by eMetricHistogram.
+ */
+static const uint64_t HistogramBounds[eMET_HISTOGRAM_COUNT][METRICS_BUCKET_COUNT] = {
+    [eMET_H_CAPTURE_BYTES]      = { 256, 4096, 65536, 1048576, 16777216, 268435456, 1073741824 },
+    [eMET_H_CAPTURE_MS]         = { 1, 5, 25, 100, 500, 2500, 10000 },
+    [eMET_H_PROVIDE_BYTES]      = { 256, 4096, 65536, 1048576, 16777216, 268435456, 1073741824 },
+};
+
+static atomic_ullong        Counters[eMET_COUNTER_COUNT];
+static sMetricHistogram     Histograms[eMET_HISTOGRAM_COUNT];
+
+static pthread_t            MetricsThread;
+static pthread_mutex_t      MetricsMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t       MetricsCond = PTHREAD_COND_INITIALIZER;
+static int                  MetricsStopReq = 0;
+static int                  MetricsRunning = 0;
+
+/**
+ * @brief 1 once a counter or histogram changed since the last export (the exporter sleeps until then).
+ */
+static atomic_int           MetricsDirty;
+
+/**************************************************************************************************
+ * INTERNAL HELPERS *******************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Reads the resident set size of this process in bytes (0 if unavailable).
+ */
+static uint64_t Internal_ReadRssBytes(void) {
+    unsigned long long Pages = 0;
+    FILE *F = fopen("/proc/self/statm", "r");
+    if (!F) return 0;
+    if (fscanf(F, "%*s %llu", &Pages) != 1) Pages = 0;
+    fclose(F);
+    return (uint64_t)Pages * (uint64_t)sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief Records a change and wakes the exporter on the first one since its last export.
+ * @note Later changes only set the flag again: the mutex is taken at most once per export.
+ */
+static inline void Internal_MarkDirty(void) {
+    if (atomic_exchange_explicit(&MetricsDirty, 1, memory_order_relaxed)) return;
+    pthread_mutex_lock(&MetricsMutex);
+    pthread_cond_signal(&MetricsCond);
+    pthread_mutex_unlock(&MetricsMutex);
+}
+
+/**
+ * @brief Exporter thread: sleeps until a metric changes, then writes the stats file at most
+ *        every METRICS_EXPORT_MS until asked to stop. An idle daemon never wakes it.
+ */
+static void *Metrics_ExporterRuntime(void *Param) {
+    (void)Param;
+
+    pthread_mutex_lock(&MetricsMutex);
+    while (!MetricsStopReq) {
+        while (!MetricsStopReq && !atomic_load_explicit(&MetricsDirty, memory_order_relaxed)) {
+            pthread_cond_wait(&MetricsCond, &MetricsMutex);
+        }
+
+        /// Batch the changes of one interval into a single export (a stop request cuts it short)
+        struct timespec Deadline;
+        clock_gettime(CLOCK_REALTIME, &Deadline);
+        Deadline.tv_sec += METRICS_EXPORT_MS / 1000;
+        Deadline.tv_nsec += (long)(METRICS_EXPORT_MS % 1000) * 1000000L;
+        if (Deadline.tv_nsec >= 1000000000L) {
+            Deadline.tv_sec++;
+            Deadline.tv_nsec -= 1000000000L;
+        }
+        while (!MetricsStopReq && pthread_cond_timedwait(&MetricsCond, &MetricsMutex, &Deadline) != ETIMEDOUT) {}
+
+        atomic_store_explicit(&MetricsDirty, 0, memory_order_relaxed);
+        pthread_mutex_unlock(&MetricsMutex);
+        Metrics_Export();
+        pthread_mutex_lock(&MetricsMutex);
+    }
+    pthread_mutex_unlock(&MetricsMutex);
+    return NULL;
+}
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+void Metrics_Add(enum eMetricCounter Id, uint64_t Value) {
+    atomic_fetch_add_explicit(&Counters[Id], Value, memory_order_relaxed);
+    Internal_MarkDirty();
+}
+
+void Metrics_Observe(enum eMetricHistogram Id, uint64_t Value) {
+    sMetricHistogram *H = &Histograms[Id];
+    int Bucket = 0;
+    while (Bucket < METRICS_BUCKET_COUNT && Value > HistogramBounds[Id][Bucket]) Bucket++;
+
+    atomic_fetch_add_explicit(&H->Buckets[Bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&H->Count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&H->Sum, Value, memory_order_relaxed);
+    Internal_MarkDirty();
+}
+
+RetType Metrics_Export(void) {
+    char TmpPath[PATH_MAX];
+    snprintf(TmpPath, sizeof(TmpPath), "%s.tmp", PATH_FILE_METRICS);
+
+    FILE *F = fopen(TmpPath, "w");
+    if (!F) {
+        xWarn("[Metrics] Cannot open %s: %s", TmpPath, strerror(errno));
+        return ERR;
+    }
+
+    for (int i = 0; i < eMET_COUNTER_COUNT; i++) {
+        fprintf(F, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                CounterInfo[i].Name, CounterInfo[i].Help, CounterInfo[i].Name, CounterInfo[i].Name,
+                (unsigned long long)atomic_load_explicit(&Counters[i], memory_order_relaxed));
+    }
+
+    for (int i = 0; i < eMET_HISTOGRAM_COUNT; i++) {
+        const char *Name = HistogramInfo[i].Name;
+        unsigned long long Cumulative = 0;
+        fprintf(F, "# HELP %s %s\n# TYPE %s histogram\n", Name, HistogramInfo[i].Help, Name);
+        for (int b = 0; b < METRICS_BUCKET_COUNT; b++) {
+            Cumulative += atomic_load_explicit(&Histograms[i].Buckets[b], memory_order_relaxed);
+            fprintf(F, "%s_bucket{le=\"%llu\"} %llu\n", Name, (unsigned long long)HistogramBounds[i][b], Cumulative);
+        }
+        Cumulative += atomic_load_explicit(&Histograms[i].Buckets[METRICS_BUCKET_COUNT], memory_order_relaxed);
+        fprintf(F, "%s_bucket{le=\"+Inf\"} %llu\n", Name, Cumulative);
+        fprintf(F, "%s_sum %llu\n%s_count %llu\n",
+                Name, (unsigned long long)atomic_load_explicit(&Histograms[i].Sum, memory_order_relaxed),
+                Name, (unsigned long long)atomic_load_explicit(&Histograms[i].Count, memory_order_relaxed));
+    }
+
+    fprintf(F, "# HELP xcbc_history_items Items currently in the history list.\n# TYPE xcbc_history_items gauge\nxcbc_history_items %d\n",
+            XCBList_GetItemSize());
+    fprintf(F, "# HELP xcbc_membudget_used_bytes Transfer buffer bytes currently allocated.\n# TYPE xcbc_membudget_used_bytes gauge\nxcbc_membudget_used_bytes %zu\n",
+            MemBudget_GetUsed());
+    fprintf(F, "# HELP xcbc_membudget_ceiling_bytes Transfer buffer ceiling.\n# TYPE xcbc_membudget_ceiling_bytes gauge\nxcbc_membudget_ceiling_bytes %zu\n",
+            MemBudget_GetCeiling());
+    fprintf(F, "# HELP xcbc_resident_memory_bytes Resident set size of the daemon.\n# TYPE xcbc_resident_memory_bytes gauge\nxcbc_resident_memory_bytes %llu\n",
+            (unsigned long long)Internal_ReadRssBytes());
+
+    int Ok = (fflush(F) == 0 && !ferror(F));
+    if (fclose(F) != 0) Ok = 0;
+    if (!Ok || rename(TmpPath, PATH_FILE_METRICS) != 0) {
+        xWarn("[Metrics] Failed to write %s.", PATH_FILE_METRICS);
+        unlink(TmpPath);
+        return ERR;
+    }
+    return OKE;
+}
+
+RetType Metrics_Start(void) {
+    xEntry1("Metrics_Start");
+
+    MetricsStopReq = 0;
+    atomic_store(&MetricsDirty, 1);
+    if (pthread_create(&MetricsThread, NULL, Metrics_ExporterRuntime, NULL) != 0) {
+        xError("[Metrics] Failed to spawn exporter thread!");
+        return ERR;
+    }
+    MetricsRunning = 1;
+
+    xExit1("Metrics_Start");
+    return OKE;
+}
+
+void Metrics_Stop(void) {
+    if (!MetricsRunning) return;
+
+    pthread_mutex_lock(&MetricsMutex);
+    MetricsStopReq = 1;
+    pthread_cond_signal(&MetricsCond);
+    pthread_mutex_unlock(&MetricsMutex);
+
+    /// The exporter writes one last snapshot on its way out
+    pthread_join(MetricsThread, NULL);
+    MetricsRunning = 0;
+}
+
+#endif /*(METRICS_EN == 1)*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,104 @@
+#ifndef __CBC_METRICS_H__
+#define __CBC_METRICS_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * METRICS DEFINITION SECTION *********************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Monotonic counters, exported as Prometheus counters.
+ */
+enum eMetricCounter {
+    eMET_CAPTURE_STARTED = 0,       /// Captures started (owner change handled)
+    eMET_CAPTURE_COMPLETED,         /// Captures committed to the writer thread
+    eMET_CAPTURE_QUEUED,            /// Owner changes queued while a capture was running
+    eMET_CAPTURE_COALESCED,         /// Queued owner changes replaced by a newer one
+    eMET_CAPTURE_DROPPED,           /// Queued owner changes discarded (queue full)
+    eMET_CAPTURE_TIMEOUT,           /// Captures aborted past their heartbeat deadline
+    eMET_CAPTURE_DEDUP,             /// Captures identical to an existing item (promoted instead)
+    eMET_BYTES_RECEIVED,            /// Payload bytes streamed to the capture sink
+    eMET_INCR_CHUNKS_RECEIVED,      /// INCR chunks received from owners
+    eMET_PROVIDE_REQUESTS,          /// SelectionRequests served (any target)
+    eMET_PROVIDE_REJECTED,          /// Data requests refused (every session busy)
+    eMET_BYTES_PROVIDED,            /// Payload bytes written to requestors
+    eMET_INCR_CHUNKS_SENT,          /// INCR chunks sent to requestors
+    eMET_PROVIDE_EVICTED,           /// Outgoing sessions evicted after their requestor stalled
+    eMET_HISTORY_EVICTED,           /// History items removed to make room (or popped)
+    eMET_COUNTER_COUNT
+};
+
+/**
+ * @brief Histograms, exported as Prometheus histograms.
+ */
+enum eMetricHistogram {
+    eMET_H_CAPTURE_BYTES = 0,       /// Size of committed captures
+    eMET_H_CAPTURE_MS,              /// Duration of committed captures (owner change to commit)
+    eMET_H_PROVIDE_BYTES,           /// Size of payloads served to requestors
+    eMET_HISTOGRAM_COUNT
+};
+
+/**
+ * @brief Number of finite buckets per histogram (an implicit +Inf bucket follows).
+ */
+#define METRICS_BUCKET_COUNT    7
+
+/**************************************************************************************************
+ * METRICS PROTOTYPES *****************************************************************************
+ **************************************************************************************************/
+
+#if (METRICS_EN == 1)
+
+/**
+ * @brief Adds to a counter (relaxed atomic, safe from any thread).
+ */
+void Metrics_Add(enum eMetricCounter Id, uint64_t Value);
+
+/**
+ * @brief Records one sample in a histogram (relaxed atomics, safe from any thread).
+ */
+void Metrics_Observe(enum eMetricHistogram Id, uint64_t Value);
+
+/**
+ * @brief Spawns the exporter thread writing PATH_FILE_METRICS at most every METRICS_EXPORT_MS, after changes only.
+ * @return OKE on success, ERR if the thread cannot be created.
+ */
+RetType Metrics_Start(void);
+
+/**
+ * @brief Joins the exporter thread after a final export.
+ */
+void Metrics_Stop(void);
+
+/**
+ * @brief Writes all metrics to PATH_FILE_METRICS in the Prometheus text format (atomic rename).
+ * @return OKE on success, ERR on I/O failure.
+ */
+RetType Metrics_Export(void);
+
+#else
+
+#define Metrics_Add(Id, Value)      ((void)0)
+#define Metrics_Observe(Id, Value)  ((void)0)
+#define Metrics_Start()             (OKE)
+#define Metrics_Stop()              ((void)0)
+#define Metrics_Export()            (OKE)
+
+#endif /*(METRICS_EN == 1)*/
+
+/**
+ * @brief Increments a counter by one.
+ */
+#define Metrics_Inc(Id)             Metrics_Add((Id), 1)
+
+#endif /*__CBC_METRICS_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,890 @@
+#include "CBC_Picker.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include "CBC_Thumb.h"
+#include "CBC_Search.h"
+#include "CBC_Fuzzy.h"
+#include "CBC_CmdQueue.h"
+#include "ClipboardCapture.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+#include <xcb/xcb.h>
+#include <poll.h>
+
+#if (PICKER_ENABLED)
+
+/**************************************************************************************************
+ * INTERNAL DEFINITIONS ***************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Keysyms the picker reacts to (values from X11/keysymdef.h).
+ */
+#define KEYSYM_BACKSPACE                0xFF08
+#define KEYSYM_TAB                      0xFF09
+#define KEYSYM_RETURN                   0xFF0D
+#define KEYSYM_ESCAPE                   0xFF1B
+#define KEYSYM_HOME                     0xFF50
+#define KEYSYM_UP                       0xFF52
+#define KEYSYM_DOWN                     0xFF54
+#define KEYSYM_PAGE_UP                  0xFF55
+#define KEYSYM_PAGE_DOWN                0xFF56
+#define KEYSYM_END                      0xFF57
+#define KEYSYM_KP_ENTER                 0xFF8D
+#define KEYSYM_ISO_LEFT_TAB             0xFE20
+
+/**
+ * @brief Margin (pixels) around the thumbnail column; row text starts after it.
+ */
+#define PICKER_PAD                      8
+#define PICKER_TEXT_X                   (2 * PICKER_PAD + PICKER_THUMB_SIZE)
+
+/**
+ * @brief Keyboard grab attempts (PICKER_GRAB_WAIT_MS apart) while the hotkey daemon still holds it.
+ */
+#define PICKER_GRAB_TRIES               100
+#define PICKER_GRAB_WAIT_MS             5
+
+enum ePickerResult {
+    ePICK_NONE = 0,
+    ePICK_ITEM,
+    ePICK_CLEAR
+};
+
+/**
+ * @brief The picker's own X connection and the resources kept on it between two openings.
+ */
+typedef struct {
+    xcb_connection_t   *Conn;
+    xcb_screen_t       *Screen;
+    xcb_window_t        Window;
+    xcb_pixmap_t        Buffer;         /// Back buffer, copied to Window once per frame
+    xcb_gcontext_t      Gc;
+    xcb_font_t          Font;
+    int                 Ascent;
+    int                 LineHeight;
+    int                 CharWidth;      /// Widest glyph (text is clipped on it)
+    int                 Wide;           /// 1 if the font has glyphs beyond Latin-1
+    int                 Width;
+    int                 Height;
+    uint32_t            RedMask;        /// TrueColor layout of the root visual
+    uint32_t            GreenMask;
+    uint32_t            BlueMask;
+    int                 ImageBpp;       /// ZPixmap bits per pixel at the root depth (0 = no thumbnails)
+    int                 ImagePad;       /// ZPixmap scanline pad (bits)
+    int                 ImageMsbFirst;
+    xcb_keysym_t       *Keysyms;        /// Core keyboard mapping
+    int                 KeysymsPerCode;
+    int                 KeycodeCount;
+    xcb_keycode_t       MinKeycode;
+} sPickerDisplay;
+
+/**
+ * @brief One decoded thumbnail, ready for xcb_put_image().
+ */
+typedef struct {
+    uint64_t            Id;             /// History item id (0 = free slot)
+    uint64_t            LastUse;
+    int                 Width;
+    int                 Height;
+    uint8_t            *Image;          /// ZPixmap bytes blended on PICKER_COLOR_BG (NULL = no thumbnail)
+    uint32_t            ImageLen;
+} sPickerThumb;
+
+/**
+ * @brief State of one opening.
+ */
+typedef struct {
+    const sXCBListSnapshot *Snap;
+    sFuzzyTable         Fuzzy;          /// Haystacks of Snap for the fuzzy matcher
+    int                *Matches;        /// Rows listed, best match first (every row, newest first, for an empty query)
+    int                *Survivors;      /// Every row matching Query, ascending
+    sFuzzyMatch        *Ranked;         /// Ranking buffer (PICKER_MATCH_MAX)
+    int                *Found;          /// Rows whose whole text payload contains Query (PICKER_SEARCH_MAX)
+    uint8_t            *Hits;           /// Per row: 1 if listed in Found
+    int                 MatchCount;
+    int                 SurvivorCount;
+    int                 Entries;        /// MatchCount, plus the "clear all" entry while Query is empty
+    int                 Selected;
+    int                 Top;            /// First visible entry
+    char                Query[PICKER_QUERY_MAX];
+    size_t              QueryLen;
+    size_t              FilteredLen;    /// Query length Matches was computed for (SIZE_MAX = recompute all)
+    int                 Dirty;
+    int                 Done;
+    enum ePickerResult  Result;
+} sPickerSession;
+
+static sPickerDisplay Display;
+static sPickerThumb ThumbCache[PICKER_THUMB_CACHE];
+static uint64_t ThumbClock = 0;
+
+/**************************************************************************************************
+ * INTERNAL HELPERS *******************************************************************************
+ **************************************************************************************************/
+
+static uint32_t Internal_Channel(uint32_t Value, uint32_t Mask) {
+    if (Mask == 0) return 0;
+    int Shift = __builtin_ctz(Mask);
+    int Bits = __builtin_popcount(Mask >> Shift);
+    Value = (Bits >= 8) ? Value << (Bits - 8) : Value >> (8 - Bits);
+    return (Value << Shift) & Mask;
+}
+
+/**
+ * @brief Converts 0xRRGGBB to a pixel value of the root visual.
+ */
+static uint32_t Internal_Pixel(uint32_t Rgb) {
+    return Internal_Channel((Rgb >> 16) & 0xFF, Display.RedMask) |
+           Internal_Channel((Rgb >> 8) & 0xFF, Display.GreenMask) |
+           Internal_Channel(Rgb & 0xFF, Display.BlueMask);
+}
+
+static inline int Internal_IsImage(enum XCBFileType Type) {
+    return Type == eFMT_IMG_PNG || Type == eFMT_IMG_JGP || Type == eFMT_IMG_BMP;
+}
+
+/**
+ * @brief Decodes one UTF-8 character (invalid bytes come out as '?', one per byte).
+ * @return The number of bytes consumed.
+ */
+static int Internal_NextCodepoint(const uint8_t *p, uint32_t *Codepoint) {
+    int Len = (p[0] < 0x80) ? 1 : ((p[0] & 0xE0) == 0xC0) ? 2 : ((p[0] & 0xF0) == 0xE0) ? 3 : ((p[0] & 0xF8) == 0xF0) ? 4 : 0;
+    uint32_t Cp = (Len == 1) ? p[0] : (Len == 2) ? (p[0] & 0x1FU) : (Len == 3) ? (p[0] & 0x0FU) : (p[0] & 0x07U);
+
+    for (int i = 1; i < Len; i++) {
+        if ((p[i] & 0xC0) != 0x80) { Len = 0; break; }
+        Cp = (Cp << 6) | (p[i] & 0x3FU);
+    }
+    if (Len == 0) {
+        *Codepoint = '?';
+        return 1;
+    }
+    *Codepoint = Cp;
+    return Len;
+}
+
+/**************************************************************************************************
+ * DISPLAY SETUP **********************************************************************************
+ **************************************************************************************************/
+
+static RetType Picker_OpenFont(void) {
+    const char *Names[] = { PICKER_FONT, PICKER_FONT_FALLBACK };
+
+    for (size_t i = 0; i < sizeof(Names) / sizeof(Names[0]); i++) {
+        xcb_font_t Font = xcb_generate_id(Display.Conn);
+        xcb_generic_error_t *Error = xcb_request_check(Display.Conn,
+            xcb_open_font_checked(Display.Conn, Font, (uint16_t)strlen(Names[i]), Names[i]));
+        if (Error) {
+            free(Error);
+            continue;
+        }
+
+        xcb_query_font_reply_t *Info = xcb_query_font_reply(Display.Conn, xcb_query_font(Display.Conn, Font), NULL);
+        if (!Info) {
+            xcb_close_font(Display.Conn, Font);
+            continue;
+        }
+        Display.Font = Font;
+        Display.Ascent = Info->font_ascent;
+        Display.LineHeight = Info->font_ascent + Info->font_descent;
+        Display.CharWidth = Info->max_bounds.character_width > 0 ? Info->max_bounds.character_width : 1;
+        Display.Wide = (Info->max_byte1 > 0);
+        free(Info);
+        return OKE;
+    }
+    return ERR;
+}
+
+static void Picker_LoadKeymap(void) {
+    const xcb_setup_t *Setup = xcb_get_setup(Display.Conn);
+    free(Display.Keysyms);
+    Display.Keysyms = NULL;
+    Display.MinKeycode = Setup->min_keycode;
+    Display.KeycodeCount = Setup->max_keycode - Setup->min_keycode + 1;
+
+    xcb_get_keyboard_mapping_reply_t *Reply = xcb_get_keyboard_mapping_reply(Display.Conn,
+        xcb_get_keyboard_mapping(Display.Conn, Display.MinKeycode, (uint8_t)Display.KeycodeCount), NULL);
+    if (!Reply) return;
+
+    int Len = xcb_get_keyboard_mapping_keysyms_length(Reply);
+    Display.Keysyms = malloc((size_t)Len * sizeof(xcb_keysym_t));
+    if (Display.Keysyms) {
+        memcpy(Display.Keysyms, xcb_get_keyboard_mapping_keysyms(Reply), (size_t)Len * sizeof(xcb_keysym_t));
+        Display.KeysymsPerCode = Reply->keysyms_per_keycode;
+    }
+    free(Reply);
+}
+
+/**
+ * @brief Opens the picker connection and creates its (unmapped) window, once per process.
+ */
+static RetType Picker_Open(void) {
+    if (Display.Conn) return OKE;
+
+    int ScreenNum = 0;
+    Display.Conn = xcb_connect(NULL, &ScreenNum);
+    if (xcb_connection_has_error(Display.Conn)) {
+        xError("[Picker] Cannot connect to the X server.");
+        xcb_disconnect(Display.Conn);
+        Display.Conn = NULL;
+        return ERR;
+    }
+
+    const xcb_setup_t *Setup = xcb_get_setup(Display.Conn);
+    xcb_screen_iterator_t Screens = xcb_setup_roots_iterator(Setup);
+    for (int i = 0; i < ScreenNum && Screens.rem > 1; i++) xcb_screen_next(&Screens);
+    Display.Screen = Screens.data;
+
+    /// Colours and thumbnails are computed from the TrueColor masks of the root visual
+    xcb_visualtype_t *Visual = NULL;
+    for (xcb_depth_iterator_t Depths = xcb_screen_allowed_depths_iterator(Display.Screen); Depths.rem && !Visual; xcb_depth_next(&Depths)) {
+        for (xcb_visualtype_iterator_t Visuals = xcb_depth_visuals_iterator(Depths.data); Visuals.rem; xcb_visualtype_next(&Visuals)) {
+            if (Visuals.data->visual_id == Display.Screen->root_visual) {
+                Visual = Visuals.data;
+                break;
+            }
+        }
+    }
+    if (!Visual || Visual->_class != XCB_VISUAL_CLASS_TRUE_COLOR || Picker_OpenFont() != OKE) {
+        xError("[Picker] Needs a TrueColor root visual and the \"%s\" font.", PICKER_FONT_FALLBACK);
+        Picker_Close();
+        return ERR;
+    }
+    Display.RedMask = Visual->red_mask;
+    Display.GreenMask = Visual->green_mask;
+    Display.BlueMask = Visual->blue_mask;
+
+    for (xcb_format_iterator_t Formats = xcb_setup_pixmap_formats_iterator(Setup); Formats.rem; xcb_format_next(&Formats)) {
+        if (Formats.data->depth == Display.Screen->root_depth) {
+            Display.ImageBpp = Formats.data->bits_per_pixel;
+            Display.ImagePad = Formats.data->scanline_pad;
+        }
+    }
+    if (Display.ImageBpp != 16 && Display.ImageBpp != 24 && Display.ImageBpp != 32) Display.ImageBpp = 0;
+    Display.ImageMsbFirst = (Setup->image_byte_order == XCB_IMAGE_ORDER_MSB_FIRST);
+
+    Picker_LoadKeymap();
+
+    Display.Width = (Display.Screen->width_in_pixels < PICKER_WIDTH) ? Display.Screen->width_in_pixels : PICKER_WIDTH;
+    Display.Height = (PICKER_ROWS + 1) * PICKER_ROW_HEIGHT;
+
+    /// Override-redirect: no window manager round trip, it appears as soon as it is mapped
+    Display.Window = xcb_generate_id(Display.Conn);
+    uint32_t WindowValues[] = {
+        Internal_Pixel(PICKER_COLOR_BG),
+        Internal_Pixel(PICKER_COLOR_BORDER),
+        1,
+        XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_BUTTON_PRESS
+    };
+    xcb_create_window(Display.Conn, XCB_COPY_FROM_PARENT, Display.Window, Display.Screen->root,
+                      0, 0, (uint16_t)Display.Width, (uint16_t)Display.Height, 1,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, Display.Screen->root_visual,
+                      XCB_CW_BACK_PIXEL | XCB_CW_BORDER_PIXEL | XCB_CW_OVERRIDE_REDIRECT | XCB_CW_EVENT_MASK,
+                      WindowValues);
+
+    Display.Buffer = xcb_generate_id(Display.Conn);
+    xcb_create_pixmap(Display.Conn, Display.Screen->root_depth, Display.Buffer, Display.Window,
+                      (uint16_t)Display.Width, (uint16_t)Display.Height);
+
+    Display.Gc = xcb_generate_id(Display.Conn);
+    uint32_t GcValues[] = { Internal_Pixel(PICKER_COLOR_FG), Internal_Pixel(PICKER_COLOR_BG), Display.Font, 0 };
+    xcb_create_gc(Display.Conn, Display.Gc, Display.Buffer,
+                  XCB_GC_FOREGROUND | XCB_GC_BACKGROUND | XCB_GC_FONT | XCB_GC_GRAPHICS_EXPOSURES, GcValues);
+
+    xcb_flush(Display.Conn);
+    xLog1("[Picker] Window ready (%dx%d, font %d px).", Display.Width, Display.Height, Display.LineHeight);
+    return OKE;
+}
+
+/**
+ * @brief Grabs the keyboard (and the pointer, so a click outside closes the picker).
+ */
+static RetType Picker_Grab(void) {
+    for (int Try = 0; Try < PICKER_GRAB_TRIES; Try++) {
+        xcb_grab_keyboard_reply_t *Reply = xcb_grab_keyboard_reply(Display.Conn,
+            xcb_grab_keyboard(Display.Conn, 1, Display.Window, XCB_CURRENT_TIME, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC), NULL);
+        int Status = Reply ? Reply->status : -1;
+        free(Reply);
+
+        if (Status == XCB_GRAB_STATUS_SUCCESS) {
+            free(xcb_grab_pointer_reply(Display.Conn,
+                xcb_grab_pointer(Display.Conn, 0, Display.Window, XCB_EVENT_MASK_BUTTON_PRESS, XCB_GRAB_MODE_ASYNC,
+                                 XCB_GRAB_MODE_ASYNC, XCB_NONE, XCB_NONE, XCB_CURRENT_TIME), NULL));
+            return OKE;
+        }
+
+        /// The hotkey daemon that sent SIGUSR1 usually still holds the keyboard for a moment
+        struct timespec Wait = { 0, PICKER_GRAB_WAIT_MS * 1000000L };
+        nanosleep(&Wait, NULL);
+    }
+    return ERR;
+}
+
+static xcb_keysym_t Picker_Keysym(xcb_keycode_t Code, uint16_t State) {
+    if (!Display.Keysyms || Display.KeysymsPerCode < 1 || Code < Display.MinKeycode ||
+        Code - Display.MinKeycode >= Display.KeycodeCount) return 0;
+
+    const xcb_keysym_t *Syms = Display.Keysyms + (size_t)(Code - Display.MinKeycode) * Display.KeysymsPerCode;
+    int Shift = (State & XCB_MOD_MASK_SHIFT) != 0;
+    xcb_keysym_t Sym = (Shift && Display.KeysymsPerCode > 1 && Syms[1]) ? Syms[1] : Syms[0];
+
+    /// Letters with a single keysym, and Caps Lock, use the upper case
+    if (Sym >= 'a' && Sym <= 'z' && ((Shift && (Display.KeysymsPerCode < 2 || !Syms[1])) || (State & XCB_MOD_MASK_LOCK))) {
+        Sym -= 32;
+    }
+    return Sym;
+}
+
+/**
+ * @brief Unicode codepoint typed by a keysym (Latin-1 and Unicode keysyms), 0 for other keys.
+ */
+static uint32_t Picker_KeysymToCodepoint(xcb_keysym_t Sym) {
+    if ((Sym >= 0x20 && Sym <= 0x7E) || (Sym >= 0xA0 && Sym <= 0xFF)) return Sym;
+    if (Sym >= 0x01000100 && Sym <= 0x0110FFFF) return Sym - 0x01000000;
+    return 0;
+}
+
+/**************************************************************************************************
+ * THUMBNAILS *************************************************************************************
+ **************************************************************************************************/
+
+static sPickerThumb *Picker_FindThumb(uint64_t Id) {
+    for (int i = 0; i < PICKER_THUMB_CACHE; i++) {
+        if (ThumbCache[i].Id == Id) {
+            ThumbCache[i].LastUse = ++ThumbClock;
+            return &ThumbCache[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Takes a free slot, or the least recently drawn one, for item Id.
+ */
+static sPickerThumb *Picker_ClaimThumb(uint64_t Id) {
+    sPickerThumb *Slot = &ThumbCache[0];
+    for (int i = 0; i < PICKER_THUMB_CACHE; i++) {
+        if (ThumbCache[i].Id == 0) { Slot = &ThumbCache[i]; break; }
+        if (ThumbCache[i].LastUse < Slot->LastUse) Slot = &ThumbCache[i];
+    }
+    free(Slot->Image);
+    memset(Slot, 0, sizeof(*Slot));
+    Slot->Id = Id;
+    Slot->LastUse = ++ThumbClock;
+    return Slot;
+}
+
+/**
+ * @brief Converts a thumbnail to ZPixmap bytes, alpha blended on the picker background.
+ */
+static void Picker_StoreThumb(sPickerThumb *Slot, const sThumb *Thumb) {
+    int Bytes = Display.ImageBpp / 8;
+    uint32_t Stride = (uint32_t)(((Thumb->Width * Display.ImageBpp + Display.ImagePad - 1) / Display.ImagePad) * Display.ImagePad / 8);
+
+    Slot->Image = calloc(Thumb->Height, Stride);
+    if (!Slot->Image) return;
+    Slot->ImageLen = Stride * (uint32_t)Thumb->Height;
+    Slot->Width = Thumb->Width;
+    Slot->Height = Thumb->Height;
+
+    for (int y = 0; y < Thumb->Height; y++) {
+        uint8_t *Out = Slot->Image + (size_t)y * Stride;
+        for (int x = 0; x < Thumb->Width; x++, Out += Bytes) {
+            uint32_t Argb = Thumb->Pixels[(size_t)y * Thumb->Width + x], A = Argb >> 24, Rgb = 0;
+            for (int Shift = 0; Shift < 24; Shift += 8) {
+                uint32_t Fg = (Argb >> Shift) & 0xFF, Bg = (PICKER_COLOR_BG >> Shift) & 0xFF;
+                Rgb |= ((Fg * A + Bg * (255 - A)) / 255) << Shift;
+            }
+            uint32_t Pixel = Internal_Pixel(Rgb);
+            for (int b = 0; b < Bytes; b++) {
+                Out[Display.ImageMsbFirst ? Bytes - 1 - b : b] = (uint8_t)(Pixel >> (8 * b));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Decodes the thumbnail of the first visible image row that has none yet.
+ * @return 1 if one was decoded (or failed), 0 if every visible row is done.
+ * @note One per call: the event loop checks for input between two decodes.
+ */
+static int Picker_LoadOneThumb(sPickerSession *Session) {
+    if (Display.ImageBpp == 0) return 0;
+
+    for (int e = Session->Top; e < Session->Top + PICKER_ROWS && e < Session->MatchCount; e++) {
+        int Index = Session->Matches[e];
+        const sXCBListRow *Row = XCBList_SnapshotRow(Session->Snap, Index);
+        if (!Internal_IsImage(Row->FileType) || Picker_FindThumb(Row->Id)) continue;
+
+        /// A slot is claimed even on failure (JPEG, damaged data) so it is not retried every frame
+        sPickerThumb *Slot = Picker_ClaimThumb(Row->Id);
+        sClipboardItem Item;
+        sThumb Thumb;
+        if (XCBList_SnapshotGetItem(Session->Snap, Index, &Item) == OKE &&
+            Thumb_Load(&Item, PICKER_THUMB_SIZE, &Thumb) == OKE) {
+            Picker_StoreThumb(Slot, &Thumb);
+            Thumb_Free(&Thumb);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/**************************************************************************************************
+ * DRAWING ****************************************************************************************
+ **************************************************************************************************/
+
+static void Picker_Fill(int X, int Y, int Width, int Height, uint32_t Rgb) {
+    uint32_t Value = Internal_Pixel(Rgb);
+    xcb_rectangle_t Rect = { (int16_t)X, (int16_t)Y, (uint16_t)Width, (uint16_t)Height };
+    xcb_change_gc(Display.Conn, Display.Gc, XCB_GC_FOREGROUND, &Value);
+    xcb_poly_fill_rectangle(Display.Conn, Display.Buffer, Display.Gc, 1, &Rect);
+}
+
+/**
+ * @brief Draws UTF-8 text, clipped to MaxWidth pixels.
+ * @return The width drawn, in pixels.
+ */
+static int Picker_DrawText(int X, int Baseline, int MaxWidth, const char *Text, uint32_t Fg, uint32_t Bg) {
+    xcb_char2b_t Glyphs[255];
+    int Max = MaxWidth / Display.CharWidth, Count = 0;
+    if (Max > 255) Max = 255;
+
+    for (const uint8_t *p = (const uint8_t *)Text; *p && Count < Max; ) {
+        uint32_t Cp;
+        p += Internal_NextCodepoint(p, &Cp);
+        if (Cp > 0xFFFF || (!Display.Wide && Cp > 0xFF)) Cp = '?';
+        Glyphs[Count].byte1 = (uint8_t)(Cp >> 8);
+        Glyphs[Count].byte2 = (uint8_t)Cp;
+        Count++;
+    }
+    if (Count == 0) return 0;
+
+    uint32_t Values[] = { Internal_Pixel(Fg), Internal_Pixel(Bg) };
+    xcb_change_gc(Display.Conn, Display.Gc, XCB_GC_FOREGROUND | XCB_GC_BACKGROUND, Values);
+    xcb_image_text_16(Display.Conn, (uint8_t)Count, Display.Buffer, Display.Gc, (int16_t)X, (int16_t)Baseline, Glyphs);
+    return Count * Display.CharWidth;
+}
+
+static void Picker_DrawRow(const sXCBListRow *Row, int Y, int Baseline, uint32_t Fg, uint32_t Bg) {
+    int TextWidth = Display.Width - PICKER_TEXT_X - PICKER_PAD;
+    char Label[NAME_MAX + 32];
+
+    if (Internal_IsImage(Row->FileType)) {
+        sPickerThumb *Thumb = Picker_FindThumb(Row->Id);
+        if (Thumb && Thumb->Image) {
+            xcb_put_image(Display.Conn, XCB_IMAGE_FORMAT_Z_PIXMAP, Display.Buffer, Display.Gc,
+                          (uint16_t)Thumb->Width, (uint16_t)Thumb->Height,
+                          (int16_t)(PICKER_PAD + (PICKER_THUMB_SIZE - Thumb->Width) / 2),
+                          (int16_t)(Y + (PICKER_ROW_HEIGHT - Thumb->Height) / 2),
+                          0, Display.Screen->root_depth, Thumb->ImageLen, Thumb->Image);
+        } else {
+            Picker_DrawText(PICKER_PAD, Baseline, PICKER_THUMB_SIZE, "IMG", PICKER_COLOR_DIM, Bg);
+        }
+        snprintf(Label, sizeof(Label), "[Image] %s", Row->Name);
+        Picker_DrawText(PICKER_TEXT_X, Baseline, TextWidth, Label, Fg, Bg);
+        return;
+    }
+
+    Picker_DrawText(PICKER_PAD, Baseline, PICKER_THUMB_SIZE, "Aa", PICKER_COLOR_DIM, Bg);
+
+    /// Line count right-aligned, the preview clipped before it
+    if (Row->Lines > 1) {
+        int Len = snprintf(Label, sizeof(Label), "%u lines", Row->Lines);
+        int Width = Len * Display.CharWidth;
+        Picker_DrawText(Display.Width - PICKER_PAD - Width, Baseline, Width, Label, PICKER_COLOR_DIM, Bg);
+        TextWidth -= Width + PICKER_PAD;
+    }
+    Picker_DrawText(PICKER_TEXT_X, Baseline, TextWidth, Row->Preview[0] ? Row->Preview : "[Empty]", Fg, Bg);
+}
+
+/**
+ * @brief Draws the prompt and the visible rows into the back buffer, then shows it.
+ * @note Only PICKER_ROWS rows are touched, however long the history is.
+ */
+static void Picker_Redraw(sPickerSession *Session) {
+    int Baseline = (PICKER_ROW_HEIGHT - Display.LineHeight) / 2 + Display.Ascent;
+    char Line[PICKER_QUERY_MAX + 32];
+
+    Picker_Fill(0, 0, Display.Width, Display.Height, PICKER_COLOR_BG);
+
+    int Len = snprintf(Line, sizeof(Line), "%d/%d", Session->SurvivorCount, Session->Snap->Count);
+    int CountX = Display.Width - PICKER_PAD - Len * Display.CharWidth;
+    Picker_DrawText(CountX, Baseline, Len * Display.CharWidth, Line, PICKER_COLOR_DIM, PICKER_COLOR_BG);
+    snprintf(Line, sizeof(Line), PICKER_PROMPT "%s_", Session->Query);
+    Picker_DrawText(PICKER_PAD, Baseline, CountX - 2 * PICKER_PAD, Line, PICKER_COLOR_FG, PICKER_COLOR_BG);
+    Picker_Fill(0, PICKER_ROW_HEIGHT - 1, Display.Width, 1, PICKER_COLOR_BORDER);
+
+    for (int r = 0; r < PICKER_ROWS && Session->Top + r < Session->Entries; r++) {
+        int Entry = Session->Top + r;
+        int Y = (r + 1) * PICKER_ROW_HEIGHT;
+        int Selected = (Entry == Session->Selected);
+        uint32_t Fg = Selected ? PICKER_COLOR_SEL_FG : PICKER_COLOR_FG;
+        uint32_t Bg = Selected ? PICKER_COLOR_SEL_BG : PICKER_COLOR_BG;
+
+        if (Selected) Picker_Fill(0, Y, Display.Width, PICKER_ROW_HEIGHT, Bg);
+        if (Entry == Session->MatchCount) {
+            Picker_DrawText(PICKER_TEXT_X, Y + Baseline, Display.Width - PICKER_TEXT_X, "--- CLEAR ALL HISTORY ---", Fg, Bg);
+        } else {
+            Picker_DrawRow(XCBList_SnapshotRow(Session->Snap, Session->Matches[Entry]), Y, Y + Baseline, Fg, Bg);
+        }
+    }
+
+    xcb_copy_area(Display.Conn, Display.Buffer, Display.Window, Display.Gc, 0, 0, 0, 0,
+                  (uint16_t)Display.Width, (uint16_t)Display.Height);
+    xcb_flush(Display.Conn);
+}
+
+/**************************************************************************************************
+ * FILTER & INPUT *********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Marks the rows whose whole text payload contains the query, not only their preview.
+ * @return The number of rows listed in Found, 0 for queries too short for the full-text index.
+ */
+static int Picker_Search(sPickerSession *Session) {
+    memset(Session->Hits, 0, (size_t)Session->Snap->Count);
+    if (!SEARCH_ENABLED || Session->QueryLen < SEARCH_MIN_QUERY) return 0;
+
+    int Found = Search_Query(Session->Snap, Session->Query, 0, Session->Found, PICKER_SEARCH_MAX);
+    if (Found < 0) return 0;
+    for (int i = 0; i < Found; i++) Session->Hits[Session->Found[i]] = 1;
+    return Found;
+}
+
+/**
+ * @brief Candidates of a grown query: the previous survivors plus the new full-text hits, ascending.
+ * @note Builds the merge in Matches (Count + 1 entries) and copies it back to Survivors.
+ */
+static void Picker_MergeFound(sPickerSession *Session, int Found) {
+    int s = 0, f = 0, Count = 0;
+
+    while (s < Session->SurvivorCount || f < Found) {
+        int Next;
+        if (f >= Found || (s < Session->SurvivorCount && Session->Survivors[s] < Session->Found[f])) {
+            Next = Session->Survivors[s++];
+        } else {
+            Next = Session->Found[f++];
+            if (s < Session->SurvivorCount && Session->Survivors[s] == Next) s++;
+        }
+        Session->Matches[Count++] = Next;
+    }
+    memcpy(Session->Survivors, Session->Matches, (size_t)Count * sizeof(int));
+    Session->SurvivorCount = Count;
+}
+
+/**
+ * @brief Recomputes Matches for the current query: rows holding it as a subsequence of their
+ *        preview or name (see CBC_Fuzzy.h), plus the full-text hits, best first.
+ * @note A query that only grew is matched against the previous survivors instead of the whole
+ *       snapshot; the full-text hits are merged in since they need not be among them.
+ */
+static void Picker_Filter(sPickerSession *Session) {
+    int Count = Session->Snap->Count;
+
+    if (Session->QueryLen == 0) {
+        for (int i = 0; i < Count; i++) Session->Matches[i] = Session->Survivors[i] = i;
+        Session->MatchCount = Session->SurvivorCount = Count;
+    } else {
+        int Found = Picker_Search(Session);
+        if (Session->FilteredLen == SIZE_MAX || Session->QueryLen < Session->FilteredLen) {
+            for (int i = 0; i < Count; i++) Session->Survivors[i] = i;
+            Session->SurvivorCount = Count;
+        } else if (Found > 0) {
+            Picker_MergeFound(Session, Found);
+        }
+
+        int TopCount;
+        Session->SurvivorCount = Fuzzy_Rank(&Session->Fuzzy, Session->Query, Session->QueryLen, Session->Hits,
+                                            Session->Survivors, Session->SurvivorCount,
+                                            Session->Ranked, PICKER_MATCH_MAX, &TopCount);
+        for (int i = 0; i < TopCount; i++) Session->Matches[i] = Session->Ranked[i].Row;
+        Session->MatchCount = TopCount;
+    }
+
+    Session->FilteredLen = Session->QueryLen;
+    Session->Entries = Session->MatchCount + (Session->QueryLen == 0);
+    Session->Selected = 0;
+    Session->Top = 0;
+    Session->Dirty = 1;
+}
+
+static void Picker_Move(sPickerSession *Session, int Delta) {
+    int Selected = Session->Selected + Delta;
+    if (Selected >= Session->Entries) Selected = Session->Entries - 1;
+    if (Selected < 0) Selected = 0;
+
+    Session->Selected = Selected;
+    if (Selected < Session->Top) Session->Top = Selected;
+    if (Selected >= Session->Top + PICKER_ROWS) Session->Top = Selected - PICKER_ROWS + 1;
+    Session->Dirty = 1;
+}
+
+static void Picker_Choose(sPickerSession *Session) {
+    if (Session->Entries == 0) return;
+    Session->Result = (Session->Selected == Session->MatchCount) ? ePICK_CLEAR : ePICK_ITEM;
+    Session->Done = 1;
+}
+
+static void Picker_AppendCodepoint(sPickerSession *Session, uint32_t Cp) {
+    char Utf8[4];
+    size_t Len;
+
+    if (Cp < 0x80) { Utf8[0] = (char)Cp; Len = 1; }
+    else if (Cp < 0x800) { Utf8[0] = (char)(0xC0 | (Cp >> 6)); Utf8[1] = (char)(0x80 | (Cp & 0x3F)); Len = 2; }
+    else if (Cp < 0x10000) { Utf8[0] = (char)(0xE0 | (Cp >> 12)); Utf8[1] = (char)(0x80 | ((Cp >> 6) & 0x3F)); Utf8[2] = (char)(0x80 | (Cp & 0x3F)); Len = 3; }
+    else { Utf8[0] = (char)(0xF0 | (Cp >> 18)); Utf8[1] = (char)(0x80 | ((Cp >> 12) & 0x3F)); Utf8[2] = (char)(0x80 | ((Cp >> 6) & 0x3F)); Utf8[3] = (char)(0x80 | (Cp & 0x3F)); Len = 4; }
+
+    if (Session->QueryLen + Len >= sizeof(Session->Query)) return;
+    memcpy(Session->Query + Session->QueryLen, Utf8, Len);
+    Session->QueryLen += Len;
+    Session->Query[Session->QueryLen] = '\0';
+    Picker_Filter(Session);
+}
+
+/**
+ * @brief Shortens the query to Len bytes; the next filter pass rescans the whole snapshot.
+ */
+static void Picker_TruncateQuery(sPickerSession *Session, size_t Len) {
+    Session->QueryLen = Len;
+    Session->Query[Len] = '\0';
+    Session->FilteredLen = SIZE_MAX;
+    Picker_Filter(Session);
+}
+
+static void Picker_HandleKey(sPickerSession *Session, const xcb_key_press_event_t *Event) {
+    xcb_keysym_t Sym = Picker_Keysym(Event->detail, Event->state);
+
+    if (Event->state & XCB_MOD_MASK_CONTROL) {
+        if (Sym == 'u' || Sym == 'U') Picker_TruncateQuery(Session, 0);
+        else if (Sym == 'p' || Sym == 'P') Picker_Move(Session, -1);
+        else if (Sym == 'n' || Sym == 'N') Picker_Move(Session, 1);
+        return;
+    }
+
+    switch (Sym) {
+        case KEYSYM_ESCAPE:
+            Session->Done = 1;
+            break;
+        case KEYSYM_RETURN:
+        case KEYSYM_KP_ENTER:
+            Picker_Choose(Session);
+            break;
+        case KEYSYM_UP:
+        case KEYSYM_ISO_LEFT_TAB:
+            Picker_Move(Session, -1);
+            break;
+        case KEYSYM_DOWN:
+        case KEYSYM_TAB:
+            Picker_Move(Session, 1);
+            break;
+        case KEYSYM_PAGE_UP:
+            Picker_Move(Session, -PICKER_ROWS);
+            break;
+        case KEYSYM_PAGE_DOWN:
+            Picker_Move(Session, PICKER_ROWS);
+            break;
+        case KEYSYM_HOME:
+            Picker_Move(Session, -Session->Entries);
+            break;
+        case KEYSYM_END:
+            Picker_Move(Session, Session->Entries);
+            break;
+        case KEYSYM_BACKSPACE:
+            if (Session->QueryLen > 0) {
+                /// Drop one whole UTF-8 character
+                size_t Len = Session->QueryLen - 1;
+                while (Len > 0 && ((uint8_t)Session->Query[Len] & 0xC0) == 0x80) Len--;
+                Picker_TruncateQuery(Session, Len);
+            }
+            break;
+        default: {
+            uint32_t Cp = Picker_KeysymToCodepoint(Sym);
+            if (Cp) Picker_AppendCodepoint(Session, Cp);
+            break;
+        }
+    }
+}
+
+static void Picker_HandleButton(sPickerSession *Session, const xcb_button_press_event_t *Event) {
+    if (Event->detail == XCB_BUTTON_INDEX_4) {
+        Picker_Move(Session, -1);
+    } else if (Event->detail == XCB_BUTTON_INDEX_5) {
+        Picker_Move(Session, 1);
+    } else if (Event->detail == XCB_BUTTON_INDEX_1) {
+        /// Pointer events are reported relative to the grab window, even outside it
+        if (Event->event_x < 0 || Event->event_x >= Display.Width || Event->event_y < 0 || Event->event_y >= Display.Height) {
+            Session->Done = 1;
+            return;
+        }
+        int Entry = Session->Top + Event->event_y / PICKER_ROW_HEIGHT - 1;
+        if (Event->event_y >= PICKER_ROW_HEIGHT && Entry < Session->Entries) {
+            Session->Selected = Entry;
+            Picker_Choose(Session);
+        }
+    }
+}
+
+static void Picker_HandleEvent(sPickerSession *Session, xcb_generic_event_t *Event) {
+    switch (Event->response_type & 0x7F) {
+        case XCB_EXPOSE:
+            if (((xcb_expose_event_t *)Event)->count == 0) Session->Dirty = 1;
+            break;
+        case XCB_KEY_PRESS:
+            Picker_HandleKey(Session, (xcb_key_press_event_t *)Event);
+            break;
+        case XCB_BUTTON_PRESS:
+            Picker_HandleButton(Session, (xcb_button_press_event_t *)Event);
+            break;
+        case XCB_MAPPING_NOTIFY:
+            if (((xcb_mapping_notify_event_t *)Event)->request == XCB_MAPPING_KEYBOARD) Picker_LoadKeymap();
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Runs the picker until the session is done: X events first, then one frame, then at most
+ *        one thumbnail decode, then sleep on the X connection and the UI wakeup.
+ */
+static void Picker_Run(sPickerSession *Session) {
+    int WakeFd = ClipboardCaptureGetUiFd();
+    struct pollfd Fds[2] = {
+        { .fd = xcb_get_file_descriptor(Display.Conn), .events = POLLIN },
+        { .fd = WakeFd, .events = POLLIN }
+    };
+
+    while (!Session->Done) {
+        xcb_generic_event_t *Event;
+        while (!Session->Done && (Event = xcb_poll_for_event(Display.Conn)) != NULL) {
+            Picker_HandleEvent(Session, Event);
+            free(Event);
+        }
+        if (Session->Done) break;
+        if (xcb_connection_has_error(Display.Conn)) {
+            xError("[Picker] Lost the X connection.");
+            break;
+        }
+
+        if (Session->Dirty) {
+            Session->Dirty = 0;
+            Picker_Redraw(Session);
+        }
+
+        /// Text rows are on screen first; thumbnails follow one by one, input still served in between
+        if (Picker_LoadOneThumb(Session)) {
+            Session->Dirty = 1;
+            continue;
+        }
+
+        if (poll(Fds, (WakeFd >= 0) ? 2 : 1, -1) < 0 && errno != EINTR) break;
+        if (Fds[1].revents & POLLIN) {
+            uint64_t Count;
+            ssize_t Ret = read(WakeFd, &Count, sizeof(Count));
+            (void)Ret;
+            /// A second SIGUSR1 toggles the picker off
+            if (RequestExit == eACTIVATE || TogglePopUpStatus == eREQ_HIDE) Session->Done = 1;
+        }
+    }
+}
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+void Picker_Show(void) {
+    xEntry1("Picker_Show");
+
+    if (Picker_Open() != OKE) return;
+
+    /// 1. Rows come from one snapshot: previews are already in memory, only full-text searches read payloads
+    sPickerSession Session;
+    memset(&Session, 0, sizeof(Session));
+    Session.Snap = XCBList_AcquireSnapshot();
+    if (!Session.Snap) return;
+    Session.Matches = malloc(((size_t)Session.Snap->Count + 1) * sizeof(int));
+    Session.Survivors = malloc(((size_t)Session.Snap->Count + 1) * sizeof(int));
+    Session.Ranked = malloc(PICKER_MATCH_MAX * sizeof(sFuzzyMatch));
+    Session.Found = malloc(PICKER_SEARCH_MAX * sizeof(int));
+    Session.Hits = malloc((size_t)Session.Snap->Count + 1);
+    if (!Session.Matches || !Session.Survivors || !Session.Ranked || !Session.Found || !Session.Hits ||
+        Fuzzy_Build(&Session.Fuzzy, Session.Snap) != OKE) {
+        free(Session.Matches);
+        free(Session.Survivors);
+        free(Session.Ranked);
+        free(Session.Found);
+        free(Session.Hits);
+        XCBList_ReleaseSnapshot(Session.Snap);
+        return;
+    }
+    Session.FilteredLen = SIZE_MAX;
+    Picker_Filter(&Session);
+
+    /// 2. Centre the window, raise it and take the keyboard
+    uint32_t Geometry[] = {
+        (uint32_t)((Display.Screen->width_in_pixels - Display.Width) / 2),
+        (uint32_t)((Display.Screen->height_in_pixels - Display.Height) / 3),
+        XCB_STACK_MODE_ABOVE
+    };
+    xcb_configure_window(Display.Conn, Display.Window,
+                         XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_STACK_MODE, Geometry);
+    xcb_map_window(Display.Conn, Display.Window);
+    Picker_Redraw(&Session);
+
+    if (Picker_Grab() == OKE) {
+        TogglePopUpStatus = eSHOWN;
+        Picker_Run(&Session);
+    } else {
+        xWarn("[Picker] Cannot grab the keyboard.");
+    }
+
+    xcb_ungrab_pointer(Display.Conn, XCB_CURRENT_TIME);
+    xcb_ungrab_keyboard(Display.Conn, XCB_CURRENT_TIME);
+    xcb_unmap_window(Display.Conn, Display.Window);
+    xcb_flush(Display.Conn);
+
+    /// 3. Act on the choice once the focus is back with the target application
+    if (Session.Result == ePICK_CLEAR) {
+        xLog1("[Picker] User requested to CLEAR ALL HISTORY.");
+        sCmd Cmd = { .Type = eCMD_CLEAR };
+        if (ClipboardCaptureSubmit(&Cmd) != OKE) xWarn("[Picker] Command queue full. Clear dropped.");
+    } else if (Session.Result == ePICK_ITEM) {
+        /// Resolve by id: the list may have moved since the snapshot
+        uint64_t Id = XCBList_SnapshotRow(Session.Snap, Session.Matches[Session.Selected])->Id;
+        xLog1("[Picker] User selected id %llu.", (unsigned long long)Id);
+        if (XCBList_SetSelectedNum(XCBList_FindById(Id)) == OKE) {
+            sCmd Cmd = { .Type = eCMD_INJECT_ID, .Id = Id };
+            if (ClipboardCaptureSubmit(&Cmd) != OKE) xWarn("[Picker] Command queue full. Selection dropped.");
+        }
+    }
+
+    if (xcb_connection_has_error(Display.Conn)) Picker_Close();
+    Fuzzy_Free(&Session.Fuzzy);
+    free(Session.Matches);
+    free(Session.Survivors);
+    free(Session.Ranked);
+    free(Session.Found);
+    free(Session.Hits);
+    XCBList_ReleaseSnapshot(Session.Snap);
+    xExit1("Picker_Show");
+}
+
+void Picker_Close(void) {
+    for (int i = 0; i < PICKER_THUMB_CACHE; i++) free(ThumbCache[i].Image);
+    memset(ThumbCache, 0, sizeof(ThumbCache));
+
+    if (!Display.Conn) return;
+    free(Display.Keysyms);
+    /// Closing the connection releases the window, pixmap, GC and font on the server
+    xcb_disconnect(Display.Conn);
+    memset(&Display, 0, sizeof(Display));
+}
+
+#endif /*(PICKER_ENABLED)*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
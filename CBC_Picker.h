@@ -0,0 +1,68 @@
+#ifndef __CBC_PICKER_H__
+#define __CBC_PICKER_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * PICKER CONFIGURATION SECTION *******************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief The built-in picker replaces Rofi when ROFI_SUPPORT is off.
+ */
+#define PICKER_ENABLED                  ((ROFI_SUPPORT == 0) && (PICKER_SUPPORT == 1))
+
+/**
+ * @brief Font used when PICKER_FONT is not installed (every X server has it).
+ */
+#define PICKER_FONT_FALLBACK            "fixed"
+
+/**
+ * @brief Capacity (bytes) of the filter query typed in the picker.
+ */
+#define PICKER_QUERY_MAX                256
+
+#define PICKER_PROMPT                   "X11 Clipboard: "
+
+/**
+ * @brief Colours (0xRRGGBB).
+ */
+#define PICKER_COLOR_BG                 0x202124
+#define PICKER_COLOR_FG                 0xD8D8D8
+#define PICKER_COLOR_DIM                0x8A8A8A
+#define PICKER_COLOR_SEL_BG             0x2F5A8A
+#define PICKER_COLOR_SEL_FG             0xFFFFFF
+#define PICKER_COLOR_BORDER             0x5A5A5A
+
+/**************************************************************************************************
+ * PICKER PROTOTYPES ******************************************************************************
+ **************************************************************************************************/
+
+#if (PICKER_ENABLED)
+
+/**
+ * @brief Shows the picker and lets the user filter and select a clipboard item.
+ * @note UI thread only. The picker has its own X connection and window, created on the first call
+ *       and kept (hidden) afterwards; rows come from one history snapshot, so opening does no
+ *       payload I/O. Blocks until the user picks an item, presses ESC, clicks outside, or a popup
+ *       toggle / exit request arrives.
+ */
+void Picker_Show(void);
+
+/**
+ * @brief Destroys the picker window and closes its X connection.
+ */
+void Picker_Close(void);
+
+#endif /*(PICKER_ENABLED)*/
+
+#endif /*__CBC_PICKER_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,152 @@
+#include "CBC_Preview.h"
+#include "CBC_Codec.h"
+#include "CBC_Segment.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+
+/**************************************************************************************************
+ * INTERNAL HELPERS *******************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Length of the UTF-8 sequence starting at In[0], or 0 if it is not valid UTF-8.
+ * @param Avail Bytes available from In.
+ * @param Final 1 if no byte follows In[Avail - 1] (a cut sequence is then invalid).
+ * @return The sequence length, 0 if invalid, -1 if more input is needed to decide.
+ */
+static int Internal_Utf8Len(const uint8_t *In, size_t Avail, int Final) {
+    uint8_t c = In[0];
+    int Len;
+    uint8_t Lo = 0x80, Hi = 0xBF;   /// Allowed range of the second byte
+
+    if (c < 0x80) return 1;
+    else if (c >= 0xC2 && c <= 0xDF) Len = 2;
+    else if (c >= 0xE0 && c <= 0xEF) { Len = 3; if (c == 0xE0) Lo = 0xA0; if (c == 0xED) Hi = 0x9F; }
+    else if (c >= 0xF0 && c <= 0xF4) { Len = 4; if (c == 0xF0) Lo = 0x90; if (c == 0xF4) Hi = 0x8F; }
+    else return 0;
+
+    for (int i = 1; i < Len; i++) {
+        if ((size_t)i >= Avail) return Final ? 0 : -1;
+        if (In[i] < ((i == 1) ? Lo : 0x80) || In[i] > ((i == 1) ? Hi : 0xBF)) return 0;
+    }
+    return Len;
+}
+
+/**
+ * @brief Copies In to Output as one menu line: whole UTF-8 characters only, control characters
+ *        replaced, at most Budget bytes.
+ * @param Consumed Receives the number of input bytes used.
+ * @return The number of bytes written (Output is not terminated).
+ */
+static size_t Internal_Sanitize(const uint8_t *In, size_t InLen, int Final, char *Output, size_t Budget, size_t *Consumed) {
+    size_t Pos = 0, Out = 0;
+
+    while (Pos < InLen && Out < Budget) {
+        int Len = Internal_Utf8Len(In + Pos, InLen - Pos, Final);
+        if (Len < 0) break;
+
+        if (Len == 0) {
+            /// Invalid byte: one '?' per byte, so the next valid character resynchronizes
+            Output[Out++] = '?';
+            Pos++;
+        } else if (Len == 1) {
+            uint8_t c = In[Pos++];
+            if (c == '\n' || c == '\r' || c == '\t') Output[Out++] = ' ';
+            else if (c < 32 || c == 127) Output[Out++] = '?';
+            else Output[Out++] = (char)c;
+        } else if (In[Pos] == 0xC2 && In[Pos + 1] < 0xA0) {
+            /// C1 control characters (U+0080..U+009F) are as unprintable as the C0 ones
+            Output[Out++] = '?';
+            Pos += 2;
+        } else {
+            if (Out + (size_t)Len > Budget) break;
+            memcpy(Output + Out, In + Pos, (size_t)Len);
+            Out += (size_t)Len;
+            Pos += (size_t)Len;
+        }
+    }
+
+    *Consumed = Pos;
+    return Out;
+}
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+void Preview_Begin(sPreviewBuilder *Builder) {
+    memset(Builder, 0, sizeof(*Builder));
+}
+
+void Preview_Feed(sPreviewBuilder *Builder, const uint8_t *Data, size_t Len) {
+    if (Len == 0) return;
+
+    if (Builder->HeadLen < sizeof(Builder->Head)) {
+        size_t Take = sizeof(Builder->Head) - Builder->HeadLen;
+        if (Take > Len) Take = Len;
+        memcpy(Builder->Head + Builder->HeadLen, Data, Take);
+        Builder->HeadLen += Take;
+    }
+
+    for (const uint8_t *p = Data, *End = Data + Len; (p = memchr(p, '\n', (size_t)(End - p))) != NULL; p++) {
+        Builder->Newlines++;
+    }
+    Builder->Total += Len;
+    Builder->Last = Data[Len - 1];
+}
+
+void Preview_End(const sPreviewBuilder *Builder, char Output[PREVIEW_TXT_LEN + 1], uint32_t *Lines) {
+    int Whole = (Builder->Total == Builder->HeadLen);
+    size_t Used;
+    size_t Len = Internal_Sanitize(Builder->Head, Builder->HeadLen, Whole, Output, PREVIEW_TXT_LEN, &Used);
+
+    /// Cut short: make room for the marker and cut again on a character boundary
+    if (!Whole || Used < Builder->HeadLen) {
+        Len = Internal_Sanitize(Builder->Head, Builder->HeadLen, Whole, Output,
+                                PREVIEW_TXT_LEN - (sizeof(PREVIEW_MORE_MARK) - 1), &Used);
+        memcpy(Output + Len, PREVIEW_MORE_MARK, sizeof(PREVIEW_MORE_MARK) - 1);
+        Len += sizeof(PREVIEW_MORE_MARK) - 1;
+    }
+    Output[Len] = '\0';
+
+    if (Lines) *Lines = (Builder->Total == 0) ? 0 : Builder->Newlines + (Builder->Last != '\n');
+}
+
+RetType Preview_FromStore(sClipboardItem *Item) {
+    Item->Preview[0] = '\0';
+    Item->Lines = 0;
+    if (Item->FileType != eFMT_TXT) return OKE;
+
+    uint8_t *Buffer = malloc(PREVIEW_SCAN_MAX);
+    if (!Buffer) return ERR;
+
+    /// No Codec_Item* here: its stale-location retry looks the item up in the (locked) list
+    int64_t Len;
+    if (Item->Segment != 0) {
+        Len = Segment_Read(Item->Segment, Item->SegOffset, Buffer, PREVIEW_SCAN_MAX, 1);
+    } else {
+        char FullPath[PATH_MAX];
+        snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, Item->Filename);
+        Len = Codec_ReadHead(FullPath, Buffer, PREVIEW_SCAN_MAX);
+    }
+    if (Len < 0) {
+        free(Buffer);
+        return ERR;
+    }
+
+    sPreviewBuilder Builder;
+    Preview_Begin(&Builder);
+    Preview_Feed(&Builder, Buffer, (size_t)Len);
+    free(Buffer);
+
+    uint32_t Lines;
+    Preview_End(&Builder, Item->Preview, &Lines);
+    if ((size_t)Len < PREVIEW_SCAN_MAX) Item->Lines = Lines;
+    return OKE;
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,69 @@
+#ifndef __CBC_PREVIEW_H__
+#define __CBC_PREVIEW_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * PREVIEW CONFIGURATION SECTION ******************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Marker appended to a preview cut short.
+ */
+#define PREVIEW_MORE_MARK               "[...]"
+
+/**************************************************************************************************
+ * PREVIEW TYPES **********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Incremental preview of a text payload, fed slice by slice while it is captured.
+ */
+typedef struct {
+    uint8_t     Head[PREVIEW_TXT_LEN];  /// First payload bytes
+    size_t      HeadLen;
+    uint64_t    Total;                  /// Payload bytes fed so far
+    uint32_t    Newlines;               /// '\n' seen so far
+    uint8_t     Last;                   /// Last byte fed
+} sPreviewBuilder;
+
+/**************************************************************************************************
+ * PREVIEW PROTOTYPES *****************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Resets a builder for a new payload.
+ */
+void Preview_Begin(sPreviewBuilder *Builder);
+
+/**
+ * @brief Feeds the next payload bytes (keeps the head, counts lines).
+ */
+void Preview_Feed(sPreviewBuilder *Builder, const uint8_t *Data, size_t Len);
+
+/**
+ * @brief Produces the menu-ready preview of everything fed so far.
+ * @param Output Receives the preview: valid UTF-8, no control characters, at most PREVIEW_TXT_LEN
+ *               bytes, ending with PREVIEW_MORE_MARK when the payload is longer.
+ * @param Lines Receives the number of lines (0 for an empty payload).
+ */
+void Preview_End(const sPreviewBuilder *Builder, char Output[PREVIEW_TXT_LEN + 1], uint32_t *Lines);
+
+/**
+ * @brief Rebuilds the preview of a stored text item from its payload.
+ * @param Item The item (file or segment record). Its Preview and Lines fields are filled.
+ * @return OKE on success, ERR if the payload cannot be read.
+ * @note Reads the store directly and never takes the ListMutex, so it is safe while holding it.
+ */
+RetType Preview_FromStore(sClipboardItem *Item);
+
+#endif /*__CBC_PREVIEW_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
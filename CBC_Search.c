@@ -0,0 +1,1027 @@
+#define _GNU_SOURCE
+#include "CBC_Search.h"
+#include "CBC_Codec.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+#include <ctype.h>
+#include <regex.h>
+#include <zlib.h>
+
+/**************************************************************************************************
+ * INTERNAL TYPES *********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Builder tables larger than this (slots) are released instead of kept for the next payload.
+ */
+#define SEARCH_BUILDER_KEEP             65536U
+
+/**
+ * @brief Removed items are purged from the postings once they outnumber the live ones (and at least this many).
+ */
+#define SEARCH_COMPACT_MIN              1024U
+
+#define SEARCH_NO_DOC                   UINT32_MAX
+
+/**
+ * @brief The items containing one trigram.
+ */
+typedef struct {
+    uint32_t    Key;        /// Trigram + 1 (0 = empty slot)
+    uint32_t    Count;
+    uint32_t    Cap;
+    uint32_t   *Docs;       /// Ascending doc ids
+} sSearchPosting;
+
+/**
+ * @brief Header of PATH_FILE_SEARCH. Followed by DocCount names (uint16_t length + bytes, doc id order),
+ *        PostingCount postings (trigram, count, doc ids) and the CRC32 of everything before it.
+ */
+typedef struct {
+    uint32_t    Magic;      /// SEARCH_MAGIC
+    uint32_t    Version;    /// SEARCH_VERSION
+    uint32_t    DocCount;
+    uint32_t    PostingCount;
+} sSearchFileHeader;
+
+/**************************************************************************************************
+ * INTERNAL DATA SECTION **************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Guards every table below. Taken after the ListMutex, never before it.
+ */
+static pthread_mutex_t  SearchMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Doc table. Ids are handed out in increasing order so every posting list stays sorted;
+ *        a removed item only clears its name until the next compaction.
+ */
+static char           **DocName = NULL;         /// Item filename (NULL once removed)
+static uint32_t        *DocKey = NULL;          /// FNV-1a of DocName
+static uint32_t         DocCount = 0, DocCap = 0, DocLive = 0;
+
+/**
+ * @brief Filename -> doc id + 1, open addressing (live docs only).
+ */
+static uint32_t        *NameSlots = NULL;
+static uint32_t         NameMask = 0;
+
+/**
+ * @brief Trigram -> posting, open addressing.
+ */
+static sSearchPosting  *Postings = NULL;
+static uint32_t         PostingMask = 0, PostingCount = 0;
+
+/**
+ * @brief Bumped by every change to the doc table. IndexDirty is set until the next save.
+ */
+static uint64_t         IndexGen = 1;
+static int              IndexDirty = 0;
+
+/**
+ * @brief Row -> doc id of the last snapshot searched, reused while neither the history nor the index changes.
+ */
+static uint32_t        *RowDoc = NULL;
+static int              RowDocCap = 0, RowDocCount = -1;
+static uint64_t         RowDocVersion = 0, RowDocGen = 0;
+
+static pthread_t        SearchThread;
+static int              SearchStopReq = 0;
+static int              SearchRunning = 0;
+
+/**************************************************************************************************
+ * INTERNAL HELPERS *******************************************************************************
+ **************************************************************************************************/
+
+static inline uint8_t Internal_Fold(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+static inline uint32_t Internal_TrigramHash(uint32_t Trigram) {
+    return Trigram * 2654435761U;
+}
+
+/**
+ * @brief FNV-1a hash of a filename.
+ */
+static uint32_t Internal_NameKey(const char *Name) {
+    uint32_t Key = 2166136261U;
+    while (*Name) {
+        Key ^= (uint8_t)*Name++;
+        Key *= 16777619U;
+    }
+    return Key;
+}
+
+/**
+ * @brief Appends the (folded) trigrams of Text to Trigrams, up to SEARCH_QUERY_TRIGRAMS in total.
+ * @return The new trigram count.
+ */
+static int Internal_AddTrigrams(const uint8_t *Text, size_t Len, uint32_t *Trigrams, int Count) {
+    for (size_t i = 2; i < Len && Count < SEARCH_QUERY_TRIGRAMS; i++) {
+        Trigrams[Count++] = ((uint32_t)Internal_Fold(Text[i - 2]) << 16) |
+                            ((uint32_t)Internal_Fold(Text[i - 1]) << 8) | Internal_Fold(Text[i]);
+    }
+    return Count;
+}
+
+/**
+ * @brief Collects the trigrams of the literals every match of a POSIX extended regex must contain.
+ * @return The trigram count (0 = the regex cannot be narrowed down: every item is checked).
+ * @note Conservative: only top-level literal runs are used. Anything inside a group, an optional
+ *       or bounded atom, a bracket expression or a GNU escape (\w, \b, ...) ends the current run,
+ *       and a top-level alternation gives up entirely.
+ */
+static int Internal_RegexTrigrams(const char *Regex, uint32_t *Trigrams) {
+    uint8_t Run[SEARCH_QUERY_TRIGRAMS + 2];
+    size_t RunLen = 0, Len = strlen(Regex), i = 0;
+    int Count = 0, Depth = 0;
+
+    while (i < Len) {
+        uint8_t c = (uint8_t)Regex[i];
+        size_t Next = i + 1;
+        int IsLiteral = 0;
+
+        if (c == '|' && Depth == 0) {
+            return 0;
+        } else if (c == '\\' && i + 1 < Len) {
+            /// "\." is a literal dot; "\w", "\b"... are GNU classes and anchors
+            IsLiteral = !isalnum((unsigned char)Regex[i + 1]);
+            c = (uint8_t)Regex[i + 1];
+            Next = i + 2;
+        } else if (c == '[') {
+            /// A ']' right after '[' or "[^" is part of the set; "[:alpha:]" and friends nest
+            if (Next < Len && Regex[Next] == '^') Next++;
+            if (Next < Len && Regex[Next] == ']') Next++;
+            while (Next < Len && Regex[Next] != ']') {
+                if (Regex[Next] == '[' && Next + 1 < Len && strchr(":.=", Regex[Next + 1])) {
+                    const char *Close = strstr(Regex + Next + 2, (const char[]){ Regex[Next + 1], ']', '\0' });
+                    Next = Close ? (size_t)(Close - Regex) + 2 : Len;
+                } else {
+                    Next++;
+                }
+            }
+            if (Next < Len) Next++;
+        } else if (c == '{') {
+            while (Next < Len && Regex[Next - 1] != '}') Next++;
+        } else if (c == '(') {
+            Depth++;
+        } else if (c == ')') {
+            if (Depth > 0) Depth--;
+        } else if (!strchr(".^$*+?", c)) {
+            IsLiteral = 1;
+        }
+
+        /// A quantified atom may be absent ('*', '?', "{0,n}") or repeated ('+')
+        uint8_t Quantifier = (Next < Len) ? (uint8_t)Regex[Next] : 0;
+        int Optional = (Quantifier == '*' || Quantifier == '?' || Quantifier == '{');
+
+        if (IsLiteral && Depth == 0 && !Optional && RunLen < sizeof(Run)) {
+            Run[RunLen++] = c;
+        }
+        if (!IsLiteral || Depth > 0 || Optional || Quantifier == '+' || RunLen == sizeof(Run)) {
+            Count = Internal_AddTrigrams(Run, RunLen, Trigrams, Count);
+            RunLen = 0;
+        }
+        i = Next;
+    }
+    return Internal_AddTrigrams(Run, RunLen, Trigrams, Count);
+}
+
+/**
+ * @brief Keeps the entries of Cur (sorted) that are also in List (sorted).
+ * @return The number of entries kept at the start of Cur.
+ */
+static uint32_t Internal_Intersect(uint32_t *Cur, uint32_t CurLen, const uint32_t *List, uint32_t ListLen) {
+    uint32_t Kept = 0, Pos = 0;
+
+    for (uint32_t i = 0; i < CurLen && Pos < ListLen; i++) {
+        uint32_t Want = Cur[i];
+
+        /// Gallop then bisect: List is usually far longer than Cur
+        uint32_t Lo = Pos, Step = 1;
+        while (Lo + Step < ListLen && List[Lo + Step] < Want) {
+            Lo += Step;
+            Step <<= 1;
+        }
+        uint32_t Hi = (Lo + Step < ListLen) ? Lo + Step : ListLen;
+        while (Lo < Hi) {
+            uint32_t Mid = Lo + (Hi - Lo) / 2;
+            if (List[Mid] < Want) Lo = Mid + 1;
+            else Hi = Mid;
+        }
+
+        Pos = Lo;
+        if (Pos < ListLen && List[Pos] == Want) Cur[Kept++] = Want;
+    }
+    return Kept;
+}
+
+static int Internal_StopRequested(void) {
+    pthread_mutex_lock(&SearchMutex);
+    int Stop = SearchStopReq;
+    pthread_mutex_unlock(&SearchMutex);
+    return Stop;
+}
+
+/**************************************************************************************************
+ * TRIGRAM BUILDER ********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Doubles the trigram set of a builder (or creates it).
+ * @return 1 on success, 0 on allocation failure.
+ */
+static int Builder_Grow(sSearchBuilder *Builder) {
+    uint32_t NewMask = Builder->Slots ? (Builder->Mask << 1) | 1U : 1023U;
+    uint32_t *New = calloc((size_t)NewMask + 1, sizeof(uint32_t));
+    if (!New) return 0;
+
+    if (Builder->Slots) {
+        for (uint32_t i = 0; i <= Builder->Mask; i++) {
+            uint32_t Key = Builder->Slots[i];
+            if (Key == 0) continue;
+            uint32_t Slot = Internal_TrigramHash(Key - 1) & NewMask;
+            while (New[Slot] != 0) Slot = (Slot + 1) & NewMask;
+            New[Slot] = Key;
+        }
+        free(Builder->Slots);
+    }
+    Builder->Slots = New;
+    Builder->Mask = NewMask;
+    return 1;
+}
+
+static void Builder_Insert(sSearchBuilder *Builder, uint32_t Trigram) {
+    uint32_t Slot = Internal_TrigramHash(Trigram) & Builder->Mask;
+    while (Builder->Slots[Slot] != 0) {
+        if (Builder->Slots[Slot] == Trigram + 1) return;
+        Slot = (Slot + 1) & Builder->Mask;
+    }
+    Builder->Slots[Slot] = Trigram + 1;
+    Builder->Count++;
+
+    /// Kept at most half full, so probing always ends on an empty slot
+    if (Builder->Count * 2 > Builder->Mask && !Builder_Grow(Builder)) Builder->Failed = 1;
+}
+
+void Search_Begin(sSearchBuilder *Builder) {
+    Builder->Count = 0;
+    Builder->Total = 0;
+    Builder->Failed = 0;
+    Builder->Tail[0] = Builder->Tail[1] = 0;
+    if (!SEARCH_ENABLED) return;
+
+    if (Builder->Slots && Builder->Mask + 1 > SEARCH_BUILDER_KEEP) {
+        free(Builder->Slots);
+        Builder->Slots = NULL;
+    }
+    if (Builder->Slots) memset(Builder->Slots, 0, ((size_t)Builder->Mask + 1) * sizeof(uint32_t));
+    else if (!Builder_Grow(Builder)) Builder->Failed = 1;
+}
+
+void Search_Feed(sSearchBuilder *Builder, const uint8_t *Data, size_t Len) {
+    if (!SEARCH_ENABLED || Builder->Failed || !Builder->Slots || Builder->Total >= SEARCH_TEXT_MAX) return;
+    if (Len > SEARCH_TEXT_MAX - Builder->Total) Len = (size_t)(SEARCH_TEXT_MAX - Builder->Total);
+
+    /// The window carries the last two bytes over, so trigrams spanning two slices are kept
+    uint32_t Window = ((uint32_t)Builder->Tail[0] << 8) | Builder->Tail[1];
+    for (size_t i = 0; i < Len; i++) {
+        Window = ((Window << 8) | Internal_Fold(Data[i])) & 0xFFFFFFU;
+        if (Builder->Total + i >= 2) {
+            Builder_Insert(Builder, Window);
+            if (Builder->Failed) return;
+        }
+    }
+    Builder->Total += Len;
+    Builder->Tail[0] = (uint8_t)(Window >> 8);
+    Builder->Tail[1] = (uint8_t)Window;
+}
+
+void Search_FreeBuilder(sSearchBuilder *Builder) {
+    free(Builder->Slots);
+    Builder->Slots = NULL;
+    Builder->Mask = 0;
+    Builder->Count = 0;
+}
+
+/**************************************************************************************************
+ * INDEX TABLES (SearchMutex held) ****************************************************************
+ **************************************************************************************************/
+
+static uint32_t NameMap_Find(const char *Name, uint32_t Key) {
+    if (!NameSlots) return SEARCH_NO_DOC;
+
+    uint32_t Slot = Key & NameMask;
+    while (NameSlots[Slot] != 0) {
+        uint32_t Doc = NameSlots[Slot] - 1;
+        if (DocKey[Doc] == Key && strcmp(DocName[Doc], Name) == 0) return Doc;
+        Slot = (Slot + 1) & NameMask;
+    }
+    return SEARCH_NO_DOC;
+}
+
+static void NameMap_Insert(uint32_t Doc) {
+    uint32_t Slot = DocKey[Doc] & NameMask;
+    while (NameSlots[Slot] != 0) Slot = (Slot + 1) & NameMask;
+    NameSlots[Slot] = Doc + 1;
+}
+
+/**
+ * @brief Removes a doc from the name map.
+ * @note Uses backward-shift deletion so linear probing never needs tombstones.
+ */
+static void NameMap_Remove(uint32_t Doc) {
+    uint32_t Slot = DocKey[Doc] & NameMask;
+    while (NameSlots[Slot] != Doc + 1) {
+        if (NameSlots[Slot] == 0) return;
+        Slot = (Slot + 1) & NameMask;
+    }
+
+    /// Pull later entries of the same probe chain back into the hole
+    uint32_t Hole = Slot;
+    uint32_t Next = (Hole + 1) & NameMask;
+    while (NameSlots[Next] != 0) {
+        uint32_t Home = DocKey[NameSlots[Next] - 1] & NameMask;
+        if (((Next - Home) & NameMask) >= ((Next - Hole) & NameMask)) {
+            NameSlots[Hole] = NameSlots[Next];
+            Hole = Next;
+        }
+        Next = (Next + 1) & NameMask;
+    }
+    NameSlots[Hole] = 0;
+}
+
+/**
+ * @brief Refills the name map from the doc table, growing it to hold Live docs at half load.
+ * @return 1 on success, 0 on allocation failure (the old map is kept).
+ */
+static int NameMap_Rebuild(uint32_t Live) {
+    uint32_t Size = 1024;
+    while (Size < Live * 2) Size <<= 1;
+
+    if (!NameSlots || Size > NameMask + 1) {
+        uint32_t *New = calloc(Size, sizeof(uint32_t));
+        if (!New) return 0;
+        free(NameSlots);
+        NameSlots = New;
+        NameMask = Size - 1;
+    } else {
+        memset(NameSlots, 0, ((size_t)NameMask + 1) * sizeof(uint32_t));
+    }
+
+    for (uint32_t Doc = 0; Doc < DocCount; Doc++) {
+        if (DocName[Doc]) NameMap_Insert(Doc);
+    }
+    return 1;
+}
+
+static sSearchPosting *Posting_Find(uint32_t Trigram) {
+    if (!Postings) return NULL;
+
+    uint32_t Slot = Internal_TrigramHash(Trigram) & PostingMask;
+    while (Postings[Slot].Key != 0) {
+        if (Postings[Slot].Key == Trigram + 1) return &Postings[Slot];
+        Slot = (Slot + 1) & PostingMask;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Moves the postings to a table of NewMask + 1 slots, dropping the empty ones.
+ * @return 1 on success, 0 on allocation failure (the old table is kept).
+ */
+static int Posting_Rehash(uint32_t NewMask) {
+    sSearchPosting *New = calloc((size_t)NewMask + 1, sizeof(sSearchPosting));
+    if (!New) return 0;
+
+    PostingCount = 0;
+    for (uint32_t i = 0; Postings && i <= PostingMask; i++) {
+        sSearchPosting *Old = &Postings[i];
+        if (Old->Key == 0) continue;
+        if (Old->Count == 0) {
+            free(Old->Docs);
+            continue;
+        }
+        uint32_t Slot = Internal_TrigramHash(Old->Key - 1) & NewMask;
+        while (New[Slot].Key != 0) Slot = (Slot + 1) & NewMask;
+        New[Slot] = *Old;
+        PostingCount++;
+    }
+    free(Postings);
+    Postings = New;
+    PostingMask = NewMask;
+    return 1;
+}
+
+/**
+ * @brief Finds the posting of a trigram, creating an empty one if needed.
+ * @return The posting, or NULL on allocation failure.
+ */
+static sSearchPosting *Posting_Get(uint32_t Trigram) {
+    sSearchPosting *Posting = Posting_Find(Trigram);
+    if (Posting) return Posting;
+
+    if (!Postings || (PostingCount + 1) * 2 > PostingMask + 1) {
+        if (!Posting_Rehash(Postings ? (PostingMask << 1) | 1U : 4095U)) return NULL;
+    }
+
+    uint32_t Slot = Internal_TrigramHash(Trigram) & PostingMask;
+    while (Postings[Slot].Key != 0) Slot = (Slot + 1) & PostingMask;
+    Postings[Slot].Key = Trigram + 1;
+    PostingCount++;
+    return &Postings[Slot];
+}
+
+static int Posting_Append(sSearchPosting *Posting, uint32_t Doc) {
+    if (Posting->Count == Posting->Cap) {
+        uint32_t NewCap = Posting->Cap ? Posting->Cap * 2 : 4;
+        uint32_t *New = realloc(Posting->Docs, (size_t)NewCap * sizeof(uint32_t));
+        if (!New) return 0;
+        Posting->Docs = New;
+        Posting->Cap = NewCap;
+    }
+    Posting->Docs[Posting->Count++] = Doc;
+    return 1;
+}
+
+/**
+ * @brief Frees every table and empties the index.
+ */
+static void Index_Reset(void) {
+    for (uint32_t Doc = 0; Doc < DocCount; Doc++) free(DocName[Doc]);
+    for (uint32_t i = 0; Postings && i <= PostingMask; i++) free(Postings[i].Docs);
+    free(DocName);
+    free(DocKey);
+    free(NameSlots);
+    free(Postings);
+    DocName = NULL;
+    DocKey = NULL;
+    NameSlots = NULL;
+    Postings = NULL;
+    DocCount = DocCap = DocLive = 0;
+    NameMask = PostingMask = PostingCount = 0;
+    IndexGen++;
+}
+
+/**
+ * @brief Marks a doc removed. Its ids stay in the postings until the next compaction.
+ */
+static void Index_Drop(uint32_t Doc) {
+    NameMap_Remove(Doc);
+    free(DocName[Doc]);
+    DocName[Doc] = NULL;
+    DocLive--;
+    IndexGen++;
+    IndexDirty = 1;
+}
+
+/**
+ * @brief Renumbers the live docs densely and purges the removed ones from the postings.
+ */
+static void Index_Compact(void) {
+    if (DocLive == DocCount) return;
+
+    uint32_t *Remap = malloc(((size_t)DocCount + 1) * sizeof(uint32_t));
+    if (!Remap) return;
+
+    uint32_t Live = 0;
+    for (uint32_t Doc = 0; Doc < DocCount; Doc++) {
+        if (DocName[Doc]) {
+            DocName[Live] = DocName[Doc];
+            DocKey[Live] = DocKey[Doc];
+            Remap[Doc] = Live++;
+        } else {
+            Remap[Doc] = SEARCH_NO_DOC;
+        }
+    }
+
+    /// Renumbering keeps the order, so the lists stay sorted
+    for (uint32_t i = 0; Postings && i <= PostingMask; i++) {
+        sSearchPosting *Posting = &Postings[i];
+        uint32_t Kept = 0;
+        for (uint32_t j = 0; j < Posting->Count; j++) {
+            uint32_t Doc = Remap[Posting->Docs[j]];
+            if (Doc != SEARCH_NO_DOC) Posting->Docs[Kept++] = Doc;
+        }
+        Posting->Count = Kept;
+    }
+    free(Remap);
+
+    DocCount = Live;
+    NameMap_Rebuild(Live);
+    if (Postings) Posting_Rehash(PostingMask);
+    IndexGen++;
+}
+
+/**
+ * @brief Adds a doc and its trigrams.
+ * @return OKE if added, ERR_ALREADY_EXISTS if the name is indexed already, ERR on allocation failure
+ *         (the item is then left out and searched by reading it back).
+ */
+static RetType Index_Insert(const char *Name, const sSearchBuilder *Builder) {
+    uint32_t Key = Internal_NameKey(Name);
+    if (NameMap_Find(Name, Key) != SEARCH_NO_DOC) return ERR_ALREADY_EXISTS;
+
+    if (DocCount - DocLive > DocLive && DocCount - DocLive >= SEARCH_COMPACT_MIN) Index_Compact();
+
+    if (DocCount == DocCap) {
+        uint32_t NewCap = DocCap ? DocCap * 2 : 1024;
+        char **Names = realloc(DocName, (size_t)NewCap * sizeof(char *));
+        if (!Names) return ERR;
+        DocName = Names;
+        uint32_t *Keys = realloc(DocKey, (size_t)NewCap * sizeof(uint32_t));
+        if (!Keys) return ERR;
+        DocKey = Keys;
+        DocCap = NewCap;
+    }
+    if (!NameSlots || (DocLive + 1) * 2 > NameMask + 1) {
+        if (!NameMap_Rebuild(DocLive + 1)) return ERR;
+    }
+
+    char *Copy = strdup(Name);
+    if (!Copy) return ERR;
+
+    uint32_t Doc = DocCount++;
+    DocName[Doc] = Copy;
+    DocKey[Doc] = Key;
+    NameMap_Insert(Doc);
+    DocLive++;
+    IndexGen++;
+    IndexDirty = 1;
+
+    for (uint32_t i = 0; Builder->Slots && i <= Builder->Mask; i++) {
+        if (Builder->Slots[i] == 0) continue;
+        sSearchPosting *Posting = Posting_Get(Builder->Slots[i] - 1);
+        if (!Posting || !Posting_Append(Posting, Doc)) {
+            /// A doc missing some trigrams would be wrongly ruled out: drop it whole
+            Index_Drop(Doc);
+            return ERR;
+        }
+    }
+    return OKE;
+}
+
+/**
+ * @brief Writes one piece of the index file and adds it to the running CRC.
+ */
+static int Internal_Write(FILE *File, uLong *Crc, const void *Data, size_t Len) {
+    *Crc = crc32(*Crc, (const Bytef *)Data, (uInt)Len);
+    return fwrite(Data, 1, Len, File) == Len;
+}
+
+/**
+ * @brief Compacts the index and writes it to PATH_FILE_SEARCH (temp file + rename).
+ * @return OKE on success, ERR on I/O errors.
+ */
+static RetType Index_Save(void) {
+    Index_Compact();
+    if (DocLive != DocCount) return ERR;
+
+    uint32_t Used = 0;
+    for (uint32_t i = 0; Postings && i <= PostingMask; i++) {
+        if (Postings[i].Count > 0) Used++;
+    }
+
+    const char *TmpPath = PATH_FILE_SEARCH ".tmp";
+    FILE *File = fopen(TmpPath, "wbe");
+    if (!File) {
+        xWarn("[Search] Failed to create %s: %s", TmpPath, strerror(errno));
+        return ERR;
+    }
+
+    uLong Crc = crc32(0L, Z_NULL, 0);
+    sSearchFileHeader Hdr = { SEARCH_MAGIC, SEARCH_VERSION, DocCount, Used };
+    int Ok = Internal_Write(File, &Crc, &Hdr, sizeof(Hdr));
+
+    for (uint32_t Doc = 0; Ok && Doc < DocCount; Doc++) {
+        uint16_t Len = (uint16_t)strlen(DocName[Doc]);
+        Ok = Internal_Write(File, &Crc, &Len, sizeof(Len)) && Internal_Write(File, &Crc, DocName[Doc], Len);
+    }
+    for (uint32_t i = 0; Ok && Postings && i <= PostingMask; i++) {
+        const sSearchPosting *Posting = &Postings[i];
+        if (Posting->Count == 0) continue;
+        uint32_t Head[2] = { Posting->Key - 1, Posting->Count };
+        Ok = Internal_Write(File, &Crc, Head, sizeof(Head)) &&
+             Internal_Write(File, &Crc, Posting->Docs, (size_t)Posting->Count * sizeof(uint32_t));
+    }
+
+    uint32_t Tail = (uint32_t)Crc;
+    if (Ok) Ok = fwrite(&Tail, 1, sizeof(Tail), File) == sizeof(Tail);
+    if (fclose(File) != 0) Ok = 0;
+    if (!Ok || rename(TmpPath, PATH_FILE_SEARCH) != 0) {
+        xWarn("[Search] Failed to write %s: %s", PATH_FILE_SEARCH, strerror(errno));
+        unlink(TmpPath);
+        return ERR;
+    }
+
+    IndexDirty = 0;
+    xLog1("[Search] Saved %u items, %u trigrams.", DocCount, Used);
+    return OKE;
+}
+
+/**
+ * @brief Parses the content of PATH_FILE_SEARCH into the (empty) index.
+ * @return OKE on success, ERR if it is damaged or memory runs out.
+ */
+static RetType Index_Parse(const uint8_t *Data, size_t Len) {
+    sSearchFileHeader Hdr;
+    uint32_t Crc;
+    if (Len < sizeof(Hdr) + sizeof(Crc)) return ERR;
+
+    Len -= sizeof(Crc);
+    memcpy(&Crc, Data + Len, sizeof(Crc));
+    memcpy(&Hdr, Data, sizeof(Hdr));
+    if (Hdr.Magic != SEARCH_MAGIC || Hdr.Version != SEARCH_VERSION) return ERR;
+    if ((uint32_t)crc32(crc32(0L, Z_NULL, 0), Data, (uInt)Len) != Crc) return ERR;
+
+    size_t Pos = sizeof(Hdr);
+    for (uint32_t i = 0; i < Hdr.DocCount; i++) {
+        uint16_t NameLen;
+        if (Pos + sizeof(NameLen) > Len) return ERR;
+        memcpy(&NameLen, Data + Pos, sizeof(NameLen));
+        Pos += sizeof(NameLen);
+        if (NameLen == 0 || NameLen > NAME_MAX || Pos + NameLen > Len) return ERR;
+
+        char Name[NAME_MAX + 1];
+        memcpy(Name, Data + Pos, NameLen);
+        Name[NameLen] = '\0';
+        Pos += NameLen;
+
+        /// Doc ids are the file order: an empty trigram set inserts the name alone
+        sSearchBuilder Empty;
+        memset(&Empty, 0, sizeof(Empty));
+        if (Index_Insert(Name, &Empty) != OKE || DocCount != i + 1) return ERR;
+    }
+
+    for (uint32_t i = 0; i < Hdr.PostingCount; i++) {
+        uint32_t Head[2];
+        if (Pos + sizeof(Head) > Len) return ERR;
+        memcpy(Head, Data + Pos, sizeof(Head));
+        Pos += sizeof(Head);
+        if (Head[0] > 0xFFFFFFU || Head[1] == 0 || Head[1] > DocCount || Pos + (size_t)Head[1] * sizeof(uint32_t) > Len) return ERR;
+
+        sSearchPosting *Posting = Posting_Get(Head[0]);
+        if (!Posting || Posting->Count != 0) return ERR;
+        Posting->Docs = malloc((size_t)Head[1] * sizeof(uint32_t));
+        if (!Posting->Docs) return ERR;
+        memcpy(Posting->Docs, Data + Pos, (size_t)Head[1] * sizeof(uint32_t));
+        Posting->Count = Posting->Cap = Head[1];
+        Pos += (size_t)Head[1] * sizeof(uint32_t);
+
+        for (uint32_t j = 0; j < Posting->Count; j++) {
+            if (Posting->Docs[j] >= DocCount || (j > 0 && Posting->Docs[j] <= Posting->Docs[j - 1])) return ERR;
+        }
+    }
+    return (Pos == Len) ? OKE : ERR;
+}
+
+/**
+ * @brief Loads PATH_FILE_SEARCH. A missing or damaged file leaves the index empty.
+ */
+static void Index_Load(void) {
+    int Fd = open(PATH_FILE_SEARCH, O_RDONLY | O_CLOEXEC);
+    if (Fd < 0) return;
+
+    struct stat St;
+    uint8_t *Data = NULL;
+    size_t Len = 0;
+    if (fstat(Fd, &St) == 0 && St.st_size > 0) {
+        Len = (size_t)St.st_size;
+        Data = malloc(Len);
+        size_t Done = 0;
+        while (Data && Done < Len) {
+            ssize_t Got = read(Fd, Data + Done, Len - Done);
+            if (Got <= 0) break;
+            Done += (size_t)Got;
+        }
+        if (Done != Len) Len = 0;
+    }
+    close(Fd);
+
+    IndexDirty = 0;
+    if (!Data || Index_Parse(Data, Len) != OKE) {
+        xWarn("[Search] Ignoring damaged index %s, rebuilding it.", PATH_FILE_SEARCH);
+        Index_Reset();
+        IndexDirty = 1;
+    } else {
+        xLog1("[Search] Loaded %u items, %u trigrams.", DocCount, PostingCount);
+    }
+    free(Data);
+}
+
+/**
+ * @brief Drops the docs of items no longer in the history (removed while the daemon was not running).
+ */
+static void Index_Reconcile(const sXCBListSnapshot *Snap) {
+    if (DocLive == 0) return;
+
+    uint8_t *Seen = calloc(DocCount, 1);
+    if (!Seen) return;
+    for (int i = 0; i < Snap->Count; i++) {
+        const char *Name = XCBList_SnapshotRow(Snap, i)->Name;
+        uint32_t Doc = NameMap_Find(Name, Internal_NameKey(Name));
+        if (Doc != SEARCH_NO_DOC) Seen[Doc] = 1;
+    }
+
+    uint32_t Dropped = 0;
+    for (uint32_t Doc = 0; Doc < DocCount; Doc++) {
+        if (DocName[Doc] && !Seen[Doc]) {
+            Index_Drop(Doc);
+            Dropped++;
+        }
+    }
+    free(Seen);
+    if (Dropped) {
+        xLog1("[Search] Dropped %u stale items.", Dropped);
+    }
+}
+
+/**
+ * @brief Maps every row of a snapshot to its doc id (SEARCH_NO_DOC = not a text item, or not indexed).
+ * @return 1 on success, 0 on allocation failure.
+ */
+static int Index_MapRows(const sXCBListSnapshot *Snap) {
+    if (RowDocCount == Snap->Count && RowDocVersion == Snap->Version && RowDocGen == IndexGen) return 1;
+
+    if (Snap->Count > RowDocCap) {
+        uint32_t *New = realloc(RowDoc, (size_t)Snap->Count * sizeof(uint32_t));
+        if (!New) return 0;
+        RowDoc = New;
+        RowDocCap = Snap->Count;
+    }
+    for (int i = 0; i < Snap->Count; i++) {
+        const sXCBListRow *Row = XCBList_SnapshotRow(Snap, i);
+        RowDoc[i] = (Row->FileType == eFMT_TXT) ? NameMap_Find(Row->Name, Internal_NameKey(Row->Name)) : SEARCH_NO_DOC;
+    }
+    RowDocCount = Snap->Count;
+    RowDocVersion = Snap->Version;
+    RowDocGen = IndexGen;
+    return 1;
+}
+
+/**
+ * @brief Marks the rows that must be read back: indexed items holding every trigram, and text
+ *        items not indexed yet.
+ * @param Verify Receives one flag per row.
+ * @return OKE on success, ERR on allocation failure.
+ */
+static RetType Index_Candidates(const sXCBListSnapshot *Snap, const uint32_t *Trigrams, int TrigramCount, uint8_t *Verify) {
+    if (!Index_MapRows(Snap)) return ERR;
+
+    uint8_t *Bits = NULL;
+    if (TrigramCount > 0 && DocCount > 0) {
+        Bits = calloc(((size_t)DocCount + 7) / 8, 1);
+        if (!Bits) return ERR;
+
+        const sSearchPosting *Lists[SEARCH_QUERY_TRIGRAMS];
+        int ListCount = 0;
+        for (int i = 0; i < TrigramCount; i++) {
+            const sSearchPosting *Posting = Posting_Find(Trigrams[i]);
+            if (!Posting || Posting->Count == 0) {
+                ListCount = -1;
+                break;
+            }
+            Lists[ListCount++] = Posting;
+        }
+
+        if (ListCount > 0) {
+            /// Start from the rarest trigram: every other list only narrows it
+            for (int i = 1; i < ListCount; i++) {
+                for (int j = i; j > 0 && Lists[j]->Count < Lists[j - 1]->Count; j--) {
+                    const sSearchPosting *Swap = Lists[j];
+                    Lists[j] = Lists[j - 1];
+                    Lists[j - 1] = Swap;
+                }
+            }
+            uint32_t *Cur = malloc((size_t)Lists[0]->Count * sizeof(uint32_t));
+            if (!Cur) {
+                free(Bits);
+                return ERR;
+            }
+            memcpy(Cur, Lists[0]->Docs, (size_t)Lists[0]->Count * sizeof(uint32_t));
+            uint32_t CurLen = Lists[0]->Count;
+            for (int i = 1; i < ListCount && CurLen > 0; i++) {
+                if (Lists[i] != Lists[i - 1]) CurLen = Internal_Intersect(Cur, CurLen, Lists[i]->Docs, Lists[i]->Count);
+            }
+            for (uint32_t i = 0; i < CurLen; i++) Bits[Cur[i] >> 3] |= (uint8_t)(1U << (Cur[i] & 7));
+            free(Cur);
+        }
+    }
+
+    for (int i = 0; i < Snap->Count; i++) {
+        uint32_t Doc = RowDoc[i];
+        if (XCBList_SnapshotRow(Snap, i)->FileType != eFMT_TXT) Verify[i] = 0;
+        else if (Doc == SEARCH_NO_DOC || !Bits) Verify[i] = 1;
+        else Verify[i] = (Bits[Doc >> 3] >> (Doc & 7)) & 1;
+    }
+    free(Bits);
+    return OKE;
+}
+
+/**************************************************************************************************
+ * INDEXING THREAD ********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Indexes the text items missing from the index (captured before it existed, or while it
+ *        was damaged), then saves it.
+ */
+static void *Search_WorkerRuntime(void *Param) {
+    (void)Param;
+
+    const sXCBListSnapshot *Snap = XCBList_AcquireSnapshot();
+    if (!Snap) return NULL;
+
+    sSearchBuilder Builder;
+    memset(&Builder, 0, sizeof(Builder));
+    uint8_t *Buffer = NULL;
+    int Indexed = 0;
+
+    for (int i = 0; i < Snap->Count && !Internal_StopRequested(); i++) {
+        const sXCBListRow *Row = XCBList_SnapshotRow(Snap, i);
+        if (Row->FileType != eFMT_TXT) continue;
+
+        pthread_mutex_lock(&SearchMutex);
+        int Known = NameMap_Find(Row->Name, Internal_NameKey(Row->Name)) != SEARCH_NO_DOC;
+        pthread_mutex_unlock(&SearchMutex);
+        if (Known) continue;
+
+        if (!Buffer && !(Buffer = malloc(SEARCH_TEXT_MAX))) break;
+        sClipboardItem Item;
+        if (XCBList_SnapshotGetItem(Snap, i, &Item) != OKE) continue;
+        int64_t Len = Codec_ItemReadHead(&Item, Buffer, SEARCH_TEXT_MAX);
+        if (Len < 0) continue;
+
+        Search_Begin(&Builder);
+        Search_Feed(&Builder, Buffer, (size_t)Len);
+        Search_Add(Row->Name, &Builder);
+        Indexed++;
+    }
+
+    XCBList_ReleaseSnapshot(Snap);
+    Search_FreeBuilder(&Builder);
+    free(Buffer);
+
+    if (Indexed) {
+        xLog1("[Search] Indexed %d text items.", Indexed);
+        pthread_mutex_lock(&SearchMutex);
+        Index_Save();
+        pthread_mutex_unlock(&SearchMutex);
+    }
+    return NULL;
+}
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+void Search_Add(const char *Filename, const sSearchBuilder *Builder) {
+    if (!SEARCH_ENABLED || Builder->Failed || !Builder->Slots) return;
+
+    pthread_mutex_lock(&SearchMutex);
+    RetType Ret = Index_Insert(Filename, Builder);
+    pthread_mutex_unlock(&SearchMutex);
+
+    if (Ret == ERR) xWarn("[Search] Failed to index %s, it will be read back by every search.", Filename);
+}
+
+void Search_Remove(const char *Filename) {
+    if (!SEARCH_ENABLED) return;
+
+    pthread_mutex_lock(&SearchMutex);
+    uint32_t Doc = NameMap_Find(Filename, Internal_NameKey(Filename));
+    if (Doc != SEARCH_NO_DOC) Index_Drop(Doc);
+    pthread_mutex_unlock(&SearchMutex);
+}
+
+RetType Search_RemoveAll(void) {
+    pthread_mutex_lock(&SearchMutex);
+    Index_Reset();
+    IndexDirty = 0;
+    pthread_mutex_unlock(&SearchMutex);
+
+    if (unlink(PATH_FILE_SEARCH) != 0 && errno != ENOENT) return ERR;
+    return OKE;
+}
+
+RetType Search_Start(void) {
+    xEntry1("Search_Start");
+    if (!SEARCH_ENABLED) return OKE;
+
+    /// Taken first: the ListMutex is never acquired with the SearchMutex held
+    const sXCBListSnapshot *Snap = XCBList_AcquireSnapshot();
+
+    pthread_mutex_lock(&SearchMutex);
+    Index_Load();
+    if (Snap) Index_Reconcile(Snap);
+    SearchStopReq = 0;
+    pthread_mutex_unlock(&SearchMutex);
+    XCBList_ReleaseSnapshot(Snap);
+
+    if (pthread_create(&SearchThread, NULL, Search_WorkerRuntime, NULL) != 0) {
+        xError("[Search] Failed to spawn the indexing thread!");
+        return ERR;
+    }
+    SearchRunning = 1;
+
+    xExit1("Search_Start");
+    return OKE;
+}
+
+void Search_Stop(void) {
+    if (!SEARCH_ENABLED) return;
+
+    if (SearchRunning) {
+        pthread_mutex_lock(&SearchMutex);
+        SearchStopReq = 1;
+        pthread_mutex_unlock(&SearchMutex);
+        pthread_join(SearchThread, NULL);
+        SearchRunning = 0;
+    }
+
+    pthread_mutex_lock(&SearchMutex);
+    if (IndexDirty) Index_Save();
+    pthread_mutex_unlock(&SearchMutex);
+}
+
+int Search_Query(const sXCBListSnapshot *Snapshot, const char *Query, int Flags, int *Rows, int MaxRows) {
+    if (!Snapshot || !Query || !Rows) return ERR_INVALID_ARG;
+    if (MaxRows <= 0 || Snapshot->Count == 0) return 0;
+
+    regex_t Regex;
+    uint32_t Trigrams[SEARCH_QUERY_TRIGRAMS];
+    int TrigramCount;
+    size_t QueryLen = strlen(Query);
+    char *Needle = NULL;
+
+    if (Flags & SEARCH_REGEX) {
+        int CFlags = REG_EXTENDED | REG_NOSUB | REG_NEWLINE | ((Flags & SEARCH_CASE) ? 0 : REG_ICASE);
+        if (regcomp(&Regex, Query, CFlags) != 0) return ERR_INVALID_ARG;
+        TrigramCount = Internal_RegexTrigrams(Query, Trigrams);
+    } else {
+        if (!(Needle = malloc(QueryLen + 1))) return ERR;
+        for (size_t i = 0; i <= QueryLen; i++) {
+            Needle[i] = (Flags & SEARCH_CASE) ? Query[i] : (char)Internal_Fold((uint8_t)Query[i]);
+        }
+        TrigramCount = Internal_AddTrigrams((const uint8_t *)Query, QueryLen, Trigrams, 0);
+    }
+
+    uint8_t *Verify = malloc((size_t)Snapshot->Count);
+    RetType Ret = Verify ? OKE : ERR;
+    if (Ret == OKE) {
+        pthread_mutex_lock(&SearchMutex);
+        Ret = Index_Candidates(Snapshot, Trigrams, TrigramCount, Verify);
+        pthread_mutex_unlock(&SearchMutex);
+    }
+
+    /// Trigrams only rule items out: every candidate is read back and checked
+    int Found = 0;
+    uint8_t *Buffer = NULL;
+    size_t BufferCap = 0;
+    for (int i = 0; Ret == OKE && i < Snapshot->Count && Found < MaxRows; i++) {
+        if (!Verify[i]) continue;
+
+        const sXCBListRow *Row = XCBList_SnapshotRow(Snapshot, i);
+        size_t Want = (Row->ContentSize > 0 && Row->ContentSize < SEARCH_TEXT_MAX) ? (size_t)Row->ContentSize : SEARCH_TEXT_MAX;
+        if (Want + 1 > BufferCap) {
+            uint8_t *New = realloc(Buffer, Want + 1);
+            if (!New) {
+                Ret = ERR;
+                break;
+            }
+            Buffer = New;
+            BufferCap = Want + 1;
+        }
+
+        sClipboardItem Item;
+        if (XCBList_SnapshotGetItem(Snapshot, i, &Item) != OKE) continue;
+        int64_t Len = Codec_ItemReadHead(&Item, Buffer, Want);
+        if (Len < 0) continue;
+
+        int Match;
+        if (Flags & SEARCH_REGEX) {
+            Buffer[Len] = '\0';
+            Match = (regexec(&Regex, (const char *)Buffer, 0, NULL, 0) == 0);
+        } else {
+            if (!(Flags & SEARCH_CASE)) {
+                for (int64_t j = 0; j < Len; j++) Buffer[j] = Internal_Fold(Buffer[j]);
+            }
+            Match = (memmem(Buffer, (size_t)Len, Needle, QueryLen) != NULL);
+        }
+        if (Match) Rows[Found++] = i;
+    }
+
+    if (Flags & SEARCH_REGEX) regfree(&Regex);
+    free(Needle);
+    free(Buffer);
+    free(Verify);
+    return (Ret == OKE) ? Found : ERR;
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
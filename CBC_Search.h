@@ -0,0 +1,136 @@
+#ifndef __CBC_SEARCH_H__
+#define __CBC_SEARCH_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include "CBC_Picker.h"
+
+/**************************************************************************************************
+ * SEARCH CONFIGURATION SECTION *******************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief The index is only built for its one reader, the built-in picker: with Rofi nothing is
+ *        collected at capture, backfilled at startup or saved at shutdown.
+ */
+#define SEARCH_ENABLED                  ((SEARCH_INDEX == 1) && PICKER_ENABLED)
+
+/**
+ * @brief Shortest query the index can narrow down (one trigram). Shorter ones scan every text item.
+ */
+#define SEARCH_MIN_QUERY                3
+
+/**
+ * @brief Most trigrams taken from one query: more would only narrow candidates already few.
+ */
+#define SEARCH_QUERY_TRIGRAMS           64
+
+/**
+ * @brief Magic bytes at the start of PATH_FILE_SEARCH ("XCSI").
+ */
+#define SEARCH_MAGIC                    0x49534358U
+
+/**
+ * @brief Current index file format version.
+ */
+#define SEARCH_VERSION                  1U
+
+/**
+ * @brief Search_Query() flags.
+ */
+#define SEARCH_REGEX                    0x01    /// Query is a POSIX extended regex ('^'/'$' match at line ends)
+#define SEARCH_CASE                     0x02    /// Match case (ASCII letters are folded otherwise)
+
+/**************************************************************************************************
+ * SEARCH TYPES ***********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Trigram set of a text payload, fed slice by slice while it is captured.
+ */
+typedef struct {
+    uint32_t   *Slots;      /// Open-addressing set of trigram + 1 (0 = empty slot)
+    uint32_t    Mask;       /// Slot count - 1
+    uint32_t    Count;      /// Distinct trigrams
+    uint64_t    Total;      /// Payload bytes fed so far
+    uint8_t     Tail[2];    /// Last two (folded) bytes fed
+    int         Failed;     /// Allocation failure: the payload is left out of the index
+} sSearchBuilder;
+
+/**************************************************************************************************
+ * SEARCH PROTOTYPES ******************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Resets a builder for a new payload (its memory is kept for the next one).
+ */
+void Search_Begin(sSearchBuilder *Builder);
+
+/**
+ * @brief Feeds the next payload bytes. Bytes past SEARCH_TEXT_MAX are ignored.
+ */
+void Search_Feed(sSearchBuilder *Builder, const uint8_t *Data, size_t Len);
+
+/**
+ * @brief Releases the memory of a builder.
+ */
+void Search_FreeBuilder(sSearchBuilder *Builder);
+
+/**
+ * @brief Adds a text item to the index under its filename.
+ * @param Filename The item filename, already pushed to XCBList.
+ * @param Builder The trigrams of its payload (left untouched).
+ * @note Items are only reached through snapshot rows: if the item left the history before this
+ *       call, its entry is inert and dropped at the next start.
+ */
+void Search_Add(const char *Filename, const sSearchBuilder *Builder);
+
+/**
+ * @brief Drops an item from the index (no error if it is not there).
+ * @note Never takes the ListMutex: safe to call with it held.
+ */
+void Search_Remove(const char *Filename);
+
+/**
+ * @brief Empties the index and deletes PATH_FILE_SEARCH.
+ * @return OKE on success, ERR if the file cannot be deleted.
+ */
+RetType Search_RemoveAll(void);
+
+/**
+ * @brief Loads PATH_FILE_SEARCH, drops the items no longer in the history and spawns a thread
+ *        indexing the text items missing from it.
+ * @return OKE on success (or when SEARCH_INDEX is off), ERR if the thread cannot be created.
+ * @note Call after the history is loaded and before the capture sink starts.
+ */
+RetType Search_Start(void);
+
+/**
+ * @brief Stops the indexing thread and saves the index to PATH_FILE_SEARCH.
+ * @note Call after the capture sink is stopped.
+ */
+void Search_Stop(void);
+
+/**
+ * @brief Finds the text items of a snapshot whose payload matches a query.
+ * @param Snapshot The history to search.
+ * @param Query A substring, or a POSIX extended regex with SEARCH_REGEX.
+ * @param Flags SEARCH_REGEX, SEARCH_CASE or 0.
+ * @param Rows Receives the matching rows, newest first.
+ * @param MaxRows Capacity of Rows: the search stops once it is full.
+ * @return The number of rows found, ERR_INVALID_ARG for an invalid regex, ERR on allocation failure.
+ * @note Only the candidates sharing every trigram of the query (or of the literals a regex
+ *       requires) are read back and checked, plus the items not indexed yet. Reads the store
+ *       directly and never takes the ListMutex.
+ */
+int Search_Query(const sXCBListSnapshot *Snapshot, const char *Query, int Flags, int *Rows, int MaxRows);
+
+#endif /*__CBC_SEARCH_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,709 @@
+#include "CBC_Segment.h"
+#include "CBC_Codec.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+/**************************************************************************************************
+ * INTERNAL TYPES SECTION *************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Record flag: the stored bytes are a zlib stream of the payload.
+ */
+#define SEGMENT_FLAG_DEFLATE    0x01U
+
+/**
+ * @brief Fixed part of a segment record. The filename (NameLen bytes) and the stored payload
+ *        (StoredLen bytes) follow it.
+ */
+typedef struct {
+    uint32_t    Magic;          /// SEGMENT_RECORD_MAGIC, or SEGMENT_RECORD_DEAD_MAGIC once released
+    uint32_t    Crc;            /// CRC32 of the rest of the record (fields below + filename + stored bytes)
+    uint16_t    NameLen;
+    uint8_t     Flags;          /// SEGMENT_FLAG_*
+    uint8_t     FileType;       /// XCBFileType
+    uint32_t    StoredLen;      /// Bytes on disk after the filename
+    uint64_t    PayloadLen;     /// Decoded payload size
+    int64_t     Timestamp;      /// Capture time
+} sSegmentRecord;
+
+_Static_assert(sizeof(sSegmentRecord) == 32, "sSegmentRecord must stay 32 bytes (on-disk format)");
+
+/**
+ * @brief Read-only view of a whole segment file.
+ */
+typedef struct {
+    const uint8_t  *Base;
+    size_t          Size;
+} sSegmentView;
+
+/**************************************************************************************************
+ * INTERNAL DATA SECTION **************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Protects the active segment (id, descriptor and size).
+ */
+static pthread_mutex_t  SegmentMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Signalled to wake the compactor (batch of releases reached, or stop request).
+ */
+static pthread_cond_t   SegmentCond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief Segment receiving appends, its descriptor (-1 until the first append) and its size.
+ */
+static uint32_t         ActiveId = 0;
+static int              ActiveFd = -1;
+static uint64_t         ActiveSize = 0;
+
+/**
+ * @brief Records released since the last compaction pass.
+ */
+static atomic_uint      ReleasedCount;
+
+/**
+ * @brief A compacted segment whose file is kept until no snapshot older than Version is alive.
+ */
+typedef struct {
+    uint32_t    Id;
+    uint64_t    Version;
+} sRetiredSegment;
+
+/**
+ * @brief Compacted segments waiting for deletion. Only touched by the compactor thread.
+ */
+static sRetiredSegment *Retired = NULL;
+static int              RetiredCount = 0;
+
+static pthread_t        CompactorThread;
+static int              SegmentStopReq = 0;
+static int              SegmentRunning = 0;
+
+/**************************************************************************************************
+ * INTERNAL HELPERS: RECORDS **********************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Builds the path of a segment file.
+ */
+static void Internal_SegmentPath(uint32_t Id, char *Path, size_t PathLen) {
+    snprintf(Path, PathLen, "%s/%08u.seg", PATH_DIR_SEGMENTS, Id);
+}
+
+/**
+ * @brief CRC32 of a record, skipping the Magic and Crc fields.
+ */
+static uint32_t Internal_RecordCrc(const sSegmentRecord *Rec, const void *Name, const void *Stored) {
+    size_t Skip = sizeof(Rec->Magic) + sizeof(Rec->Crc);
+    uLong Crc = crc32(0L, Z_NULL, 0);
+    Crc = crc32(Crc, (const Bytef *)Rec + Skip, (uInt)(sizeof(*Rec) - Skip));
+    Crc = crc32(Crc, (const Bytef *)Name, Rec->NameLen);
+    return (uint32_t)crc32(Crc, (const Bytef *)Stored, Rec->StoredLen);
+}
+
+/**
+ * @brief Tells whether a record magic is one of ours (live or released).
+ */
+static int Internal_IsRecordMagic(uint32_t Magic) {
+    return Magic == SEGMENT_RECORD_MAGIC || Magic == SEGMENT_RECORD_DEAD_MAGIC;
+}
+
+/**
+ * @brief Validates the record starting at Pos inside a mapped segment.
+ * @param Rec Receives the record header.
+ * @return Total record length, or 0 if the record is cut short or damaged.
+ * @note Released records parse too (the Magic is outside the CRC); check Rec->Magic for liveness.
+ */
+static size_t Internal_ParseRecord(const sSegmentView *View, size_t Pos, sSegmentRecord *Rec) {
+    if (Pos + sizeof(*Rec) > View->Size) return 0;
+    memcpy(Rec, View->Base + Pos, sizeof(*Rec));
+
+    if (!Internal_IsRecordMagic(Rec->Magic) || Rec->NameLen == 0 || Rec->NameLen > NAME_MAX) return 0;
+    size_t Total = sizeof(*Rec) + Rec->NameLen + Rec->StoredLen;
+    if (Total > View->Size - Pos) return 0;
+
+    const uint8_t *Name = View->Base + Pos + sizeof(*Rec);
+    if (Internal_RecordCrc(Rec, Name, Name + Rec->NameLen) != Rec->Crc) return 0;
+    return Total;
+}
+
+/**
+ * @brief Maps a whole segment file read-only.
+ * @return OKE on success, ERR if it is missing, empty or cannot be mapped.
+ */
+static RetType Internal_MapSegment(uint32_t Id, sSegmentView *View) {
+    char Path[PATH_MAX];
+    Internal_SegmentPath(Id, Path, sizeof(Path));
+
+    int Fd = open(Path, O_RDONLY | O_CLOEXEC);
+    if (Fd < 0) return ERR;
+
+    struct stat St;
+    void *Base = MAP_FAILED;
+    if (fstat(Fd, &St) == 0 && St.st_size > 0) {
+        Base = mmap(NULL, (size_t)St.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+    }
+    close(Fd);
+    if (Base == MAP_FAILED) return ERR;
+
+    madvise(Base, (size_t)St.st_size, MADV_SEQUENTIAL);
+    View->Base = Base;
+    View->Size = (size_t)St.st_size;
+    return OKE;
+}
+
+static void Internal_UnmapSegment(sSegmentView *View) {
+    if (View->Base) munmap((void *)View->Base, View->Size);
+    View->Base = NULL;
+    View->Size = 0;
+}
+
+/**
+ * @brief Sort comparator for segment ids and offsets (ascending).
+ */
+static int CompareU32Asc(const void *a, const void *b) {
+    uint32_t A = *(const uint32_t *)a, B = *(const uint32_t *)b;
+    return (A > B) - (A < B);
+}
+
+static int CompareU64Asc(const void *a, const void *b) {
+    uint64_t A = *(const uint64_t *)a, B = *(const uint64_t *)b;
+    return (A > B) - (A < B);
+}
+
+/**
+ * @brief Lists the segment ids present in PATH_DIR_SEGMENTS, ascending.
+ * @param Ids Receives a malloc'ed array (free() it).
+ * @return Number of ids (0 if none or on error).
+ */
+static int Internal_ListSegments(uint32_t **Ids) {
+    *Ids = NULL;
+    DIR *Dir = opendir(PATH_DIR_SEGMENTS);
+    if (!Dir) return 0;
+
+    int Count = 0, Cap = 0;
+    struct dirent *Entry;
+    while ((Entry = readdir(Dir)) != NULL) {
+        unsigned Id;
+        char Tail;
+        if (sscanf(Entry->d_name, "%8u.se%c", &Id, &Tail) != 2 || Tail != 'g' || Id == 0) continue;
+
+        if (Count == Cap) {
+            Cap = Cap ? Cap * 2 : 16;
+            uint32_t *Grown = realloc(*Ids, (size_t)Cap * sizeof(uint32_t));
+            if (!Grown) break;
+            *Ids = Grown;
+        }
+        (*Ids)[Count++] = (uint32_t)Id;
+    }
+    closedir(Dir);
+
+    if (Count > 1) qsort(*Ids, (size_t)Count, sizeof(uint32_t), CompareU32Asc);
+    return Count;
+}
+
+/**************************************************************************************************
+ * INTERNAL HELPERS: ACTIVE SEGMENT ***************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Opens the active segment for appending if it is not open yet.
+ * @note This function assumes the caller has already locked the SegmentMutex.
+ */
+static RetType Internal_OpenActive(void) {
+    if (ActiveFd >= 0) return OKE;
+
+    char Path[PATH_MAX];
+    Internal_SegmentPath(ActiveId, Path, sizeof(Path));
+    ActiveFd = open(Path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (ActiveFd < 0) {
+        xError("[Segment] Failed to open %s: %s", Path, strerror(errno));
+        return ERR;
+    }
+
+    struct stat St;
+    ActiveSize = (fstat(ActiveFd, &St) == 0) ? (uint64_t)St.st_size : 0;
+    return OKE;
+}
+
+/**
+ * @brief Seals the active segment once the next record would push it past SEGMENT_FILE_MAX.
+ * @note This function assumes the caller has already locked the SegmentMutex.
+ */
+static void Internal_RollIfFull(size_t RecordLen) {
+    if (ActiveSize == 0 || ActiveSize + RecordLen <= SEGMENT_FILE_MAX) return;
+
+    if (ActiveFd >= 0) close(ActiveFd);
+    ActiveFd = -1;
+    ActiveSize = 0;
+    ActiveId++;
+    xLog1("[Segment] Sealed segment %u.", ActiveId - 1);
+}
+
+/**
+ * @brief Appends one encoded record (header + name + stored bytes) with a single writev().
+ * @param Segment Receives the segment id.
+ * @param Offset Receives the record offset.
+ * @return OKE on success, ERR on I/O errors (a partial record is cut off again).
+ */
+static RetType Internal_AppendRecord(const struct iovec *Iov, int IovCount, size_t Total,
+                                     uint32_t *Segment, uint64_t *Offset) {
+    pthread_mutex_lock(&SegmentMutex);
+
+    Internal_RollIfFull(Total);
+    if (Internal_OpenActive() != OKE) {
+        pthread_mutex_unlock(&SegmentMutex);
+        return ERR;
+    }
+
+    ssize_t Written;
+    do {
+        Written = writev(ActiveFd, Iov, IovCount);
+    } while (Written < 0 && errno == EINTR);
+
+    if (Written != (ssize_t)Total) {
+        xError("[Segment] Append to segment %u failed: %s", ActiveId, (Written < 0) ? strerror(errno) : "short write");
+        if (Written > 0 && ftruncate(ActiveFd, (off_t)ActiveSize) != 0) {
+            /// Cannot cut the torn record: seal the segment, readers stop at the damaged tail
+            Internal_RollIfFull(SEGMENT_FILE_MAX);
+        }
+        pthread_mutex_unlock(&SegmentMutex);
+        return ERR;
+    }
+
+    *Segment = ActiveId;
+    *Offset = ActiveSize;
+    ActiveSize += Total;
+
+    pthread_mutex_unlock(&SegmentMutex);
+    return OKE;
+}
+
+/**
+ * @brief Resumes appending to the newest segment, cutting off a torn tail left by a crash.
+ */
+static void Internal_RecoverActive(void) {
+    uint32_t *Ids;
+    int Count = Internal_ListSegments(&Ids);
+    ActiveId = (Count > 0) ? Ids[Count - 1] : 1;
+    free(Ids);
+    if (Count == 0) return;
+
+    sSegmentView View = {0};
+    if (Internal_MapSegment(ActiveId, &View) != OKE) return;
+
+    size_t Pos = 0, Len;
+    sSegmentRecord Rec;
+    while ((Len = Internal_ParseRecord(&View, Pos, &Rec)) > 0) Pos += Len;
+    size_t Size = View.Size;
+    Internal_UnmapSegment(&View);
+
+    if (Pos < Size) {
+        char Path[PATH_MAX];
+        Internal_SegmentPath(ActiveId, Path, sizeof(Path));
+        xWarn("[Segment] Dropping %zu trailing bytes of %s.", Size - Pos, Path);
+        if (truncate(Path, (off_t)Pos) != 0) ActiveId++;
+    }
+}
+
+/**************************************************************************************************
+ * INTERNAL HELPERS: COMPACTION *******************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Tells whether Offset is in the sorted Live array.
+ */
+static int Internal_IsLive(const uint64_t *Live, int LiveCount, uint64_t Offset) {
+    return LiveCount > 0 && bsearch(&Offset, Live, (size_t)LiveCount, sizeof(uint64_t), CompareU64Asc) != NULL;
+}
+
+/**
+ * @brief Tells whether a segment was already compacted and only waits for deletion.
+ */
+static int Internal_IsRetired(uint32_t Id) {
+    for (int i = 0; i < RetiredCount; i++) {
+        if (Retired[i].Id == Id) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Deletes the compacted segments that no live snapshot can point into anymore.
+ */
+static void Internal_ReapRetired(void) {
+    if (RetiredCount == 0) return;
+
+    uint64_t Oldest = XCBList_GetOldestSnapshotVersion();
+    int Kept = 0;
+    for (int i = 0; i < RetiredCount; i++) {
+        if (Retired[i].Version > Oldest) {
+            Retired[Kept++] = Retired[i];
+            continue;
+        }
+        char Path[PATH_MAX];
+        Internal_SegmentPath(Retired[i].Id, Path, sizeof(Path));
+        unlink(Path);
+        xLog1("[Segment] Deleted compacted segment %u.", Retired[i].Id);
+    }
+    RetiredCount = Kept;
+}
+
+/**
+ * @brief Rewrites the live records of a sealed segment into the active one and retires it,
+ *        if less than SEGMENT_COMPACT_LIVE_PCT of its bytes are still referenced.
+ */
+static void Internal_CompactSegment(uint32_t Id) {
+    sSegmentView View = {0};
+    if (Internal_MapSegment(Id, &View) != OKE) return;
+
+    uint64_t *Live = NULL;
+    int LiveCount = XCBList_GetSegmentOffsets(Id, &Live);
+    if (LiveCount < 0) {
+        Internal_UnmapSegment(&View);
+        return;
+    }
+
+    size_t Pos = 0, Len, LiveBytes = 0;
+    sSegmentRecord Rec;
+    while ((Len = Internal_ParseRecord(&View, Pos, &Rec)) > 0) {
+        if (Internal_IsLive(Live, LiveCount, Pos)) LiveBytes += Len;
+        Pos += Len;
+    }
+
+    if (LiveBytes * 100 >= (size_t)SEGMENT_COMPACT_LIVE_PCT * View.Size) {
+        free(Live);
+        Internal_UnmapSegment(&View);
+        return;
+    }
+
+    int Moved = 0, Failed = 0;
+    for (Pos = 0; !Failed && (Len = Internal_ParseRecord(&View, Pos, &Rec)) > 0; Pos += Len) {
+        if (!Internal_IsLive(Live, LiveCount, Pos)) continue;
+
+        /// Records are self-contained: copy the bytes as they are
+        struct iovec Iov = { (void *)(View.Base + Pos), Len };
+        uint32_t NewSeg;
+        uint64_t NewOff;
+        if (Internal_AppendRecord(&Iov, 1, Len, &NewSeg, &NewOff) != OKE) {
+            Failed = 1;
+            break;
+        }
+
+        char Name[NAME_MAX + 1];
+        memcpy(Name, View.Base + Pos + sizeof(Rec), Rec.NameLen);
+        Name[Rec.NameLen] = '\0';
+
+        /// The item may have been evicted meanwhile: then the copy is dead on arrival.
+        /// Either way one of the two copies is released, so a recovery scan finds the item once.
+        if (XCBList_Relocate(Name, Id, Pos, NewSeg, NewOff) == OKE) {
+            Segment_Release(Id, Pos);
+            Moved++;
+        } else {
+            Segment_Release(NewSeg, NewOff);
+        }
+    }
+    free(Live);
+    Internal_UnmapSegment(&View);
+
+    /// The MOVE records must be durable before the old copies disappear
+    if (Failed || XCBList_Sync() != OKE) {
+        xWarn("[Segment] Compaction of segment %u interrupted. Keeping it.", Id);
+        return;
+    }
+
+    /// Snapshots published before the moves may still hold the old locations:
+    /// the file goes away once every one of them is released
+    sRetiredSegment *Grown = realloc(Retired, (size_t)(RetiredCount + 1) * sizeof(*Retired));
+    if (!Grown) {
+        xWarn("[Segment] Out of memory retiring segment %u. Keeping it.", Id);
+        return;
+    }
+    Retired = Grown;
+    Retired[RetiredCount].Id = Id;
+    Retired[RetiredCount].Version = XCBList_GetVersion();
+    RetiredCount++;
+    xLog1("[Segment] Compacted segment %u (%d live records moved).", Id, Moved);
+}
+
+/**
+ * @brief Compacts every sealed segment that has become sparse enough.
+ */
+static void Internal_CompactPass(void) {
+    uint32_t *Ids;
+    int Count = Internal_ListSegments(&Ids);
+
+    for (int i = 0; i < Count; i++) {
+        pthread_mutex_lock(&SegmentMutex);
+        int Sealed = (Ids[i] < ActiveId);
+        int Stop = SegmentStopReq;
+        pthread_mutex_unlock(&SegmentMutex);
+
+        if (Stop) break;
+        if (Sealed && !Internal_IsRetired(Ids[i])) Internal_CompactSegment(Ids[i]);
+    }
+    free(Ids);
+    Internal_ReapRetired();
+}
+
+/**
+ * @brief Compactor thread: runs a pass at startup, then after every batch of releases
+ *        (or every SEGMENT_COMPACT_CHECK_MS if anything was released) until asked to stop.
+ *        While compacted segments wait for deletion it also wakes every SEGMENT_RETIRE_CHECK_MS.
+ */
+static void *Segment_CompactorRuntime(void *Param) {
+    (void)Param;
+
+    /// Records released before a restart are only discovered by looking
+    Internal_CompactPass();
+
+    pthread_mutex_lock(&SegmentMutex);
+    while (!SegmentStopReq) {
+        struct timespec Deadline;
+        clock_gettime(CLOCK_REALTIME, &Deadline);
+        Deadline.tv_sec += (RetiredCount ? SEGMENT_RETIRE_CHECK_MS : SEGMENT_COMPACT_CHECK_MS) / 1000;
+        pthread_cond_timedwait(&SegmentCond, &SegmentMutex, &Deadline);
+        if (SegmentStopReq) break;
+        int Released = (atomic_exchange(&ReleasedCount, 0) != 0);
+
+        pthread_mutex_unlock(&SegmentMutex);
+        if (Released) Internal_CompactPass();
+        else Internal_ReapRetired();
+        pthread_mutex_lock(&SegmentMutex);
+    }
+    pthread_mutex_unlock(&SegmentMutex);
+
+    /// Whatever is still referenced is found empty and deleted by the next startup pass
+    Internal_ReapRetired();
+    free(Retired);
+    Retired = NULL;
+    RetiredCount = 0;
+    return NULL;
+}
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+int Segment_Accepts(enum XCBFileType Type, size_t Len) {
+    return (STORE_SEGMENTS == 1) && SegmentRunning && Type == eFMT_TXT && Len <= SEGMENT_ITEM_MAX;
+}
+
+RetType Segment_Start(void) {
+    xEntry1("Segment_Start");
+    if (STORE_SEGMENTS != 1) return OKE;
+
+    pthread_mutex_lock(&SegmentMutex);
+    Internal_RecoverActive();
+    SegmentStopReq = 0;
+    pthread_mutex_unlock(&SegmentMutex);
+    atomic_store(&ReleasedCount, 0);
+
+    if (pthread_create(&CompactorThread, NULL, Segment_CompactorRuntime, NULL) != 0) {
+        xError("[Segment] Failed to spawn compactor thread!");
+        return ERR;
+    }
+    SegmentRunning = 1;
+
+    xExit1("Segment_Start");
+    return OKE;
+}
+
+void Segment_Stop(void) {
+    if (!SegmentRunning) return;
+
+    pthread_mutex_lock(&SegmentMutex);
+    SegmentStopReq = 1;
+    pthread_cond_signal(&SegmentCond);
+    pthread_mutex_unlock(&SegmentMutex);
+
+    pthread_join(CompactorThread, NULL);
+    SegmentRunning = 0;
+
+    pthread_mutex_lock(&SegmentMutex);
+    if (ActiveFd >= 0) close(ActiveFd);
+    ActiveFd = -1;
+    pthread_mutex_unlock(&SegmentMutex);
+}
+
+RetType Segment_Append(const char *Name, enum XCBFileType Type, const uint8_t *Data, size_t Len,
+                       time_t Timestamp, uint32_t *Segment, uint64_t *Offset) {
+    if (!Name || !Segment || !Offset || (Len > 0 && !Data)) return ERR_NULL;
+    if (!SegmentRunning || Len > SEGMENT_ITEM_MAX) return ERR_UNSUPPORTED;
+
+    sSegmentRecord Rec;
+    memset(&Rec, 0, sizeof(Rec));
+    Rec.Magic = SEGMENT_RECORD_MAGIC;
+    Rec.NameLen = (uint16_t)strnlen(Name, NAME_MAX);
+    Rec.FileType = (uint8_t)Type;
+    Rec.PayloadLen = Len;
+    Rec.StoredLen = (uint32_t)Len;
+    Rec.Timestamp = (int64_t)Timestamp;
+    if (Rec.NameLen == 0) return ERR;
+
+    /// Deflate in one shot: the whole payload is already in memory
+    const uint8_t *Stored = Data;
+    uint8_t *Deflated = NULL;
+    if (Len > 0 && Codec_ShouldCompress(Type, Len, Data, Len)) {
+        uLongf DeflatedLen = compressBound((uLong)Len);
+        Deflated = malloc(DeflatedLen);
+        if (Deflated && compress2(Deflated, &DeflatedLen, Data, (uLong)Len, STORE_COMPRESS_LEVEL) == Z_OK && DeflatedLen < Len) {
+            Stored = Deflated;
+            Rec.StoredLen = (uint32_t)DeflatedLen;
+            Rec.Flags |= SEGMENT_FLAG_DEFLATE;
+        }
+    }
+    Rec.Crc = Internal_RecordCrc(&Rec, Name, Stored);
+
+    struct iovec Iov[3] = {
+        { &Rec, sizeof(Rec) },
+        { (void *)Name, Rec.NameLen },
+        { (void *)Stored, Rec.StoredLen },
+    };
+    RetType Ret = Internal_AppendRecord(Iov, 3, sizeof(Rec) + Rec.NameLen + Rec.StoredLen, Segment, Offset);
+    free(Deflated);
+    return Ret;
+}
+
+int64_t Segment_GetPayloadSize(uint32_t Segment, uint64_t Offset) {
+    char Path[PATH_MAX];
+    Internal_SegmentPath(Segment, Path, sizeof(Path));
+
+    int Fd = open(Path, O_RDONLY | O_CLOEXEC);
+    if (Fd < 0) return -1;
+
+    sSegmentRecord Rec;
+    int64_t Size = -1;
+    if (pread(Fd, &Rec, sizeof(Rec), (off_t)Offset) == (ssize_t)sizeof(Rec) && Internal_IsRecordMagic(Rec.Magic)) {
+        Size = (int64_t)Rec.PayloadLen;
+    }
+    close(Fd);
+    return Size;
+}
+
+int64_t Segment_Read(uint32_t Segment, uint64_t Offset, void *Output, size_t MaxLen, int AllowPartial) {
+    char Path[PATH_MAX];
+    Internal_SegmentPath(Segment, Path, sizeof(Path));
+
+    int Fd = open(Path, O_RDONLY | O_CLOEXEC);
+    if (Fd < 0) return ERR;
+
+    sSegmentRecord Rec;
+    if (pread(Fd, &Rec, sizeof(Rec), (off_t)Offset) != (ssize_t)sizeof(Rec) ||
+        !Internal_IsRecordMagic(Rec.Magic) || Rec.NameLen > NAME_MAX) {
+        close(Fd);
+        return ERR;
+    }
+    if (Rec.PayloadLen > MaxLen && !AllowPartial) {
+        close(Fd);
+        return ERR_OVERFLOW;
+    }
+
+    off_t DataPos = (off_t)(Offset + sizeof(Rec) + Rec.NameLen);
+    size_t Want = (Rec.PayloadLen < MaxLen) ? (size_t)Rec.PayloadLen : MaxLen;
+    int64_t Result = ERR;
+
+    if (!(Rec.Flags & SEGMENT_FLAG_DEFLATE)) {
+        /// Stored as-is: read straight into the caller's buffer
+        if (Want == 0 || pread(Fd, Output, Want, DataPos) == (ssize_t)Want) Result = (int64_t)Want;
+    } else {
+        uint8_t *Stored = malloc(Rec.StoredLen);
+        if (Stored && pread(Fd, Stored, Rec.StoredLen, DataPos) == (ssize_t)Rec.StoredLen) {
+            z_stream Zs;
+            memset(&Zs, 0, sizeof(Zs));
+            if (inflateInit(&Zs) == Z_OK) {
+                Zs.next_in = Stored;
+                Zs.avail_in = Rec.StoredLen;
+                Zs.next_out = Output;
+                Zs.avail_out = (uInt)Want;
+                int Ret = inflate(&Zs, Z_FINISH);
+                /// A partial read stops with a full output buffer before the stream ends
+                if ((Ret == Z_STREAM_END || Zs.avail_out == 0) && Zs.total_out == Want) Result = (int64_t)Want;
+                inflateEnd(&Zs);
+            }
+        }
+        free(Stored);
+    }
+    close(Fd);
+    return Result;
+}
+
+void Segment_Release(uint32_t Segment, uint64_t Offset) {
+    char Path[PATH_MAX];
+    Internal_SegmentPath(Segment, Path, sizeof(Path));
+
+    /// Not the O_APPEND active descriptor: pwrite() there would append instead of patching
+    int Fd = open(Path, O_RDWR | O_CLOEXEC);
+    if (Fd >= 0) {
+        uint32_t Magic = 0;
+        if (pread(Fd, &Magic, sizeof(Magic), (off_t)Offset) == (ssize_t)sizeof(Magic) && Magic == SEGMENT_RECORD_MAGIC) {
+            Magic = SEGMENT_RECORD_DEAD_MAGIC;
+            if (pwrite(Fd, &Magic, sizeof(Magic), (off_t)Offset) != (ssize_t)sizeof(Magic)) {
+                xWarn("[Segment] Cannot mark record %u:%llu released: %s", Segment, (unsigned long long)Offset, strerror(errno));
+            }
+        }
+        close(Fd);
+    }
+
+    if (atomic_fetch_add(&ReleasedCount, 1) + 1 >= SEGMENT_COMPACT_BATCH) {
+        pthread_cond_signal(&SegmentCond);
+    }
+}
+
+RetType Segment_RemoveAll(void) {
+    pthread_mutex_lock(&SegmentMutex);
+
+    if (ActiveFd >= 0) close(ActiveFd);
+    ActiveFd = -1;
+    ActiveSize = 0;
+
+    RetType Ret = RemoveDir(PATH_DIR_SEGMENTS);
+    if (EnsureDir(PATH_DIR_SEGMENTS) != OKE) Ret = ERR;
+
+    /// Never reuse an id: the compactor may still be copying out of an old segment
+    ActiveId++;
+    pthread_mutex_unlock(&SegmentMutex);
+    return Ret;
+}
+
+int Segment_ForEachRecord(SegmentRecordFn Fn) {
+    uint32_t *Ids;
+    int Count = Internal_ListSegments(&Ids);
+    int Visited = 0;
+
+    for (int i = 0; i < Count; i++) {
+        sSegmentView View = {0};
+        if (Internal_MapSegment(Ids[i], &View) != OKE) continue;
+
+        size_t Pos = 0, Len;
+        sSegmentRecord Rec;
+        for (; (Len = Internal_ParseRecord(&View, Pos, &Rec)) > 0; Pos += Len) {
+            /// Released (deleted, evicted, duplicate or moved) records must not come back
+            if (Rec.Magic != SEGMENT_RECORD_MAGIC) continue;
+
+            sClipboardItem Item;
+            memset(&Item, 0, sizeof(Item));
+            memcpy(Item.Filename, View.Base + Pos + sizeof(Rec), Rec.NameLen);
+            Item.Timestamp = (time_t)Rec.Timestamp;
+            Item.FileType = (enum XCBFileType)Rec.FileType;
+            Item.ContentSize = Rec.PayloadLen;
+            Item.Segment = Ids[i];
+            Item.SegOffset = Pos;
+            Fn(&Item);
+            Visited++;
+        }
+        Internal_UnmapSegment(&View);
+    }
+    free(Ids);
+    return Visited;
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,114 @@
+#ifndef __CBC_SEGMENT_H__
+#define __CBC_SEGMENT_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * SEGMENT CONFIGURATION SECTION ******************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Magic bytes at the start of every segment record ("XCSR").
+ */
+#define SEGMENT_RECORD_MAGIC            0x52534358U
+
+/**
+ * @brief Magic bytes of a released record ("XCSD"): still walked over, never restored by a scan.
+ */
+#define SEGMENT_RECORD_DEAD_MAGIC       0x44534358U
+
+/**************************************************************************************************
+ * SEGMENT TYPES **********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Called once per live record by Segment_ForEachRecord().
+ * @param Item Filename, Timestamp, FileType, ContentSize, Segment and SegOffset of the record.
+ */
+typedef void (*SegmentRecordFn)(const sClipboardItem *Item);
+
+/**************************************************************************************************
+ * SEGMENT PROTOTYPES *****************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Tells whether a payload belongs in the segment store.
+ * @param Type The clipboard file type of the payload.
+ * @param Len Payload size in bytes (or the size seen so far).
+ * @return 1 for small text payloads when STORE_SEGMENTS is enabled, 0 otherwise.
+ */
+int Segment_Accepts(enum XCBFileType Type, size_t Len);
+
+/**
+ * @brief Opens the store (a fresh active segment is created on the first append) and spawns the compactor.
+ * @return OKE on success, ERR if the compactor thread cannot be created.
+ */
+RetType Segment_Start(void);
+
+/**
+ * @brief Joins the compactor and closes the active segment.
+ */
+void Segment_Stop(void);
+
+/**
+ * @brief Appends one payload as a single record to the active segment.
+ * @param Name Filename of the item (kept in the record for recovery).
+ * @param Type The clipboard file type of the payload.
+ * @param Data Payload bytes.
+ * @param Len Payload size, at most SEGMENT_ITEM_MAX.
+ * @param Timestamp Capture time (kept in the record for recovery).
+ * @param Segment Receives the segment id.
+ * @param Offset Receives the record offset inside the segment.
+ * @return OKE on success, ERR_UNSUPPORTED if the store is not started or Len is too large, ERR on I/O errors.
+ */
+RetType Segment_Append(const char *Name, enum XCBFileType Type, const uint8_t *Data, size_t Len,
+                       time_t Timestamp, uint32_t *Segment, uint64_t *Offset);
+
+/**
+ * @brief Returns the decoded payload size of a record.
+ * @return Size in bytes, or -1 if the record cannot be read.
+ */
+int64_t Segment_GetPayloadSize(uint32_t Segment, uint64_t Offset);
+
+/**
+ * @brief Reads the decoded payload of a record.
+ * @param Output Destination buffer.
+ * @param MaxLen Capacity of Output.
+ * @param AllowPartial 1 to return the first MaxLen bytes of a larger payload, 0 to reject it.
+ * @return Number of bytes read, ERR_OVERFLOW if the payload exceeds MaxLen (and !AllowPartial),
+ *         ERR on I/O errors or a damaged record.
+ */
+int64_t Segment_Read(uint32_t Segment, uint64_t Offset, void *Output, size_t MaxLen, int AllowPartial);
+
+/**
+ * @brief Marks a record as no longer referenced by the history.
+ * @param Segment Segment holding the record.
+ * @param Offset Record offset inside the segment.
+ * @note Rewrites the record magic in place (SEGMENT_RECORD_DEAD_MAGIC) so recovery scans skip it;
+ *       the space is reclaimed later by the compactor. One small write, safe with the ListMutex held.
+ */
+void Segment_Release(uint32_t Segment, uint64_t Offset);
+
+/**
+ * @brief Deletes every segment file. The next append starts a new segment.
+ * @return OKE on success, ERR if the directory cannot be emptied.
+ */
+RetType Segment_RemoveAll(void);
+
+/**
+ * @brief Walks every live record of every segment, oldest segment first (recovery scan).
+ * @param Fn Callback receiving each record. Released records are skipped.
+ * @return The number of records visited.
+ */
+int Segment_ForEachRecord(SegmentRecordFn Fn);
+
+#endif /*__CBC_SEGMENT_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -17,13 +17,22 @@
 
 /**
  * @brief Maximum number of items retained in the clipboard history ring buffer.
+ * @note Default only: the capacity is sized at runtime (see ENV_HISTORY_ITEMS).
  */
 #define MAX_HISTORY_ITEMS       1000 
 
+/**
+ * @brief Environment variable overriding MAX_HISTORY_ITEMS at startup (e.g. XCBC_HISTORY_ITEMS=100000).
+ */
+#define ENV_HISTORY_ITEMS       "XCBC_HISTORY_ITEMS"
+
 /**
  * @brief Root directory for all temporary runtime files.
+ * @note Overridable at build time (-DPATH_DIR_ROOT=...), e.g. by `make bench`.
  */
-#define PATH_DIR_ROOT           "/home/fus/.fus/.XCBC_Data"
+#ifndef PATH_DIR_ROOT
+    #define PATH_DIR_ROOT       "/home/fus/.fus/.XCBC_Data"
+#endif /*PATH_DIR_ROOT*/
 
 /**
  * @brief Sub-directory storing the raw clipboard data chunks/files.
@@ -31,14 +40,29 @@
 #define PATH_DIR_DB             PATH_DIR_ROOT "/DBs"
 
 /**
- * @brief Path to the file storing the serialized clipboard history list.
+ * @brief Directory holding the segment files of the log-structured store (small text items).
+ */
+#define PATH_DIR_SEGMENTS       PATH_DIR_ROOT "/Segments"
+
+/**
+ * @brief Directory holding the downscaled PNG thumbnails of image items ("<item filename>.png").
+ */
+#define PATH_DIR_THUMBS         PATH_DIR_ROOT "/Thumbs"
+
+/**
+ * @brief Path to the append-only history journal (push/remove/promote/clear records, replayed at startup).
  */
 #define PATH_ITEM               PATH_DIR_ROOT "/ClipboardItem"
 
 /**
- * @brief Path to the temporary text file used to feed the Rofi menu.
+ * @brief Path to the trigram index of the text items, saved at shutdown and reloaded at startup.
+ */
+#define PATH_FILE_SEARCH        PATH_DIR_ROOT "/SearchIndex"
+
+/**
+ * @brief Path to the runtime metrics file (Prometheus text format), rewritten at most every METRICS_EXPORT_MS.
  */
-#define PATH_FILE_ROFI_MENU     PATH_DIR_ROOT "/XCBRofiMenu.txt"
+#define PATH_FILE_METRICS       PATH_DIR_ROOT "/metrics.prom"
 
 /**
  * @brief Toggle switch to enable (1) or disable (0) Rofi UI integration.
@@ -46,10 +70,200 @@
 #define ROFI_SUPPORT            1
 
 /**
- * @brief Maximum character length for text previews in the Rofi menu.
+ * @brief Toggle switch to enable (1) or disable (0) the built-in XCB picker, used when ROFI_SUPPORT is 0.
+ * @note Look and size are tuned with the PICKER_* settings below.
+ */
+#define PICKER_SUPPORT          1
+
+/**
+ * @brief Core X font of the picker. A Unicode (iso10646) font draws previews beyond Latin-1.
+ */
+#define PICKER_FONT             "-misc-fixed-medium-r-normal--13-*-*-*-*-*-iso10646-1"
+
+/**
+ * @brief Width (pixels) of the picker window.
+ */
+#define PICKER_WIDTH            720
+
+/**
+ * @brief Number of history rows visible at once (only those are drawn).
+ */
+#define PICKER_ROWS             12
+
+/**
+ * @brief Height (pixels) of one picker row.
+ */
+#define PICKER_ROW_HEIGHT       40
+
+/**
+ * @brief Longest side (pixels) of the thumbnail drawn in front of image rows.
+ */
+#define PICKER_THUMB_SIZE       36
+
+/**
+ * @brief Decoded thumbnails kept between two openings (least recently drawn is replaced).
+ */
+#define PICKER_THUMB_CACHE      128
+
+/**
+ * @brief Most rows matched through the full-text index per query (each one is read back to be checked).
+ * @note Rows whose preview matches are always listed, beyond this limit.
+ */
+#define PICKER_SEARCH_MAX       1000
+
+/**
+ * @brief Most rows listed for a non-empty query, best fuzzy matches first (the header still counts all).
+ */
+#define PICKER_MATCH_MAX        500
+
+/**
+ * @brief Toggle switch to use (1) the SSE2/AVX2 byte search of the fuzzy prefilter, picked at runtime
+ *        from the CPU features, or (0) the scalar one everywhere.
+ */
+#define FUZZY_SIMD              1
+
+/**
+ * @brief Maximum length (bytes) of the text previews shown in the Rofi menu.
+ * @note Previews are built once per capture (CBC_Preview.c) and stored with the item metadata.
  */
 #define PREVIEW_TXT_LEN         80
 
+/**
+ * @brief Bytes read from a stored payload when its preview is rebuilt (directory scan, old items).
+ * @note Lines are only counted when the whole payload fits; otherwise the count is left unknown (0).
+ */
+#define PREVIEW_SCAN_MAX        (64U * 1024U)
+
+/**
+ * @brief Toggle switch to enable (1) or disable (0) the thumbnail cache of image items.
+ * @note Thumbnails are generated by a worker thread after each image capture; menus point at them
+ *       instead of the full-size image. Only PNG and BMP can be decoded (JPEG keeps its original).
+ */
+#define THUMB_CACHE             1
+
+/**
+ * @brief Longest side (pixels) of the cached thumbnails.
+ */
+#define THUMB_SIZE              128
+
+/**
+ * @brief Largest image payload (bytes) decoded into a thumbnail. Bigger items get none.
+ */
+#define THUMB_SOURCE_MAX        (128U * 1024U * 1024U)
+
+/**
+ * @brief Toggle switch to enable (1) or disable (0) the full-text (trigram) index of text items.
+ * @note The built-in picker uses it to match the whole payload, not only the preview (see CBC_Search.h).
+ *       It is only built when the picker is (ROFI_SUPPORT 0): Rofi filters the previews itself.
+ */
+#define SEARCH_INDEX            1
+
+/**
+ * @brief Bytes of each text payload that are indexed and searched (the rest is not searchable).
+ */
+#define SEARCH_TEXT_MAX         (4U * 1024U * 1024U)
+
+/**
+ * @brief Toggle switch to enable (1) or disable (0) transparent zlib compression of stored payloads.
+ * @note Only text and BMP payloads are compressed; PNG/JPEG are already compressed and stored as-is.
+ */
+#define STORE_COMPRESS          1
+
+/**
+ * @brief Payloads smaller than this (bytes) are stored uncompressed.
+ */
+#define STORE_COMPRESS_MIN_SIZE 4096
+
+/**
+ * @brief zlib compression level used for stored payloads (1 = fastest, 9 = smallest).
+ */
+#define STORE_COMPRESS_LEVEL    3
+
+/**
+ * @brief Toggle switch to enable (1) or disable (0) appending small text items to segment files
+ *        instead of creating one file per item.
+ */
+#define STORE_SEGMENTS          1
+
+/**
+ * @brief Text items up to this size (bytes) go to the segment store; larger ones get their own file.
+ */
+#define SEGMENT_ITEM_MAX        (64U * 1024U)
+
+/**
+ * @brief A segment is sealed and a new one started once it reaches this size (bytes).
+ */
+#define SEGMENT_FILE_MAX        (64U * 1024U * 1024U)
+
+/**
+ * @brief A sealed segment is compacted once less than this percentage of its bytes is still live.
+ */
+#define SEGMENT_COMPACT_LIVE_PCT 50
+
+/**
+ * @brief The compactor wakes up after this many released records, or every SEGMENT_COMPACT_CHECK_MS.
+ */
+#define SEGMENT_COMPACT_BATCH   64
+
+/**
+ * @brief Idle period (ms) between two compaction passes when few records are released.
+ */
+#define SEGMENT_COMPACT_CHECK_MS (5 * 60 * 1000)
+
+/**
+ * @brief Period (ms) at which the compactor retries deleting compacted segments still readable through a snapshot.
+ */
+#define SEGMENT_RETIRE_CHECK_MS (10 * 1000)
+
+/**
+ * @brief The history journal is compacted once it holds this many records per history slot.
+ */
+#define JOURNAL_COMPACT_FACTOR  4
+
+/**
+ * @brief Upper bound (bytes) on all transfer buffers held at once (capture staging + provided data).
+ * @note Can be changed at runtime with MemBudget_SetCeiling(). Requests beyond it fail cleanly.
+ */
+#define MEM_BUDGET_CEILING      (256U * 1024U * 1024U)
+
+/**
+ * @brief Toggle switch to enable (1) or disable (0) capturing extra targets (text/html, ...) per item.
+ * @note Extra targets are stored in a ".mt" container beside the item and re-offered by the provider.
+ */
+#define CAPTURE_MULTI_TARGET    1
+
+/**
+ * @brief Size cap (bytes) of a single extra text target (text/html, text/plain, ...).
+ */
+#define FLAVOUR_CAP_TEXT        (4U * 1024U * 1024U)
+
+/**
+ * @brief Size cap (bytes) of a single extra image target.
+ */
+#define FLAVOUR_CAP_IMAGE       (8U * 1024U * 1024U)
+
+/**
+ * @brief Upper bound (bytes) of a single property write when providing data (single-shot or INCR chunk).
+ * @note The effective limit is the smaller of this and the server's maximum request length.
+ */
+#define PROVIDE_WRITE_MAX       (16U * 1024U * 1024U)
+
+/**
+ * @brief Toggle switch to enable (1) or disable (0) the runtime counters/histograms and their export.
+ */
+#define METRICS_EN              1
+
+/**
+ * @brief Minimum interval (ms) between two exports of PATH_FILE_METRICS.
+ * @note Nothing is written while no counter or histogram changes.
+ */
+#define METRICS_EXPORT_MS       10000
+
+/**
+ * @brief Number of commands (inject, delete, ...) that can wait for the event loop at once (power of two).
+ */
+#define CMD_QUEUE_DEPTH         256
+
 #endif /*__SETUP_H__*/
 
 /**************************************************************************************************
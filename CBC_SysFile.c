@@ -1,16 +1,51 @@
 #include "CBC_SysFile.h"
 #include "CBC_Setup.h"
+#include "CBC_Codec.h"
+#include "CBC_MemBudget.h"
+#include "CBC_Flavour.h"
+#include "CBC_Metrics.h"
+#include "CBC_Journal.h"
+#include "CBC_Segment.h"
+#include "CBC_Preview.h"
+#include "CBC_Thumb.h"
+#include "CBC_Search.h"
 #include <xUniversal.h>
 #include <xUniversalReturn.h>
+#include <stdatomic.h>
+#include <stddef.h>
 
 /**************************************************************************************************
  * INTERNAL DATA SECTION **************************************************************************
  **************************************************************************************************/ 
 
 /**
- * @brief The physical array acting as a ring buffer for clipboard items.
+ * @brief The ring buffer of clipboard items, stored column by column (structure of arrays).
+ * @note Every column holds XCBListCapacity entries indexed by the physical ring index. Lookups
+ *       (hash, size, type, name key, location) scan dense arrays and never touch the filenames.
  */
-static sClipboardItem   XCBList[MAX_HISTORY_ITEMS];
+static struct {
+    uint64_t           *Id;         /// Runtime id, unique for the lifetime of the daemon
+    int64_t            *TimeMs;     /// Capture (or last promotion) time, ms since the epoch
+    uint64_t           *Hash;       /// CRC32:Adler32 of the payload (0 = unknown)
+    uint64_t           *Size;       /// Payload size in bytes
+    uint64_t           *SegOffset;  /// Record offset inside Segment
+    uint32_t           *Segment;    /// Segment holding the payload (0 = own file in PATH_DIR_DB)
+    uint32_t           *NameKey;    /// FNV-1a of the filename, compared before the name itself
+    uint8_t            *Type;       /// XCBFileType
+    uint32_t           *Lines;      /// Line count of a text payload (0 = empty or unknown)
+    char              **Name;       /// Cold column: heap copy of the filename (NULL = empty slot)
+    char              **Preview;    /// Cold column: heap copy of the menu preview (NULL = none)
+} XCBList;
+
+/**
+ * @brief Number of slots in every XCBList column (0 until the first XCBList_SetCapacity()).
+ */
+static int              XCBListCapacity = 0;
+
+/**
+ * @brief Next runtime id handed to a stored item.
+ */
+static uint64_t         XCBListNextId = 1;
 
 /**
  * @brief The current number of items stored in the buffer.
@@ -32,10 +67,80 @@ static pthread_mutex_t  ListMutex = PTHREAD_MUTEX_INITIALIZER;
  */
 static int              XCBList_SelectedItem = -1;
 
+/**
+ * @brief Open-addressing index: ContentHash -> physical ring index + 1 (0 = empty slot).
+ * @note Only items with a known (non-zero) ContentHash are indexed. Sized to the smallest
+ *       power of two >= 2 * XCBListCapacity; XCBListHashMask is that size minus one.
+ */
+static int             *XCBListHashIndex = NULL;
+static uint32_t         XCBListHashMask = 0;
+
+/**
+ * @brief Bumped (under the ListMutex) by every change to the history; read lock-free.
+ */
+static atomic_ullong    XCBListVersion = 1;
+
+/**
+ * @brief Ring slots per snapshot chunk (1 << SNAPSHOT_CHUNK_SHIFT).
+ */
+#define SNAPSHOT_CHUNK_SHIFT    8
+#define SNAPSHOT_CHUNK_ROWS     (1 << SNAPSHOT_CHUNK_SHIFT)
+
+/**
+ * @brief The rows of one chunk of ring slots and their reference count, allocated in one block
+ *        with the filenames and previews. Shared by every snapshot that did not rebuild it.
+ */
+typedef struct {
+    atomic_int          Refs;
+    sXCBListRow         Rows[];
+} sSnapshotChunk;
+
+/**
+ * @brief A snapshot and its reference count, allocated in one block with its chunk table.
+ */
+typedef struct sSnapshotBlock {
+    atomic_int              Refs;
+    struct sSnapshotBlock  *LivePrev;   /// Links in SnapshotLive (SnapshotMutex)
+    struct sSnapshotBlock  *LiveNext;
+    sXCBListSnapshot        Public;
+    const sXCBListRow      *ChunkRows[];
+} sSnapshotBlock;
+
+/**
+ * @brief The snapshot handed to readers (holds one reference).
+ * @note Replaced by the writers with both the ListMutex and SnapshotMutex held; readers only take
+ *       SnapshotMutex, for the time of one reference bump.
+ */
+static sSnapshotBlock  *SnapshotPublished = NULL;
+static pthread_mutex_t  SnapshotMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Every snapshot still referenced (the published one included), guarded by SnapshotMutex.
+ * @note Tells the segment compactor when no reader can still hold an old record location.
+ */
+static sSnapshotBlock  *SnapshotLive = NULL;
+
+/**
+ * @brief Writer-side publication state, guarded by the ListMutex.
+ * @note SnapshotDirty has one flag per chunk written since the last publication; SnapshotAllDirty
+ *       forces a full rebuild (slots relaid out). SnapshotPending is set by any change at all.
+ */
+static uint8_t         *SnapshotDirty = NULL;
+static int              SnapshotDirtyCount = 0;
+static int              SnapshotAllDirty = 1;
+static int              SnapshotPending = 1;
+
+/**
+ * @brief Set when a publication failed (out of memory): the next reader retries under the ListMutex.
+ */
+static atomic_int       SnapshotStale = 1;
+
 /**************************************************************************************************
  * LOCKING HELPERS ********************************************************************************
  **************************************************************************************************/ 
 
+static void Internal_PublishSnapshot(void);
+
 /**
  * @brief Locks the list mutex for thread-safe operations.
  */
@@ -44,9 +149,10 @@ static void LockList(void) {
 }
 
 /**
- * @brief Unlocks the list mutex.
+ * @brief Publishes the changes made under the lock (if any), then unlocks the list mutex.
  */
 static void UnlockList(void) { 
+    Internal_PublishSnapshot();
     pthread_mutex_unlock(&ListMutex); 
 }
 
@@ -65,8 +171,8 @@ static int Convert2AllocatedIndex(int LinearIndex) {
     
     /// Ring Buffer Math: 
     /// We subtract the logical index (0 is newest) from the HeadIndex (newest physical location).
-    /// Adding MAX_HISTORY_ITEMS ensures the value is strictly positive before applying the modulo.
-    return (HeadIndex - LinearIndex + MAX_HISTORY_ITEMS) % MAX_HISTORY_ITEMS;
+    /// Adding XCBListCapacity ensures the value is strictly positive before applying the modulo.
+    return (HeadIndex - LinearIndex + XCBListCapacity) % XCBListCapacity;
 }
 
 /**
@@ -80,7 +186,7 @@ static int Convert2LinearIndex(int AllocatedIndex) {
     
     /// Reverse Ring Buffer Math:
     /// Calculate how far the given allocated index is from the current HeadIndex.
-    return (HeadIndex - AllocatedIndex + MAX_HISTORY_ITEMS) % MAX_HISTORY_ITEMS;
+    return (HeadIndex - AllocatedIndex + XCBListCapacity) % XCBListCapacity;
 }
 
 /**
@@ -88,7 +194,7 @@ static int Convert2LinearIndex(int AllocatedIndex) {
  * @param Filename The name of the file to parse.
  * @return The corresponding XCBFileType enumeration.
  */
-static enum XCBFileType GetFileTypeFromName(const char* Filename) {
+enum XCBFileType GetFileTypeFromName(const char* Filename) {
     /// Find the last occurrence of the dot ('.') in the filename string
     char *ext = strrchr(Filename, '.');
     
@@ -99,26 +205,662 @@ static enum XCBFileType GetFileTypeFromName(const char* Filename) {
     if (strcasecmp(ext, ".txt") == 0) return eFMT_TXT;
     if (strcasecmp(ext, ".png") == 0) return eFMT_IMG_PNG;
     if (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0) return eFMT_IMG_JGP;
+    if (strcasecmp(ext, ".bmp") == 0) return eFMT_IMG_BMP;
     
     /// Fallback for unknown extensions
     return eFMT_NONE;
 }
 
+/**************************************************************************************************
+ * INTERNAL HELPERS: CONTENT-HASH INDEX ***********************************************************
+ **************************************************************************************************/ 
+
 /**
- * @brief Sort comparator (Ascending): Oldest first. 
- * @param a Pointer to the first sClipboardItem.
- * @param b Pointer to the second sClipboardItem.
- * @return 1 if a > b, -1 if a < b, 0 if equal.
- * @note Used ONLY during initial Scan to setup the buffer chronologically.
+ * @brief Empties the content-hash index.
+ * @note This function assumes the caller has already locked the ListMutex.
  */
-static int CompareItemsAsc(const void *a, const void *b) {
-    sClipboardItem *itemA = (sClipboardItem *)a;
-    sClipboardItem *itemB = (sClipboardItem *)b;
-    
-    /// Compare Unix timestamps. Smaller timestamp means older file.
-    if (itemA->Timestamp > itemB->Timestamp) return 1;
-    if (itemA->Timestamp < itemB->Timestamp) return -1;
-    return 0;
+static void HashIndex_Reset(void) {
+    if (XCBListHashIndex) memset(XCBListHashIndex, 0, (XCBListHashMask + 1) * sizeof(int));
+}
+
+/**
+ * @brief Adds the item stored at a physical index to the content-hash index.
+ * @param AllocIdx Physical ring index of the item.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void HashIndex_Insert(int AllocIdx) {
+    uint64_t Hash = XCBList.Hash[AllocIdx];
+    if (Hash == 0) return;
+
+    uint32_t Slot = (uint32_t)Hash & XCBListHashMask;
+    while (XCBListHashIndex[Slot] != 0) {
+        Slot = (Slot + 1) & XCBListHashMask;
+    }
+    XCBListHashIndex[Slot] = AllocIdx + 1;
+}
+
+/**
+ * @brief Removes the item stored at a physical index from the content-hash index.
+ * @param AllocIdx Physical ring index of the item.
+ * @note Uses backward-shift deletion so linear probing never needs tombstones.
+ *       This function assumes the caller has already locked the ListMutex.
+ */
+static void HashIndex_Remove(int AllocIdx) {
+    uint64_t Hash = XCBList.Hash[AllocIdx];
+    if (Hash == 0) return;
+
+    uint32_t Slot = (uint32_t)Hash & XCBListHashMask;
+    while (XCBListHashIndex[Slot] != AllocIdx + 1) {
+        if (XCBListHashIndex[Slot] == 0) return;
+        Slot = (Slot + 1) & XCBListHashMask;
+    }
+
+    /// Pull later entries of the same probe chain back into the hole
+    uint32_t Hole = Slot;
+    uint32_t Next = (Hole + 1) & XCBListHashMask;
+    while (XCBListHashIndex[Next] != 0) {
+        uint32_t Home = (uint32_t)XCBList.Hash[XCBListHashIndex[Next] - 1] & XCBListHashMask;
+        if (((Next - Home) & XCBListHashMask) >= ((Next - Hole) & XCBListHashMask)) {
+            XCBListHashIndex[Hole] = XCBListHashIndex[Next];
+            Hole = Next;
+        }
+        Next = (Next + 1) & XCBListHashMask;
+    }
+    XCBListHashIndex[Hole] = 0;
+}
+
+/**
+ * @brief Points the index entry of an item that moved from slot From to slot To at its new slot.
+ * @note Call once the columns are in slot To. The entry keeps its place in the probe chain.
+ *       This function assumes the caller has already locked the ListMutex.
+ */
+static void HashIndex_Repoint(int From, int To) {
+    uint64_t Hash = XCBList.Hash[To];
+    if (Hash == 0) return;
+
+    uint32_t Slot = (uint32_t)Hash & XCBListHashMask;
+    while (XCBListHashIndex[Slot] != 0) {
+        if (XCBListHashIndex[Slot] == From + 1) {
+            XCBListHashIndex[Slot] = To + 1;
+            return;
+        }
+        Slot = (Slot + 1) & XCBListHashMask;
+    }
+}
+
+/**
+ * @brief Rebuilds the content-hash index from the live ring buffer.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void HashIndex_Rebuild(void) {
+    HashIndex_Reset();
+    for (int i = 0; i < XCBListSize; i++) {
+        HashIndex_Insert(Convert2AllocatedIndex(i));
+    }
+}
+
+/**
+ * @brief Finds a live item with identical content.
+ * @return The physical ring index of the match, or -1 if none.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static int HashIndex_Find(uint64_t Hash, uint64_t Size, enum XCBFileType FileType) {
+    if (Hash == 0) return -1;
+
+    uint32_t Slot = (uint32_t)Hash & XCBListHashMask;
+    while (XCBListHashIndex[Slot] != 0) {
+        int AllocIdx = XCBListHashIndex[Slot] - 1;
+        if (XCBList.Hash[AllocIdx] == Hash && XCBList.Size[AllocIdx] == Size && XCBList.Type[AllocIdx] == (uint8_t)FileType) {
+            return AllocIdx;
+        }
+        Slot = (Slot + 1) & XCBListHashMask;
+    }
+    return -1;
+}
+
+/**
+ * @brief Opens a payload for comparison: mapped from its file, or decoded into a budgeted buffer.
+ * @param Owned Receives the buffer to free with MemBudget_Free(), NULL if the payload is mapped.
+ * @return OKE on success, ERR if the payload cannot be read in full.
+ */
+static RetType Internal_OpenPayload(const sClipboardItem *Item, sCodecMapping *Map, void **Owned) {
+    *Owned = NULL;
+    RetType Ret = Codec_ItemMap(Item, Map);
+    if (Ret != ERR_UNSUPPORTED) return Ret;
+
+    /// Compressed on disk or a segment record
+    size_t Len = (size_t)Item->ContentSize;
+    *Owned = MemBudget_Alloc(Len);
+    if (!*Owned || Codec_ItemRead(Item, *Owned, Len) != (int64_t)Len) {
+        MemBudget_Free(*Owned);
+        *Owned = NULL;
+        return ERR;
+    }
+    Map->Base = *Owned;
+    Map->Len = Len;
+    return OKE;
+}
+
+/**
+ * @brief Tells whether two items with the same content hash and size really hold the same bytes.
+ * @return 1 if both payloads are readable and identical, 0 otherwise.
+ * @note Reads both payloads: the caller must not hold the ListMutex.
+ */
+static int Internal_SamePayload(const sClipboardItem *A, const sClipboardItem *B) {
+    if (A->ContentSize != B->ContentSize) return 0;
+    if (A->ContentSize == 0) return 1;
+
+    sCodecMapping MapA, MapB;
+    void *OwnedA, *OwnedB;
+    if (Internal_OpenPayload(A, &MapA, &OwnedA) != OKE) return 0;
+    if (Internal_OpenPayload(B, &MapB, &OwnedB) != OKE) {
+        if (OwnedA) MemBudget_Free(OwnedA); else Codec_UnmapFile(&MapA);
+        return 0;
+    }
+
+    int Same = (MapA.Len == MapB.Len && memcmp(MapA.Base, MapB.Base, MapA.Len) == 0);
+
+    if (OwnedA) MemBudget_Free(OwnedA); else Codec_UnmapFile(&MapA);
+    if (OwnedB) MemBudget_Free(OwnedB); else Codec_UnmapFile(&MapB);
+    return Same;
+}
+
+/**************************************************************************************************
+ * INTERNAL HELPERS: COLUMN STORAGE ***************************************************************
+ **************************************************************************************************/ 
+
+/**
+ * @brief FNV-1a hash of a filename, stored in the NameKey column.
+ */
+static uint32_t Internal_NameKey(const char *Name) {
+    uint32_t Key = 2166136261U;
+    while (*Name) {
+        Key ^= (uint8_t)*Name++;
+        Key *= 16777619U;
+    }
+    return Key;
+}
+
+/**
+ * @brief Returns the current wall-clock time in ms since the epoch.
+ */
+static int64_t Internal_NowMs(void) {
+    struct timespec Now;
+    clock_gettime(CLOCK_REALTIME, &Now);
+    return (int64_t)Now.tv_sec * 1000 + Now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Returns the filename stored in a slot ("" if the slot holds none).
+ */
+static const char *Internal_Name(int AllocIdx) {
+    return XCBList.Name[AllocIdx] ? XCBList.Name[AllocIdx] : "";
+}
+
+/**
+ * @brief Returns the preview stored in a slot ("" if the slot holds none).
+ */
+static const char *Internal_Preview(int AllocIdx) {
+    return XCBList.Preview[AllocIdx] ? XCBList.Preview[AllocIdx] : "";
+}
+
+/**
+ * @brief Records that the history changed, invalidating the shared snapshot.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_MarkChanged(void) {
+    atomic_fetch_add_explicit(&XCBListVersion, 1, memory_order_release);
+    SnapshotPending = 1;
+}
+
+/**
+ * @brief Records a change to the columns of one slot: its chunk is rebuilt at the next publication.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_MarkSlot(int AllocIdx) {
+    Internal_MarkChanged();
+    int Chunk = AllocIdx >> SNAPSHOT_CHUNK_SHIFT;
+    if (Chunk < SnapshotDirtyCount) SnapshotDirty[Chunk] = 1;
+    else SnapshotAllDirty = 1;
+}
+
+/**
+ * @brief Records a change to every slot (clear, sort, relayout): the next publication rebuilds all chunks.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_MarkAllSlots(void) {
+    Internal_MarkChanged();
+    SnapshotAllDirty = 1;
+}
+
+/**
+ * @brief Frees the heap columns (filename, preview) of a slot.
+ */
+static void Internal_FreeSlot(int AllocIdx) {
+    Internal_MarkSlot(AllocIdx);
+    free(XCBList.Name[AllocIdx]);
+    free(XCBList.Preview[AllocIdx]);
+    XCBList.Name[AllocIdx] = NULL;
+    XCBList.Preview[AllocIdx] = NULL;
+}
+
+/**
+ * @brief Copies the columns of a slot out into an sClipboardItem.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_ExportItem(int AllocIdx, sClipboardItem *Output) {
+    memset(Output, 0, sizeof(*Output));
+    snprintf(Output->Filename, NAME_MAX + 1, "%s", Internal_Name(AllocIdx));
+    Output->Id = XCBList.Id[AllocIdx];
+    Output->Timestamp = (time_t)(XCBList.TimeMs[AllocIdx] / 1000);
+    Output->FileType = (enum XCBFileType)XCBList.Type[AllocIdx];
+    Output->ContentHash = XCBList.Hash[AllocIdx];
+    Output->ContentSize = XCBList.Size[AllocIdx];
+    Output->Segment = XCBList.Segment[AllocIdx];
+    Output->SegOffset = XCBList.SegOffset[AllocIdx];
+    Output->Lines = XCBList.Lines[AllocIdx];
+    snprintf(Output->Preview, sizeof(Output->Preview), "%s", Internal_Preview(AllocIdx));
+}
+
+/**
+ * @brief Stores an item into a slot under a fresh runtime id, replacing whatever it held.
+ * @param TimeMs The item time in ms (Item->Timestamp is ignored).
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_StoreItem(int AllocIdx, const sClipboardItem *Item, int64_t TimeMs) {
+    Internal_FreeSlot(AllocIdx);
+    XCBList.Name[AllocIdx] = strdup(Item->Filename);
+    if (!XCBList.Name[AllocIdx]) xError("[XCBList] Out of memory storing %s!", Item->Filename);
+    if (Item->Preview[0] != '\0') XCBList.Preview[AllocIdx] = strdup(Item->Preview);
+
+    XCBList.Id[AllocIdx] = XCBListNextId++;
+    XCBList.TimeMs[AllocIdx] = TimeMs;
+    XCBList.Hash[AllocIdx] = Item->ContentHash;
+    XCBList.Size[AllocIdx] = Item->ContentSize;
+    XCBList.SegOffset[AllocIdx] = Item->SegOffset;
+    XCBList.Segment[AllocIdx] = Item->Segment;
+    XCBList.NameKey[AllocIdx] = Internal_NameKey(Item->Filename);
+    XCBList.Type[AllocIdx] = (uint8_t)Item->FileType;
+    XCBList.Lines[AllocIdx] = Item->Lines;
+}
+
+/**
+ * @brief Moves every column of slot Src into slot Dst (the filename and preview pointers move too).
+ * @note Src is left holding stale pointers; the caller overwrites or clears them.
+ *       The hash index entry of the item follows it; Dst must not be indexed anymore.
+ *       This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_MoveSlot(int Dst, int Src) {
+    Internal_MarkSlot(Dst);
+    XCBList.Id[Dst] = XCBList.Id[Src];
+    XCBList.TimeMs[Dst] = XCBList.TimeMs[Src];
+    XCBList.Hash[Dst] = XCBList.Hash[Src];
+    XCBList.Size[Dst] = XCBList.Size[Src];
+    XCBList.SegOffset[Dst] = XCBList.SegOffset[Src];
+    XCBList.Segment[Dst] = XCBList.Segment[Src];
+    XCBList.NameKey[Dst] = XCBList.NameKey[Src];
+    XCBList.Type[Dst] = XCBList.Type[Src];
+    XCBList.Lines[Dst] = XCBList.Lines[Src];
+    XCBList.Name[Dst] = XCBList.Name[Src];
+    XCBList.Preview[Dst] = XCBList.Preview[Src];
+    HashIndex_Repoint(Src, Dst);
+}
+
+/**
+ * @brief Frees every filename and preview and empties the ring.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_ClearSlots(void) {
+    for (int i = 0; i < XCBListCapacity; i++) Internal_FreeSlot(i);
+    XCBListSize = 0;
+    HeadIndex = -1;
+    Internal_MarkAllSlots();
+}
+
+/**
+ * @brief Reallocates one column to NewCap entries, oldest live item first.
+ * @return The new column, or NULL on allocation failure (the old one is untouched).
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void *Internal_RelayoutColumn(void *Old, size_t ElemSize, int NewCap) {
+    uint8_t *New = calloc((size_t)NewCap, ElemSize);
+    if (!New) return NULL;
+    for (int i = 0; i < XCBListSize; i++) {
+        int Src = Convert2AllocatedIndex(XCBListSize - 1 - i);
+        memcpy(New + (size_t)i * ElemSize, (uint8_t *)Old + (size_t)Src * ElemSize, ElemSize);
+    }
+    return New;
+}
+
+/**
+ * @brief Resizes every column (and the hash index) to NewCap slots, keeping the live items.
+ * @return OKE on success, ERR on allocation failure (the list is unchanged).
+ * @note XCBListSize must already be <= NewCap. The ring is relinearized: the oldest item lands
+ *       in slot 0, so logical indices (and the selection) stay valid.
+ *       This function assumes the caller has already locked the ListMutex.
+ */
+static RetType Internal_Resize(int NewCap) {
+    uint32_t Slots = 1;
+    while (Slots < 2U * (uint32_t)NewCap) Slots <<= 1;
+
+    void *Cols[11] = {
+        Internal_RelayoutColumn(XCBList.Id,        sizeof(*XCBList.Id),        NewCap),
+        Internal_RelayoutColumn(XCBList.TimeMs,    sizeof(*XCBList.TimeMs),    NewCap),
+        Internal_RelayoutColumn(XCBList.Hash,      sizeof(*XCBList.Hash),      NewCap),
+        Internal_RelayoutColumn(XCBList.Size,      sizeof(*XCBList.Size),      NewCap),
+        Internal_RelayoutColumn(XCBList.SegOffset, sizeof(*XCBList.SegOffset), NewCap),
+        Internal_RelayoutColumn(XCBList.Segment,   sizeof(*XCBList.Segment),   NewCap),
+        Internal_RelayoutColumn(XCBList.NameKey,   sizeof(*XCBList.NameKey),   NewCap),
+        Internal_RelayoutColumn(XCBList.Type,      sizeof(*XCBList.Type),      NewCap),
+        Internal_RelayoutColumn(XCBList.Lines,     sizeof(*XCBList.Lines),     NewCap),
+        Internal_RelayoutColumn(XCBList.Name,      sizeof(*XCBList.Name),      NewCap),
+        Internal_RelayoutColumn(XCBList.Preview,   sizeof(*XCBList.Preview),   NewCap),
+    };
+    int *HashIndex = calloc(Slots, sizeof(int));
+
+    int Ok = (HashIndex != NULL);
+    for (int i = 0; i < 11; i++) Ok = Ok && (Cols[i] != NULL);
+    if (!Ok) {
+        for (int i = 0; i < 11; i++) free(Cols[i]);
+        free(HashIndex);
+        return ERR;
+    }
+
+    free(XCBList.Id);        XCBList.Id        = Cols[0];
+    free(XCBList.TimeMs);    XCBList.TimeMs    = Cols[1];
+    free(XCBList.Hash);      XCBList.Hash      = Cols[2];
+    free(XCBList.Size);      XCBList.Size      = Cols[3];
+    free(XCBList.SegOffset); XCBList.SegOffset = Cols[4];
+    free(XCBList.Segment);   XCBList.Segment   = Cols[5];
+    free(XCBList.NameKey);   XCBList.NameKey   = Cols[6];
+    free(XCBList.Type);      XCBList.Type      = Cols[7];
+    free(XCBList.Lines);     XCBList.Lines     = Cols[8];
+    free(XCBList.Name);      XCBList.Name      = Cols[9];
+    free(XCBList.Preview);   XCBList.Preview   = Cols[10];
+    free(XCBListHashIndex);
+    XCBListHashIndex = HashIndex;
+    XCBListHashMask = Slots - 1;
+
+    XCBListCapacity = NewCap;
+    HeadIndex = XCBListSize - 1;
+    HashIndex_Rebuild();
+    Internal_MarkAllSlots();
+    return OKE;
+}
+
+/**
+ * @brief Allocates the default capacity (MAX_HISTORY_ITEMS) if XCBList_SetCapacity() was never called.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static RetType Internal_EnsureCapacity(void) {
+    return (XCBListCapacity > 0) ? OKE : Internal_Resize(MAX_HISTORY_ITEMS);
+}
+
+/**************************************************************************************************
+ * INTERNAL HELPERS: RAM-ONLY LIST EDITS **********************************************************
+ **************************************************************************************************/ 
+
+/**
+ * @brief Finds the logical index of the item stored under a filename, searching from the oldest.
+ * @return The logical index, or -1 if not found.
+ * @note Compares the dense NameKey column first; the filename is only read on a key match.
+ *       This function assumes the caller has already locked the ListMutex.
+ */
+static int Internal_FindByName(const char *Name) {
+    uint32_t Key = Internal_NameKey(Name);
+    for (int i = XCBListSize - 1; i >= 0; i--) {
+        int AllocIdx = Convert2AllocatedIndex(i);
+        if (XCBList.NameKey[AllocIdx] == Key && strcmp(Internal_Name(AllocIdx), Name) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Stores an item as the newest entry, dropping the oldest entry (RAM only) if full.
+ * @param TimeMs The item time in ms.
+ * @note Does not touch the disk, the journal or the hash index.
+ *       This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_AppendItem(const sClipboardItem *Item, int64_t TimeMs) {
+    if (XCBListSize >= XCBListCapacity) XCBListSize--;
+
+    /// Advance the HeadIndex circularly. If it reaches the end, it wraps back to 0.
+    HeadIndex = (HeadIndex + 1) % XCBListCapacity;
+    Internal_StoreItem(HeadIndex, Item, TimeMs);
+    XCBListSize++;
+}
+
+/**
+ * @brief Removes the item at a logical index (RAM only); older items move one step up.
+ * @note Keeps the hash index in step with the moved slots. Does not touch the disk or the journal.
+ *       This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_RemoveAt(int Linear) {
+    HashIndex_Remove(Convert2AllocatedIndex(Linear));
+    Internal_FreeSlot(Convert2AllocatedIndex(Linear));
+    for (int k = Linear; k < XCBListSize - 1; k++) {
+        Internal_MoveSlot(Convert2AllocatedIndex(k), Convert2AllocatedIndex(k + 1));
+    }
+    Internal_MarkSlot(Convert2AllocatedIndex(XCBListSize - 1));
+    XCBList.Name[Convert2AllocatedIndex(XCBListSize - 1)] = NULL;
+    XCBList.Preview[Convert2AllocatedIndex(XCBListSize - 1)] = NULL;
+    XCBListSize--;
+    if (XCBListSize == 0) HeadIndex = -1;
+    Internal_MarkChanged();
+}
+
+/**
+ * @brief Moves the item at a physical index to the head (RAM only) with a new time.
+ * @note Items newer than the moved one shift one step older. Keeps the hash index in step.
+ *       This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_MoveToHead(int AllocIdx, int64_t TimeMs) {
+    int Linear = Convert2LinearIndex(AllocIdx);
+    Internal_MarkSlot(AllocIdx);
+    if (Linear <= 0) {
+        XCBList.TimeMs[AllocIdx] = TimeMs;
+        return;
+    }
+
+    /// Park the moved item in the head slot's place through the shift, one column at a time
+    HashIndex_Remove(AllocIdx);
+    uint64_t Id = XCBList.Id[AllocIdx], Hash = XCBList.Hash[AllocIdx], Size = XCBList.Size[AllocIdx];
+    uint64_t SegOffset = XCBList.SegOffset[AllocIdx];
+    uint32_t Segment = XCBList.Segment[AllocIdx], NameKey = XCBList.NameKey[AllocIdx], Lines = XCBList.Lines[AllocIdx];
+    uint8_t Type = XCBList.Type[AllocIdx];
+    char *Name = XCBList.Name[AllocIdx], *Preview = XCBList.Preview[AllocIdx];
+
+    for (int k = Linear; k > 0; k--) {
+        Internal_MoveSlot(Convert2AllocatedIndex(k), Convert2AllocatedIndex(k - 1));
+    }
+
+    Internal_MarkSlot(HeadIndex);
+    XCBList.Id[HeadIndex] = Id;
+    XCBList.TimeMs[HeadIndex] = TimeMs;
+    XCBList.Hash[HeadIndex] = Hash;
+    XCBList.Size[HeadIndex] = Size;
+    XCBList.SegOffset[HeadIndex] = SegOffset;
+    XCBList.Segment[HeadIndex] = Segment;
+    XCBList.NameKey[HeadIndex] = NameKey;
+    XCBList.Type[HeadIndex] = Type;
+    XCBList.Lines[HeadIndex] = Lines;
+    XCBList.Name[HeadIndex] = Name;
+    XCBList.Preview[HeadIndex] = Preview;
+    HashIndex_Insert(HeadIndex);
+}
+
+/**************************************************************************************************
+ * INTERNAL HELPERS: HISTORY JOURNAL **************************************************************
+ **************************************************************************************************/ 
+
+/**
+ * @brief Journal_Rewrite() source: exports the live items, oldest first.
+ * @note Called with the ListMutex held.
+ */
+static void Internal_JournalExport(int Index, sClipboardItem *Item) {
+    Internal_ExportItem(Convert2AllocatedIndex(XCBListSize - 1 - Index), Item);
+}
+
+/**
+ * @brief Rewrites the journal from the live list (one PUSH per item, oldest first).
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_JournalCompact(void) {
+    Journal_Rewrite(Internal_JournalExport, XCBListSize);
+}
+
+/**
+ * @brief Appends a record and compacts the journal once it holds JOURNAL_COMPACT_FACTOR records per slot.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_JournalRecord(enum eJournalOp Op, const sClipboardItem *Item) {
+    if (Journal_Append(Op, Item) == OKE && Journal_GetRecordCount() >= JOURNAL_COMPACT_FACTOR * XCBListCapacity) {
+        Internal_JournalCompact();
+    }
+}
+
+/**
+ * @brief Journals a record describing the item stored in a slot.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_JournalSlot(enum eJournalOp Op, int AllocIdx) {
+    sClipboardItem Item;
+    Internal_ExportItem(AllocIdx, &Item);
+    Internal_JournalRecord(Op, &Item);
+}
+
+/**
+ * @brief Applies one replayed journal record to the RAM list.
+ * @note Called by Journal_Replay() with the ListMutex held.
+ */
+static void Internal_ReplayRecord(enum eJournalOp Op, const sClipboardItem *Item) {
+    int Linear;
+
+    switch (Op) {
+        case eJOURNAL_PUSH:
+            Internal_AppendItem(Item, (int64_t)Item->Timestamp * 1000);
+            break;
+        case eJOURNAL_REMOVE:
+            Linear = Internal_FindByName(Item->Filename);
+            if (Linear >= 0) Internal_RemoveAt(Linear);
+            break;
+        case eJOURNAL_PROMOTE:
+            Linear = Internal_FindByName(Item->Filename);
+            if (Linear >= 0) Internal_MoveToHead(Convert2AllocatedIndex(Linear), (int64_t)Item->Timestamp * 1000);
+            break;
+        case eJOURNAL_CLEAR:
+            Internal_ClearSlots();
+            break;
+        case eJOURNAL_MOVE:
+            Linear = Internal_FindByName(Item->Filename);
+            if (Linear >= 0 && Linear < XCBListSize) {
+                int AllocIdx = Convert2AllocatedIndex(Linear);
+                if (AllocIdx < 0) break;
+                Internal_MarkSlot(AllocIdx);
+                XCBList.Segment[AllocIdx] = Item->Segment;
+                XCBList.SegOffset[AllocIdx] = Item->SegOffset;
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Moves an existing item to the head (index 0) and refreshes its timestamp.
+ * @param AllocIdx Physical ring index of the item to promote.
+ * @note Items newer than the promoted one shift one step older. The file mtime is bumped so
+ *       a later XCBList_Scan() keeps the new order (segment records keep their capture time).
+ *       Assumes the caller holds the ListMutex.
+ */
+static void Internal_PromoteToHead(int AllocIdx) {
+    Internal_MoveToHead(AllocIdx, Internal_NowMs());
+
+    if (XCBList.Segment[HeadIndex] == 0) {
+        char FullPath[PATH_MAX];
+        snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, Internal_Name(HeadIndex));
+        utimes(FullPath, NULL);
+    }
+
+    Internal_JournalSlot(eJOURNAL_PROMOTE, HeadIndex);
+}
+
+/**
+ * @brief Scan order: physical slot indices sorted by the TimeMs column (oldest first).
+ * @note Used ONLY during XCBList_Scan() to set up the buffer chronologically.
+ */
+static int CompareSlotsAsc(const void *a, const void *b) {
+    int SlotA = *(const int *)a, SlotB = *(const int *)b;
+
+    /// Compare times. A smaller time means an older item; ties fall back to the append order of
+    /// segment records, then to the scan order.
+    if (XCBList.TimeMs[SlotA] != XCBList.TimeMs[SlotB]) return (XCBList.TimeMs[SlotA] > XCBList.TimeMs[SlotB]) ? 1 : -1;
+    if (XCBList.Segment[SlotA] != XCBList.Segment[SlotB]) return (XCBList.Segment[SlotA] > XCBList.Segment[SlotB]) ? 1 : -1;
+    if (XCBList.SegOffset[SlotA] != XCBList.SegOffset[SlotB]) return (XCBList.SegOffset[SlotA] > XCBList.SegOffset[SlotB]) ? 1 : -1;
+    return (SlotA > SlotB) - (SlotA < SlotB);
+}
+
+/**
+ * @brief Reorders one column of the first Count slots by Order.
+ */
+static void Internal_PermuteColumn(void *Column, size_t ElemSize, const int *Order, int Count, uint8_t *Scratch) {
+    for (int i = 0; i < Count; i++) {
+        memcpy(Scratch + (size_t)i * ElemSize, (uint8_t *)Column + (size_t)Order[i] * ElemSize, ElemSize);
+    }
+    memcpy(Column, Scratch, (size_t)Count * ElemSize);
+}
+
+/**
+ * @brief Sorts the first XCBListSize slots chronologically (oldest in slot 0).
+ * @return OKE on success, ERR on allocation failure (the slots keep the scan order).
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static RetType Internal_SortSlotsByTime(void) {
+    int *Order = malloc((size_t)XCBListSize * sizeof(int));
+    uint8_t *Scratch = malloc((size_t)XCBListSize * sizeof(uint64_t));
+    if (!Order || !Scratch) {
+        free(Order);
+        free(Scratch);
+        return ERR;
+    }
+
+    for (int i = 0; i < XCBListSize; i++) Order[i] = i;
+    qsort(Order, (size_t)XCBListSize, sizeof(int), CompareSlotsAsc);
+
+    Internal_PermuteColumn(XCBList.Id,        sizeof(*XCBList.Id),        Order, XCBListSize, Scratch);
+    Internal_PermuteColumn(XCBList.TimeMs,    sizeof(*XCBList.TimeMs),    Order, XCBListSize, Scratch);
+    Internal_PermuteColumn(XCBList.Hash,      sizeof(*XCBList.Hash),      Order, XCBListSize, Scratch);
+    Internal_PermuteColumn(XCBList.Size,      sizeof(*XCBList.Size),      Order, XCBListSize, Scratch);
+    Internal_PermuteColumn(XCBList.SegOffset, sizeof(*XCBList.SegOffset), Order, XCBListSize, Scratch);
+    Internal_PermuteColumn(XCBList.Segment,   sizeof(*XCBList.Segment),   Order, XCBListSize, Scratch);
+    Internal_PermuteColumn(XCBList.NameKey,   sizeof(*XCBList.NameKey),   Order, XCBListSize, Scratch);
+    Internal_PermuteColumn(XCBList.Type,      sizeof(*XCBList.Type),      Order, XCBListSize, Scratch);
+    Internal_PermuteColumn(XCBList.Lines,     sizeof(*XCBList.Lines),     Order, XCBListSize, Scratch);
+    Internal_PermuteColumn(XCBList.Name,      sizeof(*XCBList.Name),      Order, XCBListSize, Scratch);
+    Internal_PermuteColumn(XCBList.Preview,   sizeof(*XCBList.Preview),   Order, XCBListSize, Scratch);
+
+    free(Order);
+    free(Scratch);
+    Internal_MarkAllSlots();
+    return OKE;
+}
+
+/**
+ * @brief Deletes the payload of an item leaving the history.
+ * @note Own files are unlinked; segment records are marked released (reclaimed by the compactor).
+ *       This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_DropPayload(int AllocIdx) {
+    if (XCBList.Segment[AllocIdx] != 0) {
+        Segment_Release(XCBList.Segment[AllocIdx], XCBList.SegOffset[AllocIdx]);
+    } else {
+        char FullPath[PATH_MAX];
+        snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, Internal_Name(AllocIdx));
+        if (unlink(FullPath) != 0 && errno != ENOENT) {
+            xWarn("[XCBList] Failed to delete %s: %s", FullPath, strerror(errno));
+        }
+    }
+    FlavourSet_Remove(Internal_Name(AllocIdx));
+    Thumb_Remove(Internal_Name(AllocIdx));
+    Search_Remove(Internal_Name(AllocIdx));
 }
 
 /**
@@ -135,21 +877,26 @@ static RetType Internal_PopOldest(sClipboardItem *Output) {
     /// Since index 0 is the newest, (XCBListSize - 1) is always the oldest logical index.
     int OldestAllocIdx = Convert2AllocatedIndex(XCBListSize - 1);
     if (OldestAllocIdx < 0) return ERR;
-    
-    /// Safely construct the absolute file path targeting the DB directory
-    char FullPath[PATH_MAX];
-    snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, XCBList[OldestAllocIdx].Filename);
 
-    /// If the caller wants to read the deleted item's metadata, copy it out
+    /// Keep the metadata: the caller may want it and the journal needs the filename
+    sClipboardItem Removed;
+    Internal_ExportItem(OldestAllocIdx, &Removed);
     if (Output != NULL) {
-        memcpy(Output, &XCBList[OldestAllocIdx], sizeof(sClipboardItem));
+        memcpy(Output, &Removed, sizeof(sClipboardItem));
     }
 
-    /// Physically delete the file from the hard drive to free up space
-    RemoveDir(FullPath);
+    HashIndex_Remove(OldestAllocIdx);
+    Metrics_Inc(eMET_HISTORY_EVICTED);
+
+    /// Free the payload (file or segment record) and its extra targets to reclaim space
+    Internal_DropPayload(OldestAllocIdx);
 
-    /// Shrink the logical tracking size
+    /// Shrink the logical tracking size and release the slot's filename
     XCBListSize--;
+    if (XCBListSize == 0) HeadIndex = -1;
+    Internal_MarkChanged();
+    Internal_FreeSlot(OldestAllocIdx);
+    Internal_JournalRecord(eJOURNAL_REMOVE, &Removed);
     return OKE;
 }
 
@@ -232,6 +979,32 @@ void GetTimeBasedFilename(char *buffer, size_t size, const char *ext) {
  * PUBLIC LIST IMPLEMENTATION *********************************************************************
  **************************************************************************************************/ 
 
+/**
+ * @brief Adds one segment record found by XCBList_Scan() to the unsorted scan array.
+ * @note A later record with the same name is a compacted copy and replaces the location.
+ *       Once the array is full, the oldest entry makes room for a newer record.
+ *       Called with the ListMutex held (or during initialization).
+ */
+static void Internal_ScanSegmentRecord(const sClipboardItem *Item) {
+    int64_t TimeMs = (int64_t)Item->Timestamp * 1000;
+    uint32_t Key = Internal_NameKey(Item->Filename);
+    int Oldest = 0;
+    for (int i = 0; i < XCBListSize; i++) {
+        if (XCBList.NameKey[i] == Key && strcmp(Internal_Name(i), Item->Filename) == 0) {
+            Internal_MarkSlot(i);
+            XCBList.Segment[i] = Item->Segment;
+            XCBList.SegOffset[i] = Item->SegOffset;
+            return;
+        }
+        if (CompareSlotsAsc(&i, &Oldest) < 0) Oldest = i;
+    }
+    if (XCBListSize < XCBListCapacity) {
+        Internal_StoreItem(XCBListSize++, Item, TimeMs);
+    } else if (XCBList.TimeMs[Oldest] <= TimeMs && XCBList.Segment[Oldest] != 0) {
+        Internal_StoreItem(Oldest, Item, TimeMs);
+    }
+}
+
 /**
  * @brief Scans the database directory and rebuilds the ring buffer.
  * @param WithNoLock If 1, bypasses mutex locking (useful during initialization).
@@ -246,11 +1019,12 @@ int XCBList_Scan(int WithNoLock) {
     struct stat FileStat;
     char FullPath[PATH_MAX];
     
-    /// Completely reset the ring buffer state before scanning
-    XCBListSize = 0;
-    HeadIndex = -1; 
+    /// Completely reset the ring buffer state before scanning.
+    /// Until the final sort, slots 0..XCBListSize-1 are filled in scan order.
+    Internal_ClearSlots();
 
-    if (DirStream == NULL) {
+    if (DirStream == NULL || Internal_EnsureCapacity() != OKE) {
+        if (DirStream) closedir(DirStream);
         if (!WithNoLock) UnlockList();
         return ERR;
     }
@@ -259,77 +1033,212 @@ int XCBList_Scan(int WithNoLock) {
     while ((Entry = readdir(DirStream)) != NULL) {
         /// Ignore hidden files or current/parent directory links (".", "..")
         if (Entry->d_name[0] == '.') continue;
+
+        /// Flavour containers belong to an item; they are not history entries themselves
+        if (FlavourSet_IsSidecarName(Entry->d_name)) continue;
         
         /// Construct the absolute path to access the file's metadata
         snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, Entry->d_name);
         
         /// If we haven't reached the memory limit, load the file into the buffer
-        if (XCBListSize < MAX_HISTORY_ITEMS) {
+        if (XCBListSize < XCBListCapacity) {
             if (stat(FullPath, &FileStat) == 0) {
-                /// [LEGACY] strncpy(XCBList[XCBListSize].Filename, Entry->d_name, NAME_MAX);
-                /// [LEGACY] XCBList[XCBListSize].Filename[NAME_MAX] = '\0';
-                snprintf(XCBList[XCBListSize].Filename, NAME_MAX+1, "%s", Entry->d_name);
-                
+                sClipboardItem Item;
+                memset(&Item, 0, sizeof(Item));
+                snprintf(Item.Filename, NAME_MAX+1, "%s", Entry->d_name);
+                Item.FileType = GetFileTypeFromName(Entry->d_name);
+                Item.ContentSize = (uint64_t)FileStat.st_size;
+
                 /// Save the modification time so we can sort chronologically later
-                XCBList[XCBListSize].Timestamp = FileStat.st_mtime;
-                XCBList[XCBListSize].FileType = GetFileTypeFromName(Entry->d_name);
-                XCBListSize++;
+                Internal_StoreItem(XCBListSize++, &Item, (int64_t)FileStat.st_mtim.tv_sec * 1000 + FileStat.st_mtim.tv_nsec / 1000000);
             }
         } else {
             /// If the DB has more files than allowed, purge the excess files from disk
-            RemoveDir(FullPath); 
+            unlink(FullPath);
+            FlavourSet_Remove(Entry->d_name);
+            Thumb_Remove(Entry->d_name);
+            Search_Remove(Entry->d_name);
         }
     }
     closedir(DirStream);
 
+    /// Small text items live in segment records rather than files
+    Segment_ForEachRecord(Internal_ScanSegmentRecord);
+
     /// If we found valid files, we must re-establish the chronological Ring Buffer order
     if (XCBListSize > 0) {
         /// Sort the loaded items from oldest to newest based on their timestamp
-        qsort(XCBList, XCBListSize, sizeof(sClipboardItem), CompareItemsAsc);
+        Internal_SortSlotsByTime();
         
         /// Set HeadIndex to point to the last element (the newest item in the sorted array)
         HeadIndex = XCBListSize - 1; 
     }
 
+    /// Rebuild the menu previews of the kept text items (the directory does not store them)
+    for (int i = 0; i < XCBListSize; i++) {
+        sClipboardItem Item;
+        Internal_ExportItem(i, &Item);
+        if (Item.FileType != eFMT_TXT || Preview_FromStore(&Item) != OKE) continue;
+        Internal_MarkSlot(i);
+        XCBList.Lines[i] = Item.Lines;
+        if (Item.Preview[0] != '\0') XCBList.Preview[i] = strdup(Item.Preview);
+    }
+
+    /// Scanned items have no known hash yet; only fresh captures are indexed
+    HashIndex_Rebuild();
+
+    /// The directory is the recovery source of truth: restart the journal from it
+    Internal_JournalCompact();
+
     if (!WithNoLock) UnlockList();
+    else Internal_PublishSnapshot();
     return XCBListSize;
 }
 
+/**
+ * @brief Restores the list by replaying the history journal; scans the directory if it is unusable.
+ * @return The number of items loaded into the RAM list, or ERR on failure.
+ */
+int XCBList_Load(void) {
+    xEntry1("XCBList_Load");
+    LockList();
+
+    Internal_ClearSlots();
+    XCBList_SelectedItem = -1;
+    if (Internal_EnsureCapacity() != OKE) {
+        UnlockList();
+        return ERR;
+    }
+
+    if (Journal_Replay(Internal_ReplayRecord) == OKE) {
+        HashIndex_Rebuild();
+        if (Journal_GetRecordCount() >= JOURNAL_COMPACT_FACTOR * XCBListCapacity) Internal_JournalCompact();
+
+        int Size = XCBListSize;
+        UnlockList();
+        xLog1("[XCBList_Load] %d items restored from the journal.", Size);
+        return Size;
+    }
+    UnlockList();
+
+    xWarn("[XCBList_Load] No usable journal at %s. Scanning %s.", PATH_ITEM, PATH_DIR_DB);
+    return XCBList_Scan(0);
+}
+
 /**
  * @brief Pushes a new item into the ring buffer. Evicts the oldest if full.
  * @param Path The path or filename to be added.
  * @return OKE on success, ERR on invalid path.
  */
 RetType XCBList_PushItem(char Path[]) {
+    return XCBList_PushItemWithHash(Path, 0, 0, NULL, 0);
+}
+
+/**
+ * @brief Pushes a new item, or promotes an existing item with identical content to the head.
+ * @param Path The path or filename to be added.
+ * @param ContentHash Hash of the payload (0 = unknown, no deduplication).
+ * @param ContentSize Payload size in bytes.
+ * @param Segment Segment holding the payload (0 = own file in PATH_DIR_DB).
+ * @param SegOffset Record offset inside the segment.
+ * @param Preview Menu preview built at capture time (NULL = none).
+ * @param Lines Line count of the payload (0 = unknown).
+ * @param TimeMs Capture time of the item (0 = now). Set before the PUSH record is journaled.
+ * @return OKE if pushed, ERR_ALREADY_EXISTS if a duplicate was promoted, ERR on invalid path.
+ */
+static RetType Internal_PushItem(char Path[], uint64_t ContentHash, uint64_t ContentSize, uint32_t Segment, uint64_t SegOffset,
+                                 const char *Preview, uint32_t Lines, int64_t TimeMs) {
     char CleanName[256];
 
-    xEntry1("XCBList_PushItem(%s)", Path);
+    xEntry1("XCBList_PushItem(%s, %016llx, %u)", Path, (unsigned long long)ContentHash, Segment);
 
     /// Extract just the filename to avoid saving absolute paths in the DB
     if (GetFileNameFromPath(Path, CleanName, sizeof(CleanName)) != OKE) return ERR;
 
+    enum XCBFileType FileType = GetFileTypeFromName(CleanName);
+
+    sClipboardItem NewItem;
+    memset(&NewItem, 0, sizeof(NewItem));
+    snprintf(NewItem.Filename, NAME_MAX + 1, "%s", CleanName);
+    NewItem.FileType = FileType;
+    NewItem.ContentHash = ContentHash;
+    NewItem.ContentSize = ContentSize;
+    NewItem.Segment = Segment;
+    NewItem.SegOffset = SegOffset;
+    NewItem.Lines = Lines;
+    if (Preview) snprintf(NewItem.Preview, sizeof(NewItem.Preview), "%s", Preview);
+
     LockList();
+    if (Internal_EnsureCapacity() != OKE) {
+        UnlockList();
+        return ERR;
+    }
+
+    /// A hash match is only a candidate: the bytes are compared outside the lock,
+    /// then the match is looked up again in case the list changed meanwhile
+    uint64_t CheckedId = 0;
+    int Same = 0;
+    int DupIdx;
+    while ((DupIdx = HashIndex_Find(ContentHash, ContentSize, FileType)) >= 0 && XCBList.Id[DupIdx] != CheckedId) {
+        sClipboardItem Dup;
+        Internal_ExportItem(DupIdx, &Dup);
+        UnlockList();
+        Same = Internal_SamePayload(&NewItem, &Dup);
+        LockList();
+        CheckedId = Dup.Id;
+        if (Internal_EnsureCapacity() != OKE) {
+            UnlockList();
+            return ERR;
+        }
+    }
+
+    /// Identical payload already in history: bring it to the front instead of storing a clone
+    if (DupIdx >= 0 && Same) {
+        xLog1("[XCBList] %s duplicates %s. Promoting existing item.", CleanName, Internal_Name(DupIdx));
+        Internal_PromoteToHead(DupIdx);
+        UnlockList();
+        Metrics_Inc(eMET_CAPTURE_DEDUP);
+        return ERR_ALREADY_EXISTS;
+    }
+    if (DupIdx >= 0) xWarn("[XCBList] %s collides with the hash of %s. Keeping both.", CleanName, Internal_Name(DupIdx));
     
     /// If the buffer has reached maximum capacity, pop the oldest item to make space
-    if (XCBListSize >= MAX_HISTORY_ITEMS) {
+    if (XCBListSize >= XCBListCapacity) {
         Internal_PopOldest(NULL); 
     }
 
-    /// Advance the HeadIndex circularly. If it reaches the end, it wraps back to 0.
-    HeadIndex = (HeadIndex + 1) % MAX_HISTORY_ITEMS;
-
-    /// Store the new item's metadata at the newly allocated HeadIndex
-    /// [LEGACY]strncpy(XCBList[HeadIndex].Filename, CleanName, NAME_MAX);
-    snprintf(XCBList[HeadIndex].Filename, NAME_MAX + 1, "%s", CleanName);
-    XCBList[HeadIndex].Filename[NAME_MAX] = '\0';
-    XCBList[HeadIndex].Timestamp = time(NULL);
-    XCBList[HeadIndex].FileType = GetFileTypeFromName(CleanName);
+    /// Store the new item's metadata as the newest entry
+    Internal_AppendItem(&NewItem, (TimeMs != 0) ? TimeMs : Internal_NowMs());
 
-    XCBListSize++;
+    HashIndex_Insert(HeadIndex);
+    Internal_JournalSlot(eJOURNAL_PUSH, HeadIndex);
     UnlockList();
     return OKE;
 }
 
+/**
+ * @brief Pushes a new item, or promotes an existing item with identical content to the head.
+ * @param Path The path or filename to be added.
+ * @param ContentHash Hash of the payload (0 = unknown, no deduplication).
+ * @param ContentSize Payload size in bytes.
+ * @param Preview Menu preview built at capture time (NULL = none).
+ * @param Lines Line count of the payload (0 = unknown).
+ * @return OKE if pushed, ERR_ALREADY_EXISTS if a duplicate was promoted, ERR on invalid path.
+ */
+RetType XCBList_PushItemWithHash(char Path[], uint64_t ContentHash, uint64_t ContentSize, const char *Preview, uint32_t Lines) {
+    return Internal_PushItem(Path, ContentHash, ContentSize, 0, 0, Preview, Lines, 0);
+}
+
+/**
+ * @brief Pushes an item stored in a segment record, or promotes an identical item to the head.
+ * @return OKE if pushed, ERR_ALREADY_EXISTS if a duplicate was promoted, ERR on invalid input.
+ */
+RetType XCBList_PushSegmentItem(char Path[], uint64_t ContentHash, uint64_t ContentSize, uint32_t Segment, uint64_t SegOffset,
+                                const char *Preview, uint32_t Lines) {
+    if (Segment == 0) return ERR;
+    return Internal_PushItem(Path, ContentHash, ContentSize, Segment, SegOffset, Preview, Lines, 0);
+}
+
 /**
  * @brief Checks if a file exists on disk before pushing it to the list.
  * @param Path The filename to be verified and added.
@@ -346,14 +1255,8 @@ RetType XCBList_PushItemWithExistCheck(char Path[]) {
     /// Verify physical file presence on the disk
     if (stat(FullPath, &FileStat) != 0) return ERR;
 
-    /// Delegate the insertion logic to the standard Push function
-    XCBList_PushItem(CleanName);
-
-    /// Override the generated timestamp with the actual file modification time
-    LockList();
-    XCBList[HeadIndex].Timestamp = FileStat.st_mtime;
-    UnlockList();
-    return OKE;
+    /// Stamp the item with the file modification time, so the journal replays the order seen live
+    return Internal_PushItem(CleanName, 0, 0, 0, 0, NULL, 0, (int64_t)FileStat.st_mtime * 1000);
 }
 
 /**
@@ -387,7 +1290,7 @@ RetType XCBList_GetItem(int n, sClipboardItem *Output) {
     
     /// Copy the metadata out to the caller's buffer
     if (Output != NULL) {
-        memcpy(Output, &XCBList[AllocIdx], sizeof(sClipboardItem));
+        Internal_ExportItem(AllocIdx, Output);
     }
     UnlockList();
     return OKE;
@@ -415,6 +1318,44 @@ int XCBList_GetItemSize(void) {
     return Size;
 }
 
+/**
+ * @brief Gets the number of items the history can hold before evicting the oldest.
+ * @return The capacity (MAX_HISTORY_ITEMS until XCBList_SetCapacity() is called).
+ */
+int XCBList_GetCapacity(void) {
+    int Capacity;
+    LockList();
+    Capacity = (XCBListCapacity > 0) ? XCBListCapacity : MAX_HISTORY_ITEMS;
+    UnlockList();
+    return Capacity;
+}
+
+/**
+ * @brief Grows or shrinks the history to Capacity items.
+ * @param Capacity The new number of slots (>= 1).
+ * @return OKE on success, ERR_OVERFLOW if Capacity is out of range, ERR on allocation failure.
+ * @note Shrinking evicts the oldest items (payloads included) until the list fits.
+ */
+RetType XCBList_SetCapacity(int Capacity) {
+    xEntry1("XCBList_SetCapacity(%d)", Capacity);
+    if (Capacity < 1 || Capacity > (INT_MAX / 2)) return ERR_OVERFLOW;
+
+    LockList();
+    while (XCBListSize > Capacity) Internal_PopOldest(NULL);
+
+    RetType Ret = Internal_Resize(Capacity);
+    if (Ret != OKE) {
+        xError("[XCBList] Cannot allocate %d history slots.", Capacity);
+    } else if (Journal_GetRecordCount() >= JOURNAL_COMPACT_FACTOR * XCBListCapacity) {
+        Internal_JournalCompact();
+    }
+    if (XCBList_SelectedItem >= XCBListSize) XCBList_SelectedItem = XCBListSize - 1;
+    UnlockList();
+
+    xExit1("XCBList_SetCapacity");
+    return Ret;
+}
+
 /**
  * @brief Reads the binary content of a file corresponding to a logical index.
  * @param n The logical index of the item.
@@ -424,52 +1365,40 @@ int XCBList_GetItemSize(void) {
  */
 RetType XCBList_ReadAsBinary(int n, void* Output, int MaxOutputSize) {
     xEntry1("XCBList_ReadAsBinary(%d, %p, %d)", n, Output, MaxOutputSize);
+
+    /// Pinned before the item is resolved: the compactor keeps the segment it points into until released
+    const sXCBListSnapshot *Pin = XCBList_AcquireSnapshot();
     LockList();
     
     /// Find exactly where this item's metadata sits in the array
     int AllocIdx = Convert2AllocatedIndex(n);
     if (AllocIdx < 0) { 
         UnlockList(); 
+        XCBList_ReleaseSnapshot(Pin);
         return ERR_OVERFLOW; 
     }
     
-    /// Reconstruct the absolute path to the physical file
-    char FullPath[PATH_MAX];
-    snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, XCBList[AllocIdx].Filename);
+    sClipboardItem Item;
+    Internal_ExportItem(AllocIdx, &Item);
     UnlockList();
 
-    xLog1("[XCBList_ReadAsBinary] FullPath=%s", FullPath);
+    xLog1("[XCBList_ReadAsBinary] Item=%s (segment %u)", Item.Filename, Item.Segment);
 
-    /// Open file in Read Binary mode
-    FILE *f = fopen(FullPath, "rb");
-    if (!f) return ERR;
-    
-    /// If the caller passed NULL, they just wanted to verify if the file is readable
+    /// If the caller passed NULL, they just wanted to verify if the payload is readable
     if (Output == NULL) { 
-        fclose(f); 
-        return OKE; 
+        RetType Ret = (Codec_ItemGetPayloadSize(&Item) >= 0) ? OKE : ERR;
+        XCBList_ReleaseSnapshot(Pin);
+        return Ret; 
     }
 
-    /// Jump to the end of the file to determine its byte size
-    fseek(f, 0, SEEK_END);
-    long FileSize = ftell(f);
-    /// Rewind the cursor back to the start for reading
-    rewind(f);
-
-    /// Prevent memory corruption by rejecting oversized files
-    if (FileSize > (long)MaxOutputSize) { 
-        fclose(f); 
-        return ERR; 
-    }
-    
-    /// Read the entire file content into the user-provided buffer in one go
-    size_t ReadSize = fread(Output, 1, FileSize, f);
-    fclose(f);
+    /// Decode the payload (compressed, raw or segment record) straight into the caller's buffer.
+    /// Payloads larger than MaxOutputSize are rejected to prevent memory corruption.
+    int64_t ReadSize = Codec_ItemRead(&Item, Output, (MaxOutputSize > 0) ? (size_t)MaxOutputSize : 0);
+    XCBList_ReleaseSnapshot(Pin);
 
-    xLog1("[XCBList_ReadAsBinary] ReadSize=%ld", ReadSize);
+    xLog1("[XCBList_ReadAsBinary] ReadSize=%lld", (long long)ReadSize);
     
-    /// Ensure we read exactly the number of bytes we expected
-    return (ReadSize == (size_t)FileSize) ? OKE : ERR;
+    return (ReadSize >= 0) ? OKE : ERR;
 }
 
 /**
@@ -535,13 +1464,414 @@ int XCBList_GetSelectedItem(sClipboardItem *Output) {
     
     /// 3. Copy metadata if Output pointer is provided
     if (Output != NULL) {
-        memcpy(Output, &XCBList[AllocIdx], sizeof(sClipboardItem));
+        Internal_ExportItem(AllocIdx, Output);
     }
     
     UnlockList();
     return OKE;
 }
 
+/**
+ * @brief Finds the logical index of the item stored under a filename.
+ * @param Name The filename to look for.
+ * @return The logical index, or -1 if not found.
+ */
+int XCBList_FindByName(const char *Name) {
+    if (!Name) return -1;
+
+    LockList();
+    int Found = Internal_FindByName(Name);
+    UnlockList();
+    return Found;
+}
+
+/**
+ * @brief Finds an item by its runtime id.
+ * @param Id The id to look for.
+ * @return The logical index (0 = newest), or -1 if no item has that id.
+ */
+int XCBList_FindById(uint64_t Id) {
+    int Found = -1;
+
+    LockList();
+    for (int i = 0; i < XCBListSize; i++) {
+        if (XCBList.Id[Convert2AllocatedIndex(i)] == Id) {
+            Found = i;
+            break;
+        }
+    }
+    UnlockList();
+    return Found;
+}
+
+/**************************************************************************************************
+ * PUBLIC SNAPSHOT API ****************************************************************************
+ **************************************************************************************************/ 
+
+/**
+ * @brief Returns the list version (lock-free).
+ */
+uint64_t XCBList_GetVersion(void) {
+    return atomic_load_explicit(&XCBListVersion, memory_order_acquire);
+}
+
+/**
+ * @brief Copies a range of items under a single lock acquisition.
+ * @param Start The first logical index (0 = newest).
+ * @param Count Number of items wanted.
+ * @param Output Destination array.
+ * @param Version Optional, receives the version of the copied items.
+ * @return The number of items copied, or ERR on invalid arguments.
+ */
+int XCBList_ReadRange(int Start, int Count, sClipboardItem *Output, uint64_t *Version) {
+    if (Start < 0 || Count < 0 || (Count > 0 && Output == NULL)) return ERR;
+
+    LockList();
+    int Copied = 0;
+    for (int i = Start; i < XCBListSize && Copied < Count; i++) {
+        Internal_ExportItem(Convert2AllocatedIndex(i), &Output[Copied++]);
+    }
+    if (Version) *Version = XCBList_GetVersion();
+    UnlockList();
+    return Copied;
+}
+
+/**
+ * @brief Drops one reference to a chunk; the last one frees it. NULL is ignored.
+ */
+static void Internal_ChunkUnref(const sXCBListRow *Rows) {
+    if (!Rows) return;
+    sSnapshotChunk *Chunk = (sSnapshotChunk *)((uint8_t *)Rows - offsetof(sSnapshotChunk, Rows));
+    if (atomic_fetch_sub_explicit(&Chunk->Refs, 1, memory_order_acq_rel) == 1) free(Chunk);
+}
+
+/**
+ * @brief Drops one reference to a snapshot; the last one frees it and releases its chunks.
+ */
+static void Internal_SnapshotUnref(sSnapshotBlock *Block) {
+    if (!Block || atomic_fetch_sub_explicit(&Block->Refs, 1, memory_order_acq_rel) != 1) return;
+
+    pthread_mutex_lock(&SnapshotMutex);
+    if (Block->LivePrev) Block->LivePrev->LiveNext = Block->LiveNext;
+    else SnapshotLive = Block->LiveNext;
+    if (Block->LiveNext) Block->LiveNext->LivePrev = Block->LivePrev;
+    pthread_mutex_unlock(&SnapshotMutex);
+
+    int ChunkCount = (Block->Public.Capacity + SNAPSHOT_CHUNK_ROWS - 1) >> SNAPSHOT_CHUNK_SHIFT;
+    for (int k = 0; k < ChunkCount; k++) Internal_ChunkUnref(Block->ChunkRows[k]);
+    free(Block);
+}
+
+/**
+ * @brief Copies the slots of one chunk into one allocation: header, rows, then the filenames and previews.
+ * @param Rows Receives the rows (one reference), or NULL if no slot of the chunk is live.
+ * @return OKE on success, ERR on allocation failure.
+ * @note This function assumes the caller has already locked the ListMutex.
+ */
+static RetType Internal_BuildChunk(int ChunkIdx, const sXCBListRow **Rows) {
+    int First = ChunkIdx << SNAPSHOT_CHUNK_SHIFT;
+    int Last = (First + SNAPSHOT_CHUNK_ROWS < XCBListCapacity) ? First + SNAPSHOT_CHUNK_ROWS : XCBListCapacity;
+
+    /// Only live slots are ever read back; a chunk without any is not stored at all
+    size_t NamesLen = 0;
+    int Live = 0;
+    for (int Slot = First; Slot < Last; Slot++) {
+        int Linear = Convert2LinearIndex(Slot);
+        if (Linear < 0 || Linear >= XCBListSize) continue;
+        NamesLen += strlen(Internal_Name(Slot)) + strlen(Internal_Preview(Slot)) + 2;
+        Live++;
+    }
+    *Rows = NULL;
+    if (Live == 0) return OKE;
+
+    sSnapshotChunk *Chunk = malloc(sizeof(sSnapshotChunk) + (size_t)(Last - First) * sizeof(sXCBListRow) + NamesLen);
+    if (!Chunk) return ERR;
+    atomic_init(&Chunk->Refs, 1);
+
+    char *Names = (char *)(Chunk->Rows + (Last - First));
+    for (int Slot = First; Slot < Last; Slot++) {
+        sXCBListRow *Row = &Chunk->Rows[Slot - First];
+        int Linear = Convert2LinearIndex(Slot);
+        if (Linear < 0 || Linear >= XCBListSize) {
+            memset(Row, 0, sizeof(*Row));
+            Row->Name = Row->Preview = "";
+            continue;
+        }
+        size_t Len = strlen(Internal_Name(Slot)) + 1;
+        size_t PreviewLen = strlen(Internal_Preview(Slot)) + 1;
+        memcpy(Names, Internal_Name(Slot), Len);
+        memcpy(Names + Len, Internal_Preview(Slot), PreviewLen);
+
+        Row->Id = XCBList.Id[Slot];
+        Row->TimeMs = XCBList.TimeMs[Slot];
+        Row->ContentHash = XCBList.Hash[Slot];
+        Row->ContentSize = XCBList.Size[Slot];
+        Row->SegOffset = XCBList.SegOffset[Slot];
+        Row->Segment = XCBList.Segment[Slot];
+        Row->FileType = (enum XCBFileType)XCBList.Type[Slot];
+        Row->Lines = XCBList.Lines[Slot];
+        Row->Name = Names;
+        Row->Preview = Names + Len;
+        Names += Len + PreviewLen;
+    }
+    *Rows = Chunk->Rows;
+    return OKE;
+}
+
+/**
+ * @brief Publishes the changes made since the last publication as a new snapshot.
+ * @note Chunks nobody wrote to are shared with the previous snapshot, so a push costs one chunk copy
+ *       plus the chunk table. On allocation failure the changes stay pending (retried by the next
+ *       writer, or by the next reader through SnapshotStale).
+ *       This function assumes the caller has already locked the ListMutex.
+ */
+static void Internal_PublishSnapshot(void) {
+    if (!SnapshotPending) return;
+
+    int ChunkCount = (XCBListCapacity + SNAPSHOT_CHUNK_ROWS - 1) >> SNAPSHOT_CHUNK_SHIFT;
+    if (ChunkCount != SnapshotDirtyCount) {
+        uint8_t *Dirty = realloc(SnapshotDirty, (ChunkCount > 0) ? (size_t)ChunkCount : 1);
+        if (!Dirty) {
+            atomic_store(&SnapshotStale, 1);
+            return;
+        }
+        SnapshotDirty = Dirty;
+        SnapshotDirtyCount = ChunkCount;
+        SnapshotAllDirty = 1;
+    }
+
+    /// SnapshotPublished only changes under the ListMutex, which we hold
+    sSnapshotBlock *Prev = SnapshotPublished;
+    int Reuse = Prev && !SnapshotAllDirty && Prev->Public.Capacity == XCBListCapacity;
+
+    sSnapshotBlock *Block = malloc(sizeof(sSnapshotBlock) + (size_t)ChunkCount * sizeof(const sXCBListRow *));
+    if (!Block) {
+        atomic_store(&SnapshotStale, 1);
+        return;
+    }
+    for (int k = 0; k < ChunkCount; k++) {
+        if (Reuse && !SnapshotDirty[k]) {
+            Block->ChunkRows[k] = Prev->ChunkRows[k];
+            if (Block->ChunkRows[k]) {
+                sSnapshotChunk *Chunk = (sSnapshotChunk *)((uint8_t *)Block->ChunkRows[k] - offsetof(sSnapshotChunk, Rows));
+                atomic_fetch_add_explicit(&Chunk->Refs, 1, memory_order_relaxed);
+            }
+        } else if (Internal_BuildChunk(k, &Block->ChunkRows[k]) != OKE) {
+            for (int j = 0; j < k; j++) Internal_ChunkUnref(Block->ChunkRows[j]);
+            free(Block);
+            xError("[XCBList] Out of memory publishing a snapshot!");
+            atomic_store(&SnapshotStale, 1);
+            return;
+        }
+    }
+
+    atomic_init(&Block->Refs, 1);
+    Block->Public.Version = XCBList_GetVersion();
+    Block->Public.Count = XCBListSize;
+    Block->Public.Head = (HeadIndex >= 0) ? HeadIndex : 0;
+    Block->Public.Capacity = XCBListCapacity;
+    Block->Public.Chunks = Block->ChunkRows;
+
+    if (ChunkCount > 0) memset(SnapshotDirty, 0, (size_t)ChunkCount);
+    SnapshotAllDirty = 0;
+    SnapshotPending = 0;
+
+    pthread_mutex_lock(&SnapshotMutex);
+    Block->LivePrev = NULL;
+    Block->LiveNext = SnapshotLive;
+    if (SnapshotLive) SnapshotLive->LivePrev = Block;
+    SnapshotLive = Block;
+    SnapshotPublished = Block;
+    pthread_mutex_unlock(&SnapshotMutex);
+    atomic_store(&SnapshotStale, 0);
+    Internal_SnapshotUnref(Prev);
+}
+
+/**
+ * @brief Takes a reference to the published snapshot.
+ * @return The snapshot, or NULL if none was published yet.
+ */
+static sSnapshotBlock *Internal_TakePublished(void) {
+    pthread_mutex_lock(&SnapshotMutex);
+    sSnapshotBlock *Block = SnapshotPublished;
+    if (Block) atomic_fetch_add_explicit(&Block->Refs, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&SnapshotMutex);
+    return Block;
+}
+
+/**
+ * @brief Returns the published snapshot (one reference bump).
+ * @return The snapshot, or NULL on allocation failure.
+ */
+const sXCBListSnapshot *XCBList_AcquireSnapshot(void) {
+    /// Writers publish before unlocking: normally the reader only takes a reference
+    if (atomic_load(&SnapshotStale)) {
+        /// Nothing published yet, or the last publication ran out of memory: retry it
+        LockList();
+        UnlockList();
+    }
+
+    sSnapshotBlock *Block = Internal_TakePublished();
+    if (!Block) {
+        xError("[XCBList] No snapshot available!");
+        return NULL;
+    }
+    return &Block->Public;
+}
+
+/**
+ * @brief Drops a snapshot reference.
+ */
+void XCBList_ReleaseSnapshot(const sXCBListSnapshot *Snapshot) {
+    if (!Snapshot) return;
+    Internal_SnapshotUnref((sSnapshotBlock *)((uint8_t *)Snapshot - offsetof(sSnapshotBlock, Public)));
+}
+
+/**
+ * @brief Scans the live snapshots for the oldest version.
+ */
+uint64_t XCBList_GetOldestSnapshotVersion(void) {
+    uint64_t Oldest = UINT64_MAX;
+    pthread_mutex_lock(&SnapshotMutex);
+    for (sSnapshotBlock *Block = SnapshotLive; Block; Block = Block->LiveNext) {
+        if (Block->Public.Version < Oldest) Oldest = Block->Public.Version;
+    }
+    pthread_mutex_unlock(&SnapshotMutex);
+    return Oldest;
+}
+
+/**
+ * @brief Maps a snapshot row to its ring slot, then to its chunk.
+ */
+const sXCBListRow *XCBList_SnapshotRow(const sXCBListSnapshot *Snapshot, int n) {
+    int Slot = (Snapshot->Head - n + Snapshot->Capacity) % Snapshot->Capacity;
+    return &Snapshot->Chunks[Slot >> SNAPSHOT_CHUNK_SHIFT][Slot & (SNAPSHOT_CHUNK_ROWS - 1)];
+}
+
+/**
+ * @brief Expands a snapshot row into an sClipboardItem.
+ * @return OKE on success, ERR if n is out of bounds.
+ */
+RetType XCBList_SnapshotGetItem(const sXCBListSnapshot *Snapshot, int n, sClipboardItem *Output) {
+    if (!Snapshot || !Output || n < 0 || n >= Snapshot->Count) return ERR;
+
+    const sXCBListRow *Row = XCBList_SnapshotRow(Snapshot, n);
+    memset(Output, 0, sizeof(*Output));
+    snprintf(Output->Filename, NAME_MAX + 1, "%s", Row->Name);
+    Output->Id = Row->Id;
+    Output->Timestamp = (time_t)(Row->TimeMs / 1000);
+    Output->FileType = Row->FileType;
+    Output->ContentHash = Row->ContentHash;
+    Output->ContentSize = Row->ContentSize;
+    Output->Segment = Row->Segment;
+    Output->SegOffset = Row->SegOffset;
+    Output->Lines = Row->Lines;
+    snprintf(Output->Preview, sizeof(Output->Preview), "%s", Row->Preview);
+    return OKE;
+}
+
+/**
+ * @brief Removes one item from the ring buffer and deletes its file.
+ * @param n The logical index of the item.
+ * @return OKE on success, ERR if the index is out of bounds.
+ */
+RetType XCBList_DeleteItem(int n) {
+    xEntry1("XCBList_DeleteItem(%d)", n);
+    LockList();
+
+    int AllocIdx = Convert2AllocatedIndex(n);
+    if (AllocIdx < 0) {
+        UnlockList();
+        return ERR;
+    }
+
+    Internal_DropPayload(AllocIdx);
+    sClipboardItem Removed;
+    Internal_ExportItem(AllocIdx, &Removed);
+
+    /// Close the gap: every older item moves one step towards the head
+    Internal_RemoveAt(n);
+    Internal_JournalRecord(eJOURNAL_REMOVE, &Removed);
+
+    if (XCBList_SelectedItem == n) XCBList_SelectedItem = -1;
+    else if (XCBList_SelectedItem > n) XCBList_SelectedItem--;
+
+    UnlockList();
+
+    xExit1("XCBList_DeleteItem");
+    return OKE;
+}
+
+/**
+ * @brief Collects the record offsets of every item stored in a segment, sorted ascending.
+ */
+int XCBList_GetSegmentOffsets(uint32_t Segment, uint64_t **Offsets) {
+    *Offsets = NULL;
+    LockList();
+
+    int Count = 0;
+    for (int i = 0; i < XCBListSize; i++) {
+        if (XCBList.Segment[Convert2AllocatedIndex(i)] == Segment) Count++;
+    }
+    if (Count > 0) {
+        *Offsets = malloc((size_t)Count * sizeof(uint64_t));
+        if (!*Offsets) {
+            UnlockList();
+            return -1;
+        }
+        int n = 0;
+        for (int i = 0; i < XCBListSize; i++) {
+            int AllocIdx = Convert2AllocatedIndex(i);
+            if (XCBList.Segment[AllocIdx] == Segment) (*Offsets)[n++] = XCBList.SegOffset[AllocIdx];
+        }
+    }
+    UnlockList();
+
+    /// Insertion sort: offsets mostly follow capture order already
+    for (int i = 1; i < Count; i++) {
+        uint64_t Key = (*Offsets)[i];
+        int j = i - 1;
+        while (j >= 0 && (*Offsets)[j] > Key) {
+            (*Offsets)[j + 1] = (*Offsets)[j];
+            j--;
+        }
+        (*Offsets)[j + 1] = Key;
+    }
+    return Count;
+}
+
+/**
+ * @brief Points an item at a new copy of its segment record and journals the move.
+ */
+RetType XCBList_Relocate(const char *Name, uint32_t OldSegment, uint64_t OldOffset, uint32_t NewSegment, uint64_t NewOffset) {
+    if (!Name) return ERR_NULL;
+    LockList();
+
+    int Linear = Internal_FindByName(Name);
+    int AllocIdx = (Linear >= 0) ? Convert2AllocatedIndex(Linear) : -1;
+    if (AllocIdx < 0 || XCBList.Segment[AllocIdx] != OldSegment || XCBList.SegOffset[AllocIdx] != OldOffset) {
+        UnlockList();
+        return ERR;
+    }
+    XCBList.Segment[AllocIdx] = NewSegment;
+    XCBList.SegOffset[AllocIdx] = NewOffset;
+    Internal_MarkSlot(AllocIdx);
+    Internal_JournalSlot(eJOURNAL_MOVE, AllocIdx);
+
+    UnlockList();
+    return OKE;
+}
+
+/**
+ * @brief Flushes the history journal to disk.
+ */
+RetType XCBList_Sync(void) {
+    LockList();
+    RetType Ret = Journal_Sync();
+    UnlockList();
+    return Ret;
+}
+
 /**
  * @brief Clears all clipboard items from both RAM and physical storage.
  */
@@ -571,14 +1901,21 @@ int XCBList_ClearAllItems(void) {
         UnlockList();
         return ERR;
     }
+    if (Segment_RemoveAll() != OKE) {
+        xError("[XCBList] Failed to remove the segment files!");
+    }
+    if (Thumb_RemoveAll() != OKE) {
+        xError("[XCBList] Failed to remove the thumbnails!");
+    }
+    if (Search_RemoveAll() != OKE) {
+        xError("[XCBList] Failed to remove the search index!");
+    }
 
-    /// 4. Reset internal RAM state (Circle Buffer indicators)
-    XCBListSize = 0;
-    HeadIndex   = -1;
+    /// 4. Reset internal RAM state (Circle Buffer indicators) and release the filenames
+    Internal_ClearSlots();
     XCBList_SelectedItem = -1;
-    
-    /// Optional: Clean the memory array (though not strictly required for a ring buffer)
-    memset(XCBList, 0, sizeof(XCBList));
+    HashIndex_Reset();
+    Internal_JournalRecord(eJOURNAL_CLEAR, NULL);
 
     UnlockList();
     
@@ -732,30 +2069,18 @@ RetType EnsureDB(void){
     RetVal = EnsureDir(PATH_DIR_DB);
     if(RetVal != OKE) return RetVal;
 
+    /// Segment files of the log-structured store (small text items)
+    RetVal = EnsureDir(PATH_DIR_SEGMENTS);
+    if(RetVal != OKE) return RetVal;
+
+    /// Downscaled thumbnails of image items
+    RetVal = EnsureDir(PATH_DIR_THUMBS);
+    if(RetVal != OKE) return RetVal;
+
     xExit1("EnsureDB");
     return OKE;
 }
 
-/**
- * @brief Simple helper to save text data to a specific file.
- * @param data The data buffer to be written.
- * @param len Length of the data.
- */
-void SaveClipboardToFile(const char* data, int len) {
-    xEntry1("SaveClipboardToFile");
-    
-    /// Open the file in write mode, overriding any existing content
-    FILE *fp = fopen(PATH_ITEM, "w"); 
-    if (fp) {
-        fwrite(data, 1, len, fp);
-        fclose(fp);
-        xLog1("Saved %d bytes to %s", len, PATH_ITEM);
-    } else {
-        xError("Failed to open file for writing: %s", PATH_ITEM);
-    }
-    xExit1("SaveClipboardToFile");
-}
-
 /**************************************************************************************************
  * EOF ********************************************************************************************
  **************************************************************************************************/
@@ -14,6 +14,7 @@
 #include <time.h>
 #include <stdint.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -57,14 +58,50 @@ enum XCBFileType {
  * @brief Union to hold clipboard item metadata with raw access capability.
  */
 typedef union {
-    uint8_t RawData[NAME_MAX + 4 + sizeof(time_t) + sizeof(enum XCBFileType)];
+    uint8_t RawData[NAME_MAX + 4 + sizeof(time_t) + sizeof(enum XCBFileType) + 4 * sizeof(uint64_t) + 2 * sizeof(uint32_t) + PREVIEW_TXT_LEN + 1];
     struct {
         char                Filename[NAME_MAX + 4]; 
         time_t              Timestamp;
         enum XCBFileType    FileType;
+        uint64_t            ContentHash;    /// CRC32:Adler32 of the payload (0 = unknown)
+        uint64_t            ContentSize;    /// Payload size in bytes (valid when ContentHash != 0)
+        uint32_t            Segment;        /// Segment holding the payload (0 = own file in PATH_DIR_DB)
+        uint64_t            SegOffset;      /// Offset of the payload record inside that segment
+        uint64_t            Id;             /// Runtime id, unique within this process (0 = not from the list)
+        uint32_t            Lines;          /// Line count of a text payload (0 = empty or unknown)
+        char                Preview[PREVIEW_TXT_LEN + 1]; /// Menu-ready text preview ("" = none), see CBC_Preview.h
     };
 } sClipboardItem;
 
+/**
+ * @brief One history item inside an sXCBListSnapshot.
+ */
+typedef struct {
+    uint64_t            Id;             /// Runtime id (stable while the item stays in the history)
+    int64_t             TimeMs;         /// Capture (or last promotion) time, ms since the epoch
+    uint64_t            ContentHash;    /// CRC32:Adler32 of the payload (0 = unknown)
+    uint64_t            ContentSize;    /// Payload size in bytes
+    uint64_t            SegOffset;      /// Offset of the payload record inside Segment
+    uint32_t            Segment;        /// Segment holding the payload (0 = own file in PATH_DIR_DB)
+    enum XCBFileType    FileType;
+    uint32_t            Lines;          /// Line count of a text payload (0 = empty or unknown)
+    const char         *Name;           /// Filename, owned by the snapshot
+    const char         *Preview;        /// Menu-ready text preview ("" = none), owned by the snapshot
+} sXCBListRow;
+
+/**
+ * @brief Immutable, reference-counted copy of the whole history, published by the list writers.
+ * @note Rows are stored by ring slot in fixed-size chunks; consecutive snapshots share every chunk
+ *       no writer touched. Index rows with XCBList_SnapshotRow() (0 = newest), without the ListMutex.
+ */
+typedef struct {
+    uint64_t            Version;        /// XCBList_GetVersion() at the time of the copy
+    int                 Count;          /// Number of rows
+    int                 Head;           /// Ring slot of row 0
+    int                 Capacity;       /// Ring size
+    const sXCBListRow *const *Chunks;   /// Rows of each chunk of slots (NULL = no live slot in it)
+} sXCBListSnapshot;
+
 /**************************************************************************************************
  * SYSTEM / UTILS PROTOTYPES **********************************************************************
  **************************************************************************************************/ 
@@ -84,6 +121,13 @@ void GetTimeBasedFilenameTxt(char *buffer, size_t size);
  */
 void GetTimeBasedFilename(char *buffer, size_t size, const char *ext);
 
+/**
+ * @brief Maps a filename extension (.txt, .png, .jpg/.jpeg, .bmp) to its XCBFileType.
+ * @param Filename The name of the file to parse.
+ * @return The matching XCBFileType, or eFMT_NONE for unknown extensions.
+ */
+enum XCBFileType GetFileTypeFromName(const char* Filename);
+
 /**
  * @brief Extracts the file name from a full path (e.g., "A/B/C.txt" -> "C.txt").
  * @param Path The full path string.
@@ -98,12 +142,20 @@ RetType GetFileNameFromPath(char *Path, char *OutputFileName, int MaxFileNameSiz
  **************************************************************************************************/ 
 
 /**
- * @brief Scans DB directory. Keeps only MAX_HISTORY_ITEMS, deletes the rest.
+ * @brief Scans DB directory. Keeps only the newest XCBList_GetCapacity() items, deletes the rest. Rewrites the journal.
  * @param WithNoLock Set to 1 to bypass mutex locking, 0 for thread-safe scan.
  * @return The number of items loaded into the RAM list.
  */
 int XCBList_Scan(int WithNoLock);
 
+/**
+ * @brief Restores the list at startup by replaying the history journal (PATH_ITEM).
+ * @return The number of items loaded into the RAM list, or ERR on failure.
+ * @note Falls back to XCBList_Scan() when the journal is missing or unreadable. Cost depends on
+ *       the journal length (bounded by compaction), not on the number of files in PATH_DIR_DB.
+ */
+int XCBList_Load(void);
+
 /**
  * @brief Pushes a name/path to the list without checking the disk. Extracts filename only.
  * @param Path The file path to push.
@@ -111,6 +163,33 @@ int XCBList_Scan(int WithNoLock);
  */
 RetType XCBList_PushItem(char Path[]);
 
+/**
+ * @brief Pushes a name/path with its content hash, deduplicating against the existing history.
+ * @param Path The file path to push.
+ * @param ContentHash Hash of the payload (0 = unknown, disables deduplication).
+ * @param ContentSize Payload size in bytes.
+ * @param Preview Menu preview built at capture time (NULL = none), see Preview_End().
+ * @param Lines Line count of the payload (0 = unknown).
+ * @return OKE if pushed, ERR_ALREADY_EXISTS if an identical item was promoted to the head instead
+ *         (the caller owns the new file and should delete it), ERR on invalid path.
+ */
+RetType XCBList_PushItemWithHash(char Path[], uint64_t ContentHash, uint64_t ContentSize, const char *Preview, uint32_t Lines);
+
+/**
+ * @brief Pushes an item whose payload lives in a segment record, deduplicating like XCBList_PushItemWithHash().
+ * @param Path The item filename (no file exists in PATH_DIR_DB).
+ * @param ContentHash Hash of the payload (0 = unknown, disables deduplication).
+ * @param ContentSize Payload size in bytes.
+ * @param Segment The segment holding the record.
+ * @param SegOffset The record offset inside the segment.
+ * @param Preview Menu preview built at capture time (NULL = none), see Preview_End().
+ * @param Lines Line count of the payload (0 = unknown).
+ * @return OKE if pushed, ERR_ALREADY_EXISTS if an identical item was promoted to the head instead
+ *         (the caller should release the record), ERR on invalid path.
+ */
+RetType XCBList_PushSegmentItem(char Path[], uint64_t ContentHash, uint64_t ContentSize, uint32_t Segment, uint64_t SegOffset,
+                                const char *Preview, uint32_t Lines);
+
 /**
  * @brief Pushes a name/path to the list only if it physically exists in PATH_DIR_DB.
  * @param Path The file path to push.
@@ -142,6 +221,7 @@ RetType XCBList_GetLatestItem(sClipboardItem *Output);
 
 /**
  * @brief Reads the binary content of the file at logical index 'n'.
+ * @note Compressed payloads are inflated transparently.
  * @param n The logical index of the item.
  * @param Output Buffer to store the binary data. Pass NULL to verify disk presence.
  * @param MaxOutputSize The maximum capacity of the output buffer.
@@ -155,6 +235,19 @@ RetType XCBList_ReadAsBinary(int n, void* Output, int MaxOutputSize);
  */
 int XCBList_GetItemSize(void);
 
+/**
+ * @brief Returns the number of items the history holds before evicting the oldest.
+ * @return The capacity.
+ */
+int XCBList_GetCapacity(void);
+
+/**
+ * @brief Grows or shrinks the history to Capacity items (the oldest items are evicted to fit).
+ * @param Capacity The new number of slots (>= 1).
+ * @return OKE on success, ERR_OVERFLOW if Capacity is out of range, ERR on allocation failure.
+ */
+RetType XCBList_SetCapacity(int Capacity);
+
 /**
  * @brief Sets the currently selected logical index.
  * @param LinearIndex The UI index to select (0 to XCBListSize - 1).
@@ -175,10 +268,110 @@ int XCBList_GetSelectedNum(void);
  */
 int XCBList_GetSelectedItem(sClipboardItem *Output);
 
+/**
+ * @brief Finds an item by its stored filename.
+ * @param Name The filename (as in sClipboardItem.Filename).
+ * @return The logical index (0 = newest), or -1 if no item has that name.
+ */
+int XCBList_FindByName(const char *Name);
+
+/**
+ * @brief Finds an item by its runtime id (e.g. a row picked from a snapshot).
+ * @param Id The sClipboardItem.Id / sXCBListRow.Id of the item.
+ * @return The current logical index (0 = newest), or -1 if the item left the history.
+ */
+int XCBList_FindById(uint64_t Id);
+
+/**
+ * @brief Returns the list version, bumped by every change to the history. Lock-free.
+ * @return The current version.
+ */
+uint64_t XCBList_GetVersion(void);
+
+/**
+ * @brief Copies up to Count items starting at logical index Start under one lock acquisition.
+ * @param Start The first logical index (0 = newest).
+ * @param Count Number of items wanted.
+ * @param Output Array of at least Count items.
+ * @param Version Optional, receives the list version the items belong to.
+ * @return The number of items copied (0 when Start is past the end), or ERR on invalid arguments.
+ */
+int XCBList_ReadRange(int Start, int Count, sClipboardItem *Output, uint64_t *Version);
+
+/**
+ * @brief Returns a consistent snapshot of the whole history.
+ * @return The snapshot (release it with XCBList_ReleaseSnapshot()), or NULL on allocation failure.
+ * @note Every list change publishes a new snapshot before the ListMutex is released, rebuilding only
+ *       the chunks it wrote to. Acquiring one just takes a reference, so readers never block captures.
+ */
+const sXCBListSnapshot *XCBList_AcquireSnapshot(void);
+
+/**
+ * @brief Drops a reference taken by XCBList_AcquireSnapshot(). NULL is ignored.
+ */
+void XCBList_ReleaseSnapshot(const sXCBListSnapshot *Snapshot);
+
+/**
+ * @brief Returns the version of the oldest snapshot still referenced by anyone (the published one included).
+ * @return That version, or UINT64_MAX if no snapshot is alive.
+ * @note A record location replaced at version V can no longer be read through a snapshot once this is >= V.
+ */
+uint64_t XCBList_GetOldestSnapshotVersion(void);
+
+/**
+ * @brief Returns one row of a snapshot.
+ * @param Snapshot The snapshot.
+ * @param n The row (0 = newest), 0 <= n < Snapshot->Count.
+ * @return The row, owned by the snapshot.
+ */
+const sXCBListRow *XCBList_SnapshotRow(const sXCBListSnapshot *Snapshot, int n);
+
+/**
+ * @brief Fills an sClipboardItem from a snapshot row, for APIs that take one (Codec_Item*, ...).
+ * @param Snapshot The snapshot.
+ * @param n The row (0 = newest).
+ * @param Output Receives the item.
+ * @return OKE on success, ERR if n is out of bounds.
+ */
+RetType XCBList_SnapshotGetItem(const sXCBListSnapshot *Snapshot, int n, sClipboardItem *Output);
+
+/**
+ * @brief Removes the item at logical index 'n' from RAM and deletes its file.
+ * @param n The logical index (0 = newest).
+ * @return OKE on success, ERR if the index is out of bounds.
+ * @note Older items move one step up; the selection follows the item it pointed to.
+ */
+RetType XCBList_DeleteItem(int n);
+
+/**
+ * @brief Collects the record offsets of every item stored in a segment.
+ * @param Segment The segment id.
+ * @param Offsets Receives a malloc'ed array sorted ascending (free() it), NULL if empty.
+ * @return The number of offsets, or -1 on allocation failure.
+ */
+int XCBList_GetSegmentOffsets(uint32_t Segment, uint64_t **Offsets);
+
+/**
+ * @brief Points an item at a new copy of its segment record and journals the move.
+ * @param Name The item filename.
+ * @param OldSegment The segment the item is expected to be in.
+ * @param OldOffset The record offset the item is expected to be at.
+ * @param NewSegment The segment holding the copy.
+ * @param NewOffset The offset of the copy.
+ * @return OKE if moved, ERR if the item is gone or no longer at the old location.
+ */
+RetType XCBList_Relocate(const char *Name, uint32_t OldSegment, uint64_t OldOffset, uint32_t NewSegment, uint64_t NewOffset);
+
+/**
+ * @brief Flushes the history journal to disk.
+ * @return OKE on success, ERR on failure.
+ */
+RetType XCBList_Sync(void);
+
 /**
  * @brief Clears all clipboard items from both RAM and physical storage.
  * @return The number of items successfully cleared, or ERR on system failure.
- * @note This operation is irreversible as it deletes all files in PATH_DIR_DB.
+ * @note This operation is irreversible as it deletes all files in PATH_DIR_DB and PATH_DIR_SEGMENTS.
  */
 int XCBList_ClearAllItems(void);
 
@@ -214,13 +407,6 @@ RetType RemoveDir(const char path[]);
  */
 RetType EnsureDB(void);
 
-/**
- * @brief Simple helper to save raw text data to a demonstration file.
- * @param data The text data buffer.
- * @param len Length of the data in bytes.
- */
-void SaveClipboardToFile(const char* data, int len);
-
 #endif /*__CBC_SYSFILE_H__*/
 
 /**************************************************************************************************
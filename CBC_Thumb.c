@@ -0,0 +1,764 @@
+#include "CBC_Thumb.h"
+#include "CBC_Codec.h"
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+#include <xUniversal.h>
+#include <xUniversalReturn.h>
+#include <zlib.h>
+
+/**************************************************************************************************
+ * INTERNAL TYPES *********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Box filter: every source pixel is added to the thumbnail pixel covering it.
+ */
+typedef struct {
+    int         Width;          /// Source size
+    int         Height;
+    int         OutWidth;       /// Thumbnail size
+    int         OutHeight;
+    int        *ColumnMap;      /// Source column -> thumbnail column
+    uint64_t   *Sums;           /// 5 sums per thumbnail pixel: R*A, G*A, B*A, A, samples
+} sThumbScaler;
+
+/**
+ * @brief Header fields of a PNG stream, with its palette expanded to 0xAARRGGBB.
+ */
+typedef struct {
+    uint32_t    Width;
+    uint32_t    Height;
+    int         Depth;          /// Bits per sample
+    int         ColorType;
+    int         Channels;
+    size_t      RowBytes;       /// Bytes per scanline, filter byte excluded
+    size_t      PixelBytes;     /// Filter distance (bytes per complete pixel, at least 1)
+    uint32_t    Palette[256];
+} sPngInfo;
+
+/**
+ * @brief One queued thumbnail request.
+ */
+typedef struct {
+    char                Filename[NAME_MAX + 4];
+    enum XCBFileType    FileType;
+} sThumbJob;
+
+/**************************************************************************************************
+ * INTERNAL DATA SECTION **************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Protects the request queue and the stop flag; ThumbCond wakes the worker.
+ */
+static pthread_mutex_t  ThumbMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   ThumbCond = PTHREAD_COND_INITIALIZER;
+
+static sThumbJob        ThumbQueue[THUMB_QUEUE_DEPTH];
+static int              ThumbQueueHead = 0;
+static int              ThumbQueueCount = 0;
+
+static pthread_t        ThumbThread;
+static int              ThumbStopReq = 0;
+static int              ThumbRunning = 0;
+
+/**************************************************************************************************
+ * INTERNAL HELPERS *******************************************************************************
+ **************************************************************************************************/
+
+static inline uint32_t Internal_Be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint32_t Internal_Le32(const uint8_t *p) {
+    return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+static inline void Internal_PutBe32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline uint32_t Internal_Argb(uint32_t A, uint32_t R, uint32_t G, uint32_t B) {
+    return (A << 24) | (R << 16) | (G << 8) | B;
+}
+
+/**
+ * @brief Sets up a scaler fitting Width x Height into MaxSize x MaxSize, aspect ratio kept.
+ */
+static RetType Scaler_Begin(sThumbScaler *Scaler, int Width, int Height, int MaxSize) {
+    memset(Scaler, 0, sizeof(*Scaler));
+    Scaler->Width = Width;
+    Scaler->Height = Height;
+    if (Width >= Height) {
+        Scaler->OutWidth = (Width < MaxSize) ? Width : MaxSize;
+        Scaler->OutHeight = (int)((int64_t)Height * Scaler->OutWidth / Width);
+    } else {
+        Scaler->OutHeight = (Height < MaxSize) ? Height : MaxSize;
+        Scaler->OutWidth = (int)((int64_t)Width * Scaler->OutHeight / Height);
+    }
+    if (Scaler->OutWidth < 1) Scaler->OutWidth = 1;
+    if (Scaler->OutHeight < 1) Scaler->OutHeight = 1;
+
+    Scaler->ColumnMap = malloc((size_t)Width * sizeof(int));
+    Scaler->Sums = calloc((size_t)Scaler->OutWidth * Scaler->OutHeight * 5, sizeof(uint64_t));
+    if (!Scaler->ColumnMap || !Scaler->Sums) return ERR;
+
+    for (int x = 0; x < Width; x++) {
+        Scaler->ColumnMap[x] = (int)((int64_t)x * Scaler->OutWidth / Width);
+    }
+    return OKE;
+}
+
+/**
+ * @brief Adds source row y (Width pixels, 0xAARRGGBB) to the thumbnail.
+ */
+static void Scaler_AddRow(sThumbScaler *Scaler, int y, const uint32_t *Line) {
+    uint64_t *Row = Scaler->Sums + (size_t)((int64_t)y * Scaler->OutHeight / Scaler->Height) * Scaler->OutWidth * 5;
+
+    for (int x = 0; x < Scaler->Width; x++) {
+        uint32_t Pixel = Line[x];
+        uint64_t A = Pixel >> 24;
+        uint64_t *Sum = Row + (size_t)Scaler->ColumnMap[x] * 5;
+        Sum[0] += ((Pixel >> 16) & 0xFF) * A;
+        Sum[1] += ((Pixel >> 8) & 0xFF) * A;
+        Sum[2] += (Pixel & 0xFF) * A;
+        Sum[3] += A;
+        Sum[4]++;
+    }
+}
+
+/**
+ * @brief Averages the sums into Out (alpha-weighted colours, so transparent pixels do not bleed).
+ */
+static RetType Scaler_End(sThumbScaler *Scaler, sThumb *Out) {
+    size_t Count = (size_t)Scaler->OutWidth * Scaler->OutHeight;
+    Out->Pixels = malloc(Count * sizeof(uint32_t));
+    if (!Out->Pixels) return ERR;
+    Out->Width = Scaler->OutWidth;
+    Out->Height = Scaler->OutHeight;
+
+    for (size_t i = 0; i < Count; i++) {
+        const uint64_t *Sum = Scaler->Sums + i * 5;
+        if (Sum[3] == 0 || Sum[4] == 0) {
+            Out->Pixels[i] = 0;
+        } else {
+            Out->Pixels[i] = Internal_Argb((uint32_t)(Sum[3] / Sum[4]), (uint32_t)(Sum[0] / Sum[3]),
+                                           (uint32_t)(Sum[1] / Sum[3]), (uint32_t)(Sum[2] / Sum[3]));
+        }
+    }
+    return OKE;
+}
+
+static void Scaler_Free(sThumbScaler *Scaler) {
+    free(Scaler->ColumnMap);
+    free(Scaler->Sums);
+    Scaler->ColumnMap = NULL;
+    Scaler->Sums = NULL;
+}
+
+/**************************************************************************************************
+ * PNG DECODER ************************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Reverses the scanline filter of Row (Row[0] is the filter type) against the previous row.
+ * @return OKE, or ERR for an unknown filter type.
+ */
+static RetType Png_Unfilter(uint8_t *Row, const uint8_t *Prev, size_t Len, size_t Bpp) {
+    uint8_t *Cur = Row + 1;
+    const uint8_t *Up = Prev + 1;
+
+    switch (Row[0]) {
+        case 0:
+            break;
+        case 1:
+            for (size_t i = Bpp; i < Len; i++) Cur[i] += Cur[i - Bpp];
+            break;
+        case 2:
+            for (size_t i = 0; i < Len; i++) Cur[i] += Up[i];
+            break;
+        case 3:
+            for (size_t i = 0; i < Len; i++) {
+                Cur[i] += (uint8_t)(((i >= Bpp ? Cur[i - Bpp] : 0) + Up[i]) >> 1);
+            }
+            break;
+        case 4:
+            for (size_t i = 0; i < Len; i++) {
+                int a = (i >= Bpp) ? Cur[i - Bpp] : 0, b = Up[i], c = (i >= Bpp) ? Up[i - Bpp] : 0;
+                int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                Cur[i] += (uint8_t)((pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c);
+            }
+            break;
+        default:
+            return ERR;
+    }
+    return OKE;
+}
+
+/**
+ * @brief Converts one unfiltered scanline to 0xAARRGGBB pixels (16-bit samples keep their high byte).
+ */
+static void Png_ConvertRow(const sPngInfo *Png, const uint8_t *Row, uint32_t *Line) {
+    size_t Step = (size_t)Png->Depth / 8;   /// Bytes per sample (0 below 8 bits)
+
+    for (uint32_t x = 0; x < Png->Width; x++) {
+        uint32_t v, r, g, b, a = 255;
+
+        if (Png->Depth < 8) {
+            size_t Bit = (size_t)x * Png->Depth;
+            uint32_t Max = (1U << Png->Depth) - 1;
+            v = (Row[Bit >> 3] >> (8 - Png->Depth - (Bit & 7))) & Max;
+            Line[x] = (Png->ColorType == 3) ? Png->Palette[v] : Internal_Argb(255, v * 255 / Max, v * 255 / Max, v * 255 / Max);
+            continue;
+        }
+
+        const uint8_t *p = Row + (size_t)x * Png->Channels * Step;
+        switch (Png->ColorType) {
+            case 0: r = g = b = p[0]; break;
+            case 3: Line[x] = Png->Palette[p[0]]; continue;
+            case 4: r = g = b = p[0]; a = p[Step]; break;
+            case 2: r = p[0]; g = p[Step]; b = p[2 * Step]; break;
+            default: r = p[0]; g = p[Step]; b = p[2 * Step]; a = p[3 * Step]; break;
+        }
+        Line[x] = Internal_Argb(a, r, g, b);
+    }
+}
+
+/**
+ * @brief Parses and validates IHDR.
+ * @return OKE, ERR_UNSUPPORTED for interlaced images, ERR for invalid headers.
+ */
+static RetType Png_ParseHeader(sPngInfo *Png, const uint8_t *Body, uint32_t Len) {
+    if (Len != 13) return ERR;
+    Png->Width = Internal_Be32(Body);
+    Png->Height = Internal_Be32(Body + 4);
+    Png->Depth = Body[8];
+    Png->ColorType = Body[9];
+
+    if (Png->Width == 0 || Png->Height == 0 || Png->Width > THUMB_DIM_MAX || Png->Height > THUMB_DIM_MAX) return ERR;
+    if (Body[10] != 0 || Body[11] != 0) return ERR;
+    if (Body[12] != 0) return ERR_UNSUPPORTED;
+
+    int d = Png->Depth;
+    switch (Png->ColorType) {
+        case 0: Png->Channels = 1; if (d != 1 && d != 2 && d != 4 && d != 8 && d != 16) return ERR; break;
+        case 3: Png->Channels = 1; if (d != 1 && d != 2 && d != 4 && d != 8) return ERR; break;
+        case 2: Png->Channels = 3; if (d != 8 && d != 16) return ERR; break;
+        case 4: Png->Channels = 2; if (d != 8 && d != 16) return ERR; break;
+        case 6: Png->Channels = 4; if (d != 8 && d != 16) return ERR; break;
+        default: return ERR;
+    }
+
+    size_t Bits = (size_t)Png->Channels * Png->Depth;
+    Png->RowBytes = ((size_t)Png->Width * Bits + 7) / 8;
+    Png->PixelBytes = (Bits >= 8) ? Bits / 8 : 1;
+    for (int i = 0; i < 256; i++) Png->Palette[i] = Internal_Argb(255, 0, 0, 0);
+    return OKE;
+}
+
+static RetType Png_Decode(const uint8_t *Data, size_t Len, int MaxSize, sThumb *Out) {
+    static const uint8_t Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (Len < sizeof(Signature) || memcmp(Data, Signature, sizeof(Signature)) != 0) return ERR;
+
+    sPngInfo *Png = calloc(1, sizeof(sPngInfo));
+    if (!Png) return ERR;
+
+    sThumbScaler Scaler;
+    memset(&Scaler, 0, sizeof(Scaler));
+    z_stream Zs;
+    memset(&Zs, 0, sizeof(Zs));
+    int ZReady = 0, HaveHeader = 0;
+    uint8_t *Rows = NULL, *Cur = NULL, *Prev = NULL;
+    uint32_t *Line = NULL;
+    size_t Filled = 0;
+    uint32_t y = 0;
+    RetType Ret = ERR;
+
+    for (size_t Pos = sizeof(Signature); Pos + 12 <= Len; ) {
+        uint32_t ChunkLen = Internal_Be32(Data + Pos);
+        const uint8_t *Type = Data + Pos + 4, *Body = Data + Pos + 8;
+        if (ChunkLen > Len - Pos - 12) break;
+        Pos += 12 + (size_t)ChunkLen;
+
+        if (!HaveHeader) {
+            if (memcmp(Type, "IHDR", 4) != 0) break;
+            Ret = Png_ParseHeader(Png, Body, ChunkLen);
+            if (Ret != OKE) goto Done;
+            Ret = ERR;
+            HaveHeader = 1;
+        }
+        else if (memcmp(Type, "PLTE", 4) == 0) {
+            for (uint32_t i = 0; i < ChunkLen / 3 && i < 256; i++) {
+                Png->Palette[i] = Internal_Argb(255, Body[3 * i], Body[3 * i + 1], Body[3 * i + 2]);
+            }
+        }
+        else if (memcmp(Type, "tRNS", 4) == 0 && Png->ColorType == 3) {
+            for (uint32_t i = 0; i < ChunkLen && i < 256; i++) {
+                Png->Palette[i] = (Png->Palette[i] & 0x00FFFFFFU) | ((uint32_t)Body[i] << 24);
+            }
+        }
+        else if (memcmp(Type, "IDAT", 4) == 0) {
+            /// First IDAT: PLTE/tRNS are known by now, set up the row buffers and the inflater
+            if (!ZReady) {
+                Rows = calloc(2, Png->RowBytes + 1);
+                Line = malloc((size_t)Png->Width * sizeof(uint32_t));
+                if (!Rows || !Line || Scaler_Begin(&Scaler, (int)Png->Width, (int)Png->Height, MaxSize) != OKE) goto Done;
+                if (inflateInit(&Zs) != Z_OK) goto Done;
+                ZReady = 1;
+                Cur = Rows;
+                Prev = Rows + Png->RowBytes + 1;
+            }
+
+            Zs.next_in = (Bytef *)Body;
+            Zs.avail_in = ChunkLen;
+            while (y < Png->Height) {
+                Zs.next_out = Cur + Filled;
+                Zs.avail_out = (uInt)(Png->RowBytes + 1 - Filled);
+                int Z = inflate(&Zs, Z_NO_FLUSH);
+                size_t Before = Filled;
+                Filled = Png->RowBytes + 1 - Zs.avail_out;
+
+                int RowDone = (Filled == Png->RowBytes + 1);
+                if (RowDone) {
+                    if (Png_Unfilter(Cur, Prev, Png->RowBytes, Png->PixelBytes) != OKE) goto Done;
+                    Png_ConvertRow(Png, Cur + 1, Line);
+                    Scaler_AddRow(&Scaler, (int)y, Line);
+                    uint8_t *Swap = Prev;
+                    Prev = Cur;
+                    Cur = Swap;
+                    Filled = 0;
+                    y++;
+                }
+
+                if (Z == Z_STREAM_END) break;
+                if (Z != Z_OK && Z != Z_BUF_ERROR) goto Done;
+                /// Input used up (or no progress possible): continue with the next IDAT
+                if (!RowDone && (Zs.avail_in == 0 || Filled == Before)) break;
+            }
+            if (y == Png->Height) break;
+        }
+        else if (memcmp(Type, "IEND", 4) == 0) {
+            break;
+        }
+    }
+
+    if (ZReady && y == Png->Height) Ret = Scaler_End(&Scaler, Out);
+
+Done:
+    if (ZReady) inflateEnd(&Zs);
+    Scaler_Free(&Scaler);
+    free(Rows);
+    free(Line);
+    free(Png);
+    return Ret;
+}
+
+/**************************************************************************************************
+ * BMP DECODER ************************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Extracts the channel selected by Mask from a pixel and widens/narrows it to 8 bits.
+ */
+static inline uint32_t Bmp_Channel(uint32_t Pixel, uint32_t Mask) {
+    if (Mask == 0) return 0;
+    int Shift = __builtin_ctz(Mask);
+    int Bits = __builtin_popcount(Mask >> Shift);
+    uint32_t v = (Pixel & Mask) >> Shift;
+    return (Bits >= 8) ? v >> (Bits - 8) : v * 255 / ((1U << Bits) - 1);
+}
+
+/**
+ * @brief Decodes an uncompressed 24/32-bit BMP (BI_RGB or BI_BITFIELDS), as copied by browsers and editors.
+ */
+static RetType Bmp_Decode(const uint8_t *Data, size_t Len, int MaxSize, sThumb *Out) {
+    if (Len < 54 || Data[0] != 'B' || Data[1] != 'M') return ERR;
+
+    uint32_t PixelOffset = Internal_Le32(Data + 10);
+    uint32_t HeaderSize = Internal_Le32(Data + 14);
+    int32_t Width = (int32_t)Internal_Le32(Data + 18);
+    int32_t Height = (int32_t)Internal_Le32(Data + 22);
+    int Bpp = Data[28] | (Data[29] << 8);
+    uint32_t Compression = Internal_Le32(Data + 30);
+    int TopDown = (Height < 0);
+    if (TopDown) Height = -Height;
+
+    if (HeaderSize < 40) return ERR_UNSUPPORTED;
+    if (Width <= 0 || Height <= 0 || Width > THUMB_DIM_MAX || Height > THUMB_DIM_MAX) return ERR;
+
+    uint32_t RMask = 0x00FF0000U, GMask = 0x0000FF00U, BMask = 0x000000FFU, AMask = 0;
+    if (Bpp == 32 && (Compression == 3 || Compression == 6)) {
+        /// Masks sit right after the 40-byte header, inside it for V4/V5 headers: same offset either way
+        if (Len < 70) return ERR;
+        RMask = Internal_Le32(Data + 54);
+        GMask = Internal_Le32(Data + 58);
+        BMask = Internal_Le32(Data + 62);
+        if (HeaderSize >= 56 || Compression == 6) AMask = Internal_Le32(Data + 66);
+    } else if (!((Bpp == 24 || Bpp == 32) && Compression == 0)) {
+        return ERR_UNSUPPORTED;
+    }
+
+    size_t Stride = (((size_t)Width * Bpp + 31) / 32) * 4;
+    if (PixelOffset > Len || Stride * (size_t)Height > Len - PixelOffset) return ERR;
+    const uint8_t *Pixels = Data + PixelOffset;
+
+    /// Many writers leave the alpha channel at zero: treat such images as opaque
+    if (AMask) {
+        int AnyAlpha = 0;
+        for (int32_t y = 0; y < Height && !AnyAlpha; y++) {
+            for (int32_t x = 0; x < Width; x++) {
+                if (Internal_Le32(Pixels + (size_t)y * Stride + (size_t)x * 4) & AMask) { AnyAlpha = 1; break; }
+            }
+        }
+        if (!AnyAlpha) AMask = 0;
+    }
+
+    sThumbScaler Scaler;
+    memset(&Scaler, 0, sizeof(Scaler));
+    uint32_t *Line = malloc((size_t)Width * sizeof(uint32_t));
+    RetType Ret = ERR;
+    if (Line && Scaler_Begin(&Scaler, Width, Height, MaxSize) == OKE) {
+        for (int32_t y = 0; y < Height; y++) {
+            const uint8_t *Row = Pixels + (size_t)(TopDown ? y : Height - 1 - y) * Stride;
+            for (int32_t x = 0; x < Width; x++) {
+                if (Bpp == 24) {
+                    const uint8_t *p = Row + (size_t)x * 3;
+                    Line[x] = Internal_Argb(255, p[2], p[1], p[0]);
+                } else {
+                    uint32_t v = Internal_Le32(Row + (size_t)x * 4);
+                    Line[x] = Internal_Argb(AMask ? Bmp_Channel(v, AMask) : 255,
+                                            Bmp_Channel(v, RMask), Bmp_Channel(v, GMask), Bmp_Channel(v, BMask));
+                }
+            }
+            Scaler_AddRow(&Scaler, y, Line);
+        }
+        Ret = Scaler_End(&Scaler, Out);
+    }
+    Scaler_Free(&Scaler);
+    free(Line);
+    return Ret;
+}
+
+/**************************************************************************************************
+ * PUBLIC API IMPLEMENTATION **********************************************************************
+ **************************************************************************************************/
+
+RetType Thumb_Decode(const uint8_t *Data, size_t Len, enum XCBFileType Type, int MaxSize, sThumb *Out) {
+    memset(Out, 0, sizeof(*Out));
+    if (!Data || MaxSize < 1) return ERR_NULL;
+
+    switch (Type) {
+        case eFMT_IMG_PNG: return Png_Decode(Data, Len, MaxSize, Out);
+        case eFMT_IMG_BMP: return Bmp_Decode(Data, Len, MaxSize, Out);
+        default:           return ERR_UNSUPPORTED;
+    }
+}
+
+RetType Thumb_FromItem(const sClipboardItem *Item, int MaxSize, sThumb *Out) {
+    memset(Out, 0, sizeof(*Out));
+    if (Item->FileType != eFMT_IMG_PNG && Item->FileType != eFMT_IMG_BMP) return ERR_UNSUPPORTED;
+
+    /// Raw payloads (PNG) are decoded straight from the page cache
+    sCodecMapping Map;
+    RetType Ret = Codec_ItemMap(Item, &Map);
+    if (Ret == OKE) {
+        Ret = (Map.Len > THUMB_SOURCE_MAX) ? ERR_OVERFLOW : Thumb_Decode(Map.Base, Map.Len, Item->FileType, MaxSize, Out);
+        Codec_UnmapFile(&Map);
+        return Ret;
+    }
+    if (Ret != ERR_UNSUPPORTED) return Ret;
+
+    /// Compressed (BMP): inflate the whole payload first
+    int64_t Size = Codec_ItemGetPayloadSize(Item);
+    if (Size <= 0) return ERR;
+    if (Size > (int64_t)THUMB_SOURCE_MAX) return ERR_OVERFLOW;
+
+    uint8_t *Buffer = malloc((size_t)Size);
+    if (!Buffer) return ERR;
+    Ret = (Codec_ItemRead(Item, Buffer, (size_t)Size) == Size) ? Thumb_Decode(Buffer, (size_t)Size, Item->FileType, MaxSize, Out) : ERR;
+    free(Buffer);
+    return Ret;
+}
+
+void Thumb_Free(sThumb *Thumb) {
+    free(Thumb->Pixels);
+    memset(Thumb, 0, sizeof(*Thumb));
+}
+
+/**************************************************************************************************
+ * THUMBNAIL CACHE ********************************************************************************
+ **************************************************************************************************/
+
+static inline int Internal_CanDecode(enum XCBFileType Type) {
+    return Type == eFMT_IMG_PNG || Type == eFMT_IMG_BMP;
+}
+
+/**
+ * @brief Writes one PNG chunk (length, type, data, CRC).
+ */
+static int Internal_WriteChunk(FILE *File, const char *Type, const uint8_t *Data, uint32_t Len) {
+    uint8_t Head[8], Tail[4];
+    Internal_PutBe32(Head, Len);
+    memcpy(Head + 4, Type, 4);
+    uLong Crc = crc32(crc32(0L, Z_NULL, 0), Head + 4, 4);
+    if (Len) Crc = crc32(Crc, Data, Len);
+    Internal_PutBe32(Tail, (uint32_t)Crc);
+
+    return fwrite(Head, 1, sizeof(Head), File) == sizeof(Head) &&
+           (Len == 0 || fwrite(Data, 1, Len, File) == Len) &&
+           fwrite(Tail, 1, sizeof(Tail), File) == sizeof(Tail);
+}
+
+/**
+ * @brief Generates and saves the thumbnail of one item, unless it already exists.
+ */
+static void Internal_Generate(const char *Filename, enum XCBFileType Type) {
+    char Path[PATH_MAX];
+    Thumb_GetPath(Filename, Path, sizeof(Path));
+    if (access(Path, F_OK) == 0) return;
+
+    /// Images are always stored in their own file: a name and a type locate the payload
+    sClipboardItem Item;
+    memset(&Item, 0, sizeof(Item));
+    snprintf(Item.Filename, sizeof(Item.Filename), "%s", Filename);
+    Item.FileType = Type;
+
+    sThumb Thumb;
+    RetType Ret = Thumb_FromItem(&Item, THUMB_SIZE, &Thumb);
+    if (Ret != OKE) {
+        xLog1("[Thumb] No thumbnail for %s (%d).", Filename, (int)Ret);
+        return;
+    }
+    if (Thumb_Save(&Thumb, Filename) == OKE && XCBList_FindByName(Filename) < 0) {
+        /// Evicted while it was being decoded: its Thumb_Remove() already ran
+        Thumb_Remove(Filename);
+    }
+    Thumb_Free(&Thumb);
+}
+
+static int Internal_StopRequested(void) {
+    pthread_mutex_lock(&ThumbMutex);
+    int Stop = ThumbStopReq;
+    pthread_mutex_unlock(&ThumbMutex);
+    return Stop;
+}
+
+/**
+ * @brief Deletes thumbnails whose item left the history while the daemon was not running
+ *        (and temp files of interrupted writes).
+ */
+static void Internal_Sweep(void) {
+    DIR *Dir = opendir(PATH_DIR_THUMBS);
+    if (!Dir) return;
+
+    struct dirent *Entry;
+    int Removed = 0;
+    size_t ExtLen = sizeof(THUMB_FILE_EXT) - 1;
+    while ((Entry = readdir(Dir)) != NULL) {
+        if (strcmp(Entry->d_name, ".") == 0 || strcmp(Entry->d_name, "..") == 0) continue;
+
+        char Name[NAME_MAX + 1];
+        size_t Len = strlen(Entry->d_name);
+        int Stale = (Entry->d_name[0] == '.') || Len <= ExtLen || strcmp(Entry->d_name + Len - ExtLen, THUMB_FILE_EXT) != 0;
+        if (!Stale) {
+            snprintf(Name, sizeof(Name), "%.*s", (int)(Len - ExtLen), Entry->d_name);
+            Stale = (XCBList_FindByName(Name) < 0);
+        }
+        if (Stale) {
+            char Path[PATH_MAX];
+            snprintf(Path, sizeof(Path), "%s/%s", PATH_DIR_THUMBS, Entry->d_name);
+            if (unlink(Path) == 0) Removed++;
+        }
+    }
+    closedir(Dir);
+    if (Removed) {
+        xLog1("[Thumb] Removed %d stale thumbnails.", Removed);
+    }
+}
+
+/**
+ * @brief Generates the missing thumbnails of the whole history (items captured before the cache
+ *        existed, or requests dropped at the last shutdown).
+ */
+static void Internal_Backfill(void) {
+    const sXCBListSnapshot *Snap = XCBList_AcquireSnapshot();
+    if (!Snap) return;
+
+    for (int i = 0; i < Snap->Count && !Internal_StopRequested(); i++) {
+        const sXCBListRow *Row = XCBList_SnapshotRow(Snap, i);
+        if (Internal_CanDecode(Row->FileType)) Internal_Generate(Row->Name, Row->FileType);
+    }
+    XCBList_ReleaseSnapshot(Snap);
+}
+
+/**
+ * @brief Worker thread: sweeps and backfills once, then serves requests until asked to stop.
+ */
+static void *Thumb_WorkerRuntime(void *Param) {
+    (void)Param;
+
+    Internal_Sweep();
+    Internal_Backfill();
+
+    pthread_mutex_lock(&ThumbMutex);
+    while (!ThumbStopReq) {
+        if (ThumbQueueCount == 0) {
+            pthread_cond_wait(&ThumbCond, &ThumbMutex);
+            continue;
+        }
+        sThumbJob Job = ThumbQueue[ThumbQueueHead];
+        ThumbQueueHead = (ThumbQueueHead + 1) % THUMB_QUEUE_DEPTH;
+        ThumbQueueCount--;
+
+        pthread_mutex_unlock(&ThumbMutex);
+        Internal_Generate(Job.Filename, Job.FileType);
+        pthread_mutex_lock(&ThumbMutex);
+    }
+    pthread_mutex_unlock(&ThumbMutex);
+    return NULL;
+}
+
+RetType Thumb_Load(const sClipboardItem *Item, int MaxSize, sThumb *Out) {
+    char Path[PATH_MAX];
+    sCodecMapping Map;
+
+    Thumb_GetPath(Item->Filename, Path, sizeof(Path));
+    if (Internal_CanDecode(Item->FileType) && Codec_MapFile(Path, &Map) == OKE) {
+        RetType Ret = Thumb_Decode(Map.Base, Map.Len, eFMT_IMG_PNG, MaxSize, Out);
+        Codec_UnmapFile(&Map);
+        if (Ret == OKE) return OKE;
+    }
+    return Thumb_FromItem(Item, MaxSize, Out);
+}
+
+void Thumb_GetPath(const char *Filename, char *Output, size_t OutputSize) {
+    snprintf(Output, OutputSize, "%s/%s%s", PATH_DIR_THUMBS, Filename, THUMB_FILE_EXT);
+}
+
+RetType Thumb_Save(const sThumb *Thumb, const char *Filename) {
+    size_t RowBytes = (size_t)Thumb->Width * 4 + 1;
+    size_t RawLen = RowBytes * (size_t)Thumb->Height;
+    uLongf PackedLen = compressBound((uLong)RawLen);
+    uint8_t *Raw = malloc(RawLen);
+    uint8_t *Packed = malloc(PackedLen);
+    RetType Ret = ERR;
+
+    if (Raw && Packed) {
+        /// Filter type 0 rows of straight RGBA
+        for (int y = 0; y < Thumb->Height; y++) {
+            uint8_t *Row = Raw + (size_t)y * RowBytes;
+            *Row++ = 0;
+            for (int x = 0; x < Thumb->Width; x++, Row += 4) {
+                uint32_t Argb = Thumb->Pixels[(size_t)y * Thumb->Width + x];
+                Row[0] = (uint8_t)(Argb >> 16);
+                Row[1] = (uint8_t)(Argb >> 8);
+                Row[2] = (uint8_t)Argb;
+                Row[3] = (uint8_t)(Argb >> 24);
+            }
+        }
+
+        if (compress2(Packed, &PackedLen, Raw, (uLong)RawLen, Z_DEFAULT_COMPRESSION) == Z_OK) {
+            static const uint8_t Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+            uint8_t Header[13];
+            Internal_PutBe32(Header, (uint32_t)Thumb->Width);
+            Internal_PutBe32(Header + 4, (uint32_t)Thumb->Height);
+            Header[8] = 8;      /// Bit depth
+            Header[9] = 6;      /// RGBA
+            Header[10] = Header[11] = Header[12] = 0;
+
+            char Path[PATH_MAX], TmpPath[PATH_MAX];
+            Thumb_GetPath(Filename, Path, sizeof(Path));
+            snprintf(TmpPath, sizeof(TmpPath), "%s/.%s%s.tmp", PATH_DIR_THUMBS, Filename, THUMB_FILE_EXT);
+
+            FILE *File = fopen(TmpPath, "wbe");
+            if (File) {
+                int Ok = fwrite(Signature, 1, sizeof(Signature), File) == sizeof(Signature) &&
+                         Internal_WriteChunk(File, "IHDR", Header, sizeof(Header)) &&
+                         Internal_WriteChunk(File, "IDAT", Packed, (uint32_t)PackedLen) &&
+                         Internal_WriteChunk(File, "IEND", NULL, 0);
+                if (fclose(File) != 0) Ok = 0;
+                if (Ok && rename(TmpPath, Path) == 0) Ret = OKE;
+                else unlink(TmpPath);
+            }
+            if (Ret != OKE) xWarn("[Thumb] Failed to write %s: %s", Path, strerror(errno));
+        }
+    }
+
+    free(Raw);
+    free(Packed);
+    return Ret;
+}
+
+RetType Thumb_Start(void) {
+    xEntry1("Thumb_Start");
+    if (THUMB_CACHE != 1) return OKE;
+
+    pthread_mutex_lock(&ThumbMutex);
+    ThumbStopReq = 0;
+    ThumbQueueHead = 0;
+    ThumbQueueCount = 0;
+    pthread_mutex_unlock(&ThumbMutex);
+
+    if (pthread_create(&ThumbThread, NULL, Thumb_WorkerRuntime, NULL) != 0) {
+        xError("[Thumb] Failed to spawn thumbnail worker!");
+        return ERR;
+    }
+    ThumbRunning = 1;
+
+    xExit1("Thumb_Start");
+    return OKE;
+}
+
+void Thumb_Stop(void) {
+    if (!ThumbRunning) return;
+
+    pthread_mutex_lock(&ThumbMutex);
+    ThumbStopReq = 1;
+    pthread_cond_signal(&ThumbCond);
+    pthread_mutex_unlock(&ThumbMutex);
+
+    pthread_join(ThumbThread, NULL);
+    ThumbRunning = 0;
+}
+
+void Thumb_Request(const char *Filename, enum XCBFileType Type) {
+    if (!Internal_CanDecode(Type)) return;
+
+    pthread_mutex_lock(&ThumbMutex);
+    if (ThumbRunning && !ThumbStopReq && ThumbQueueCount < THUMB_QUEUE_DEPTH) {
+        sThumbJob *Job = &ThumbQueue[(ThumbQueueHead + ThumbQueueCount) % THUMB_QUEUE_DEPTH];
+        snprintf(Job->Filename, sizeof(Job->Filename), "%s", Filename);
+        Job->FileType = Type;
+        ThumbQueueCount++;
+        pthread_cond_signal(&ThumbCond);
+    }
+    pthread_mutex_unlock(&ThumbMutex);
+}
+
+int Thumb_Lookup(const char *Filename, enum XCBFileType Type, char *Output, size_t OutputSize) {
+    if (THUMB_CACHE != 1 || !Internal_CanDecode(Type)) return 0;
+
+    Thumb_GetPath(Filename, Output, OutputSize);
+    if (access(Output, F_OK) == 0) return 1;
+    Thumb_Request(Filename, Type);
+    return 0;
+}
+
+void Thumb_Remove(const char *Filename) {
+    char Path[PATH_MAX];
+    Thumb_GetPath(Filename, Path, sizeof(Path));
+    unlink(Path);
+}
+
+RetType Thumb_RemoveAll(void) {
+    RetType Ret = RemoveDir(PATH_DIR_THUMBS);
+    if (EnsureDir(PATH_DIR_THUMBS) != OKE) Ret = ERR;
+    return Ret;
+}
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
@@ -0,0 +1,132 @@
+#ifndef __CBC_THUMB_H__
+#define __CBC_THUMB_H__
+
+/**************************************************************************************************
+ * INCLUDE SECTION ********************************************************************************
+ **************************************************************************************************/
+
+#include "CBC_Setup.h"
+#include "CBC_SysFile.h"
+
+/**************************************************************************************************
+ * THUMBNAIL CONFIGURATION SECTION ****************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Largest accepted image side (pixels), a guard against corrupt headers.
+ */
+#define THUMB_DIM_MAX                   32768
+
+/**
+ * @brief Thumbnail requests that can wait for the worker at once (more are dropped and
+ *        requested again by the next menu).
+ */
+#define THUMB_QUEUE_DEPTH               64
+
+/**
+ * @brief Suffix appended to the item filename to name its thumbnail in PATH_DIR_THUMBS.
+ */
+#define THUMB_FILE_EXT                  ".png"
+
+/**************************************************************************************************
+ * THUMBNAIL TYPES ********************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief A downscaled image, one 0xAARRGGBB word per pixel (straight alpha), row by row.
+ */
+typedef struct {
+    int         Width;
+    int         Height;
+    uint32_t   *Pixels;
+} sThumb;
+
+/**************************************************************************************************
+ * THUMBNAIL PROTOTYPES ***************************************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief Decodes an image and box-filters it down to fit in MaxSize x MaxSize (never upscaled).
+ * @param Data The encoded image.
+ * @param Len Size of Data in bytes.
+ * @param Type eFMT_IMG_PNG or eFMT_IMG_BMP.
+ * @param MaxSize Longest side of the thumbnail, in pixels.
+ * @param Out Receives the thumbnail (release it with Thumb_Free()).
+ * @return OKE on success, ERR_UNSUPPORTED for JPEG, interlaced PNG or exotic BMP layouts,
+ *         ERR for damaged data or allocation failures.
+ * @note PNG rows are inflated and scaled one at a time: the full-size image is never held.
+ */
+RetType Thumb_Decode(const uint8_t *Data, size_t Len, enum XCBFileType Type, int MaxSize, sThumb *Out);
+
+/**
+ * @brief Same as Thumb_Decode() for a stored history item (mapped when raw, read when compressed).
+ * @return As Thumb_Decode(), plus ERR_OVERFLOW if the payload exceeds THUMB_SOURCE_MAX.
+ * @note Goes through the Codec_Item* readers, so do not call it with the ListMutex held.
+ */
+RetType Thumb_FromItem(const sClipboardItem *Item, int MaxSize, sThumb *Out);
+
+/**
+ * @brief Releases the pixels of a thumbnail.
+ */
+void Thumb_Free(sThumb *Thumb);
+
+/**
+ * @brief Same as Thumb_FromItem(), but decodes the cached thumbnail when there is one.
+ */
+RetType Thumb_Load(const sClipboardItem *Item, int MaxSize, sThumb *Out);
+
+/**
+ * @brief Builds the path of the cached thumbnail of an item.
+ */
+void Thumb_GetPath(const char *Filename, char *Output, size_t OutputSize);
+
+/**
+ * @brief Writes a thumbnail as an RGBA PNG under PATH_DIR_THUMBS (temp file + rename).
+ * @param Filename The item filename the thumbnail belongs to.
+ * @return OKE on success, ERR on encoder or I/O errors.
+ */
+RetType Thumb_Save(const sThumb *Thumb, const char *Filename);
+
+/**
+ * @brief Spawns the thumbnail worker. It first deletes thumbnails of items no longer in the history,
+ *        then generates the missing ones, then serves Thumb_Request().
+ * @return OKE on success (or when THUMB_CACHE is off), ERR if the thread cannot be created.
+ * @note Call after the history is loaded.
+ */
+RetType Thumb_Start(void);
+
+/**
+ * @brief Stops the worker. Requests still queued are dropped (the next start backfills them).
+ */
+void Thumb_Stop(void);
+
+/**
+ * @brief Asks the worker to generate the thumbnail of an item (PNG and BMP only).
+ * @note Never blocks: the request is dropped if THUMB_QUEUE_DEPTH requests are already waiting.
+ */
+void Thumb_Request(const char *Filename, enum XCBFileType Type);
+
+/**
+ * @brief Looks up the cached thumbnail of an item.
+ * @param Output Receives its path when it exists.
+ * @return 1 if it exists, 0 otherwise (it is then requested from the worker).
+ */
+int Thumb_Lookup(const char *Filename, enum XCBFileType Type, char *Output, size_t OutputSize);
+
+/**
+ * @brief Deletes the cached thumbnail of an item (no error if there is none).
+ * @note One unlink: safe with the ListMutex held.
+ */
+void Thumb_Remove(const char *Filename);
+
+/**
+ * @brief Deletes every cached thumbnail.
+ * @return OKE on success, ERR if the directory cannot be emptied.
+ */
+RetType Thumb_RemoveAll(void);
+
+#endif /*__CBC_THUMB_H__*/
+
+/**************************************************************************************************
+ * EOF ********************************************************************************************
+ **************************************************************************************************/
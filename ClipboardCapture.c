@@ -1,11 +1,26 @@
+#define _GNU_SOURCE
 #include "ClipboardCapture.h"
 #include "CBC_Setup.h"
 #include "CBC_SysFile.h"
+#include "CBC_CaptureSink.h"
+#include "CBC_MemBudget.h"
+#include "CBC_Codec.h"
+#include "CBC_Metrics.h"
+#include "CBC_Segment.h"
+#include "CBC_Preview.h"
+#include "CBC_Picker.h"
+#include "CBC_Thumb.h"
+#include "CBC_Search.h"
 #include "xUniversal.h"
 #include <xUniversalReturn.h>
 #include <xcb/xcb.h>
 #include <sys/time.h>
-#include <semaphore.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <spawn.h>
 
 /**************************************************************************************************
  * FORWARD DECLARATIONS ***************************************************************************
@@ -83,6 +98,11 @@ size_t ActiveDataLen = 0;
  */
 xcb_atom_t ActiveDataType = 0;
 
+/**
+ * @brief Extra targets (text/html, ...) offered alongside the active data, or NULL.
+ */
+sFlavourSet *ActiveFlavours = NULL;
+
 /**************************************************************************************************
  * X11 CORE & CONNECTION SECTION ******************************************************************
  **************************************************************************************************/ 
@@ -113,146 +133,277 @@ volatile sig_atomic_t TogglePopUpStatus = eNOT_STARTED;
 volatile sig_atomic_t RequestExit       = eDEACTIVATE;
 
 /**
- * @brief Flag to trigger the injection of the selected clipboard item into the active window.
+ * @brief Thread handle for the event loop: X11 events (capture + provide), signals, commands and deadlines.
+ */
+static pthread_t XClipboardRuntimeThread_Loop;
+
+/**
+ * @brief 1 once the event loop thread has been spawned (it must be joined on shutdown).
  */
-volatile sig_atomic_t ReqTestInject     = eDEACTIVATE;
+static int LoopThreadStarted = 0;
 
 /**
- * @brief Synchronization flag used to block the Provider thread until the Receiver thread finishes X11 setup.
+ * @brief Signals consumed through LoopSignalFd (blocked in every thread).
  */
-volatile sig_atomic_t ReqWaitForSetup   = eACTIVATE;      
+static sigset_t LoopSignalSet;
 
 /**
- * @brief POSIX Semaphore used to block and wake up the Provider thread without consuming CPU cycles.
+ * @brief epoll instance of the event loop.
  */
-static sem_t SemProviderWakeup;
+static int LoopEpollFd = -1;
 
 /**
- * @brief Thread handle for the OS signal listener (SIGINT, SIGUSR1, SIGUSR2).
+ * @brief signalfd receiving SIGUSR1/SIGUSR2/SIGINT/SIGTERM.
  */
-static pthread_t SignalRuntimeThread;
+static int LoopSignalFd = -1;
 
 /**
- * @brief Thread handle for the X11 event loop that continuously receives clipboard data.
+ * @brief eventfd waking the event loop (exit request, queued commands).
  */
-static pthread_t XClipboardRuntimeThread_Receiver;
+static int LoopWakeFd = -1;
 
 /**
- * @brief Thread handle for the background loop that serves clipboard data to other applications.
+ * @brief timerfd armed on the nearest capture/provide deadline (disarmed when there is none).
  */
-static pthread_t XClipboardRuntimeThread_Provider;
+static int LoopTimerFd = -1;
+
+/**
+ * @brief eventfd waking the UI (main) thread (popup request, exit request).
+ */
+static int UiWakeFd = -1;
+
+/**
+ * @brief Sources registered in the epoll set (stored in epoll_event.data.u32).
+ */
+enum eLoopSource {
+    eLOOP_SRC_X = 0,
+    eLOOP_SRC_SIGNAL,
+    eLOOP_SRC_WAKE,
+    eLOOP_SRC_TIMER
+};
 
 
 /**************************************************************************************************
- * INCR PROTOCOL (PROVIDER) SECTION ***************************************************************
- **************************************************************************************************/ 
+ * PROVIDE TRANSACTION (PROVIDER) SECTION *********************************************************
+ **************************************************************************************************/
 
 /**
- * @brief Maximum chunk size (64KB) for sending data via the INCR protocol.
+ * @brief Initial (and smallest) chunk size (64KB) for sending data via the INCR protocol.
  */
 #define INCR_CHUNK_SIZE 65536
 
 /**
- * @brief Pointer to the payload currently being transmitted to another application.
+ * @brief A requestor consuming a chunk within this many milliseconds gets a twice larger next chunk.
+ */
+#define INCR_CHUNK_FAST_MS 4
+
+/**
+ * @brief A requestor taking longer than this many milliseconds per chunk gets a twice smaller next chunk.
+ */
+#define INCR_CHUNK_SLOW_MS 50
+
+/**
+ * @brief Largest property write the server accepts (bytes), refreshed by InitRequestLimit().
+ * @note Payloads up to this size are served single-shot; INCR chunks never exceed it.
  */
-uint8_t *IncrData = NULL;
+static size_t ProvideWriteMax = INCR_CHUNK_SIZE;
 
 /**
- * @brief Total size in bytes of the payload being transmitted.
+ * @brief Safety timeout in milliseconds to automatically break a stuck transaction.
  */
-size_t IncrDataLen = 0;
+#define TRANSACTION_TIMEOUT_MS 5000
 
 /**
- * @brief Current byte offset indicating how much data has been successfully transmitted.
+ * @brief Maximum number of INCR transfers served concurrently.
  */
-size_t IncrOffset = 0;
+#define PROVIDE_SESSION_MAX 16
 
 /**
- * @brief The X11 Window ID of the application requesting the clipboard data.
+ * @brief A clipboard item being offered, shared by ActiveData and every session streaming it.
  */
-xcb_window_t IncrRequestor = XCB_NONE;
+typedef struct {
+    void               *Data;           /// Primary payload (MemBudget buffer, or Map.Base)
+    size_t              Len;            /// Primary payload size in bytes
+    sCodecMapping       Map;            /// Read-only view of the stored file when served zero-copy
+    sFlavourSet        *Flavours;       /// Extra targets, or NULL
+    int                 Refs;           /// 1 while it is the active item + 1 per session using it
+} sProvidePayload;
 
 /**
- * @brief The X11 Atom representing the property used to stage outgoing chunks.
+ * @brief State of one outgoing INCR transfer, keyed by (Requestor, Property).
  */
-xcb_atom_t IncrProperty = XCB_NONE;
+typedef struct {
+    int                 Active;         /// 1 while the transfer is in flight
+    xcb_window_t        Requestor;      /// Window receiving the data
+    xcb_atom_t          Property;       /// Requestor property used to stage outgoing chunks
+    xcb_atom_t          Target;         /// Requested data format (e.g., UTF8_STRING, image/png)
+    sProvidePayload    *Payload;        /// Item the data belongs to (one reference held)
+    const uint8_t      *Data;           /// Bytes being transmitted (primary or a flavour of Payload)
+    size_t              Len;            /// Total size in bytes of Data
+    size_t              Offset;         /// Bytes already handed to the requestor
+    size_t              ChunkSize;      /// Size of the next chunk, adapted to the requestor's pace
+    long long           LastSendMs;     /// When the last chunk was staged (turnaround measurement)
+    long long           DeadlineMs;     /// The session is evicted if the requestor stalls past it
+} sProvideSession;
 
 /**
- * @brief The X11 Atom representing the requested data format (e.g., UTF8_STRING, image/png).
+ * @brief The item currently offered on the clipboard (mirrored by ActiveData/ActiveFlavours).
  */
-xcb_atom_t IncrTarget = XCB_NONE;
+static sProvidePayload *ActivePayload = NULL;
 
+/**
+ * @brief Outgoing INCR transfers. Independent from captures: serving never blocks capturing.
+ */
+static sProvideSession ProvideSessions[PROVIDE_SESSION_MAX];
 
 /**************************************************************************************************
- * FULL-TRANSACTION LOCK & 128MB RAM CACHING (RECEIVER) SECTION ***********************************
- **************************************************************************************************/ 
+ * MULTI-TARGET CAPTURE (RECEIVER) SECTION ********************************************************
+ **************************************************************************************************/
+
+#if (CAPTURE_MULTI_TARGET == 1)
 
 /**
- * @brief Maximum size of the RAM cache buffer (128MB).
+ * @brief An extra target worth keeping next to the primary payload, with its size cap.
  */
-#define MAX_RAM_CACHE (128U * 1024U * 1024U)
+typedef struct {
+    const char         *Name;
+    size_t              Cap;
+} sFlavourSpec;
 
 /**
- * @brief Safety timeout in milliseconds to automatically break a stuck transaction.
+ * @brief Extra targets fetched in the same transaction as the primary one (if advertised).
+ * @note The primary target is never fetched twice; at most FLAVOUR_MAX entries are requested.
+ */
+static const sFlavourSpec FlavourSpecs[] = {
+    { "UTF8_STRING",    FLAVOUR_CAP_TEXT  },
+    { "text/plain",     FLAVOUR_CAP_TEXT  },
+    { "text/html",      FLAVOUR_CAP_TEXT  },
+    { "text/uri-list",  FLAVOUR_CAP_TEXT  },
+    { "text/rtf",       FLAVOUR_CAP_TEXT  },
+    { "image/png",      FLAVOUR_CAP_IMAGE },
+};
+
+#define FLAVOUR_SPEC_COUNT  ((int)(sizeof(FlavourSpecs) / sizeof(FlavourSpecs[0])))
+
+/**
+ * @brief Interned atoms of FlavourSpecs (same order).
+ */
+static xcb_atom_t FlavourSpecAtoms[FLAVOUR_SPEC_COUNT];
+
+/**
+ * @brief One property per in-flight extra target, so replies never overwrite each other.
  */
-#define TRANSACTION_TIMEOUT_MS 5000          
+static xcb_atom_t FlavourPropAtoms[FLAVOUR_MAX];
 
 /**
- * @brief Global lock flag to prevent interleaved or spamming transactions (0 = free, 1 = busy).
+ * @brief 1 once the read of FlavourPropAtoms[slot] was queued. Any value written there afterwards is
+ *        an INCR chunk nobody reads: it is deleted on arrival so the owner can finish its transfer.
  */
-volatile sig_atomic_t TransactionLock = 0;   
+static uint8_t FlavourDraining[FLAVOUR_MAX];
 
 /**
- * @brief Flag indicating whether the Receiver is currently processing an incoming INCR stream.
+ * @brief State of one extra target requested by a capture transaction.
  */
-static int IsReceivingIncr = 0;              
+typedef struct {
+    const sFlavourSpec         *Spec;       /// Requested target, NULL once dropped
+    xcb_atom_t                  Target;     /// Atom of Spec->Name
+    int                         HasCookie;  /// 1 once the SelectionNotify arrived and the read was queued
+    xcb_get_property_cookie_t   Cookie;     /// Pending read of FlavourPropAtoms[slot]
+} sFlavourSlot;
+
+#endif /*(CAPTURE_MULTI_TARGET == 1)*/
+
+/**************************************************************************************************
+ * CAPTURE TRANSACTION (RECEIVER) SECTION *********************************************************
+ **************************************************************************************************/
+
+/**
+ * @brief State of one incoming capture, keyed by (Selection, Property).
+ */
+typedef struct {
+    int                 Active;             /// 1 while the capture is in flight
+    xcb_atom_t          Selection;          /// Selection being captured (e.g., CLIPBOARD)
+    xcb_window_t        Owner;              /// Owner the data is fetched from
+    xcb_atom_t          Property;           /// Property on MyWindow receiving the primary target
+    xcb_timestamp_t     Time;               /// Ownership timestamp used for every conversion
+    long long           DeadlineMs;         /// Heartbeat deadline; the capture is aborted past it
+    long long           StartMs;            /// When the capture started (duration metric)
+    int                 IsReceivingIncr;    /// 1 while an INCR stream is being received
+    size_t              TotalBytesReceived; /// Bytes streamed to the capture sink so far
+    uint32_t            IncrSizeEst;        /// Total size announced in the INCR header (0 = unknown)
+    char                Filename[NAME_MAX]; /// Generated filename of the incoming item
+#if (CAPTURE_MULTI_TARGET == 1)
+    sFlavourSlot        Flavours[FLAVOUR_MAX];  /// Extra targets (slot i uses FlavourPropAtoms[i])
+    int                 FlavourCount;           /// Number of valid entries inside Flavours
+#endif /*(CAPTURE_MULTI_TARGET == 1)*/
+} sCaptureTxn;
+
+/**
+ * @brief The incoming capture. Captures are serialized by the capture sink (one file at a time);
+ *        owner changes arriving meanwhile wait in the pending queue.
+ */
+static sCaptureTxn CaptureTxn;
+
+/**************************************************************************************************
+ * PENDING CAPTURE QUEUE (RECEIVER) SECTION *******************************************************
+ **************************************************************************************************/
 
 /**
- * @brief Timestamp of the current X11 transaction used to prevent race conditions.
+ * @brief Maximum number of owner changes waiting for the current capture to finish.
+ * @note There is at most one entry per selection, so this only bounds the number of selections.
  */
-static xcb_timestamp_t CurrentTransactionTime = XCB_CURRENT_TIME;
+#define PENDING_CAPTURE_MAX 4
 
 /**
- * @brief Heartbeat timestamp (in milliseconds) used to track transaction timeouts.
+ * @brief An owner change seen while a capture was running.
  */
-static long long TransactionStartMs = 0;     
+typedef struct {
+    xcb_atom_t          Selection;  /// Selection that changed hands (the queue key)
+    xcb_window_t        Owner;      /// Most recent owner of that selection
+    xcb_timestamp_t     Timestamp;  /// Time the most recent owner claimed it
+} sPendingCapture;
 
 /**
- * @brief Pointer to the statically allocated 128MB RAM buffer for fast data ingestion.
+ * @brief FIFO of captures to start once the current one is done (oldest first).
  */
-static uint8_t *IncrRecvBuf = NULL;          
+static sPendingCapture PendingCaptures[PENDING_CAPTURE_MAX];
 
 /**
- * @brief Current write offset within the 128MB RAM cache.
+ * @brief Number of valid entries inside PendingCaptures.
  */
-static size_t IncrRecvOffset = 0;          
+static int PendingCaptureCount = 0;
+
+/**************************************************************************************************
+ * PIPELINED PROPERTY READ (RECEIVER) SECTION *****************************************************
+ **************************************************************************************************/
 
 /**
- * @brief Cumulative count of bytes received across all chunks and disk flushes.
+ * @brief Maximum number of xcb_get_property requests kept in flight while draining a property.
  */
-static size_t TotalBytesReceived = 0;      
+#define PROP_PIPELINE_DEPTH 8
 
 /**
- * @brief File handle used to flush the RAM cache to disk when full or finished.
+ * @brief Smallest slice (64KB) requested per xcb_get_property while draining.
  */
-FILE *IncrRecvFile = NULL;                   
+#define PROP_SLICE_MIN      (64U * 1024U)
 
 /**
- * @brief The generated filename for the current incoming clipboard item.
+ * @brief Largest slice (1MB) requested per xcb_get_property, matching one capture sink buffer.
  */
-char IncrRecvFilename[NAME_MAX];
+#define PROP_SLICE_MAX      (1U * 1024U * 1024U)
 
 /**************************************************************************************************
  * HELPER FUNCTIONS *******************************************************************************
- **************************************************************************************************/ 
+ **************************************************************************************************/
 
 /**
  * @brief Returns current time in milliseconds.
  */
 static inline long long GetNowMs(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    /// Monotonic: deadlines are armed on a CLOCK_MONOTONIC timerfd and must not jump with the wall clock
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
 /**
@@ -272,55 +423,412 @@ static inline void GetUniqueFilename(char *buf, size_t len, const char *ext) {
 }
 
 /**
- * @brief Pushes incoming data to the 128MB RAM Cache. Flushes to disk if full.
+ * @brief Pushes the deadline of a capture forward (called on every sign of progress).
+ */
+static inline void CaptureTxn_Heartbeat(sCaptureTxn *Txn) {
+    Txn->DeadlineMs = GetNowMs() + TRANSACTION_TIMEOUT_MS;
+}
+
+/**
+ * @brief Streams incoming data into the capture sink. The writer thread handles the disk.
+ * @param Txn The capture the data belongs to.
  * @param data The incoming byte payload.
  * @param len The length of the payload.
+ * @note The first failed write aborts the sink, so the capture is never committed truncated.
+ *       The transfer itself keeps being drained so the owner is not left waiting.
+ */
+static inline void PushToCache(sCaptureTxn *Txn, const uint8_t *data, size_t len) {
+    if (!CaptureSink_IsOpen()) return;
+
+    if (CaptureSink_Write(data, len) != OKE) {
+        xError("[Capture] Failed to stage %s after %zu bytes. Dropping it.", Txn->Filename, Txn->TotalBytesReceived);
+        CaptureSink_Abort();
+        return;
+    }
+    Txn->TotalBytesReceived += len;
+    Metrics_Add(eMET_BYTES_RECEIVED, len);
+}
+
+#if (CAPTURE_MULTI_TARGET == 1)
+
+/**
+ * @brief Drops every extra target of a capture, discarding reads still in flight.
+ */
+static void Flavours_Reset(sCaptureTxn *Txn) {
+    for (int i = 0; i < Txn->FlavourCount; i++) {
+        if (Txn->Flavours[i].HasCookie) xcb_discard_reply(Connection, Txn->Flavours[i].Cookie.sequence);
+    }
+    memset(Txn->Flavours, 0, sizeof(Txn->Flavours));
+    Txn->FlavourCount = 0;
+}
+
+/**
+ * @brief Queues a conversion for every advertised extra target. The caller flushes once.
+ * @param Txn The capture requesting the targets.
+ * @param Atoms Targets advertised by the owner.
+ * @param Count Number of advertised targets.
+ * @param Primary The target streamed to the capture sink (skipped here).
+ */
+static void Flavours_Request(sCaptureTxn *Txn, const xcb_atom_t *Atoms, int Count, xcb_atom_t Primary) {
+    Flavours_Reset(Txn);
+
+    for (int s = 0; s < FLAVOUR_SPEC_COUNT && Txn->FlavourCount < FLAVOUR_MAX; s++) {
+        if (FlavourSpecAtoms[s] == XCB_ATOM_NONE || FlavourSpecAtoms[s] == Primary) continue;
+
+        for (int i = 0; i < Count; i++) {
+            if (Atoms[i] != FlavourSpecAtoms[s]) continue;
+
+            int Slot = Txn->FlavourCount++;
+            Txn->Flavours[Slot].Spec = &FlavourSpecs[s];
+            Txn->Flavours[Slot].Target = FlavourSpecAtoms[s];
+            FlavourDraining[Slot] = 0;
+            xcb_delete_property(Connection, MyWindow, FlavourPropAtoms[Slot]);
+            xcb_convert_selection(Connection, MyWindow, Txn->Selection, FlavourSpecAtoms[s], FlavourPropAtoms[Slot], Txn->Time);
+            break;
+        }
+    }
+
+    if (Txn->FlavourCount > 0) xLog1("[Flavours] Requested %d extra target(s).", Txn->FlavourCount);
+}
+
+/**
+ * @brief Claims a SelectionNotify that answers an extra target.
+ * @return 1 if the event was consumed here, 0 if it belongs to a primary target.
+ * @note The property read is only queued; its reply is collected when the capture ends,
+ *       so extra targets never add a blocking round trip to the capture.
+ */
+static int Flavours_HandleNotify(sCaptureTxn *Txn, xcb_selection_notify_event_t *Nevent) {
+    for (int i = 0; Txn && i < Txn->FlavourCount; i++) {
+        sFlavourSlot *Slot = &Txn->Flavours[i];
+        if (!Slot->Spec || Slot->HasCookie || Slot->Target != Nevent->target) continue;
+        if (Nevent->property != XCB_NONE && Nevent->property != FlavourPropAtoms[i]) continue;
+
+        if (Nevent->property == XCB_NONE) {
+            /// Owner refused this flavour: nothing to read, the primary transfer goes on
+            Slot->Spec = NULL;
+        } else {
+            /// delete=1 answers an INCR header right away (the server deletes it along with the read),
+            /// so the owner never stalls on a flavour: its chunks are drained by Flavours_HandlePropertyNotify
+            Slot->Cookie = xcb_get_property(Connection, 1, MyWindow, FlavourPropAtoms[i], XCB_GET_PROPERTY_TYPE_ANY, 0, (uint32_t)((Slot->Spec->Cap + 3) / 4));
+            Slot->HasCookie = 1;
+            FlavourDraining[i] = 1;
+        }
+        return 1;
+    }
+
+    /// Late answer for a capture that already ended: clean our property and ignore it
+    for (int i = 0; i < FLAVOUR_MAX; i++) {
+        if (Nevent->property != XCB_NONE && Nevent->property == FlavourPropAtoms[i]) {
+            xcb_delete_property(Connection, MyWindow, FlavourPropAtoms[i]);
+            FlavourDraining[i] = 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Discards an INCR chunk written to a flavour property whose read was already queued.
+ * @return 1 if the event was consumed here, 0 otherwise.
+ * @note Deleting the chunk is the acknowledgement the owner waits for before sending the next one.
+ */
+static int Flavours_HandlePropertyNotify(xcb_property_notify_event_t *PropEv) {
+    for (int i = 0; i < FLAVOUR_MAX; i++) {
+        if (PropEv->atom != FlavourPropAtoms[i] || !FlavourDraining[i]) continue;
+        xcb_delete_property(Connection, MyWindow, FlavourPropAtoms[i]);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Collects the extra targets that arrived during a capture.
+ * @return Heap-allocated set (ownership to the caller), or NULL if nothing usable arrived.
+ */
+static sFlavourSet *Flavours_Collect(sCaptureTxn *Txn) {
+    sFlavourSet *Set = NULL;
+
+    for (int i = 0; i < Txn->FlavourCount; i++) {
+        sFlavourSlot *Slot = &Txn->Flavours[i];
+        if (!Slot->HasCookie) continue;
+
+        xcb_get_property_reply_t *r = xcb_get_property_reply(Connection, Slot->Cookie, NULL);
+        Slot->HasCookie = 0;
+        if (!r) continue;
+
+        int Len = xcb_get_property_value_length(r);
+        if (r->type == AtomIncr) {
+            xLog1("[Flavours] %s arrived as INCR. Draining it, skipped.", Slot->Spec->Name);
+        } else if (r->bytes_after > 0) {
+            xLog1("[Flavours] %s exceeds its %zu bytes cap. Skipped.", Slot->Spec->Name, Slot->Spec->Cap);
+        } else if (Len > 0) {
+            if (!Set) Set = calloc(1, sizeof(sFlavourSet));
+            if (Set && FlavourSet_Add(Set, Slot->Spec->Name, xcb_get_property_value(r), (size_t)Len) != OKE) {
+                xWarn("[Flavours] Could not keep %s (%d bytes).", Slot->Spec->Name, Len);
+            }
+        }
+
+        /// The server only deletes a property read in full: drop what the cap left behind
+        if (r->bytes_after > 0) xcb_delete_property(Connection, MyWindow, FlavourPropAtoms[i]);
+        free(r);
+    }
+
+    if (Set && Set->Count == 0) {
+        free(Set);
+        Set = NULL;
+    }
+    return Set;
+}
+
+#endif /*(CAPTURE_MULTI_TARGET == 1)*/
+
+/**
+ * @brief Removes the pending capture of a selection, if any.
+ * @param Selection The selection whose pending entry is dropped.
+ */
+static void PendingCapture_Remove(xcb_atom_t Selection) {
+    for (int i = 0; i < PendingCaptureCount; i++) {
+        if (PendingCaptures[i].Selection != Selection) continue;
+        memmove(&PendingCaptures[i], &PendingCaptures[i + 1], (size_t)(PendingCaptureCount - i - 1) * sizeof(sPendingCapture));
+        PendingCaptureCount--;
+        return;
+    }
+}
+
+/**
+ * @brief Records an owner change that arrived while a capture was running.
+ * @note Coalescing: a selection only ever holds its latest content, so a newer event for the
+ *       same selection (same owner or not) replaces the queued one instead of adding work.
+ */
+static void PendingCapture_Push(xcb_atom_t Selection, xcb_window_t Owner, xcb_timestamp_t Timestamp) {
+    for (int i = 0; i < PendingCaptureCount; i++) {
+        if (PendingCaptures[i].Selection != Selection) continue;
+        xLog1("[PENDING] Coalescing owner %u into queued capture (was %u).", Owner, PendingCaptures[i].Owner);
+        PendingCaptures[i].Owner = Owner;
+        PendingCaptures[i].Timestamp = Timestamp;
+        Metrics_Inc(eMET_CAPTURE_COALESCED);
+        return;
+    }
+
+    if (PendingCaptureCount >= PENDING_CAPTURE_MAX) {
+        xWarn("[PENDING] Queue full. Dropping oldest pending owner %u.", PendingCaptures[0].Owner);
+        PendingCapture_Remove(PendingCaptures[0].Selection);
+        Metrics_Inc(eMET_CAPTURE_DROPPED);
+    }
+    Metrics_Inc(eMET_CAPTURE_QUEUED);
+
+    PendingCaptures[PendingCaptureCount].Selection = Selection;
+    PendingCaptures[PendingCaptureCount].Owner = Owner;
+    PendingCaptures[PendingCaptureCount].Timestamp = Timestamp;
+    PendingCaptureCount++;
+    xLog1("[PENDING] Queued capture of owner %u (%d pending).", Owner, PendingCaptureCount);
+}
+
+/**
+ * @brief Returns the capture a SelectionNotify/PropertyNotify belongs to.
+ * @param Selection The selection of the event (XCB_ATOM_NONE to match any).
+ * @param Property The property on MyWindow the event refers to.
+ * @return The matching active capture, or NULL.
+ */
+static sCaptureTxn *CaptureTxn_Find(xcb_atom_t Selection, xcb_atom_t Property) {
+    if (!CaptureTxn.Active) return NULL;
+    if (Selection != XCB_ATOM_NONE && Selection != CaptureTxn.Selection) return NULL;
+    if (Property != XCB_NONE && Property != CaptureTxn.Property) return NULL;
+    return &CaptureTxn;
+}
+
+/**
+ * @brief Starts a capture and asks the owner of a selection for its TARGETS.
+ * @param Selection The selection to capture.
+ * @param Owner The owner window.
+ * @param Timestamp The time the owner claimed the selection.
+ */
+static void CaptureTxn_Start(xcb_atom_t Selection, xcb_window_t Owner, xcb_timestamp_t Timestamp) {
+    sCaptureTxn *Txn = &CaptureTxn;
+
+    xLog1("[XFixes] New Owner %u. Starting capture and cleaning property...", Owner);
+
+    memset(Txn, 0, sizeof(*Txn));
+    Txn->Active = 1;
+    Txn->Selection = Selection;
+    Txn->Owner = Owner;
+    Txn->Property = AtomProperty;
+    Txn->Time = Timestamp;
+    Txn->StartMs = GetNowMs();
+    CaptureTxn_Heartbeat(Txn);
+    Metrics_Inc(eMET_CAPTURE_STARTED);
+
+    xcb_delete_property(Connection, MyWindow, Txn->Property);
+
+    xcb_convert_selection(Connection, MyWindow, Txn->Selection, AtomTarget, Txn->Property, Txn->Time);
+    xcb_flush(Connection);
+}
+
+/**
+ * @brief Starts the oldest queued capture if no capture is running.
+ */
+static void StartNextPendingCapture(void) {
+    if (CaptureTxn.Active || PendingCaptureCount == 0) return;
+
+    sPendingCapture Next = PendingCaptures[0];
+    PendingCapture_Remove(Next.Selection);
+    CaptureTxn_Start(Next.Selection, Next.Owner, Next.Timestamp);
+}
+
+/**
+ * @brief Abandons a capture without keeping anything (timeout or fatal error).
+ */
+static void CaptureTxn_Abort(sCaptureTxn *Txn) {
+    CaptureSink_Abort();
+#if (CAPTURE_MULTI_TARGET == 1)
+    Flavours_Reset(Txn);
+#endif /*(CAPTURE_MULTI_TARGET == 1)*/
+    Txn->Active = 0;
+}
+
+/**
+ * @brief Finalizes a capture, commits it to the writer thread, and starts the next queued one.
+ * @note The item is pushed to XCBList by the writer thread once the last byte reaches the disk.
+ */
+static void CaptureTxn_Finish(sCaptureTxn *Txn) {
+    if (CaptureSink_IsOpen()) {
+#if (CAPTURE_MULTI_TARGET == 1)
+        sFlavourSet *Flavours = Flavours_Collect(Txn);
+        if (Flavours) CaptureSink_AttachFlavours(Flavours);
+#endif /*(CAPTURE_MULTI_TARGET == 1)*/
+        xLog1("[CaptureSink] Committing %s (%zu bytes).", Txn->Filename, Txn->TotalBytesReceived);
+        CaptureSink_Commit();
+        Metrics_Inc(eMET_CAPTURE_COMPLETED);
+        Metrics_Observe(eMET_H_CAPTURE_BYTES, Txn->TotalBytesReceived);
+        Metrics_Observe(eMET_H_CAPTURE_MS, (uint64_t)(GetNowMs() - Txn->StartMs));
+    }
+#if (CAPTURE_MULTI_TARGET == 1)
+    Flavours_Reset(Txn);
+#endif /*(CAPTURE_MULTI_TARGET == 1)*/
+
+    Txn->Active = 0;
+    xLog1("[Capture] Transaction finalized.");
+
+    /// Owner changes that arrived meanwhile are captured right away instead of being lost
+    StartNextPendingCapture();
+}
+
+/**
+ * @brief Picks the slice size for a drain so the remaining bytes spread across the pipeline.
+ * @param Remaining Bytes still to be read (from bytes_after or the announced INCR size).
+ * @return Slice length in 32-bit words, as expected by xcb_get_property.
+ */
+static inline uint32_t GetSliceWords(size_t Remaining) {
+    size_t Slice = Remaining / PROP_PIPELINE_DEPTH;
+    if (Slice < PROP_SLICE_MIN) Slice = PROP_SLICE_MIN;
+    if (Slice > PROP_SLICE_MAX) Slice = PROP_SLICE_MAX;
+    return (uint32_t)((Slice + 3) / 4);
+}
+
+/**
+ * @brief Reads the rest of a capture's property with several xcb_get_property requests in flight.
+ * @param Txn The capture being drained.
+ * @param WordOffset Offset (in 32-bit words) of the first byte not yet consumed.
+ * @param BytesAfter Bytes still stored on the server after WordOffset.
+ * @note Every request uses delete=True: the server only deletes the property on the reply
+ *       whose bytes_after is 0, so the last slice also acknowledges the chunk with no extra request.
  */
-static inline void PushToCache(const uint8_t *data, size_t len) {
-    size_t Written = 0;
-    while (Written < len) {
-        size_t SpaceLeft = MAX_RAM_CACHE - IncrRecvOffset;
-        size_t ToWrite = (len - Written < SpaceLeft) ? (len - Written) : SpaceLeft;
-        
-        memcpy(IncrRecvBuf + IncrRecvOffset, data + Written, ToWrite);
-        IncrRecvOffset += ToWrite;
-        Written += ToWrite;
-        TotalBytesReceived += ToWrite;
-
-        /// RAM is full (128MB reached) -> Flush to Disk to free up space
-        if (IncrRecvOffset == MAX_RAM_CACHE) {
-            if (IncrRecvFile) {
-                xLog1("[RAM CACHE] 128MB Full! Flushing to disk...");
-                fwrite(IncrRecvBuf, 1, MAX_RAM_CACHE, IncrRecvFile);
-                fflush(IncrRecvFile);
+static void DrainPropertyPipelined(sCaptureTxn *Txn, uint32_t WordOffset, uint32_t BytesAfter) {
+    xcb_get_property_cookie_t Cookies[PROP_PIPELINE_DEPTH];
+    int Head = 0, InFlight = 0;
+    size_t Remaining = BytesAfter;
+    uint32_t NextOffset = WordOffset;
+    uint32_t SliceWords = GetSliceWords(Remaining);
+
+    while (Remaining > 0 || InFlight > 0) {
+        /// Keep the pipeline full: queue every slice we already know the server holds
+        while (Remaining > 0 && InFlight < PROP_PIPELINE_DEPTH) {
+            uint32_t Words = (uint32_t)((Remaining + 3) / 4);
+            if (Words > SliceWords) Words = SliceWords;
+
+            Cookies[(Head + InFlight) % PROP_PIPELINE_DEPTH] =
+                xcb_get_property(Connection, 1, MyWindow, Txn->Property, XCB_GET_PROPERTY_TYPE_ANY, NextOffset, Words);
+            InFlight++;
+            NextOffset += Words;
+            Remaining = (Remaining > (size_t)Words * 4) ? Remaining - (size_t)Words * 4 : 0;
+        }
+
+        xcb_get_property_reply_t *r = xcb_get_property_reply(Connection, Cookies[Head], NULL);
+        Head = (Head + 1) % PROP_PIPELINE_DEPTH;
+        InFlight--;
+
+        int nLen = r ? xcb_get_property_value_length(r) : 0;
+        if (nLen > 0) PushToCache(Txn, xcb_get_property_value(r), nLen);
+
+        /// Property vanished or shrank under us: drop the now-pointless outstanding requests
+        if (!r || nLen == 0 || (r->bytes_after == 0 && InFlight > 0)) {
+            while (InFlight > 0) {
+                xcb_discard_reply(Connection, Cookies[Head].sequence);
+                Head = (Head + 1) % PROP_PIPELINE_DEPTH;
+                InFlight--;
             }
-            IncrRecvOffset = 0; /// Reset RAM pointer
+            Remaining = 0;
         }
+        if (r) free(r);
+    }
+}
+
+/**
+ * @brief Releases a flavour set owned by the provider.
+ */
+static void FreeFlavourSet(sFlavourSet *Set) {
+    if (!Set) return;
+    FlavourSet_Clear(Set);
+    free(Set);
+}
+
+/**
+ * @brief Drops one reference to an offered item, freeing it with the last one.
+ */
+static void ProvidePayload_Unref(sProvidePayload *Payload) {
+    if (!Payload || --Payload->Refs > 0) return;
+    if (Payload->Map.Base) Codec_UnmapFile(&Payload->Map);
+    else MemBudget_Free(Payload->Data);
+    FreeFlavourSet(Payload->Flavours);
+    free(Payload);
+}
+
+/**
+ * @brief Returns the outgoing transfer staged on (Requestor, Property), if any.
+ */
+static sProvideSession *ProvideSession_Find(xcb_window_t Requestor, xcb_atom_t Property) {
+    for (int i = 0; i < PROVIDE_SESSION_MAX; i++) {
+        sProvideSession *Session = &ProvideSessions[i];
+        if (Session->Active && Session->Requestor == Requestor && Session->Property == Property) return Session;
     }
+    return NULL;
 }
 
 /**
- * @brief Finalizes the transaction, flushes remaining RAM to disk, and unlocks the fortress.
+ * @brief Ends an outgoing transfer and drops its reference to the item.
  */
-static inline void FinalizeTransactionAndUnlock(void) {
-    if (IncrRecvFile) {
-        if (IncrRecvOffset > 0) {
-            xLog1("[RAM CACHE] Flushing remaining %zu bytes to disk.", IncrRecvOffset);
-            fwrite(IncrRecvBuf, 1, IncrRecvOffset, IncrRecvFile);
-            fflush(IncrRecvFile);
+static void ProvideSession_Release(sProvideSession *Session) {
+    ProvidePayload_Unref(Session->Payload);
+    memset(Session, 0, sizeof(*Session));
+}
+
+/**
+ * @brief Evicts every session whose requestor stopped consuming chunks.
+ * @param Now Current time in milliseconds.
+ * @return Number of free session slots afterwards.
+ */
+static int ProvideSession_EvictStalled(long long Now) {
+    int Free = 0;
+    for (int i = 0; i < PROVIDE_SESSION_MAX; i++) {
+        sProvideSession *Session = &ProvideSessions[i];
+        if (Session->Active && Now >= Session->DeadlineMs) {
+            xWarn("[Provide] Requestor %u stalled at %zu/%zu bytes. Evicting session.", Session->Requestor, Session->Offset, Session->Len);
+            ProvideSession_Release(Session);
+            Metrics_Inc(eMET_PROVIDE_EVICTED);
         }
-        fclose(IncrRecvFile);
-        IncrRecvFile = NULL;
-        XCBList_PushItem(IncrRecvFilename);
+        if (!Session->Active) Free++;
     }
-    
-    /// Reset States
-    IncrRecvOffset = 0;
-    TotalBytesReceived = 0;
-    IsReceivingIncr = 0;
-    TransactionLock = 0; /// UNLOCK THE FORTRESS
-    
-    xLog1("[FORTRESS] Transaction finalized and unlocked.");
+    return Free;
 }
 
 /**************************************************************************************************
@@ -390,10 +898,37 @@ void InitAtoms(xcb_connection_t *c) {
     AtomProperty  = GetAtomByName(c, PROP_NAME);
     AtomTimestamp = GetAtomByName(c, "TIMESTAMP"); 
     AtomIncr      = GetAtomByName(c, "INCR");
+
+#if (CAPTURE_MULTI_TARGET == 1)
+    char PropName[64];
+    for (int i = 0; i < FLAVOUR_SPEC_COUNT; i++) {
+        FlavourSpecAtoms[i] = GetAtomByName(c, FlavourSpecs[i].Name);
+    }
+    for (int i = 0; i < FLAVOUR_MAX; i++) {
+        snprintf(PropName, sizeof(PropName), "%s_F%d", PROP_NAME, i);
+        FlavourPropAtoms[i] = GetAtomByName(c, PropName);
+    }
+#endif /*(CAPTURE_MULTI_TARGET == 1)*/
     
     xExit1("InitAtoms");
 }
 
+/**
+ * @brief Derives the single-shot/INCR chunk limit from the server's maximum request length.
+ */
+void InitRequestLimit(xcb_connection_t *c) {
+    /// Enables BIG-REQUESTS when the server offers it; the length is in 4-byte units
+    uint64_t MaxBytes = (uint64_t)xcb_get_maximum_request_length(c) * 4U;
+    uint64_t Header = sizeof(xcb_change_property_request_t);
+    uint64_t Limit = (MaxBytes > Header) ? MaxBytes - Header : 0;
+
+    if (Limit > PROVIDE_WRITE_MAX) Limit = PROVIDE_WRITE_MAX;
+    if (Limit < INCR_CHUNK_SIZE) Limit = INCR_CHUNK_SIZE;
+    ProvideWriteMax = (size_t)Limit;
+
+    xLog1("[InitRequestLimit] Max request %llu bytes. Single-shot/INCR chunk limit %zu bytes.", (unsigned long long)MaxBytes, ProvideWriteMax);
+}
+
 /**
  * @brief Creates a hidden dummy window to receive XFixes events.
  */
@@ -442,67 +977,121 @@ void SubscribeClipboardEvents(xcb_connection_t *c, xcb_window_t window) {
 
 void SetClipboardData(xcb_connection_t *c, xcb_window_t win, void *data, size_t len, xcb_atom_t type) {
     xEntry1("SetClipboardData");
-    
-    long long Now = GetNowMs();
-    if (TransactionLock) {
-        if (Now - TransactionStartMs < TRANSACTION_TIMEOUT_MS) {
-            xWarn("[SetClipboardData] TransactionLock active; discarding SetClipboardData request.");
-            return;
-        } else {
-            xWarn("[SetClipboardData] TransactionLock timed out; forcing reset and accepting new data.");
-            TransactionLock = 0;
-            IncrRequestor = XCB_NONE;
-            IncrProperty  = XCB_NONE;
-            IncrTarget    = XCB_NONE;
-            IncrOffset    = 0;
-            IncrData      = NULL;
-            IncrDataLen   = 0;
-        }
-    }
 
-    if (ActiveData) {
-        free(ActiveData);
-    }
-    
-    ActiveData = malloc(len);
-    if (!ActiveData) {
-        xError("[SetClipboardData] Out of memory!");
-        ActiveData = NULL;
-        ActiveDataLen = 0;
-        ActiveDataType = 0;
+    void *Copy = MemBudget_Alloc(len);
+    if (!Copy) {
+        xError("[SetClipboardData] Memory budget exhausted!");
         return;
     }
-    memcpy(ActiveData, data, len);
-    ActiveDataLen = len;
+    memcpy(Copy, data, len);
+    SetClipboardDataOwned(c, win, Copy, len, type);
+
+    xExit1("SetClipboardData");
+}
+
+void SetClipboardDataOwned(xcb_connection_t *c, xcb_window_t win, void *data, size_t len, xcb_atom_t type) {
+    SetClipboardItemOwned(c, win, data, len, type, NULL);
+}
+
+/**
+ * @brief Makes a payload the active clipboard item and claims CLIPBOARD ownership.
+ * @param Payload Freshly built payload holding one reference, adopted by the provider.
+ */
+static void Internal_OfferPayload(xcb_connection_t *c, xcb_window_t win, sProvidePayload *Payload, xcb_atom_t type) {
+    /// Sessions still streaming the previous item keep their own reference to it; captures and
+    /// transfers never block (or discard) a new clipboard item.
+    ProvideSession_EvictStalled(GetNowMs());
+    ProvidePayload_Unref(ActivePayload);
+    MemBudget_Trim();
+
+    ActivePayload = Payload;
+    ActiveData = Payload->Data;
+    ActiveDataLen = Payload->Len;
     ActiveDataType = type;
+    ActiveFlavours = Payload->Flavours;
 
     xcb_set_selection_owner(c, win, AtomClipboard, XCB_CURRENT_TIME);
-    
+
     xcb_get_selection_owner_cookie_t ck = xcb_get_selection_owner(c, AtomClipboard);
     xcb_get_selection_owner_reply_t *r = xcb_get_selection_owner_reply(c, ck, NULL);
-    
+
     if (r && r->owner == win) {
         xLog1("[SetClipboardData] Successfully claimed Clipboard ownership!");
     } else {
         xError("[SetClipboardData] Failed to claim ownership.");
     }
-    
+
     if (r) free(r);
     xcb_flush(c);
-    
-    xExit1("SetClipboardData");
+}
+
+void SetClipboardItemOwned(xcb_connection_t *c, xcb_window_t win, void *data, size_t len, xcb_atom_t type, sFlavourSet *flavours) {
+    xEntry1("SetClipboardItemOwned");
+
+    sProvidePayload *Payload = calloc(1, sizeof(sProvidePayload));
+    if (!Payload) {
+        xError("[SetClipboardData] Out of memory!");
+        MemBudget_Free(data);
+        FreeFlavourSet(flavours);
+        return;
+    }
+    Payload->Data = data;
+    Payload->Len = len;
+    Payload->Flavours = flavours;
+    Payload->Refs = 1;
+
+    Internal_OfferPayload(c, win, Payload, type);
+
+    xExit1("SetClipboardItemOwned");
+}
+
+void SetClipboardItemMapped(xcb_connection_t *c, xcb_window_t win, sCodecMapping *map, xcb_atom_t type, sFlavourSet *flavours) {
+    xEntry1("SetClipboardItemMapped");
+
+    sProvidePayload *Payload = calloc(1, sizeof(sProvidePayload));
+    if (!Payload) {
+        xError("[SetClipboardData] Out of memory!");
+        Codec_UnmapFile(map);
+        FreeFlavourSet(flavours);
+        return;
+    }
+    Payload->Map = *map;
+    Payload->Data = (void *)map->Base;
+    Payload->Len = map->Len;
+    Payload->Flavours = flavours;
+    Payload->Refs = 1;
+    map->Base = NULL;
+    map->Len = 0;
+
+    Internal_OfferPayload(c, win, Payload, type);
+
+    xExit1("SetClipboardItemMapped");
 }
 
 /**************************************************************************************************
  * SIGNAL HANDLER SECTION *************************************************************************
  **************************************************************************************************/ 
 
-void SignalEventHandler(int SigNum) {
-    xLog1("[SignalEventHandler] Was called with SigNum=%d", SigNum);
+/**
+ * @brief Adds one to an eventfd counter (async-signal-safe).
+ */
+static inline void KickEventFd(int Fd) {
+    uint64_t One = 1;
+    if (Fd >= 0) {
+        ssize_t Ret = write(Fd, &One, sizeof(One));
+        (void)Ret;
+    }
+}
 
+/**
+ * @brief Applies a signal: raises the matching flag and wakes the thread acting on it.
+ * @note Async-signal-safe: only flags and eventfd writes.
+ */
+static void DispatchSignal(int SigNum) {
     if (SigNum == SIGINT || SigNum == SIGTERM) {
         RequestExit = eACTIVATE;
-        xLog1("[SignalEventHandler] Activate RequestExit!");
+        KickEventFd(LoopWakeFd);
+        KickEventFd(UiWakeFd);
     } 
     else if (SigNum == SIGUSR1) {
         if (TogglePopUpStatus == eHIDEN || TogglePopUpStatus == eNOT_STARTED) {
@@ -511,21 +1100,51 @@ void SignalEventHandler(int SigNum) {
         else if (TogglePopUpStatus == eSHOWN) {
             TogglePopUpStatus = eREQ_HIDE;
         }
+        KickEventFd(UiWakeFd);
     }
     else if (SigNum == SIGUSR2) {
-        xLog1("[SignalEventHandler] Injecting selected item into X11 Clipboard...");
-        ReqTestInject = eACTIVATE;
-        sem_post(&SemProviderWakeup);
+        /// Selected item, else the newest one
+        sCmd Cmd = { .Type = eCMD_INJECT_INDEX, .Index = -1 };
+        ClipboardCaptureSubmit(&Cmd);
     }
 }
 
+void SignalEventHandler(int SigNum) {
+    DispatchSignal(SigNum);
+}
+
 RetType RegisterSignal(void) {
     xEntry1("RegisterSignal");
 
-    signal(SIGUSR2, SignalEventHandler); 
-    signal(SIGUSR1, SignalEventHandler); 
-    signal(SIGINT,  SignalEventHandler); 
-    signal(SIGTERM, SignalEventHandler); 
+    sigemptyset(&LoopSignalSet);
+    sigaddset(&LoopSignalSet, SIGUSR1);
+    sigaddset(&LoopSignalSet, SIGUSR2);
+    sigaddset(&LoopSignalSet, SIGINT);
+    sigaddset(&LoopSignalSet, SIGTERM);
+
+    /// Handlers only run if a signal lands while unblocked (e.g., while spawning Rofi);
+    /// everything else is read from the signalfd by the event loop.
+    struct sigaction Action;
+    memset(&Action, 0, sizeof(Action));
+    Action.sa_handler = SignalEventHandler;
+    Action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &Action, NULL);
+    sigaction(SIGUSR2, &Action, NULL);
+    sigaction(SIGINT,  &Action, NULL);
+    sigaction(SIGTERM, &Action, NULL);
+
+    /// Peers that go away (a requestor, Rofi closing its stdin early) must surface as EPIPE,
+    /// not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+
+    /// Block before any thread is spawned so every thread inherits the mask
+    if (pthread_sigmask(SIG_BLOCK, &LoopSignalSet, NULL) != 0) return ERR;
+
+    LoopSignalFd = signalfd(-1, &LoopSignalSet, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (LoopSignalFd < 0) {
+        xError("[RegisterSignal] signalfd failed: %s", strerror(errno));
+        return ERR;
+    }
 
     xLog1("[RegisterSignal] Listening for OS signals... (PID: %d)", getpid());
 
@@ -533,34 +1152,23 @@ RetType RegisterSignal(void) {
     return OKE; 
 }
 
-RetType SignalRuntime(int Param) {
-    (void)Param;
-    xEntry1("SignalRuntime");
-
-    RegisterSignal();
-
-    while (1) {
-        pause(); 
-
-        if (RequestExit != 0) {
-            xLog1("[SignalRuntime] Exit flag detected. Stopping signal thread...");
-            break;
-        }
+void ClipboardCaptureWaitUiRequest(void) {
+    uint64_t Count;
+    while (read(UiWakeFd, &Count, sizeof(Count)) < 0 && errno == EINTR) {}
+}
 
-        if (TogglePopUpStatus == eREQ_SHOW) {
-            xLog1("[SignalRuntime] Action required: SHOW PopUp!");
-        } 
-        else if (TogglePopUpStatus == eREQ_HIDE) {
-            xLog1("[SignalRuntime] Action required: HIDE PopUp!");
-        }
-    }
+int ClipboardCaptureGetUiFd(void) {
+    return UiWakeFd;
+}
 
-    xExit1("SignalRuntime");
-    return OKE;
+RetType ClipboardCaptureSubmit(const sCmd *Cmd) {
+    RetType Ret = CmdQueue_Push(Cmd);
+    if (Ret == OKE) KickEventFd(LoopWakeFd);
+    return Ret;
 }
 
 /**************************************************************************************************
- * CLIPBOARD EVENT HANDLERS IMPLEMENTATION (FULL-TRANSACTION FORTRESS) ****************************
+ * CLIPBOARD EVENT HANDLERS IMPLEMENTATION (TRANSACTION OBJECTS) **********************************
  **************************************************************************************************/
 
 /**
@@ -568,42 +1176,33 @@ RetType SignalRuntime(int Param) {
  */
 void HandleXFixesNotify(xcb_generic_event_t *Event) {
     xcb_xfixes_selection_notify_event_t *Sevent = (xcb_xfixes_selection_notify_event_t *)Event;
-    if (Sevent->owner == MyWindow) return;
-
-    long long Now = GetNowMs();
+    if (Sevent->owner == MyWindow) {
+        /// We own the selection now: whatever was queued for it no longer exists
+        PendingCapture_Remove(Sevent->selection);
+        return;
+    }
 
-    /// [FORTRESS LOCK]: Ignore spamming if we are busy handling an active transaction
-    if (TransactionLock) {
-        if (Now - TransactionStartMs < TRANSACTION_TIMEOUT_MS) {
-            xLog1("[XFixes] FORTRESS LOCK: Discarding new owner %u.", Sevent->owner);
+    /// Only one capture streams to the sink at a time: queue (and coalesce) owner changes meanwhile.
+    /// Outgoing transfers have their own transaction objects and never hold captures back.
+    if (CaptureTxn.Active) {
+        if (GetNowMs() < CaptureTxn.DeadlineMs) {
+            PendingCapture_Push(Sevent->selection, Sevent->owner, Sevent->timestamp);
             return;
-        } else {
-            xWarn("[XFixes] TIMEOUT: Previous transaction stuck. Breaking lock.");
-            if (IncrRecvFile) { fclose(IncrRecvFile); IncrRecvFile = NULL; }
-            IncrRecvOffset = 0;
-            TotalBytesReceived = 0;
-            IsReceivingIncr = 0;
-            TransactionLock = 0;
         }
+        xWarn("[XFixes] TIMEOUT: Previous capture stuck. Aborting it.");
+        CaptureTxn_Abort(&CaptureTxn);
+        Metrics_Inc(eMET_CAPTURE_TIMEOUT);
     }
 
-    xLog1("[XFixes] New Owner %u. Locking transaction and cleaning property...", Sevent->owner);
-    
-    TransactionLock = 1; 
-    TransactionStartMs = Now;
-    CurrentTransactionTime = Sevent->timestamp;
-
-    xcb_delete_property(Connection, MyWindow, AtomProperty);
-    xcb_flush(Connection);
-
-    xcb_convert_selection(Connection, MyWindow, AtomClipboard, AtomTarget, AtomProperty, CurrentTransactionTime);
-    xcb_flush(Connection);
+    /// This event is newer than anything queued for the same selection
+    PendingCapture_Remove(Sevent->selection);
+    CaptureTxn_Start(Sevent->selection, Sevent->owner, Sevent->timestamp);
 }
 
 /**
  * @brief Handle format negotiation and select the best media type.
  */
-static inline void HandleSelectionNotify_Negotiate(xcb_selection_notify_event_t *Nevent, void *Data, int ByteLen) {
+static inline void HandleSelectionNotify_Negotiate(sCaptureTxn *Txn, void *Data, int ByteLen) {
     xcb_atom_t *Atoms = (xcb_atom_t *)Data;
     int Count = ByteLen / sizeof(xcb_atom_t);
     xcb_atom_t Target = XCB_ATOM_NONE;
@@ -617,158 +1216,164 @@ static inline void HandleSelectionNotify_Negotiate(xcb_selection_notify_event_t
 
     if (Target != XCB_ATOM_NONE) {
         xLog1("[Negotiate] Chosen Target: %u. Requesting data...", Target);
-        
-        TransactionStartMs = GetNowMs(); /// Update heartbeat
-        
-        xcb_delete_property(Connection, MyWindow, AtomProperty);
-        xcb_flush(Connection);
-        
-        xcb_convert_selection(Connection, MyWindow, AtomClipboard, Target, AtomProperty, CurrentTransactionTime);
-        xcb_flush(Connection);
+
+        CaptureTxn_Heartbeat(Txn);
+
+        xcb_delete_property(Connection, MyWindow, Txn->Property);
+
+#if (CAPTURE_MULTI_TARGET == 1)
+        /// Extra targets go out first, in the same flush: their answers are usually in before
+        /// the primary payload finishes, so the whole item costs about one extra round trip.
+        Flavours_Request(Txn, Atoms, Count, Target);
+#endif /*(CAPTURE_MULTI_TARGET == 1)*/
+
+        xcb_convert_selection(Connection, MyWindow, Txn->Selection, Target, Txn->Property, Txn->Time);
     } else {
-        xWarn("[Negotiate] No supported target found. Unlocking.");
-        FinalizeTransactionAndUnlock();
+        xWarn("[Negotiate] No supported target found. Finishing.");
+        CaptureTxn_Finish(Txn);
     }
 }
 
 /**
- * @brief Handles the initial response. Sets up the INCR RAM cache or saves Single-shot data.
+ * @brief Handles the initial response. Opens the capture sink for INCR or saves Single-shot data.
  */
-static inline void HandleSelectionNotify_ReceiveAndSave(xcb_selection_notify_event_t *Nevent, xcb_get_property_reply_t *reply, void *Data, int ByteLen) {
+static inline void HandleSelectionNotify_ReceiveAndSave(sCaptureTxn *Txn, xcb_selection_notify_event_t *Nevent, xcb_get_property_reply_t *reply, void *Data, int ByteLen) {
     const char *Ext = (Nevent->target == AtomPng) ? "png" : (Nevent->target == AtomJpeg) ? "jpg" : (Nevent->target == AtomBmp) ? "bmp" : "txt";
-    
-    GetUniqueFilename(IncrRecvFilename, sizeof(IncrRecvFilename), Ext);
-    char FullPath[PATH_MAX];
-    snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, IncrRecvFilename);
-    
-    if (IncrRecvFile) fclose(IncrRecvFile);
-    IncrRecvFile = fopen(FullPath, "wb");
-    
-    if (!IncrRecvFile) {
-        xError("[Receive] Failed to open file! Unlocking.");
-        FinalizeTransactionAndUnlock();
+
+    GetUniqueFilename(Txn->Filename, sizeof(Txn->Filename), Ext);
+
+    /// Single-shot replies announce their full size up front: ByteLen + bytes_after
+    size_t SizeHint = (reply->type == AtomIncr) ? 0 : (size_t)ByteLen + reply->bytes_after;
+
+    if (CaptureSink_Open(Txn->Filename, SizeHint) != OKE) {
+        xError("[Receive] Failed to open capture sink! Finishing.");
+        CaptureTxn_Finish(Txn);
         return;
     }
 
-    IncrRecvOffset = 0;
-    TotalBytesReceived = 0;
+    Txn->TotalBytesReceived = 0;
 
     if (reply->type == AtomIncr) {
         uint32_t SizeEst = 0;
         if (ByteLen >= 4) memcpy(&SizeEst, Data, 4);
-        
-        xLog1("[INCR] Started! Est Size: %u bytes. Processing to 128MB RAM Cache...", SizeEst);
-        IsReceivingIncr = 1;
-        TransactionStartMs = GetNowMs(); /// Update heartbeat
 
-        xcb_delete_property(Connection, MyWindow, AtomProperty);
-        xcb_flush(Connection);
-    } 
+        xLog1("[INCR] Started! Est Size: %u bytes. Streaming to capture sink...", SizeEst);
+        CaptureSink_SetSizeHint(SizeEst);
+        Txn->IncrSizeEst = SizeEst;
+        Txn->IsReceivingIncr = 1;
+        CaptureTxn_Heartbeat(Txn);
+
+        /// The INCR header was already deleted by the get-with-delete in HandleSelectionNotify,
+        /// which is the owner's cue to start sending chunks.
+    }
     else {
-        xLog1("[Single-shot] Received directly. Pumping to RAM Cache...");
-        
-        PushToCache((uint8_t *)Data, ByteLen);
-        
-        uint32_t BytesAfter = reply->bytes_after;
-        uint32_t WordOffset = (ByteLen + 3) / 4; 
-
-        /// Drain loop if X Server hides data in Single-shot
-        while (BytesAfter > 0) {
-            
-            xcb_get_property_cookie_t ck = xcb_get_property(Connection, 0, MyWindow, AtomProperty, XCB_GET_PROPERTY_TYPE_ANY, WordOffset, 262144);
-            xcb_get_property_reply_t *r = xcb_get_property_reply(Connection, ck, NULL);
-            if (!r) break;
-            
-            int nLen = xcb_get_property_value_length(r);
-            if (nLen > 0) {
-                PushToCache(xcb_get_property_value(r), nLen);
-                WordOffset += (nLen + 3) / 4;
+        xLog1("[Single-shot] Received directly. Streaming to capture sink...");
+
+        PushToCache(Txn, (uint8_t *)Data, ByteLen);
+
+        /// Drain whatever the first reply could not carry, several slices in flight at once.
+        /// The last slice deletes the property, so no separate delete request is needed.
+        if (reply->bytes_after > 0) {
+            DrainPropertyPipelined(Txn, (ByteLen + 3) / 4, reply->bytes_after);
+        }
+
+        xLog1("[Single-shot] DONE. Final size: %zu bytes.", Txn->TotalBytesReceived);
+
+        CaptureTxn_Finish(Txn);
+    }
+}
+
+/**
+ * @brief Receives one INCR chunk of a capture.
+ */
+static void HandlePropertyNotify_Capture(sCaptureTxn *Txn) {
+    CaptureTxn_Heartbeat(Txn); /// Update heartbeat to prevent timeout
+
+    /// First slice sized from what is left of the announced INCR total; get-with-delete
+    /// acknowledges the chunk in the same round trip whenever it fits in one reply.
+    size_t Expected = (Txn->IncrSizeEst > Txn->TotalBytesReceived) ? Txn->IncrSizeEst - Txn->TotalBytesReceived : 0;
+    size_t FirstSlice = (Expected > 0 && Expected < PROP_SLICE_MAX) ? Expected : PROP_SLICE_MAX;
+    uint32_t FirstWords = (uint32_t)((FirstSlice + 3) / 4);
+
+    xcb_get_property_cookie_t ck = xcb_get_property(Connection, 1, MyWindow, Txn->Property, XCB_GET_PROPERTY_TYPE_ANY, 0, FirstWords);
+    xcb_get_property_reply_t *r = xcb_get_property_reply(Connection, ck, NULL);
+
+    if (r) {
+        int ChunkLen = xcb_get_property_value_length(r);
+
+        if (ChunkLen > 0) {
+            Metrics_Inc(eMET_INCR_CHUNKS_RECEIVED);
+            PushToCache(Txn, xcb_get_property_value(r), ChunkLen);
+
+            /// THE DRAIN: Exhaust the current X Server property (pipelined). The final
+            /// slice deletes it, which signals the sender to stage the next chunk.
+            if (r->bytes_after > 0) {
+                DrainPropertyPipelined(Txn, (ChunkLen + 3) / 4, r->bytes_after);
             }
-            BytesAfter = r->bytes_after;
-            free(r);
         }
-        
-        xLog1("[Single-shot] DONE. Final size: %zu bytes.", TotalBytesReceived);
-        
-        xcb_delete_property(Connection, MyWindow, AtomProperty);
-        xcb_flush(Connection);
-        
-        FinalizeTransactionAndUnlock();
+        else {
+            /// 0-byte chunk means EOF (already deleted by the read). Close transaction.
+            xLog1("[INCR DONE] Total transferred: %zu bytes. Finalizing...", Txn->TotalBytesReceived);
+            CaptureTxn_Finish(Txn);
+        }
+        free(r);
+    }
+}
+
+/**
+ * @brief Stages the next INCR chunk of an outgoing transfer (the requestor consumed the last one).
+ */
+static void HandlePropertyNotify_Provide(sProvideSession *Txn) {
+    long long Now = GetNowMs();
+    Txn->DeadlineMs = Now + TRANSACTION_TIMEOUT_MS;
+
+    /// Grow the chunk while the requestor keeps up, shrink it when it lags behind
+    long long Turnaround = Now - Txn->LastSendMs;
+    if (Turnaround <= INCR_CHUNK_FAST_MS && Txn->ChunkSize * 2 <= ProvideWriteMax) {
+        Txn->ChunkSize *= 2;
+    } else if (Turnaround > INCR_CHUNK_SLOW_MS && Txn->ChunkSize / 2 >= INCR_CHUNK_SIZE) {
+        Txn->ChunkSize /= 2;
+    }
+    Txn->LastSendMs = Now;
+
+    size_t BytesLeft = Txn->Len - Txn->Offset;
+    if (BytesLeft > 0) {
+        size_t ChunkSize = (BytesLeft > Txn->ChunkSize) ? Txn->ChunkSize : BytesLeft;
+
+        /// @brief xcb_change_property changes a property on a window.
+        /// @param Mode XCB_PROP_MODE_REPLACE overwrites the property.
+        /// @param Format 8 (8-bit elements for binary stream).
+        xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, Txn->Requestor, Txn->Property, Txn->Target, 8, ChunkSize, Txn->Data + Txn->Offset);
+        Txn->Offset += ChunkSize;
+        Metrics_Inc(eMET_INCR_CHUNKS_SENT);
+        Metrics_Add(eMET_BYTES_PROVIDED, ChunkSize);
+    } else {
+        uint8_t EOF_D = 0;
+        xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, Txn->Requestor, Txn->Property, Txn->Target, 8, 0, &EOF_D);
+        ProvideSession_Release(Txn);
     }
 }
 
 /**
- * @brief Handles Property change events (INCR chunk stream).
+ * @brief Handles Property change events, routed to the transaction owning (window, property).
  */
 void HandlePropertyNotify(xcb_generic_event_t *Event) {
     xcb_property_notify_event_t *PropEv = (xcb_property_notify_event_t *)Event;
-    
-    /// --- [RECEIVER MODE] ---
-    if (IsReceivingIncr && PropEv->window == MyWindow && PropEv->atom == AtomProperty && PropEv->state == XCB_PROPERTY_NEW_VALUE) {
-        
-        TransactionStartMs = GetNowMs(); /// Update heartbeat to prevent timeout
-
-        xcb_get_property_cookie_t ck = xcb_get_property(Connection, 0, MyWindow, AtomProperty, XCB_GET_PROPERTY_TYPE_ANY, 0, 262144);
-        xcb_get_property_reply_t *r = xcb_get_property_reply(Connection, ck, NULL);
-        
-        if (r) {
-            int ChunkLen = xcb_get_property_value_length(r);
-            uint32_t BytesAfter = r->bytes_after;
-
-            if (ChunkLen > 0) {
-                PushToCache(xcb_get_property_value(r), ChunkLen);
-
-                /// THE DRAIN: Exhaust the current X Server property before deleting it
-                uint32_t WordOffset = (ChunkLen + 3) / 4;
-                while (BytesAfter > 0) {
-                    xcb_get_property_cookie_t nck = xcb_get_property(Connection, 0, MyWindow, AtomProperty, XCB_GET_PROPERTY_TYPE_ANY, WordOffset, 262144);
-                    xcb_get_property_reply_t *nr = xcb_get_property_reply(Connection, nck, NULL);
-                    if (!nr) break;
-
-                    int nLen = xcb_get_property_value_length(nr);
-                    if (nLen > 0) {
-                        PushToCache(xcb_get_property_value(nr), nLen);
-                        WordOffset += (nLen + 3) / 4;
-                    }
-                    BytesAfter = nr->bytes_after;
-                    free(nr);
-                }
 
-                /// Signal the sender that we have exhausted the chunk
-                xcb_delete_property(Connection, MyWindow, AtomProperty);
-                xcb_flush(Connection);
-            } 
-            else {
-                /// 0-byte chunk means EOF. Close transaction.
-                xLog1("[INCR DONE] Total transferred: %zu bytes. Finalizing...", TotalBytesReceived);
-                xcb_delete_property(Connection, MyWindow, AtomProperty);
-                xcb_flush(Connection);
-                
-                FinalizeTransactionAndUnlock();
-            }
-            free(r);
-        }
-        return; 
+    /// --- [CAPTURE] New INCR chunk staged on our window ---
+    if (PropEv->window == MyWindow && PropEv->state == XCB_PROPERTY_NEW_VALUE) {
+#if (CAPTURE_MULTI_TARGET == 1)
+        if (Flavours_HandlePropertyNotify(PropEv)) return;
+#endif /*(CAPTURE_MULTI_TARGET == 1)*/
+        sCaptureTxn *Capture = CaptureTxn_Find(XCB_ATOM_NONE, PropEv->atom);
+        if (Capture && Capture->IsReceivingIncr) HandlePropertyNotify_Capture(Capture);
+        return;
     }
-    
-    /// --- [PROVIDER MODE] ---
-    if (PropEv->state == XCB_PROPERTY_DELETE && PropEv->window == IncrRequestor && PropEv->atom == IncrProperty) {
-        size_t BytesLeft = IncrDataLen - IncrOffset;
-        if (BytesLeft > 0) {
-            size_t ChunkSize = (BytesLeft > INCR_CHUNK_SIZE) ? INCR_CHUNK_SIZE : BytesLeft;
-            
-            /// @brief xcb_change_property changes a property on a window.
-            /// @param Mode XCB_PROP_MODE_REPLACE overwrites the property.
-            /// @param Format 8 (8-bit elements for binary stream).
-            xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, IncrRequestor, IncrProperty, IncrTarget, 8, ChunkSize, (uint8_t *)IncrData + IncrOffset);
-            IncrOffset += ChunkSize;
-        } else {
-            uint8_t EOF_D = 0;
-            xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, IncrRequestor, IncrProperty, IncrTarget, 8, 0, &EOF_D);
-            IncrRequestor = XCB_NONE;
-            TransactionLock = 0; /// Unlock provider
-        }
-        xcb_flush(Connection);
+
+    /// --- [PROVIDE] Requestor consumed the previous chunk ---
+    if (PropEv->state == XCB_PROPERTY_DELETE) {
+        sProvideSession *Provide = ProvideSession_Find(PropEv->window, PropEv->atom);
+        if (Provide) HandlePropertyNotify_Provide(Provide);
     }
 }
 
@@ -777,16 +1382,28 @@ void HandlePropertyNotify(xcb_generic_event_t *Event) {
  */
 void HandleSelectionNotify(xcb_generic_event_t *Event) {
     xcb_selection_notify_event_t *Nevent = (xcb_selection_notify_event_t *)Event;
+    sCaptureTxn *Txn = CaptureTxn_Find(Nevent->selection, XCB_NONE);
+
+#if (CAPTURE_MULTI_TARGET == 1)
+    /// Answers for extra targets must never finalize (or reject) the primary transfer
+    if (Flavours_HandleNotify(Txn, Nevent)) return;
+#endif /*(CAPTURE_MULTI_TARGET == 1)*/
+
+    if (!Txn || (Nevent->property != XCB_NONE && Nevent->property != Txn->Property)) {
+        xLog1("[SelectionNotify] No capture waiting for this answer. Ignored.");
+        return;
+    }
 
     if (Nevent->property == XCB_NONE) {
-        xWarn("[SelectionNotify] Conversion REJECTED. Unlocking.");
-        xcb_delete_property(Connection, MyWindow, AtomProperty);
-        xcb_flush(Connection);
-        FinalizeTransactionAndUnlock();
+        xWarn("[SelectionNotify] Conversion REJECTED. Finishing.");
+        xcb_delete_property(Connection, MyWindow, Txn->Property);
+        CaptureTxn_Finish(Txn);
         return;
     }
 
-    xcb_get_property_cookie_t cookie = xcb_get_property(Connection, 0, MyWindow, AtomProperty, XCB_GET_PROPERTY_TYPE_ANY, 0, 2097152);
+    /// Get-with-delete: small replies (TARGETS, INCR header, single-shot payloads) are consumed and
+    /// removed in one request. Larger ones are kept until the pipelined drain reads the last slice.
+    xcb_get_property_cookie_t cookie = xcb_get_property(Connection, 1, MyWindow, Txn->Property, XCB_GET_PROPERTY_TYPE_ANY, 0, 2097152);
     xcb_get_property_reply_t *reply = xcb_get_property_reply(Connection, cookie, NULL);
 
     if (reply) {
@@ -795,22 +1412,84 @@ void HandleSelectionNotify(xcb_generic_event_t *Event) {
 
         if (ByteLen > 0) {
             if (Nevent->target == AtomTarget) {
-                HandleSelectionNotify_Negotiate(Nevent, Data, ByteLen);
+                HandleSelectionNotify_Negotiate(Txn, Data, ByteLen);
             }
-            else if (Nevent->target == AtomUtf8 || Nevent->target == AtomPng || 
+            else if (Nevent->target == AtomUtf8 || Nevent->target == AtomPng ||
                      Nevent->target == AtomJpeg || Nevent->target == AtomBmp) {
-                HandleSelectionNotify_ReceiveAndSave(Nevent, reply, Data, ByteLen);
+                HandleSelectionNotify_ReceiveAndSave(Txn, Nevent, reply, Data, ByteLen);
             }
         } else {
-            xWarn("[SelectionNotify] Empty property. Unlocking.");
-            xcb_delete_property(Connection, MyWindow, AtomProperty);
-            xcb_flush(Connection);
-            FinalizeTransactionAndUnlock();
+            xWarn("[SelectionNotify] Empty property. Finishing.");
+            xcb_delete_property(Connection, MyWindow, Txn->Property);
+            CaptureTxn_Finish(Txn);
         }
         free(reply);
     } else {
-        FinalizeTransactionAndUnlock();
+        CaptureTxn_Finish(Txn);
+    }
+}
+
+/**
+ * @brief Writes a payload to the requestor's property, switching to INCR when it is too large.
+ * @param Req The selection request being answered.
+ * @param Property The property to write to.
+ * @param Payload The item Data belongs to (referenced by the INCR session).
+ * @param Data Payload bytes (primary data or one of Payload's flavours).
+ * @param Len Payload size in bytes.
+ * @param Type Target atom announced as the property type.
+ * @return 1 if the payload was written (or the INCR transfer started), 0 if every session is busy.
+ */
+static int ServeSelectionPayload(xcb_selection_request_event_t *Req, xcb_atom_t Property, sProvidePayload *Payload, const uint8_t *Data, size_t Len, xcb_atom_t Type) {
+    Metrics_Observe(eMET_H_PROVIDE_BYTES, Len);
+    if (Len <= ProvideWriteMax) {
+        xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, Req->requestor, Property, Type, 8, Len, Data);
+        Metrics_Add(eMET_BYTES_PROVIDED, Len);
+        return 1;
+    }
+
+    /// Same requestor asking again on the same property: restart its session from scratch
+    sProvideSession *Txn = ProvideSession_Find(Req->requestor, Property);
+    if (Txn) ProvideSession_Release(Txn);
+
+    if (ProvideSession_EvictStalled(GetNowMs()) == 0) {
+        xWarn("[HandleSelectionRequest] %d transfers in flight. Rejecting req.", PROVIDE_SESSION_MAX);
+        Metrics_Inc(eMET_PROVIDE_REJECTED);
+        return 0;
     }
+    for (int i = 0; !Txn && i < PROVIDE_SESSION_MAX; i++) {
+        if (!ProvideSessions[i].Active) Txn = &ProvideSessions[i];
+    }
+
+    Payload->Refs++;
+    Txn->Payload = Payload;
+    Txn->Active = 1;
+    Txn->Data = Data;
+    Txn->Len = Len;
+    Txn->Offset = 0;
+    Txn->Requestor = Req->requestor;
+    Txn->Property = Property;
+    Txn->Target = Type;
+    Txn->ChunkSize = INCR_CHUNK_SIZE;
+    Txn->LastSendMs = GetNowMs();
+    Txn->DeadlineMs = Txn->LastSendMs + TRANSACTION_TIMEOUT_MS;
+
+    uint32_t EventMask[] = { XCB_EVENT_MASK_PROPERTY_CHANGE };
+    xcb_change_window_attributes(Connection, Req->requestor, XCB_CW_EVENT_MASK, EventMask);
+    uint32_t TotalSize = Len;
+    xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, Req->requestor, Property, AtomIncr, 32, 1, &TotalSize);
+    return 1;
+}
+
+/**
+ * @brief Finds an extra target of the active item by atom.
+ * @return The flavour, or NULL if the active item does not carry it.
+ */
+static sFlavour *FindActiveFlavour(xcb_atom_t Target) {
+    if (!ActiveFlavours || Target == XCB_ATOM_NONE) return NULL;
+    for (int i = 0; i < ActiveFlavours->Count; i++) {
+        if (ActiveFlavours->Items[i].Atom == Target) return &ActiveFlavours->Items[i];
+    }
+    return NULL;
 }
 
 /**
@@ -819,7 +1498,7 @@ void HandleSelectionNotify(xcb_generic_event_t *Event) {
 void HandleSelectionRequest(xcb_generic_event_t *Event) {
     xEntry1("HandleSelectionRequest");
     xcb_selection_request_event_t *Req = (xcb_selection_request_event_t *)Event;
-    
+
     xcb_selection_notify_event_t Reply;
     memset(&Reply, 0, sizeof(Reply));
     Reply.response_type = XCB_SELECTION_NOTIFY;
@@ -827,44 +1506,37 @@ void HandleSelectionRequest(xcb_generic_event_t *Event) {
     Reply.selection     = Req->selection;
     Reply.target        = Req->target;
     Reply.time          = Req->time;
-    Reply.property      = XCB_NONE; 
-    
+    Reply.property      = XCB_NONE;
+
     xcb_atom_t ValidProperty = (Req->property == XCB_NONE) ? Req->target : Req->property;
+    Metrics_Inc(eMET_PROVIDE_REQUESTS);
+
+    if (Req->target == AtomTarget) {
+        xcb_atom_t SupportedTargets[3 + FLAVOUR_MAX] = { AtomTarget, AtomTimestamp, ActiveDataType };
+        int TargetCount = 3;
+
+        /// Advertise every stored flavour, so apps can pick text/html over plain text, etc.
+        for (int i = 0; ActiveFlavours && i < ActiveFlavours->Count; i++) {
+            xcb_atom_t Atom = ActiveFlavours->Items[i].Atom;
+            if (Atom != XCB_ATOM_NONE && Atom != ActiveDataType) SupportedTargets[TargetCount++] = Atom;
+        }
 
-    if (Req->target == AtomTarget) { 
-        xcb_atom_t SupportedTargets[] = { AtomTarget, AtomTimestamp, ActiveDataType };
-        xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, Req->requestor, ValidProperty, XCB_ATOM_ATOM, 32, 3, SupportedTargets);
+        xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, Req->requestor, ValidProperty, XCB_ATOM_ATOM, 32, TargetCount, SupportedTargets);
         Reply.property = ValidProperty;
     }
     else if (Req->target == AtomTimestamp) {
-        xcb_timestamp_t CurrentTime = Req->time; 
+        xcb_timestamp_t CurrentTime = Req->time;
         xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, Req->requestor, ValidProperty, XCB_ATOM_INTEGER, 32, 1, &CurrentTime);
         Reply.property = ValidProperty;
     }
-    else if (Req->target == ActiveDataType && ActiveData != NULL) {
-        if (ActiveDataLen > INCR_CHUNK_SIZE) {
-            if (IncrRequestor != XCB_NONE) {
-                xWarn("[HandleSelectionRequest] Provider busy. Rejecting req.");
-                Reply.property = XCB_NONE;
-            } else {
-                IncrData = (uint8_t *)ActiveData; 
-                IncrDataLen = ActiveDataLen; 
-                IncrOffset = 0;
-                IncrRequestor = Req->requestor; 
-                IncrProperty = ValidProperty; 
-                IncrTarget = ActiveDataType;
-
-                uint32_t EventMask[] = { XCB_EVENT_MASK_PROPERTY_CHANGE };
-                xcb_change_window_attributes(Connection, Req->requestor, XCB_CW_EVENT_MASK, EventMask);
-                uint32_t TotalSize = ActiveDataLen;
-                xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, Req->requestor, ValidProperty, AtomIncr, 32, 1, &TotalSize);
-                
-                TransactionLock = 1; /// Lock provider transaction
-                TransactionStartMs = GetNowMs();
-                Reply.property = ValidProperty;
-            }
-        } else {
-            xcb_change_property(Connection, XCB_PROP_MODE_REPLACE, Req->requestor, ValidProperty, ActiveDataType, 8, ActiveDataLen, ActiveData);
+    else if (Req->target == ActiveDataType && ActivePayload != NULL) {
+        if (ServeSelectionPayload(Req, ValidProperty, ActivePayload, ActivePayload->Data, ActivePayload->Len, ActiveDataType)) {
+            Reply.property = ValidProperty;
+        }
+    }
+    else {
+        sFlavour *Flavour = FindActiveFlavour(Req->target);
+        if (Flavour && ServeSelectionPayload(Req, ValidProperty, ActivePayload, Flavour->Data, Flavour->Len, Req->target)) {
             Reply.property = ValidProperty;
         }
     }
@@ -872,89 +1544,186 @@ void HandleSelectionRequest(xcb_generic_event_t *Event) {
     /// @brief xcb_send_event transmits an event directly to a client.
     /// @param Propagate Mask XCB_EVENT_MASK_NO_EVENT ensures targeted delivery.
     xcb_send_event(Connection, 0, Req->requestor, XCB_EVENT_MASK_NO_EVENT, (const char *)&Reply);
-    xcb_flush(Connection);
     xExit1("HandleSelectionRequest");
 }
 
+/**************************************************************************************************
+ * THREAD RUNTIME SECTION *************************************************************************
+ **************************************************************************************************/
+
 /**
- * @brief Sends a dummy client message to unblock xcb_wait_for_event.
- * @note This is crucial for cleanly shutting down the Receiver thread which
- * would otherwise remain blocked indefinitely waiting for X11 activity.
+ * @brief Offers a history item on CLIPBOARD.
  */
-static inline void WakeUpReceiverThread(void) {
-    if (Connection && MyWindow != XCB_NONE) {
-        xcb_client_message_event_t DummyEvent;
-        memset(&DummyEvent, 0, sizeof(DummyEvent));
-        DummyEvent.response_type = XCB_CLIENT_MESSAGE;
-        DummyEvent.format = 32;
-        DummyEvent.window = MyWindow;
-        DummyEvent.type = AtomTarget; /// Attach an arbitrary valid Atom
+static void Internal_InjectItem(const sClipboardItem *Item) {
+    xcb_atom_t TargetAtom = AtomUtf8; 
+    if (Item->FileType == eFMT_IMG_PNG) TargetAtom = AtomPng;
+    else if (Item->FileType == eFMT_IMG_JGP) TargetAtom = AtomJpeg;
+    else if (Item->FileType == eFMT_IMG_BMP) TargetAtom = AtomBmp; 
+    
+    /// Re-offer the extra targets captured with the item, if any
+    sFlavourSet *Flavours = calloc(1, sizeof(sFlavourSet));
+    if (Flavours && (FlavourSet_Load(Flavours, Item->Filename) != OKE || Flavours->Count == 0)) {
+        free(Flavours);
+        Flavours = NULL;
+    }
+    for (int i = 0; Flavours && i < Flavours->Count; i++) {
+        Flavours->Items[i].Atom = GetAtomByName(Connection, Flavours->Items[i].Name);
+    }
 
-        /// @brief xcb_send_event forces the X Server to route an event directly to MyWindow
-        xcb_send_event(Connection, 0, MyWindow, XCB_EVENT_MASK_NO_EVENT, (const char *)&DummyEvent);
-        xcb_flush(Connection);
-        xLog1("[Finalize] Sent Dummy Event to wake up Receiver thread.");
+    /// Raw payloads are served straight from a read-only mapping of the stored file:
+    /// no read, no copy, no size limit. Eviction only unlinks the name, the mapping
+    /// keeps the pages alive until the last session using them ends.
+    sCodecMapping Map;
+    RetType MapRet = Codec_ItemMap(Item, &Map);
+    if (MapRet == OKE) {
+        SetClipboardItemMapped(Connection, MyWindow, &Map, TargetAtom, Flavours);
+    } else if (MapRet == ERR_UNSUPPORTED) {
+        /// Compressed on disk or a segment record: decode into a buffer sized from the payload
+        int64_t PayloadSize = Codec_ItemGetPayloadSize(Item);
+        void *RawData = (PayloadSize > 0) ? MemBudget_Alloc(PayloadSize) : NULL;
+        if (RawData && Codec_ItemRead(Item, RawData, PayloadSize) == PayloadSize) {
+            /// Ownership of RawData (and Flavours) moves to the provider: no second copy
+            SetClipboardItemOwned(Connection, MyWindow, RawData, PayloadSize, TargetAtom, Flavours);
+        } else {
+            MemBudget_Free(RawData);
+            FreeFlavourSet(Flavours);
+        }
+    } else {
+        xWarn("[Inject] Cannot open %s.", Item->Filename);
+        FreeFlavourSet(Flavours);
     }
 }
 
-/**************************************************************************************************
- * THREAD RUNTIME SECTION *************************************************************************
- **************************************************************************************************/
+/**
+ * @brief Runs one queued command.
+ * @note Event loop thread only: this is where other threads' requests touch the X connection.
+ */
+static void Loop_ExecuteCommand(const sCmd *Cmd) {
+    sClipboardItem Item;
+    int Index;
+
+    /// Pinned before the item is resolved: the compactor keeps the segment it points into until released
+    int Inject = (Cmd->Type == eCMD_INJECT_INDEX || Cmd->Type == eCMD_INJECT_NAME || Cmd->Type == eCMD_INJECT_ID);
+    const sXCBListSnapshot *Pin = Inject ? XCBList_AcquireSnapshot() : NULL;
+
+    switch (Cmd->Type) {
+        case eCMD_INJECT_INDEX:
+            /// -1: the item picked in the menu, or the newest one if nothing was picked yet
+            if (Cmd->Index >= 0 ? XCBList_GetItem(Cmd->Index, &Item) == OKE
+                                : (XCBList_GetSelectedItem(&Item) == OKE || XCBList_GetLatestItem(&Item) == OKE)) {
+                Internal_InjectItem(&Item);
+            } else {
+                xWarn("[Cmd] Inject: no item at index %d.", Cmd->Index);
+            }
+            break;
+        case eCMD_INJECT_NAME:
+            Index = XCBList_FindByName(Cmd->Name);
+            if (Index >= 0 && XCBList_GetItem(Index, &Item) == OKE) {
+                Internal_InjectItem(&Item);
+            } else {
+                xWarn("[Cmd] Inject: no item named %s.", Cmd->Name);
+            }
+            break;
+        case eCMD_INJECT_ID:
+            Index = XCBList_FindById(Cmd->Id);
+            if (Index >= 0 && XCBList_GetItem(Index, &Item) == OKE) {
+                Internal_InjectItem(&Item);
+            } else {
+                xWarn("[Cmd] Inject: item %llu left the history.", (unsigned long long)Cmd->Id);
+            }
+            break;
+        case eCMD_CLEAR:
+            XCBList_ClearAllItems();
+            break;
+        case eCMD_DELETE:
+            if (XCBList_DeleteItem(Cmd->Index) != OKE) xWarn("[Cmd] Delete: no item at index %d.", Cmd->Index);
+            break;
+        case eCMD_RELOAD:
+            XCBList_Scan(0);
+            break;
+        default:
+            xWarn("[Cmd] Unknown command %d.", (int)Cmd->Type);
+            break;
+    }
+    XCBList_ReleaseSnapshot(Pin);
+}
 
 /**
- * @brief Provider Thread: Idles at 0% CPU waiting to inject data into the Clipboard.
+ * @brief Arms the loop timer on the nearest capture/provide deadline, or disarms it.
  */
-void* XClipboardRuntime_Provider(void* Param){
-    (void)Param;
-    xEntry1("XClipboardRuntime_Provider");
-    
-    /// Wait until the Receiver thread has fully initialized the XCB Connection and Window
-    while(ReqWaitForSetup == eACTIVATE) {
-        usleep(5U * 1000U); 
+static void Loop_ArmDeadlineTimer(void) {
+    long long Next = CaptureTxn.Active ? CaptureTxn.DeadlineMs : 0;
+
+    for (int i = 0; i < PROVIDE_SESSION_MAX; i++) {
+        if (ProvideSessions[i].Active && (Next == 0 || ProvideSessions[i].DeadlineMs < Next)) Next = ProvideSessions[i].DeadlineMs;
     }
 
-    while (RequestExit != eACTIVATE) {
-        /// [BLOCK-WAIT]: Completely suspend this thread, consuming 0% CPU.
-        /// It will wake up when another thread calls sem_post(&SemProviderWakeup).
-        sem_wait(&SemProviderWakeup); 
-        
-        if (RequestExit == eACTIVATE) break;
-
-        if (ReqTestInject == eACTIVATE) {
-            ReqTestInject = eDEACTIVATE;
-            sClipboardItem LatestItem;
-            
-            if (XCBList_GetSelectedItem(&LatestItem) == OKE) {
-                xcb_atom_t TargetAtom = AtomUtf8; 
-                if (LatestItem.FileType == eFMT_IMG_PNG) TargetAtom = AtomPng;
-                else if (LatestItem.FileType == eFMT_IMG_JGP) TargetAtom = AtomJpeg;
-                else if (LatestItem.FileType == eFMT_IMG_BMP) TargetAtom = AtomBmp; 
-
-                static uint8_t RawData[8U * 1024U * 1024U]; 
-                char FullPath[PATH_MAX];
-                snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, LatestItem.Filename);
-                struct stat FileStat;
-                
-                if (stat(FullPath, &FileStat) == 0 && FileStat.st_size > 0 && (size_t)FileStat.st_size <= sizeof(RawData)) {
-                    int SelectedIdx = XCBList_GetSelectedNum();
-                    if (XCBList_ReadAsBinary(SelectedIdx, RawData, sizeof(RawData)) >= 0) {
-                        SetClipboardData(Connection, MyWindow, (void *)RawData, FileStat.st_size, TargetAtom);
-                    }
-                }
-            }
-        }
+    /// An all-zero value disarms the timer
+    struct itimerspec Spec;
+    memset(&Spec, 0, sizeof(Spec));
+    if (Next > 0) {
+        Spec.it_value.tv_sec = Next / 1000;
+        Spec.it_value.tv_nsec = (Next % 1000) * 1000000L;
+        if (Spec.it_value.tv_sec == 0 && Spec.it_value.tv_nsec == 0) Spec.it_value.tv_nsec = 1;
     }
-        
-    xExit1("XClipboardRuntime_Provider");
-    return NULL;
+    timerfd_settime(LoopTimerFd, TFD_TIMER_ABSTIME, &Spec, NULL);
+}
+
+/**
+ * @brief Aborts a stalled capture and evicts stalled outgoing sessions (loop timer expired).
+ */
+static void Loop_HandleDeadlines(void) {
+    long long Now = GetNowMs();
+
+    if (CaptureTxn.Active && Now >= CaptureTxn.DeadlineMs) {
+        xWarn("[Loop] TIMEOUT: Capture from owner %u stalled. Aborting it.", CaptureTxn.Owner);
+        CaptureTxn_Abort(&CaptureTxn);
+        Metrics_Inc(eMET_CAPTURE_TIMEOUT);
+        StartNextPendingCapture();
+    }
+
+    ProvideSession_EvictStalled(Now);
 }
 
 /**
- * @brief Receiver Thread: Blocks continuously to catch events from the X Server.
+ * @brief Routes one X11 event to its handler.
  */
-void* XClipboardRuntime_Receiver(void* Param) {
+static void Loop_DispatchXEvent(xcb_generic_event_t *Event, uint8_t XFixesEventBase) {
+    uint8_t EventType = Event->response_type & ~0x80;
+
+    if (EventType == (XFixesEventBase + XCB_XFIXES_SELECTION_NOTIFY)) {
+        HandleXFixesNotify(Event);
+    }
+    else if (EventType == XCB_SELECTION_NOTIFY) {
+        HandleSelectionNotify(Event);
+    }
+    else if (EventType == XCB_SELECTION_REQUEST) {
+        HandleSelectionRequest(Event);
+    }
+    else if (EventType == XCB_PROPERTY_NOTIFY) {
+        HandlePropertyNotify(Event);
+    }
+}
+
+/**
+ * @brief Adds a file descriptor to the loop's epoll set.
+ */
+static RetType Loop_Watch(int Fd, enum eLoopSource Source) {
+    struct epoll_event Ev;
+    memset(&Ev, 0, sizeof(Ev));
+    Ev.events = EPOLLIN;
+    Ev.data.u32 = Source;
+    return (epoll_ctl(LoopEpollFd, EPOLL_CTL_ADD, Fd, &Ev) == 0) ? OKE : ERR;
+}
+
+/**
+ * @brief Event loop thread: one epoll set over the X connection, signals, wakeups and deadlines.
+ * @note Sleeps until something happens (no periodic wakeups), drains every queued X event per
+ *       wakeup and flushes the connection once before sleeping again.
+ */
+void* XClipboardRuntime_Loop(void* Param) {
     (void)Param; 
-    xEntry1("XClipboardRuntime_Receiver");
+    xEntry1("XClipboardRuntime_Loop");
 
     Connection = xcb_connect(NULL, NULL);
     if (xcb_connection_has_error(Connection)) return NULL;
@@ -964,6 +1733,7 @@ void* XClipboardRuntime_Receiver(void* Param) {
     uint8_t XFixesEventBase = xfixes_data->first_event;
 
     InitAtoms(Connection);
+    InitRequestLimit(Connection);
     MyWindow = CreateListenerWindow(Connection);
     SubscribeClipboardEvents(Connection, MyWindow);
 
@@ -972,45 +1742,85 @@ void* XClipboardRuntime_Receiver(void* Param) {
         exit(-1);
     }
 
-    /// Signal the Provider thread that X11 setup is complete
-    ReqWaitForSetup = eDEACTIVATE; 
-    xLog1("[XClipboardRuntime_Receiver] Setup Done. Listening for events...");
+    if (Loop_Watch(xcb_get_file_descriptor(Connection), eLOOP_SRC_X) != OKE ||
+        Loop_Watch(LoopSignalFd, eLOOP_SRC_SIGNAL) != OKE ||
+        Loop_Watch(LoopWakeFd, eLOOP_SRC_WAKE) != OKE ||
+        Loop_Watch(LoopTimerFd, eLOOP_SRC_TIMER) != OKE) {
+        xError("[XClipboardRuntime_Loop] epoll_ctl failed: %s", strerror(errno));
+        RequestExit = eACTIVATE;
+        KickEventFd(UiWakeFd);
+    }
+
+    xLog1("[XClipboardRuntime_Loop] Setup Done. Listening for events...");
 
     xcb_generic_event_t *Event;
+    struct epoll_event Ready[4];
 
     while (RequestExit != eACTIVATE) {
-        
-        /// [BLOCK-WAIT]: Suspend execution here until an Event (or the exit Dummy Event) arrives
-        Event = xcb_wait_for_event(Connection);
-        if (Event == NULL) {
-            if (xcb_connection_has_error(Connection)) {
-                xError("[XClipboardRuntime_Receiver] Connection has an error!");
-                break;
-            }
-            continue;
+        /// Drain everything already received, including events queued while waiting for replies
+        while ((Event = xcb_poll_for_event(Connection)) != NULL) {
+            Loop_DispatchXEvent(Event, XFixesEventBase);
+            free(Event);
         }
-
-        uint8_t EventType = Event->response_type & ~0x80;
-
-        if (EventType == (XFixesEventBase + XCB_XFIXES_SELECTION_NOTIFY)) {
-            HandleXFixesNotify(Event);
+        if (xcb_connection_has_error(Connection)) {
+            xError("[XClipboardRuntime_Loop] Connection has an error!");
+            RequestExit = eACTIVATE;
+            KickEventFd(UiWakeFd);
+            break;
         }
-        else if (EventType == XCB_SELECTION_NOTIFY) {
-            HandleSelectionNotify(Event);
+
+        /// Run every queued command, one by one and in order (bursts are never merged)
+        sCmd Cmd;
+        while (CmdQueue_Pop(&Cmd) == OKE) {
+            Loop_ExecuteCommand(&Cmd);
         }
-        else if (EventType == XCB_SELECTION_REQUEST) {
-            HandleSelectionRequest(Event);
+
+        Loop_ArmDeadlineTimer();
+        xcb_flush(Connection);
+
+        /// Commands waiting on replies (and the flush itself) may have pulled events off the socket
+        /// into xcb's queue: epoll would never report them, so go back to the drain instead of sleeping.
+        if ((Event = xcb_poll_for_queued_event(Connection)) != NULL) {
+            Loop_DispatchXEvent(Event, XFixesEventBase);
+            free(Event);
+            continue;
         }
-        else if (EventType == XCB_PROPERTY_NOTIFY) {
-            HandlePropertyNotify(Event);
+
+        /// [BLOCK-WAIT]: Suspend until the X server, a signal, a wakeup or a deadline needs us
+        int Count = epoll_wait(LoopEpollFd, Ready, (int)(sizeof(Ready) / sizeof(Ready[0])), -1);
+        if (Count < 0) {
+            if (errno == EINTR) continue;
+            xError("[XClipboardRuntime_Loop] epoll_wait failed: %s", strerror(errno));
+            break;
         }
-        /// Note: Dummy events (XCB_CLIENT_MESSAGE) used for waking up the thread are safely ignored here.
 
-        free(Event);
+        for (int i = 0; i < Count; i++) {
+            uint64_t Ticks;
+            struct signalfd_siginfo Info;
+
+            switch (Ready[i].data.u32) {
+                case eLOOP_SRC_SIGNAL:
+                    while (read(LoopSignalFd, &Info, sizeof(Info)) == (ssize_t)sizeof(Info)) {
+                        xLog1("[XClipboardRuntime_Loop] Signal %u received.", Info.ssi_signo);
+                        DispatchSignal((int)Info.ssi_signo);
+                    }
+                    break;
+                case eLOOP_SRC_WAKE:
+                    while (read(LoopWakeFd, &Ticks, sizeof(Ticks)) == (ssize_t)sizeof(Ticks)) {}
+                    break;
+                case eLOOP_SRC_TIMER:
+                    while (read(LoopTimerFd, &Ticks, sizeof(Ticks)) == (ssize_t)sizeof(Ticks)) {}
+                    Loop_HandleDeadlines();
+                    break;
+                default:
+                    /// eLOOP_SRC_X: drained at the top of the loop
+                    break;
+            }
+        }
     }
 
     xcb_disconnect(Connection);
-    xExit1("XClipboardRuntime_Receiver");
+    xExit1("XClipboardRuntime_Loop");
     return NULL;
 }
 
@@ -1018,62 +1828,121 @@ void* XClipboardRuntime_Receiver(void* Param) {
  * LIFECYCLE SECTION IMPLEMENTATION ***************************************************************
  **************************************************************************************************/ 
 
+/**
+ * @brief Closes a file descriptor owned by the event loop and marks it unused.
+ */
+static void CloseLoopFd(int *Fd) {
+    if (*Fd >= 0) close(*Fd);
+    *Fd = -1;
+}
+
 void ClipboardCaptureFinalize(void) {
     xLog1("[Finalize] Initiating shutdown sequence...");
     
     /// 1. Raise the exit flag for the entire system
     RequestExit = eACTIVATE;
 
-    /// 2. Wake up the Signal Thread (if it is suspended in pause())
-    int SigKillStatus = pthread_kill(SignalRuntimeThread, SIGINT);
-    if (SigKillStatus == 0) {
-        pthread_join(SignalRuntimeThread, NULL);
+    /// 2. Wake up the event loop (via eventfd) and wait for it, unless we are running on it
+    if (LoopThreadStarted && !pthread_equal(pthread_self(), XClipboardRuntimeThread_Loop)) {
+        KickEventFd(LoopWakeFd);
+        pthread_join(XClipboardRuntimeThread_Loop, NULL);
+        LoopThreadStarted = 0;
+        xLog1("[Finalize] Event loop joined.");
     }
 
-    /// 3. Wake up the Provider Thread (via Semaphore)
-    sem_post(&SemProviderWakeup);
-    pthread_join(XClipboardRuntimeThread_Provider, NULL);
-    xLog1("[Finalize] Provider Thread joined.");
+    /// 3. Drain pending captures to disk and stop the writer thread
+    CaptureSink_Stop();
+    xLog1("[Finalize] Capture sink drained.");
+
+    /// The sink was the last writer of the segment store: stop the compactor
+    Segment_Stop();
 
-    /// 4. Wake up the Receiver Thread (via Dummy X11 Event)
-    WakeUpReceiverThread();
-    pthread_join(XClipboardRuntimeThread_Receiver, NULL);
-    xLog1("[Finalize] Receiver Thread joined.");
+    /// ... and the last producer of thumbnail requests and index updates
+    Thumb_Stop();
+    Search_Stop();
+
+    /// 4. Write the last metrics snapshot and stop the exporter
+    Metrics_Stop();
     
-    if (ActiveData != NULL) {
-        free(ActiveData);
-        ActiveData = NULL;
-    }
-    if (IncrRecvBuf) { 
-        free(IncrRecvBuf); 
-        IncrRecvBuf = NULL; 
+    for (int i = 0; i < PROVIDE_SESSION_MAX; i++) {
+        if (ProvideSessions[i].Active) ProvideSession_Release(&ProvideSessions[i]);
     }
+    ProvidePayload_Unref(ActivePayload);
+    ActivePayload = NULL;
+    ActiveData = NULL;
+    ActiveFlavours = NULL;
+
+#if (PICKER_ENABLED)
+    /// The picker runs on this (UI) thread and has returned by now
+    Picker_Close();
+#endif /*(PICKER_ENABLED)*/
     
-    /// Cleanup the Semaphore resource
-    sem_destroy(&SemProviderWakeup);
+    /// Release the loop resources
+    CloseLoopFd(&LoopEpollFd);
+    CloseLoopFd(&LoopSignalFd);
+    CloseLoopFd(&LoopWakeFd);
+    CloseLoopFd(&LoopTimerFd);
+    CloseLoopFd(&UiWakeFd);
 }
 
 RetType ClipboardCaptureInitialize(void) {
     atexit(ClipboardCaptureFinalize);
 
     if (EnsureDB() != OKE) return ERR;
-    if (XCBList_Scan(0) < 0) return ERR;
 
-    /// Initialize the Semaphore (pshared = 0, initial_value = 0 to start in a blocking state)
-    sem_init(&SemProviderWakeup, 0, 0);
+    /// Size the history before loading it, so a larger capacity keeps every journaled item
+    const char *HistoryItems = getenv(ENV_HISTORY_ITEMS);
+    long Capacity = HistoryItems ? strtol(HistoryItems, NULL, 10) : MAX_HISTORY_ITEMS;
+    if (Capacity < 1 || Capacity > INT_MAX / 2) {
+        xWarn("[Init] Ignoring %s=%s, keeping %d items.", ENV_HISTORY_ITEMS, HistoryItems, MAX_HISTORY_ITEMS);
+        Capacity = MAX_HISTORY_ITEMS;
+    }
+    if (XCBList_SetCapacity((int)Capacity) != OKE) return ERR;
+    if (XCBList_Load() < 0) return ERR;
+
+    CmdQueue_Init();
+
+    /// Signals are consumed through a signalfd: block them before any thread exists
+    if (RegisterSignal() != OKE) return ERR;
+
+    LoopEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    LoopWakeFd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    LoopTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    UiWakeFd    = eventfd(0, EFD_CLOEXEC);
+    if (LoopEpollFd < 0 || LoopWakeFd < 0 || LoopTimerFd < 0 || UiWakeFd < 0) {
+        xError("[Initialize] FATAL: Failed to create the event loop descriptors!");
+        return ERR;
+    }
+
+    /// Without the segment store every capture simply gets its own file
+    if (Segment_Start() != OKE) {
+        xWarn("[Initialize] Segment store unavailable.");
+    }
+
+    /// Thumbnails are best effort: menus fall back to the full-size images
+    if (Thumb_Start() != OKE) {
+        xWarn("[Initialize] Thumbnail worker unavailable.");
+    }
+
+    /// Only does anything for the built-in picker, whose queries would otherwise read every text item back
+    if (Search_Start() != OKE) {
+        xWarn("[Initialize] Search indexing thread unavailable.");
+    }
 
-    IncrRecvBuf = malloc(MAX_RAM_CACHE);
-    if (!IncrRecvBuf) {
-        xError("[Initialize] FATAL: Out of memory for 128MB RAM Cache!");
+    if (CaptureSink_Start() != OKE) {
+        xError("[Initialize] FATAL: Failed to start the capture sink!");
         return ERR;
     }
 
-    /// Spawn the three independent application threads
-    if (pthread_create(&SignalRuntimeThread, NULL, (void *(*)(void *))SignalRuntime, NULL) != 0) return ERR;
-    if (pthread_create(&XClipboardRuntimeThread_Provider, NULL, (void *(*)(void *))XClipboardRuntime_Provider, NULL) != 0) return ERR;
-    if (pthread_create(&XClipboardRuntimeThread_Receiver, NULL, (void *(*)(void *))XClipboardRuntime_Receiver, NULL) != 0) return ERR;
+    /// Metrics are best effort: the daemon runs without the stats file if the exporter fails
+    if (Metrics_Start() != OKE) {
+        xWarn("[Initialize] Metrics exporter unavailable.");
+    }
 
-    xLog1("[Initialize] Started. Threads Online. 128MB RAM Cache Online.");
+    if (pthread_create(&XClipboardRuntimeThread_Loop, NULL, XClipboardRuntime_Loop, NULL) != 0) return ERR;
+    LoopThreadStarted = 1;
+
+    xLog1("[Initialize] Started. Event loop Online. Capture sink Online.");
     return OKE;
 }
 
@@ -1083,65 +1952,43 @@ RetType ClipboardCaptureInitialize(void) {
 
 #if (ROFI_SUPPORT == 1)
 
-    #ifndef PREVIEW_TXT_LEN
-        #define PREVIEW_TXT_LEN 80
-    #endif /*PREVIEW_TXT_LEN*/
-
     /**
-     * @brief Reads file content and writes a formatted Rofi menu item directly to the temp file.
-     * @param OutFile The temporary file stream (/tmp/cbc_rofi.txt).
+     * @brief Writes a formatted Rofi menu item to the stdin pipe of the Rofi process.
+     * @param OutFile The stdin stream of the Rofi process.
      * @param Index The logical index of the clipboard item.
      * @param Item Pointer to the clipboard item data structure.
      * @return OKE on success.
-     * @note Unprintable characters and newlines are sanitized to prevent Rofi parsing crashes.
+     * @note Text items use the preview stored with their metadata (already sanitized, see CBC_Preview.h).
      */
     RetType WriteRofiMenuItem(FILE *OutFile, int Index, sClipboardItem *Item) {
         char FullPath[PATH_MAX];
         snprintf(FullPath, sizeof(FullPath), "%s/%s", PATH_DIR_DB, Item->Filename);
 
-        if (Item->FileType == eFMT_IMG_PNG || Item->FileType == eFMT_IMG_JGP) {
-            /// For images: No preview text, just print "[Image]" and pass the path as Thumbnail
+        if (Item->FileType == eFMT_IMG_PNG || Item->FileType == eFMT_IMG_JGP || Item->FileType == eFMT_IMG_BMP) {
+            /// For images: No preview text, just print "[Image]" and pass the cached thumbnail as icon.
+            /// Rofi would otherwise decode every full-size image; only those without one yet fall back.
+            char IconPath[PATH_MAX];
+            const char *Icon = Thumb_Lookup(Item->Filename, Item->FileType, IconPath, sizeof(IconPath)) ? IconPath : FullPath;
             fprintf(OutFile, "%d: [Image] %s%cicon\x1f%s\n", 
-                    Index, Item->Filename, '\0', FullPath);
+                    Index, Item->Filename, '\0', Icon);
         } 
         else {
-            /// For text: Read file content to generate a preview string
-            FILE *fp = fopen(FullPath, "rb");
-            char Preview[PREVIEW_TXT_LEN + 1];
-            memset(Preview, 0, sizeof(Preview));
-            
-            if (fp) {
-                /// Read up to PREVIEW_TXT_LEN characters
-                size_t ReadBytes = fread(Preview, 1, PREVIEW_TXT_LEN, fp);
-                fclose(fp);
-                
-                /// Safely null-terminate the string
-                Preview[ReadBytes] = '\0';
-                
-                /// [CRITICAL STEP]: Sanitize the string!
-                /// Replace newlines/tabs with space.
-                /// Replace unprintable/control characters with '?' to prevent Rofi from crashing.
-                for (size_t i = 0; i < ReadBytes; i++) {
-                    if (Preview[i] == '\n' || Preview[i] == '\r' || Preview[i] == '\t') {
-                        Preview[i] = ' '; 
-                    } 
-                    /// Filter out standard ASCII control characters (0-31), except we already handled \n, \r, \t
-                    else if ((unsigned char)Preview[i] < 32 || Preview[i] == 127) {
-                        Preview[i] = '?';
-                    }
-                }
-                
-                /// If the text is longer than the allowed limit, append "[...]"
-                if (ReadBytes == PREVIEW_TXT_LEN) {
-                    Preview[PREVIEW_TXT_LEN - 5] = '[';
-                    Preview[PREVIEW_TXT_LEN - 4] = '.';
-                    Preview[PREVIEW_TXT_LEN - 3] = '.';
-                    Preview[PREVIEW_TXT_LEN - 2] = '.';
-                    Preview[PREVIEW_TXT_LEN - 1] = ']';
-                }
-                
+            /// For text: the sanitized preview was built once at capture time, no payload I/O here.
+            /// Only items pushed without one (legacy XCBList_PushItem callers) read their head.
+            sClipboardItem Rebuilt;
+            const sClipboardItem *Src = Item;
+            if (Item->Preview[0] == '\0' && Item->Lines == 0) {
+                Rebuilt = *Item;
+                Src = (Preview_FromStore(&Rebuilt) == OKE) ? &Rebuilt : NULL;
+            }
+
+            if (Src && Src->Lines > 1) {
+                fprintf(OutFile, "%d: %s (%u lines)%cicon\x1ftext-x-generic\n",
+                        Index, Src->Preview, Src->Lines, '\0');
+            }
+            else if (Src) {
                 fprintf(OutFile, "%d: %s%cicon\x1ftext-x-generic\n", 
-                        Index, Preview, '\0');
+                        Index, Src->Preview, '\0');
             } 
             else {
                 /// Fallback in case the file is missing or deleted
@@ -1157,56 +2004,98 @@ RetType ClipboardCaptureInitialize(void) {
      */
     void ShowRofiMenu(void) {
         xEntry1("ShowRofiMenu");
-        
-        /// 1. Create a temporary file to hold the menu items
-        FILE *tmp = fopen(PATH_FILE_ROFI_MENU, "w");
-        if (!tmp) {
-            xError("[UI] Failed to create temp file for Rofi.");
+
+        /// 1. Take one consistent snapshot of the list: captures landing meanwhile neither
+        ///    wait for us nor shift the indices we print
+        const sXCBListSnapshot *Snap = XCBList_AcquireSnapshot();
+        if (!Snap) return;
+
+        /// 2. Start Rofi directly (no shell, no temp file) with its stdin and stdout on pipes
+        int InPipe[2], OutPipe[2];
+        if (pipe2(InPipe, O_CLOEXEC) != 0) {
+            xError("[UI] pipe2 failed: %s", strerror(errno));
+            XCBList_ReleaseSnapshot(Snap);
+            return;
+        }
+        if (pipe2(OutPipe, O_CLOEXEC) != 0) {
+            xError("[UI] pipe2 failed: %s", strerror(errno));
+            close(InPipe[0]);
+            close(InPipe[1]);
+            XCBList_ReleaseSnapshot(Snap);
+            return;
+        }
+
+        posix_spawn_file_actions_t Actions;
+        posix_spawn_file_actions_init(&Actions);
+        posix_spawn_file_actions_adddup2(&Actions, InPipe[0], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&Actions, OutPipe[1], STDOUT_FILENO);
+
+        /// Rofi would inherit our blocked signals and ignored SIGPIPE: give it a clean slate
+        posix_spawnattr_t Attr;
+        sigset_t NoSignals, DefaultSignals = LoopSignalSet;
+        sigemptyset(&NoSignals);
+        sigaddset(&DefaultSignals, SIGPIPE);
+        posix_spawnattr_init(&Attr);
+        posix_spawnattr_setsigmask(&Attr, &NoSignals);
+        posix_spawnattr_setsigdefault(&Attr, &DefaultSignals);
+        posix_spawnattr_setflags(&Attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+        char *RofiArgv[] = { "rofi", "-dmenu", "-i", "-show-icons", "-p", "X11 Clipboard", NULL };
+        pid_t RofiPid;
+        int SpawnErr = posix_spawnp(&RofiPid, RofiArgv[0], &Actions, &Attr, RofiArgv, environ);
+        posix_spawn_file_actions_destroy(&Actions);
+        posix_spawnattr_destroy(&Attr);
+        close(InPipe[0]);
+        close(OutPipe[1]);
+
+        FILE *RofiIn = (SpawnErr == 0) ? fdopen(InPipe[1], "w") : NULL;
+        FILE *RofiOut = (SpawnErr == 0) ? fdopen(OutPipe[0], "r") : NULL;
+        if (!RofiIn || !RofiOut) {
+            xError("[UI] Failed to execute Rofi: %s", strerror(SpawnErr ? SpawnErr : errno));
+            if (RofiIn) fclose(RofiIn); else close(InPipe[1]);
+            if (RofiOut) fclose(RofiOut); else close(OutPipe[0]);
+            if (SpawnErr == 0) while (waitpid(RofiPid, NULL, 0) < 0 && errno == EINTR) {}
+            XCBList_ReleaseSnapshot(Snap);
             return;
         }
 
-        /// 2. Dump the current RAM list into the text file
-        int size = XCBList_GetItemSize();
-        for (int i = 0; i < size; i++) {
+        /// 3. Stream the entries, newest first: Rofi draws while we are still writing.
+        ///    If the user picks early, Rofi exits and the rest is dropped (EPIPE, SIGPIPE is ignored).
+        int size = Snap->Count;
+        for (int i = 0; i < size && !ferror(RofiIn); i++) {
             sClipboardItem item;
-            if (XCBList_GetItem(i, &item) == OKE) {
-                WriteRofiMenuItem(tmp, i, &item);
+            if (XCBList_SnapshotGetItem(Snap, i, &item) == OKE) {
+                WriteRofiMenuItem(RofiIn, i, &item);
             }
         }
 
         /// [NEW OPTION]: Append "Clear All History" at the end of the list
         /// We use the index equal to 'size' as a special signal
-        fprintf(tmp, "%d: --- CLEAR ALL HISTORY ---%cicon\x1f" "edit-clear-all\n", size, '\0');
+        fprintf(RofiIn, "%d: --- CLEAR ALL HISTORY ---%cicon\x1f" "edit-clear-all\n", size, '\0');
 
-        fclose(tmp);
-
-        /// 3. Execute Rofi
-        static char RofiCmd[512]; 
-        snprintf(RofiCmd, sizeof(RofiCmd), "rofi -dmenu -i -show-icons -p 'X11 Clipboard' < %s", PATH_FILE_ROFI_MENU);
-        FILE *rofi = popen(RofiCmd, "r");
-        
-        if (!rofi) {
-            xError("[UI] Failed to execute Rofi.");
-            return;
-        }
+        /// Closing stdin tells Rofi the list is complete
+        fclose(RofiIn);
 
+        /// 4. Read the selection back from Rofi's stdout
         char result[256];
-        if (fgets(result, sizeof(result), rofi) != NULL) {
+        if (fgets(result, sizeof(result), RofiOut) != NULL) {
             int selected_index = -1;
             if (sscanf(result, "%d:", &selected_index) == 1) {
                 
-                /// 4. Logic Handling based on index
+                /// 5. Logic Handling based on index
                 if (selected_index == size) {
                     /// User selected "CLEAR ALL HISTORY"
                     xLog1("[UI] User requested to CLEAR ALL HISTORY.");
-                    XCBList_ClearAllItems();
+                    sCmd Cmd = { .Type = eCMD_CLEAR };
+                    if (ClipboardCaptureSubmit(&Cmd) != OKE) xWarn("[Rofi] Command queue full. Clear dropped.");
                 } 
-                else {
-                    /// User selected a normal item
-                    xLog1("[UI] User selected index: %d", selected_index);
-                    if (XCBList_SetSelectedNum(selected_index) == OKE) {
-                        ReqTestInject = eACTIVATE;
-                        sem_post(&SemProviderWakeup);
+                else if (selected_index >= 0 && selected_index < size) {
+                    /// User selected a normal item: resolve it by id, the list may have moved since the snapshot
+                    uint64_t Id = XCBList_SnapshotRow(Snap, selected_index)->Id;
+                    xLog1("[UI] User selected index: %d (id %llu)", selected_index, (unsigned long long)Id);
+                    if (XCBList_SetSelectedNum(XCBList_FindById(Id)) == OKE) {
+                        sCmd Cmd = { .Type = eCMD_INJECT_ID, .Id = Id };
+                        if (ClipboardCaptureSubmit(&Cmd) != OKE) xWarn("[Rofi] Command queue full. Selection dropped.");
                     }
                 }
             }
@@ -1214,7 +2103,9 @@ RetType ClipboardCaptureInitialize(void) {
             xLog1("[UI] User cancelled Rofi (pressed ESC).");
         }
 
-        pclose(rofi);
+        fclose(RofiOut);
+        while (waitpid(RofiPid, NULL, 0) < 0 && errno == EINTR) {}
+        XCBList_ReleaseSnapshot(Snap);
         xExit1("ShowRofiMenu");
     }
 
@@ -3,6 +3,9 @@
 
 #include "CBC_Setup.h"
 #include "CBC_SysFile.h"
+#include "CBC_Flavour.h"
+#include "CBC_Codec.h"
+#include "CBC_CmdQueue.h"
 
 /**************************************************************************************************
  * ENUMERATIONS SECTION ***************************************************************************
@@ -84,6 +87,11 @@ extern size_t                   ActiveDataLen;
  */
 extern xcb_atom_t               ActiveDataType;
 
+/**
+ * @brief Extra targets (text/html, ...) offered alongside the active data, or NULL.
+ */
+extern sFlavourSet             *ActiveFlavours;
+
 /* --- X11 Core --- */
 
 /**
@@ -126,11 +134,6 @@ extern volatile sig_atomic_t TogglePopUpStatus;
  */
 extern volatile sig_atomic_t RequestExit;
 
-/**
- * @brief Flag to trigger the injection of the selected clipboard item into the active window.
- */
-extern volatile sig_atomic_t ReqTestInject;
-
 /**************************************************************************************************
  * X11 SERVER SECTION PROTOTYPES ******************************************************************
  **************************************************************************************************/ 
@@ -150,6 +153,14 @@ xcb_atom_t GetAtomByName(xcb_connection_t *c, const char *name);
  */
 void InitAtoms(xcb_connection_t *c);
 
+/**
+ * @brief Queries the server's maximum request length (BIG-REQUESTS aware) and sizes provider writes from it.
+ * @param c Connection to the X server.
+ * @note Payloads up to the resulting limit are served single-shot; larger ones use INCR chunks that
+ *       start at INCR_CHUNK_SIZE and grow or shrink with the requestor's turnaround.
+ */
+void InitRequestLimit(xcb_connection_t *c);
+
 /**
  * @brief Creates a hidden dummy window to receive XFixes events.
  * @param c Connection to the X server.
@@ -168,6 +179,9 @@ void SubscribeClipboardEvents(xcb_connection_t *c, xcb_window_t window);
  * CLIPBOARD PROVIDER SECTION PROTOTYPES **********************************************************
  **************************************************************************************************/ 
 
+/// The SetClipboard* functions below touch the X connection and the active item without locks:
+/// call them on the event loop thread only. Other threads go through ClipboardCaptureSubmit().
+
 /**
  * @brief Loads data into memory and claims ownership of the X11 Clipboard.
  * @param c Connection to the X server.
@@ -179,40 +193,86 @@ void SubscribeClipboardEvents(xcb_connection_t *c, xcb_window_t window);
  */
 void SetClipboardData(xcb_connection_t *c, xcb_window_t win, void *data, size_t len, xcb_atom_t type);
 
+/**
+ * @brief Same as SetClipboardData() but adopts the buffer instead of copying it.
+ * @param c Connection to the X server.
+ * @param win Our listener window ID.
+ * @param data Buffer obtained from MemBudget_Alloc(). Ownership passes to the provider (freed on failure).
+ * @param len Length of the data in bytes.
+ * @param type The format of the data (e.g., AtomUtf8, AtomPng).
+ */
+void SetClipboardDataOwned(xcb_connection_t *c, xcb_window_t win, void *data, size_t len, xcb_atom_t type);
+
+/**
+ * @brief Same as SetClipboardDataOwned() but also offers extra targets next to the primary one.
+ * @param c Connection to the X server.
+ * @param win Our listener window ID.
+ * @param data Buffer obtained from MemBudget_Alloc(). Ownership passes to the provider (freed on failure).
+ * @param len Length of the data in bytes.
+ * @param type The format of the primary data (e.g., AtomUtf8, AtomPng).
+ * @param flavours Heap-allocated set with resolved atoms, or NULL. Ownership passes to the provider.
+ */
+void SetClipboardItemOwned(xcb_connection_t *c, xcb_window_t win, void *data, size_t len, xcb_atom_t type, sFlavourSet *flavours);
+
+/**
+ * @brief Same as SetClipboardItemOwned() but serves a stored file straight from its mapping (zero-copy).
+ * @param c Connection to the X server.
+ * @param win Our listener window ID.
+ * @param map View obtained from Codec_MapFile(). Ownership passes to the provider (cleared on return).
+ * @param type The format of the primary data (e.g., AtomUtf8, AtomPng).
+ * @param flavours Heap-allocated set with resolved atoms, or NULL. Ownership passes to the provider.
+ * @note The view stays mapped while any requestor is still streaming it, even if the item is evicted.
+ */
+void SetClipboardItemMapped(xcb_connection_t *c, xcb_window_t win, sCodecMapping *map, xcb_atom_t type, sFlavourSet *flavours);
+
 /**************************************************************************************************
  * SIGNAL HANDLER SECTION PROTOTYPES **************************************************************
  **************************************************************************************************/ 
 
 /**
- * @brief Asynchronous handler called directly by the Linux Kernel when a signal arrives.
+ * @brief Fallback handler for signals delivered while they are unblocked (e.g., while Rofi is spawned).
  * @param SigNum The ID of the received POSIX signal (e.g., SIGINT, SIGUSR1).
- * @note Avoid calling non-reentrant functions (like printf/malloc) inside this handler.
+ * @note Only raises flags and writes eventfds, both async-signal-safe.
  */
 void SignalEventHandler(int SigNum);
 
 /**
- * @brief Registers the application's signal handlers with the Operating System.
- * @return OKE on success.
+ * @brief Blocks SIGUSR1/SIGUSR2/SIGINT/SIGTERM and routes them to the event loop through a signalfd.
+ * @return OKE on success, ERR if the signalfd cannot be created.
+ * @note Must run before any thread is spawned so that every thread inherits the blocked mask.
  */
 RetType RegisterSignal(void);
 
-/**
- * @brief The main loop for the Signal Thread. It idles and waits for OS signals.
- * @param Param Optional parameter passed when the thread starts (can be 0 or NULL).
- * @return OKE when the thread exits cleanly.
- */
-RetType SignalRuntime(int Param);
-
 /**************************************************************************************************
  * CLIPBOARD RUNTIME SECTION PROTOTYPES ***********************************************************
  **************************************************************************************************/ 
 
 /**
- * @brief The main blocking loop of the application handling X11 events and data fetching.
- * @param Param Optional parameter passed when the thread starts.
- * @return OKE upon successful termination.
+ * @brief Event loop thread: waits on one epoll set for X11 events, signals, wakeups and deadlines.
+ * @param Param Unused.
+ * @return NULL when the loop exits.
+ */
+void* XClipboardRuntime_Loop(void* Param);
+
+/**
+ * @brief Queues a command (inject, delete, clear, reload) for the event loop and wakes it.
+ * @param Cmd The command, copied into the queue.
+ * @return OKE if queued, ERR_BUSY if CMD_QUEUE_DEPTH commands are already waiting.
+ * @note Lock-free and async-signal-safe: callable from any thread and from signal handlers.
+ */
+RetType ClipboardCaptureSubmit(const sCmd *Cmd);
+
+/**
+ * @brief Blocks the calling (UI) thread until a popup or exit request arrives.
+ */
+void ClipboardCaptureWaitUiRequest(void);
+
+/**
+ * @brief Returns the eventfd that becomes readable on a popup toggle or exit request.
+ * @note For UI code that sleeps on its own descriptors (the built-in picker polls it next to its
+ *       X connection). Reading it consumes the wakeup; the flags tell what was requested.
  */
-RetType XClipboardRuntime(int Param);
+int ClipboardCaptureGetUiFd(void);
 
 /**************************************************************************************************
  * LIFECYCLE SECTION PROTOTYPES *******************************************************************
@@ -225,7 +285,7 @@ RetType XClipboardRuntime(int Param);
 void ClipboardCaptureFinalize(void);
 
 /**
- * @brief Initializes directories, starts the Signal Thread, and prepares the X11 environment.
+ * @brief Initializes directories, routes signals to a signalfd, and starts the event loop and capture sink.
  * @return OKE on success, ERR on initialization failure.
  */
 RetType ClipboardCaptureInitialize(void);
@@ -237,18 +297,20 @@ RetType ClipboardCaptureInitialize(void);
 #if (ROFI_SUPPORT == 1)
 
 /**
- * @brief Reads file content and writes a formatted Rofi menu item directly to the temp file.
- * @param OutFile The temporary file stream (/tmp/cbc_rofi.txt).
+ * @brief Writes a formatted Rofi menu item to the stdin pipe of the Rofi process.
+ * @param OutFile The stdin stream of the Rofi process.
  * @param Index The logical index of the clipboard item.
  * @param Item Pointer to the clipboard item data.
  * @return OKE on success.
- * @note Newlines and unprintable characters are sanitized to prevent Rofi parsing errors.
+ * @note Text items show the preview stored at capture time (sanitized once, no payload I/O).
  */
 RetType WriteRofiMenuItem(FILE *OutFile, int Index, sClipboardItem *Item);
 
 /**
  * @brief Calls the Rofi dmenu interface to let the user select a clipboard item.
- * @note This function blocks the caller thread until the user makes a selection or presses ESC.
+ * @note Rofi is spawned without a shell; entries are streamed to its stdin over a pipe and the
+ *       selection is read from its stdout. Blocks the caller thread until the user makes a
+ *       selection or presses ESC.
  */
 void ShowRofiMenu(void);
 
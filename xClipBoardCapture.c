@@ -2,13 +2,14 @@
 #define XLOG_LEVEL  0
 #include <xUniversal.h>
 #include "ClipboardCapture.h"
+#include "CBC_Picker.h"
 
 /// @brief Main entry point. Initializes systems and runs the UI event loop.
 /// @param argc Argument count.
 /// @param argv Argument vector.
 /// @return 0 on success, -1 on initialization failure.
 int main(int argc, char *argv[]) {
-    /// 1. Initialize background threads (Signal + X11)
+    /// 1. Initialize background threads (event loop + capture sink)
     if (ClipboardCaptureInitialize() != OKE) {
         return -1;
     }
@@ -18,16 +19,20 @@ int main(int argc, char *argv[]) {
     /// 2. Main UI Event Loop
     while (RequestExit != eACTIVATE) {
         
-        /// Check if the Signal Thread requested the popup menu (via SIGUSR1)
+        /// Check if the event loop requested the popup menu (via SIGUSR1)
         if (TogglePopUpStatus == eREQ_SHOW) {
+#if (ROFI_SUPPORT == 1)
             ShowRofiMenu();
+#elif (PICKER_ENABLED)
+            Picker_Show();
+#endif
             
             /// Reset the popup status to hidden after the menu closes
             TogglePopUpStatus = eHIDEN;
         }
-        
-        /// Sleep 10ms to prevent 100% CPU usage while idling
-        usleep(10000); 
+
+        /// Sleep until SIGUSR1 or an exit request (no periodic wakeups)
+        ClipboardCaptureWaitUiRequest();
     }
 
     xLog1("[Main] Exit signal detected. Cleaning up...");